@@ -107,8 +107,36 @@ static const char *WARN_INVALID_COUNTER_ALARM =
 #define XSyncCAAllTrigger \
     (XSyncCACounter | XSyncCAValueType | XSyncCAValue | XSyncCATestType)
 
+/*  Besides pTriglist, a counter keeps its triggers in sorted arrays, one
+ *  per test type, ordered by test value.  A counter change then only has
+ *  to look at the triggers whose threshold lies between the old and the
+ *  new value, and the bracket values of system counters come from binary
+ *  searches instead of a walk over every trigger.  Triggers with any
+ *  other CheckTrigger land in SYNC_INDEX_OTHER; as long as a counter has
+ *  some of those, it falls back to walking pTriglist.
+ */
+enum {
+    SYNC_INDEX_POSITIVE_COMPARISON,
+    SYNC_INDEX_NEGATIVE_COMPARISON,
+    SYNC_INDEX_POSITIVE_TRANSITION,
+    SYNC_INDEX_NEGATIVE_TRANSITION,
+    SYNC_INDEX_OTHER,
+    SYNC_INDEX_TYPES
+};
+
+typedef struct _SyncTriggerIndex {
+    SyncTrigger **triggers[SYNC_INDEX_TYPES];
+    int num[SYNC_INDEX_TYPES];
+    int size[SYNC_INDEX_TYPES];
+    unsigned int removed;       /* bumped when a trigger leaves the counter */
+} SyncTriggerIndex;
+
 static void SyncComputeBracketValues(SyncCounter *);
 
+static void SyncIndexInsert(SyncCounter *, SyncTrigger *);
+
+static Bool SyncIndexRemove(SyncCounter *, SyncTrigger *);
+
 static void SyncInitServerTime(void);
 
 static void SyncInitIdleTime(void);
@@ -173,6 +201,9 @@ SyncDeleteTriggerFromSyncObject(SyncTrigger * pTrigger)
     if (SYNC_COUNTER == pTrigger->pSync->type) {
         pCounter = (SyncCounter *) pTrigger->pSync;
 
+        if (SyncIndexRemove(pCounter, pTrigger))
+            pCounter->pIndex->removed++;
+
         if (IsSystemCounter(pCounter))
             SyncComputeBracketValues(pCounter);
     }
@@ -208,6 +239,8 @@ SyncAddTriggerToSyncObject(SyncTrigger * pTrigger)
     if (SYNC_COUNTER == pTrigger->pSync->type) {
         pCounter = (SyncCounter *) pTrigger->pSync;
 
+        SyncIndexInsert(pCounter, pTrigger);
+
         if (IsSystemCounter(pCounter))
             SyncComputeBracketValues(pCounter);
     }
@@ -309,6 +342,263 @@ SyncCheckTriggerFence(SyncTrigger * pTrigger, int64_t unused)
     return (pFence == NULL || pFence->funcs.CheckTriggered(pFence));
 }
 
+static int
+SyncIndexType(SyncTrigger * pTrigger)
+{
+    if (pTrigger->CheckTrigger == SyncCheckTriggerPositiveComparison)
+        return SYNC_INDEX_POSITIVE_COMPARISON;
+    if (pTrigger->CheckTrigger == SyncCheckTriggerNegativeComparison)
+        return SYNC_INDEX_NEGATIVE_COMPARISON;
+    if (pTrigger->CheckTrigger == SyncCheckTriggerPositiveTransition)
+        return SYNC_INDEX_POSITIVE_TRANSITION;
+    if (pTrigger->CheckTrigger == SyncCheckTriggerNegativeTransition)
+        return SYNC_INDEX_NEGATIVE_TRANSITION;
+    return SYNC_INDEX_OTHER;
+}
+
+/* Position of the first trigger with a test value >= value, or > value
+ * if 'after' is set.
+ */
+static int
+SyncIndexBound(SyncTriggerIndex * pIndex, int type, int64_t value, Bool after)
+{
+    SyncTrigger **triggers = pIndex->triggers[type];
+    int lo = 0, hi = pIndex->num[type];
+
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+
+        if (triggers[mid]->test_value < value ||
+            (after && triggers[mid]->test_value == value))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void
+SyncIndexInsert(SyncCounter * pCounter, SyncTrigger * pTrigger)
+{
+    SyncTriggerIndex *pIndex = pCounter->pIndex;
+    int type = SyncIndexType(pTrigger);
+    int pos;
+
+    /* Failure is not an option here either */
+    if (!pIndex)
+        pIndex = pCounter->pIndex = XNFcallocarray(1, sizeof(SyncTriggerIndex));
+
+    if (pIndex->num[type] == pIndex->size[type]) {
+        pIndex->size[type] = pIndex->size[type] ? pIndex->size[type] * 2 : 4;
+        pIndex->triggers[type] = XNFreallocarray(pIndex->triggers[type],
+                                                 pIndex->size[type],
+                                                 sizeof(SyncTrigger *));
+    }
+
+    if (type == SYNC_INDEX_OTHER)
+        pos = pIndex->num[type];
+    else
+        pos = SyncIndexBound(pIndex, type, pTrigger->test_value, TRUE);
+
+    memmove(&pIndex->triggers[type][pos + 1], &pIndex->triggers[type][pos],
+            (pIndex->num[type] - pos) * sizeof(SyncTrigger *));
+    pIndex->triggers[type][pos] = pTrigger;
+    pIndex->num[type]++;
+}
+
+static void
+SyncIndexDrop(SyncTriggerIndex * pIndex, int type, int pos)
+{
+    pIndex->num[type]--;
+    memmove(&pIndex->triggers[type][pos], &pIndex->triggers[type][pos + 1],
+            (pIndex->num[type] - pos) * sizeof(SyncTrigger *));
+}
+
+/* Returns FALSE if pTrigger was not in the index */
+static Bool
+SyncIndexRemove(SyncCounter * pCounter, SyncTrigger * pTrigger)
+{
+    SyncTriggerIndex *pIndex = pCounter->pIndex;
+    int type, pos;
+
+    if (!pIndex)
+        return FALSE;
+
+    /* Where it should be... */
+    type = SyncIndexType(pTrigger);
+    if (type != SYNC_INDEX_OTHER) {
+        for (pos = SyncIndexBound(pIndex, type, pTrigger->test_value, FALSE);
+             pos < pIndex->num[type] &&
+             pIndex->triggers[type][pos]->test_value == pTrigger->test_value;
+             pos++) {
+            if (pIndex->triggers[type][pos] == pTrigger) {
+                SyncIndexDrop(pIndex, type, pos);
+                return TRUE;
+            }
+        }
+    }
+
+    /* ...or anywhere, if its type or test value changed under us */
+    for (type = 0; type < SYNC_INDEX_TYPES; type++) {
+        for (pos = 0; pos < pIndex->num[type]; pos++) {
+            if (pIndex->triggers[type][pos] == pTrigger) {
+                SyncIndexDrop(pIndex, type, pos);
+                return TRUE;
+            }
+        }
+    }
+    return FALSE;
+}
+
+static void
+SyncIndexFree(SyncCounter * pCounter)
+{
+    int type;
+
+    if (!pCounter->pIndex)
+        return;
+    for (type = 0; type < SYNC_INDEX_TYPES; type++)
+        free(pCounter->pIndex->triggers[type]);
+    free(pCounter->pIndex);
+    pCounter->pIndex = NULL;
+}
+
+/* Give a trigger on a counter a new test value, keeping the index sorted */
+static void
+SyncSetTestValue(SyncTrigger * pTrigger, int64_t test_value)
+{
+    SyncCounter *pCounter = NULL;
+
+    if (pTrigger->pSync && SYNC_COUNTER == pTrigger->pSync->type &&
+        SyncIndexRemove((SyncCounter *) pTrigger->pSync, pTrigger))
+        pCounter = (SyncCounter *) pTrigger->pSync;
+
+    pTrigger->test_value = test_value;
+
+    if (pCounter)
+        SyncIndexInsert(pCounter, pTrigger);
+}
+
+/*  Fire the triggers of pCounter which became true when it changed from
+ *  oldval.  Returns FALSE if a fired trigger took others off the counter,
+ *  the caller then has to walk the full trigger list for the rest.
+ */
+static Bool
+SyncIndexFire(SyncCounter * pCounter, int64_t oldval)
+{
+    SyncTriggerIndex *pIndex = pCounter->pIndex;
+    int64_t newval = pCounter->value;
+    SyncTrigger *stack[32], **fire = stack;
+    int first[SYNC_INDEX_OTHER], last[SYNC_INDEX_OTHER];
+    int type, i, n = 0;
+    unsigned int removed;
+    Bool done = TRUE;
+
+    first[SYNC_INDEX_POSITIVE_COMPARISON] = 0;
+    last[SYNC_INDEX_POSITIVE_COMPARISON] =
+        SyncIndexBound(pIndex, SYNC_INDEX_POSITIVE_COMPARISON, newval, TRUE);
+
+    first[SYNC_INDEX_NEGATIVE_COMPARISON] =
+        SyncIndexBound(pIndex, SYNC_INDEX_NEGATIVE_COMPARISON, newval, FALSE);
+    last[SYNC_INDEX_NEGATIVE_COMPARISON] =
+        pIndex->num[SYNC_INDEX_NEGATIVE_COMPARISON];
+
+    /* oldval < test_value <= newval */
+    first[SYNC_INDEX_POSITIVE_TRANSITION] = last[SYNC_INDEX_POSITIVE_TRANSITION] = 0;
+    if (newval > oldval) {
+        first[SYNC_INDEX_POSITIVE_TRANSITION] =
+            SyncIndexBound(pIndex, SYNC_INDEX_POSITIVE_TRANSITION, oldval, TRUE);
+        last[SYNC_INDEX_POSITIVE_TRANSITION] =
+            SyncIndexBound(pIndex, SYNC_INDEX_POSITIVE_TRANSITION, newval, TRUE);
+    }
+
+    /* newval <= test_value < oldval */
+    first[SYNC_INDEX_NEGATIVE_TRANSITION] = last[SYNC_INDEX_NEGATIVE_TRANSITION] = 0;
+    if (newval < oldval) {
+        first[SYNC_INDEX_NEGATIVE_TRANSITION] =
+            SyncIndexBound(pIndex, SYNC_INDEX_NEGATIVE_TRANSITION, newval, FALSE);
+        last[SYNC_INDEX_NEGATIVE_TRANSITION] =
+            SyncIndexBound(pIndex, SYNC_INDEX_NEGATIVE_TRANSITION, oldval, FALSE);
+    }
+
+    for (type = 0; type < SYNC_INDEX_OTHER; type++)
+        n += last[type] - first[type];
+    if (n == 0)
+        return TRUE;
+
+    /* firing reorders the index (alarms move on), so work on a copy */
+    if (n > (int) ARRAY_SIZE(stack))
+        fire = XNFreallocarray(NULL, n, sizeof(SyncTrigger *));
+    for (n = 0, type = 0; type < SYNC_INDEX_OTHER; type++)
+        for (i = first[type]; i < last[type]; i++)
+            fire[n++] = pIndex->triggers[type][i];
+
+    removed = pIndex->removed;
+    for (i = 0; i < n; i++) {
+        /* an Await which fired frees its sibling triggers */
+        if (pIndex->removed != removed) {
+            done = FALSE;
+            break;
+        }
+        if ((*fire[i]->CheckTrigger) (fire[i], oldval))
+            (*fire[i]->TriggerFired) (fire[i]);
+    }
+
+    if (fire != stack)
+        free(fire);
+    return done;
+}
+
+/* The bracket values of a system counter from the index, see
+ * SyncComputeBracketValues() for what each test type contributes.
+ */
+static void
+SyncIndexBracketValues(SyncCounter * pCounter, SyncCounterType ct,
+                       int64_t **pnewltval, int64_t **pnewgtval)
+{
+    SyncTriggerIndex *pIndex = pCounter->pIndex;
+    SysCounterInfo *psci = pCounter->pSysCounterInfo;
+    int64_t value = pCounter->value;
+    int type, less, greater;
+
+    for (type = 0; type < SYNC_INDEX_OTHER; type++) {
+        switch (type) {
+        case SYNC_INDEX_POSITIVE_COMPARISON:
+        case SYNC_INDEX_NEGATIVE_COMPARISON:
+            if (ct == (type == SYNC_INDEX_POSITIVE_COMPARISON ?
+                       XSyncCounterNeverIncreases : XSyncCounterNeverDecreases))
+                continue;
+            /* nothing for a test value equal to the counter */
+            greater = SyncIndexBound(pIndex, type, value, TRUE);
+            less = SyncIndexBound(pIndex, type, value, FALSE) - 1;
+            break;
+        case SYNC_INDEX_NEGATIVE_TRANSITION:
+            if (ct == XSyncCounterNeverIncreases)
+                continue;
+            greater = SyncIndexBound(pIndex, type, value, TRUE);
+            less = greater - 1;
+            break;
+        default:
+            if (ct == XSyncCounterNeverDecreases)
+                continue;
+            greater = SyncIndexBound(pIndex, type, value, FALSE);
+            less = greater - 1;
+            break;
+        }
+
+        if (greater < pIndex->num[type] &&
+            pIndex->triggers[type][greater]->test_value < psci->bracket_greater) {
+            psci->bracket_greater = pIndex->triggers[type][greater]->test_value;
+            *pnewgtval = &psci->bracket_greater;
+        }
+        if (less >= 0 &&
+            pIndex->triggers[type][less]->test_value > psci->bracket_less) {
+            psci->bracket_less = pIndex->triggers[type][less]->test_value;
+            *pnewltval = &psci->bracket_less;
+        }
+    }
+}
+
 static inline Bool
 checked_int64_add(int64_t *out, int64_t a, int64_t b)
 {
@@ -339,8 +629,8 @@ checked_int64_subtract(int64_t *out, int64_t a, int64_t b)
 }
 
 static int
-SyncInitTrigger(ClientPtr client, SyncTrigger * pTrigger, XID syncObject,
-                RESTYPE resType, Mask changes)
+SyncSetupTrigger(ClientPtr client, SyncTrigger * pTrigger, XID syncObject,
+                 RESTYPE resType, Mask changes)
 {
     SyncObject *pSync = pTrigger->pSync;
     SyncCounter *pCounter = NULL;
@@ -445,6 +735,31 @@ SyncInitTrigger(ClientPtr client, SyncTrigger * pTrigger, XID syncObject,
     return Success;
 }
 
+/*  The test type and value of the trigger may change even if this fails
+ *  half way, so take it out of its counter's index while it is being set
+ *  up, and put it back in its new place if it is still on the counter.
+ */
+static int
+SyncInitTrigger(ClientPtr client, SyncTrigger * pTrigger, XID syncObject,
+                RESTYPE resType, Mask changes)
+{
+    SyncCounter *pCounter = NULL;
+    int rc;
+
+    if (pTrigger->pSync && SYNC_COUNTER == pTrigger->pSync->type &&
+        SyncIndexRemove((SyncCounter *) pTrigger->pSync, pTrigger))
+        pCounter = (SyncCounter *) pTrigger->pSync;
+
+    rc = SyncSetupTrigger(client, pTrigger, syncObject, resType, changes);
+
+    if (pCounter && pTrigger->pSync == &pCounter->sync) {
+        SyncIndexInsert(pCounter, pTrigger);
+        if (IsSystemCounter(pCounter))
+            SyncComputeBracketValues(pCounter);
+    }
+    return rc;
+}
+
 /*  AlarmNotify events happen in response to actions taken on an Alarm or
  *  the counter used by the alarm.  AlarmNotify may be sent to multiple
  *  clients.  The alarm maintains a list of clients interested in events.
@@ -628,7 +943,7 @@ SyncAlarmTriggerFired(SyncTrigger * pTrigger)
      *  events, give the trigger its new test value.
      */
     SyncSendAlarmNotifyEvents(pAlarm);
-    pTrigger->test_value = new_test_value;
+    SyncSetTestValue(pTrigger, new_test_value);
 }
 
 /*  This function is called when an Await unblocks, either as a result
@@ -745,6 +1060,11 @@ SyncChangeCounter(SyncCounter * pCounter, int64_t newval)
 
     oldval = SyncUpdateCounter(pCounter, newval);
 
+    /* only look at the triggers between the old and the new value */
+    if (pCounter->pIndex && !pCounter->pIndex->num[SYNC_INDEX_OTHER] &&
+        SyncIndexFire(pCounter, oldval))
+        goto done;
+
     /* run through triggers to see if any become true */
     for (ptl = pCounter->sync.pTriglist; ptl; ptl = pnext) {
         pnext = ptl->next;
@@ -773,6 +1093,7 @@ SyncChangeCounter(SyncCounter * pCounter, int64_t newval)
         }
     }
 
+ done:
     if (IsSystemCounter(pCounter)) {
         SyncComputeBracketValues(pCounter);
     }
@@ -1101,6 +1422,11 @@ SyncComputeBracketValues(SyncCounter * pCounter)
     psci->bracket_greater = LLONG_MAX;
     psci->bracket_less = LLONG_MIN;
 
+    if (pCounter->pIndex && !pCounter->pIndex->num[SYNC_INDEX_OTHER]) {
+        SyncIndexBracketValues(pCounter, ct, &pnewltval, &pnewgtval);
+        goto done;
+    }
+
     for (pCur = pCounter->sync.pTriglist; pCur; pCur = pCur->next) {
         pTrigger = pCur->pTrigger;
 
@@ -1169,6 +1495,7 @@ SyncComputeBracketValues(SyncCounter * pCounter)
         }
     }                           /* end for each trigger */
 
+ done:
     (*psci->BracketValues) ((void *) pCounter, pnewltval, pnewgtval);
 
 }
@@ -1229,6 +1556,7 @@ FreeCounter(void *env, XID id)
         }
     }
 
+    SyncIndexFree(pCounter);
     free(pCounter);
     return Success;
 }
@@ -44,6 +44,8 @@
 #include <dix-config.h>
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 
 #include "dix/resource_priv.h"
 #include "os/bug_priv.h"
@@ -201,6 +203,7 @@ compRedirectWindow(ClientPtr pClient, WindowPtr pWin, int update)
         cw->damageRegistered = FALSE;
         cw->damaged = FALSE;
         cw->pOldPixmap = NullPixmap;
+        cw->pClassPixmap = NullPixmap;
         dixSetPrivate(&pWin->devPrivates, CompWindowPrivateKey, cw);
     }
     ccw->next = cw->clients;
@@ -536,19 +539,230 @@ compGetBackgroundState(WindowPtr pWin)
     return pWin->backgroundState;
 }
 
+/*
+ * Backing pixmap pool.
+ *
+ * Every resize of a redirected window allocates a new backing pixmap,
+ * copies the old contents over and frees the old one.  When backing
+ * pixmaps are plain memory, allocate them rounded up to a size class
+ * and trim the header to the window size; the old pixmap freed by a
+ * resize goes back to a small per-screen pool, where the next resize
+ * usually finds one big enough.  An interactive resize then just swaps
+ * two pixmaps back and forth until the window outgrows the size class.
+ *
+ * Pooled pixmaps still hold the old window contents, so they are only
+ * handed back to the window which released them.
+ */
+
+/* Round up to a multiple of 1/8 to 1/4 of the size, at least 32 */
+static int
+compPoolClassSize(int v)
+{
+    int step = 32;
+
+    while (step * 8 <= v)
+        step <<= 1;
+    return (v + step - 1) & ~(step - 1);
+}
+
+static void
+compPoolRemove(CompScreenPtr cs, int i)
+{
+    cs->numPooled--;
+    memmove(&cs->pool[i], &cs->pool[i + 1],
+            (cs->numPooled - i) * sizeof(cs->pool[0]));
+}
+
+static CARD32
+compPoolExpire(OsTimerPtr timer, CARD32 now, void *arg)
+{
+    ScreenPtr pScreen = arg;
+    CompScreenPtr cs = GetCompScreen(pScreen);
+
+    /* the pool is ordered oldest first */
+    while (cs->numPooled) {
+        CARD32 age = now - cs->pool[0].time;
+
+        if (age < COMP_POOL_EXPIRE)
+            return COMP_POOL_EXPIRE - age;
+        dixDestroyPixmap(cs->pool[0].pPixmap, 0);
+        compPoolRemove(cs, 0);
+        cs->poolStats.expired++;
+    }
+    return 0;
+}
+
+void
+compFreePixmapPool(ScreenPtr pScreen)
+{
+    CompScreenPtr cs = GetCompScreen(pScreen);
+
+    TimerFree(cs->poolTimer);
+    cs->poolTimer = NULL;
+    while (cs->numPooled) {
+        dixDestroyPixmap(cs->pool[0].pPixmap, 0);
+        compPoolRemove(cs, 0);
+    }
+}
+
+static PixmapPtr
+compPoolTake(ScreenPtr pScreen, XID owner, int w, int h, int depth,
+             int *class_w, int *class_h)
+{
+    CompScreenPtr cs = GetCompScreen(pScreen);
+    int64_t limit = (int64_t) 2 * compPoolClassSize(w) * compPoolClassSize(h);
+    int64_t best_area = 0;
+    int best = -1;
+    PixmapPtr pPixmap;
+
+    for (int i = 0; i < cs->numPooled; i++) {
+        CompPooledPixmapRec *pooled = &cs->pool[i];
+        int64_t area = (int64_t) pooled->width * pooled->height;
+
+        if (pooled->owner != owner ||
+            pooled->pPixmap->drawable.depth != depth ||
+            pooled->width < w || pooled->height < h || area > limit)
+            continue;
+        if (best < 0 || area < best_area) {
+            best = i;
+            best_area = area;
+        }
+    }
+    if (best < 0)
+        return NULL;
+
+    pPixmap = cs->pool[best].pPixmap;
+    *class_w = cs->pool[best].width;
+    *class_h = cs->pool[best].height;
+    compPoolRemove(cs, best);
+
+    (*pScreen->ModifyPixmapHeader) (pPixmap, w, h, 0, 0, 0, NULL);
+    cs->poolStats.reused++;
+    return pPixmap;
+}
+
+/*
+ * Allocate a backing pixmap, from the pool if possible.  *class_w and
+ * *class_h are set to the allocated size when the pixmap may go back
+ * to the pool, or to zero.
+ */
+static PixmapPtr
+compCreateBackingPixmap(WindowPtr pWin, int w, int h,
+                        int *class_w, int *class_h)
+{
+    ScreenPtr pScreen = pWin->drawable.pScreen;
+    CompScreenPtr cs = GetCompScreen(pScreen);
+    int depth = pWin->drawable.depth;
+    PixmapPtr pPixmap;
+    int cw, ch;
+
+    *class_w = *class_h = 0;
+
+    /* Trimming the header only works when nobody interprets it */
+    if (pScreen->ModifyPixmapHeader != miModifyPixmapHeader)
+        cs->poolState = CompPoolDisabled;
+
+    if (cs->poolState == CompPoolDisabled)
+        return (*pScreen->CreatePixmap) (pScreen, w, h, depth,
+                                         CREATE_PIXMAP_USAGE_BACKING_PIXMAP);
+
+    pPixmap = compPoolTake(pScreen, pWin->drawable.id, w, h, depth,
+                           class_w, class_h);
+    if (pPixmap)
+        return pPixmap;
+
+    cw = compPoolClassSize(w);
+    ch = compPoolClassSize(h);
+    pPixmap = (*pScreen->CreatePixmap) (pScreen, cw, ch, depth,
+                                        CREATE_PIXMAP_USAGE_BACKING_PIXMAP);
+    if (!pPixmap)
+        return NULL;
+
+    if (cs->poolState == CompPoolUnknown) {
+        /* accelerated pixmaps keep their storage elsewhere */
+        cs->poolState = pPixmap->devPrivate.ptr ? CompPoolEnabled :
+            CompPoolDisabled;
+        if (cs->poolState == CompPoolDisabled) {
+            dixDestroyPixmap(pPixmap, 0);
+            return (*pScreen->CreatePixmap) (pScreen, w, h, depth,
+                                             CREATE_PIXMAP_USAGE_BACKING_PIXMAP);
+        }
+    }
+
+    (*pScreen->ModifyPixmapHeader) (pPixmap, w, h, 0, 0, 0, NULL);
+    cs->poolStats.allocated++;
+    *class_w = cw;
+    *class_h = ch;
+    return pPixmap;
+}
+
+/*
+ * Free a backing pixmap no longer used by pWin, keeping it in the pool
+ * if it was allocated from a size class and nobody else holds it.
+ */
+void
+compReleasePixmap(WindowPtr pWin, PixmapPtr pPixmap, int width, int height)
+{
+    ScreenPtr pScreen = pWin->drawable.pScreen;
+    CompScreenPtr cs = GetCompScreen(pScreen);
+
+    if (!width || !height || pPixmap->refcnt != 1 ||
+        cs->poolState != CompPoolEnabled) {
+        dixDestroyPixmap(pPixmap, 0);
+        return;
+    }
+
+    if (cs->numPooled == COMP_POOL_SIZE) {
+        dixDestroyPixmap(cs->pool[0].pPixmap, 0);
+        compPoolRemove(cs, 0);
+        cs->poolStats.expired++;
+    }
+
+    cs->pool[cs->numPooled].pPixmap = pPixmap;
+    cs->pool[cs->numPooled].owner = pWin->drawable.id;
+    cs->pool[cs->numPooled].width = width;
+    cs->pool[cs->numPooled].height = height;
+    cs->pool[cs->numPooled].time = GetTimeInMillis();
+    cs->numPooled++;
+    cs->poolStats.released++;
+
+    if (cs->numPooled == 1)
+        cs->poolTimer = TimerSet(cs->poolTimer, 0, COMP_POOL_EXPIRE,
+                                 compPoolExpire, pScreen);
+}
+
+void
+CompositeGetPixmapPoolStats(ScreenPtr pScreen,
+                            CompositePixmapPoolStatsPtr pStats)
+{
+    CompScreenPtr cs = NULL;
+
+    if (dixPrivateKeyRegistered(CompScreenPrivateKey))
+        cs = GetCompScreen(pScreen);
+    if (cs)
+        *pStats = cs->poolStats;
+    else
+        memset(pStats, 0, sizeof(*pStats));
+}
+
 static PixmapPtr
 compNewPixmap(WindowPtr pWin, int x, int y, int w, int h)
 {
     ScreenPtr pScreen = pWin->drawable.pScreen;
     WindowPtr pParent = pWin->parent;
+    CompWindowPtr cw = GetCompWindow(pWin);
     PixmapPtr pPixmap;
+    int class_w, class_h;
 
-    pPixmap = (*pScreen->CreatePixmap) (pScreen, w, h, pWin->drawable.depth,
-                                        CREATE_PIXMAP_USAGE_BACKING_PIXMAP);
+    pPixmap = compCreateBackingPixmap(pWin, w, h, &class_w, &class_h);
 
     if (!pPixmap)
         return 0;
 
+    cw->pClassPixmap = class_w ? pPixmap : NullPixmap;
+    cw->classWidth = class_w;
+    cw->classHeight = class_h;
+
     pPixmap->screen_x = x;
     pPixmap->screen_y = y;
 
@@ -702,10 +916,20 @@ compReallocPixmap(WindowPtr pWin, int draw_x, int draw_y,
     pix_w = w + (bw << 1);
     pix_h = h + (bw << 1);
     if (pix_w != pOld->drawable.width || pix_h != pOld->drawable.height) {
+        PixmapPtr pOldClass = cw->pClassPixmap;
+        int old_w = cw->classWidth, old_h = cw->classHeight;
+
         pNew = compNewPixmap(pWin, pix_x, pix_y, pix_w, pix_h);
         if (!pNew)
             return FALSE;
         cw->pOldPixmap = pOld;
+        if (pOld == pOldClass) {
+            cw->oldClassWidth = old_w;
+            cw->oldClassHeight = old_h;
+        }
+        else {
+            cw->oldClassWidth = cw->oldClassHeight = 0;
+        }
         compSetPixmap(pWin, pNew, bw);
     }
     else {
@@ -62,6 +62,7 @@ static void compCloseScreen(CallbackListPtr *pcbl, ScreenPtr pScreen, void *unus
 {
     CompScreenPtr cs = GetCompScreen(pScreen);
 
+    compFreePixmapPool(pScreen);
     free(cs->alternateVisuals);
     free(cs->implicitRedirectExceptions);
 
@@ -91,6 +91,10 @@ typedef struct _CompWindow {
     int oldy;
     PixmapPtr pOldPixmap;
     int borderClipX, borderClipY;
+    /* backing pixmaps allocated from a size class, see compalloc.c */
+    PixmapPtr pClassPixmap;
+    int classWidth, classHeight;
+    int oldClassWidth, oldClassHeight;
 } CompWindowRec, *CompWindowPtr;
 
 #define COMP_ORIGIN_INVALID	    0x80000000
@@ -118,6 +122,22 @@ typedef struct _CompImplicitRedirectException {
     XID winVisual;
 } CompImplicitRedirectException;
 
+#define COMP_POOL_SIZE          8
+#define COMP_POOL_EXPIRE        1000    /* ms an idle pooled pixmap is kept */
+
+typedef struct _CompPooledPixmap {
+    PixmapPtr pPixmap;
+    XID owner;                  /* window it was released by */
+    int width, height;          /* allocated size, >= the drawable size */
+    CARD32 time;                /* when it was released */
+} CompPooledPixmapRec;
+
+typedef enum {
+    CompPoolUnknown,
+    CompPoolEnabled,
+    CompPoolDisabled,
+} CompPoolState;
+
 typedef struct _CompScreen {
     CopyWindowProcPtr CopyWindow;
     CreateWindowProcPtr CreateWindow;
@@ -160,6 +180,16 @@ typedef struct _CompScreen {
     CompOverlayClientPtr pOverlayClients;
 
     SourceValidateProcPtr SourceValidate;
+
+    /*
+     * Backing pixmaps released by window resizes, kept briefly for
+     * reuse by the next resize
+     */
+    CompPoolState poolState;
+    int numPooled;
+    CompPooledPixmapRec pool[COMP_POOL_SIZE];
+    OsTimerPtr poolTimer;
+    CompositePixmapPoolStatsRec poolStats;
 } CompScreenRec, *CompScreenPtr;
 
 extern DevPrivateKeyRec CompScreenPrivateKeyRec;
@@ -228,6 +258,12 @@ compReallocPixmap(WindowPtr pWin, int x, int y,
 
 void compMarkAncestors(WindowPtr pWin);
 
+void
+ compReleasePixmap(WindowPtr pWin, PixmapPtr pPixmap, int width, int height);
+
+void
+ compFreePixmapPool(ScreenPtr pScreen);
+
 /*
  * compinit.c
  */
@@ -370,7 +370,8 @@ compFreeOldPixmap(WindowPtr pWin)
         CompWindowPtr cw = GetCompWindow(pWin);
 
         if (cw->pOldPixmap) {
-            dixDestroyPixmap(cw->pOldPixmap, 0);
+            compReleasePixmap(pWin, cw->pOldPixmap,
+                              cw->oldClassWidth, cw->oldClassHeight);
             cw->pOldPixmap = NullPixmap;
         }
     }
@@ -621,6 +622,14 @@ compSetRedirectBorderClip(WindowPtr pWin, RegionPtr pRegion)
     RegionTranslate(&cw->borderClip,
                     pWin->drawable.x - cw->borderClipX,
                     pWin->drawable.y - cw->borderClipY);
+    cw->borderClipX = pWin->drawable.x;
+    cw->borderClipY = pWin->drawable.y;
+    /*
+     * Windows revalidated because a sibling moved usually keep their
+     * border clip; nothing to repaint or copy then
+     */
+    if (RegionEqual(&cw->borderClip, pRegion))
+        return;
     /*
      * Compute newly visible portion of window for repaint
      */
@@ -634,8 +643,6 @@ compSetRedirectBorderClip(WindowPtr pWin, RegionPtr pRegion)
      * Save the new border clip region
      */
     RegionCopy(&cw->borderClip, pRegion);
-    cw->borderClipX = pWin->drawable.x;
-    cw->borderClipY = pWin->drawable.y;
 }
 
 RegionPtr
@@ -1338,6 +1338,7 @@ ProcQueryFont(ClientPtr client)
 {
     xQueryFontReply *reply;
     FontPtr pFont;
+    int rlength;
     int rc;
 
     REQUEST(xResourceReq);
@@ -1350,40 +1351,27 @@ ProcQueryFont(ClientPtr client)
     if (rc != Success)
         return rc;
 
-    {
-        xCharInfo *pmax = FONTINKMAX(pFont);
-        xCharInfo *pmin = FONTINKMIN(pFont);
-        int nprotoxcistructs;
-        int rlength;
-
-        nprotoxcistructs = (pmax->rightSideBearing == pmin->rightSideBearing &&
-                            pmax->leftSideBearing == pmin->leftSideBearing &&
-                            pmax->descent == pmin->descent &&
-                            pmax->ascent == pmin->ascent &&
-                            pmax->characterWidth == pmin->characterWidth) ?
-            0 : N2dChars(pFont);
-
-        rlength = sizeof(xQueryFontReply) +
-            FONTINFONPROPS(FONTCHARSET(pFont)) * sizeof(xFontProp) +
-            nprotoxcistructs * sizeof(xCharInfo);
-        reply = calloc(1, rlength);
-        if (!reply) {
-            return BadAlloc;
-        }
-
-        reply->type = X_Reply;
-        reply->length = bytes_to_int32(rlength - sizeof(xGenericReply));
-        reply->sequenceNumber = client->sequence;
-        QueryFont(pFont, reply, nprotoxcistructs);
+    reply = QueryFontCached(pFont, &rlength);
+    if (!reply)
+        return BadAlloc;
 
-        if (client->swapped) {
-            SwapFont(reply, TRUE);
-        }
+    /* the reply is kept with the font, swap a copy */
+    if (client->swapped) {
+        xQueryFontReply *swapped = malloc(rlength);
 
+        if (!swapped)
+            return BadAlloc;
+        memcpy(swapped, reply, rlength);
+        swapped->sequenceNumber = client->sequence;
+        SwapFont(swapped, TRUE);
+        WriteToClient(client, rlength, swapped);
+        free(swapped);
+    }
+    else {
+        reply->sequenceNumber = client->sequence;
         WriteToClient(client, rlength, reply);
-        free(reply);
-        return Success;
     }
+    return Success;
 }
 
 int
@@ -281,6 +281,7 @@ int CoreKeyboardProc(DeviceIntPtr dev, int what);
 
 typedef struct _xQueryFontReply *xQueryFontReplyPtr;
 void QueryFont(FontPtr pFont, xQueryFontReplyPtr pReply, int nProtoCCIStructs);
+xQueryFontReplyPtr QueryFontCached(FontPtr pFont, int *rlength);
 
 extern Bool whiteRoot;
 
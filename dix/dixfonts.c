@@ -203,13 +203,158 @@ LoadGlyphs(ClientPtr client, FontPtr pfont, unsigned nchars, int item_size,
         return Successful;
 }
 
+/*
+ * Core text asks the font backend for the same few hundred glyphs over
+ * and over, and QueryFont walks all metrics of the font every time.  Both
+ * results only change when the font does, so they are kept with the font
+ * until it is closed: the glyph of each 8-bit character, the glyphs of
+ * the first GLYPH_CACHE_ROWS rows of a 16-bit font used, and the
+ * QueryFont reply.
+ *
+ * Backends which load glyphs on demand (the font server) hand out
+ * different glyphs before and after loading, their glyphs aren't cached.
+ */
+#define GLYPH_CACHE_ROWS        32
+
+typedef struct _FontCache {
+    int encoding8;              /* FontEncoding, -1 until first used */
+    int encoding16;
+    int nrows;
+    CharInfoPtr glyphs8[256];
+    CharInfoPtr *rows[256];
+    xQueryFontReply *reply;
+    int replyLength;
+} FontCacheRec, *FontCachePtr;
+
+/* cached for characters the font doesn't have and has no default for */
+static CharInfoRec noGlyph;
+
+static int fontCacheIndex = -1;
+
+static struct {
+    unsigned long glyphHits;
+    unsigned long glyphMisses;
+    unsigned long replyHits;
+    unsigned long replyMisses;
+    unsigned long listHits;
+    unsigned long listMisses;
+} fontCacheStats;
+
+static FontCachePtr
+GetFontCache(FontPtr font)
+{
+    FontCachePtr cache;
+
+    if (fontCacheIndex < 0)
+        return NULL;
+
+    cache = FontGetPrivate(font, fontCacheIndex);
+    if (!cache) {
+        cache = calloc(1, sizeof(FontCacheRec));
+        if (!cache)
+            return NULL;
+        cache->encoding8 = cache->encoding16 = -1;
+        if (!xfont2_font_set_private(font, fontCacheIndex, cache)) {
+            free(cache);
+            return NULL;
+        }
+    }
+    return cache;
+}
+
+static void
+FreeFontCache(FontPtr font)
+{
+    FontCachePtr cache;
+    int i;
+
+    if (fontCacheIndex < 0)
+        return;
+    cache = FontGetPrivate(font, fontCacheIndex);
+    if (!cache)
+        return;
+
+    for (i = 0; i < 256; i++)
+        free(cache->rows[i]);
+    free(cache->reply);
+    free(cache);
+    xfont2_font_set_private(font, fontCacheIndex, NULL);
+}
+
+/* Returns the slot caching the glyph of chars, or NULL if there is none */
+static CharInfoPtr *
+FontCacheSlot(FontCachePtr cache, unsigned char *chars,
+              FontEncoding fontEncoding)
+{
+    switch (fontEncoding) {
+    case Linear8Bit:
+    case TwoD8Bit:
+        if (cache->encoding8 != (int) fontEncoding) {
+            if (cache->encoding8 != -1)
+                return NULL;
+            cache->encoding8 = fontEncoding;
+        }
+        return &cache->glyphs8[chars[0]];
+    case Linear16Bit:
+    case TwoD16Bit:
+        if (cache->encoding16 != (int) fontEncoding) {
+            if (cache->encoding16 != -1)
+                return NULL;
+            cache->encoding16 = fontEncoding;
+        }
+        if (!cache->rows[chars[0]]) {
+            if (cache->nrows == GLYPH_CACHE_ROWS)
+                return NULL;
+            cache->rows[chars[0]] = calloc(256, sizeof(CharInfoPtr));
+            if (!cache->rows[chars[0]])
+                return NULL;
+            cache->nrows++;
+        }
+        return &cache->rows[chars[0]][chars[1]];
+    }
+    return NULL;
+}
+
 void
 GetGlyphs(FontPtr font, unsigned long count, unsigned char *chars,
           FontEncoding fontEncoding,
           unsigned long *glyphcount,    /* RETURN */
           CharInfoPtr *glyphs)          /* RETURN */
 {
-    (*font->get_glyphs) (font, count, chars, fontEncoding, glyphcount, glyphs);
+    FontCachePtr cache = NULL;
+    int size = (fontEncoding == Linear8Bit || fontEncoding == TwoD8Bit) ? 1 : 2;
+    unsigned long n = 0;
+
+    if (!fpe_functions[font->fpe->type]->load_glyphs)
+        cache = GetFontCache(font);
+    if (!cache) {
+        (*font->get_glyphs) (font, count, chars, fontEncoding, glyphcount,
+                             glyphs);
+        return;
+    }
+
+    for (; count--; chars += size) {
+        CharInfoPtr *slot = FontCacheSlot(cache, chars, fontEncoding);
+        CharInfoPtr glyph;
+        unsigned long got;
+
+        if (slot && *slot) {
+            fontCacheStats.glyphHits++;
+            glyph = *slot;
+        }
+        else {
+            (*font->get_glyphs) (font, 1, chars, fontEncoding, &got, &glyph);
+            if (!got)
+                glyph = &noGlyph;
+            if (slot) {
+                fontCacheStats.glyphMisses++;
+                *slot = glyph;
+            }
+        }
+        if (glyph != &noGlyph)
+            glyphs[n++] = glyph;
+    }
+    *glyphcount = n;
 }
 
 /*
@@ -548,6 +693,7 @@ CloseFont(void *value, XID fid)
         });
         if (pfont == defaultFont)
             defaultFont = NULL;
+        FreeFontCache(pfont);
 #ifdef XF86BIGFONT
         XF86BigfontFreeFontShm(pfont);
 #endif
@@ -623,6 +769,198 @@ QueryFont(FontPtr pFont, xQueryFontReply * pReply, int nProtoCCIStructs)
     return;
 }
 
+/**
+ * Returns the QueryFont reply for pFont, built on first use and kept
+ * until the font is closed, or NULL when out of memory.  The reply
+ * belongs to the font and lacks the sequence number; *rlength is set to
+ * its size in bytes.
+ */
+xQueryFontReply *
+QueryFontCached(FontPtr pFont, int *rlength)
+{
+    FontCachePtr cache = GetFontCache(pFont);
+    xCharInfo *pmax = FONTINKMAX(pFont);
+    xCharInfo *pmin = FONTINKMIN(pFont);
+    xQueryFontReply *reply;
+    int nprotoxcistructs;
+    int length;
+
+    if (!cache)
+        return NULL;
+    if (cache->reply) {
+        fontCacheStats.replyHits++;
+        *rlength = cache->replyLength;
+        return cache->reply;
+    }
+
+    nprotoxcistructs = (pmax->rightSideBearing == pmin->rightSideBearing &&
+                        pmax->leftSideBearing == pmin->leftSideBearing &&
+                        pmax->descent == pmin->descent &&
+                        pmax->ascent == pmin->ascent &&
+                        pmax->characterWidth == pmin->characterWidth) ?
+        0 : N2dChars(pFont);
+
+    length = sizeof(xQueryFontReply) +
+        FONTINFONPROPS(FONTCHARSET(pFont)) * sizeof(xFontProp) +
+        nprotoxcistructs * sizeof(xCharInfo);
+    reply = calloc(1, length);
+    if (!reply)
+        return NULL;
+
+    reply->type = X_Reply;
+    reply->length = bytes_to_int32(length - sizeof(xGenericReply));
+    QueryFont(pFont, reply, nprotoxcistructs);
+
+    fontCacheStats.replyMisses++;
+    cache->reply = reply;
+    cache->replyLength = length;
+    *rlength = length;
+    return reply;
+}
+
+/*
+ * ListFonts walks every element of the font path and matches the pattern
+ * against each directory, for every request, and clients ask for the same
+ * patterns again and again.  The names found for a pattern are kept in a
+ * trie keyed by the pattern until the font path changes.
+ *
+ * A list cut short by max_names still answers requests for as many names
+ * or fewer, as the walk is the same up to where it stopped.  Font servers
+ * can change what they list at any time, nothing is kept while one is on
+ * the font path.
+ */
+#define LIST_FONTS_PATTERNS     256
+
+typedef struct _ListFontsNode {
+    struct _ListFontsNode *child;       /* patterns one character longer */
+    struct _ListFontsNode *next;        /* same prefix, other character */
+    FontNamesPtr names;                 /* names for the pattern ending here */
+    unsigned max_names;                 /* how many names were asked for */
+    unsigned char ch;
+} ListFontsNodeRec, *ListFontsNodePtr;
+
+static ListFontsNodePtr listFontsIndex;
+static int listFontsPatterns;
+
+static void
+FreeListFontsNodes(ListFontsNodePtr node)
+{
+    while (node) {
+        ListFontsNodePtr next = node->next;
+
+        FreeListFontsNodes(node->child);
+        if (node->names)
+            xfont2_free_font_names(node->names);
+        free(node);
+        node = next;
+    }
+}
+
+static void
+EmptyListFontsIndex(void)
+{
+    FreeListFontsNodes(listFontsIndex);
+    listFontsIndex = NULL;
+    listFontsPatterns = 0;
+}
+
+static ListFontsNodePtr
+ListFontsIndexNode(const unsigned char *pattern, unsigned length, Bool create)
+{
+    ListFontsNodePtr *link = &listFontsIndex;
+    ListFontsNodePtr node = NULL;
+
+    for (; length--; pattern++) {
+        for (node = *link; node && node->ch != *pattern; node = node->next)
+            ;
+        if (!node) {
+            if (!create || !(node = calloc(1, sizeof(ListFontsNodeRec))))
+                return NULL;
+            node->ch = *pattern;
+            node->next = *link;
+            *link = node;
+        }
+        link = &node->child;
+    }
+    return node;
+}
+
+static Bool
+ListFontsCacheable(FontPathElementPtr *fpes, int nfpes)
+{
+    for (int i = 0; i < nfpes; i++)
+        if (fpe_functions[fpes[i]->type]->load_glyphs)
+            return FALSE;
+    return TRUE;
+}
+
+/* Keeps names, which now belong to the index, or frees them */
+static void
+ListFontsIndexStore(const unsigned char *pattern, unsigned length,
+                    unsigned max_names, FontNamesPtr names)
+{
+    ListFontsNodePtr node;
+
+    if (listFontsPatterns == LIST_FONTS_PATTERNS)
+        EmptyListFontsIndex();
+
+    node = ListFontsIndexNode(pattern, length, TRUE);
+    if (!node || (node->names && node->max_names >= max_names)) {
+        xfont2_free_font_names(names);
+        return;
+    }
+    if (node->names)
+        xfont2_free_font_names(node->names);
+    else
+        listFontsPatterns++;
+    node->names = names;
+    node->max_names = max_names;
+}
+
+static FontNamesPtr
+ListFontsIndexLookup(const unsigned char *pattern, unsigned length,
+                     unsigned max_names)
+{
+    ListFontsNodePtr node = ListFontsIndexNode(pattern, length, FALSE);
+
+    if (!node || !node->names)
+        return NULL;
+    if (node->names->nnames == node->max_names && max_names > node->max_names)
+        return NULL;
+    return node->names;
+}
+
+static int
+SendListFontsReply(ClientPtr client, FontNamesPtr names, unsigned max_names)
+{
+    int nnames = min((unsigned) names->nnames, max_names);
+
+    xListFontsReply reply = {
+        .nFonts = nnames,
+    };
+
+    x_rpcbuf_t rpcbuf = { .swapped = client->swapped, .err_clear = TRUE };
+    for (int i = 0; i < nnames; i++) {
+        if (names->length[i] > 255)
+            reply.nFonts--;
+        else {
+            /* write a pascal string */
+            x_rpcbuf_write_CARD8(&rpcbuf, names->length[i]);
+            x_rpcbuf_write_CARD8s(&rpcbuf, (CARD8*)names->names[i], names->length[i]);
+        }
+    }
+
+    if (rpcbuf.error)
+        return BadAlloc;
+
+    if (client->swapped) {
+        swaps(&reply.nFonts);
+    }
+
+    X_SEND_REPLY_WITH_RPCBUF(client, reply, rpcbuf);
+    return Success;
+}
+
 static Bool
 doListFontsAndAliases(ClientPtr client, struct list_fonts_closure *c)
 {
@@ -811,32 +1149,17 @@ doListFontsAndAliases(ClientPtr client, struct list_fonts_closure *c)
     names = c->names;
     client = c->client;
 
-    xListFontsReply reply = {
-        .nFonts = names->nnames,
-    };
-
-    x_rpcbuf_t rpcbuf = { .swapped = client->swapped, .err_clear = TRUE };
-    for (int i = 0; i < names->nnames; i++) {
-        if (names->length[i] > 255)
-            reply.nFonts--;
-        else {
-            /* write a pascal string */
-            x_rpcbuf_write_CARD8(&rpcbuf, names->length[i]);
-            x_rpcbuf_write_CARD8s(&rpcbuf, (CARD8*)names->names[i], names->length[i]);
-        }
-    }
-
-    if (rpcbuf.error) {
+    if (SendListFontsReply(client, names, c->current.max_names) != Success) {
         SendErrorToClient(client, X_ListFonts, 0, 0, BadAlloc);
         goto bail;
     }
 
-    if (client->swapped) {
-        swaps(&reply.nFonts);
+    if (c->current.patlen && ListFontsCacheable(c->fpe_list, c->num_fpes)) {
+        ListFontsIndexStore((unsigned char *) c->current.pattern,
+                            c->current.patlen, c->current.max_names, names);
+        names = NULL;
     }
 
-    X_SEND_REPLY_WITH_RPCBUF(client, reply, rpcbuf);
-
  bail:
     ClientWakeup(client);
     for (int i = 0; i < c->num_fpes; i++)
@@ -869,6 +1192,16 @@ ListFonts(ClientPtr client, unsigned char *pattern, unsigned length,
     if (access != Success)
         return access;
 
+    if (length) {
+        FontNamesPtr names = ListFontsIndexLookup(pattern, length, max_names);
+
+        if (names) {
+            fontCacheStats.listHits++;
+            return SendListFontsReply(client, names, max_names);
+        }
+        fontCacheStats.listMisses++;
+    }
+
     if (!(c = calloc(1, sizeof *c)))
         return BadAlloc;
     c->fpe_list = calloc(num_fpes, sizeof(FontPathElementPtr));
@@ -1669,6 +2002,9 @@ SetFontPathElements(int npaths, unsigned char *paths, int *bad, Bool persist)
     unsigned char *cp = paths;
     FontPathElementPtr fpe = NULL, *fplist;
 
+    /* elements already on the path get rescanned below */
+    EmptyListFontsIndex();
+
     fplist = calloc(npaths, sizeof(FontPathElementPtr));
     if (!fplist) {
         *bad = 0;
@@ -1932,6 +2268,21 @@ get_client_resolutions(int *num)
 void
 FreeFonts(void)
 {
+    if (fontCacheStats.glyphHits + fontCacheStats.glyphMisses +
+        fontCacheStats.replyHits + fontCacheStats.replyMisses +
+        fontCacheStats.listHits + fontCacheStats.listMisses)
+        LogMessageVerb(X_INFO, 3, "fonts: %lu glyph lookups, %lu cached; "
+                       "%lu QueryFont replies, %lu cached; "
+                       "%lu ListFonts, %lu from the index\n",
+                       fontCacheStats.glyphHits + fontCacheStats.glyphMisses,
+                       fontCacheStats.glyphHits,
+                       fontCacheStats.replyHits + fontCacheStats.replyMisses,
+                       fontCacheStats.replyHits,
+                       fontCacheStats.listHits + fontCacheStats.listMisses,
+                       fontCacheStats.listHits);
+    memset(&fontCacheStats, 0, sizeof(fontCacheStats));
+    EmptyListFontsIndex();
+
     if (patternCache) {
         xfont2_free_font_pattern_cache(patternCache);
         patternCache = 0;
@@ -2125,4 +2476,6 @@ InitFonts(void)
 	xfont2_free_font_pattern_cache(fontPatternCache);
     fontPatternCache = xfont2_make_font_pattern_cache();
     xfont2_init(&xfont2_client_funcs);
+    if (fontCacheIndex < 0)
+        fontCacheIndex = xfont2_allocate_font_private_index();
 }
@@ -96,6 +96,7 @@ Equipment Corporation.
 #include "dix/selection_priv.h"
 #include "dix/server_priv.h"
 #include "include/extinit.h"
+#include "mi/mi_priv.h"
 #include "os/audit_priv.h"
 #include "os/auth.h"
 #include "os/client_priv.h"
@@ -346,6 +347,8 @@ dix_main(int argc, char *argv[], char *envp[])
 
         FreeFonts();
 
+        miFreeDrawCaches();
+
         FreeAllAtoms();
 
         FreeAuditTimer();
@@ -30,6 +30,7 @@
 
 static int dri3_request;
 DevPrivateKeyRec dri3_screen_private_key;
+DevPrivateKeyRec dri3_client_private_key;
 
 static x_server_generation_t dri3_screen_generation;
 
@@ -106,6 +107,10 @@ dri3_extension_init(void)
 
     dri3_request = extension->base;
 
+    if (!dixRegisterPrivateKey(&dri3_client_private_key, PRIVATE_CLIENT,
+                               sizeof (dri3_client_priv_rec)))
+        goto bail;
+
     DIX_FOR_EACH_SCREEN({
         if (!dri3_screen_init(walkScreen, NULL))
             goto bail;
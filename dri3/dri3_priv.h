@@ -34,6 +34,8 @@
 
 extern DevPrivateKeyRec dri3_screen_private_key;
 
+extern DevPrivateKeyRec dri3_client_private_key;
+
 extern RESTYPE dri3_syncobj_type;
 
 typedef struct dri3_dmabuf_format {
@@ -77,6 +79,16 @@ dri3_screen_priv(ScreenPtr screen)
     return (dri3_screen_priv_ptr)dixLookupPrivate(&(screen)->devPrivates, &dri3_screen_private_key);
 }
 
+typedef struct dri3_client_priv {
+    CARD32                      minor_version;  /* as agreed in QueryVersion */
+} dri3_client_priv_rec, *dri3_client_priv_ptr;
+
+static inline dri3_client_priv_ptr
+dri3_client_priv(ClientPtr client)
+{
+    return (dri3_client_priv_ptr)dixLookupPrivate(&(client)->devPrivates, &dri3_client_private_key);
+}
+
 int
 proc_dri3_dispatch(ClientPtr client);
 
@@ -34,6 +34,7 @@
 #include <xace.h>
 #include <protocol-versions.h>
 #include <drm_fourcc.h>
+#include "misync_priv.h"
 #include "randrstr_priv.h"
 #include "dixstruct_priv.h"
 
@@ -122,6 +123,10 @@ proc_dri3_query_version(ClientPtr client)
         }
     });
 
+    /* 1.5 only adds eventfds to what FenceFromFD takes */
+    if (reply.minorVersion == 4)
+        reply.minorVersion = 5;
+
     /* From DRI3 proto:
      *
      * The client sends the highest supported version to the server
@@ -135,6 +140,7 @@ proc_dri3_query_version(ClientPtr client)
         reply.majorVersion = stuff->majorVersion;
         reply.minorVersion = stuff->minorVersion;
     }
+    dri3_client_priv(client)->minor_version = reply.minorVersion;
 
     X_REPLY_FIELD_CARD32(majorVersion);
     X_REPLY_FIELD_CARD32(minorVersion);
@@ -336,6 +342,12 @@ proc_dri3_fence_from_fd(ClientPtr client)
     if (fd < 0)
         return BadValue;
 
+    /* clients which did not ask for 1.5 get the old behaviour */
+    if (dri3_client_priv(client)->minor_version < 5 && miSyncShmIsEventFd(fd)) {
+        close(fd);
+        return BadValue;
+    }
+
     status = SyncCreateFenceFromFD(client, drawable, stuff->fence,
                                    fd, stuff->initially_triggered);
 
@@ -672,12 +672,17 @@ ExaBlockHandler(ScreenPtr pScreen, void *pTimeout)
 
     /* Try and keep the offscreen memory area tidy every now and then (at most
      * once per second) when the server has been idle for at least 100ms.
+     * Each pass only moves a bounded number of pixmaps.
      */
     if (pExaScr->numOffscreenAvailable > 1) {
         CARD32 now = GetTimeInMillis();
 
-        pExaScr->nextDefragment = now +
-            max(100, (INT32) (pExaScr->lastDefragment + 1000 - now));
+        /* an unfinished pass goes on after the next 100ms of idle time */
+        if (pExaScr->defragPending)
+            pExaScr->nextDefragment = now + 100;
+        else
+            pExaScr->nextDefragment = now +
+                max(100, (INT32) (pExaScr->lastDefragment + 1000 - now));
         AdjustWaitForDelay(pTimeout, pExaScr->nextDefragment - now);
     }
 }
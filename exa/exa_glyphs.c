@@ -78,38 +78,96 @@ typedef enum {
     ExaGlyphNeedFlush,          /* would evict a glyph already in the buffer */
 } ExaGlyphCacheResult;
 
+/* Glyph caches may use up to 1/EXA_GLYPH_CACHE_SHARE of offscreen memory */
+#define EXA_GLYPH_CACHE_SHARE 8
+
+/* What we assume when the driver manages offscreen memory itself */
+#define EXA_GLYPH_CACHE_DEFAULT_MEMORY (32 << 20)
+
+/* Which caches there are and how far each of them may grow.  Small alpha
+ * glyphs are what most text is made of, and what large CJK pages need by
+ * the thousand, so they get the most room.
+ */
+static const struct {
+    pixman_format_code_t format;
+    int glyphSize;
+    int share;                  /* part of the budget, out of 8 */
+    int minGlyphs, maxGlyphs;
+} exaGlyphCachePolicy[EXA_NUM_GLYPH_CACHES] = {
+    { PIXMAN_a8,        16, 4, 256, 4096 },
+    { PIXMAN_a8,        32, 2, 256, 1024 },
+    { PIXMAN_a8r8g8b8,  16, 1, 256, 2048 },
+    { PIXMAN_a8r8g8b8,  32, 1, 256, 512 },
+};
+
+/* Smallest prime above twice the cache size, so that linear probing always
+ * finds an empty slot soon.
+ */
+static int
+exaGlyphCacheHashSize(int size)
+{
+    int n, d;
+
+    for (n = size * 2 + 1;; n += 2) {
+        for (d = 3; d * d <= n; d += 2)
+            if (n % d == 0)
+                break;
+        if (d * d > n)
+            return n;
+    }
+}
+
+/* Size each cache for its share of offscreen memory, in whole rows, without
+ * letting the picture of a format get taller than the driver can render.
+ */
+static int
+exaGlyphCacheSize(ExaScreenPrivPtr pExaScr, int i, unsigned long budget)
+{
+    ExaGlyphCachePtr cache = &pExaScr->glyphCaches[i];
+    int bytes = cache->glyphWidth * cache->glyphHeight *
+        PIXMAN_FORMAT_BPP(cache->format) / 8;
+    unsigned long glyphs = budget / 8 * exaGlyphCachePolicy[i].share / bytes;
+    int maxHeight = pExaScr->info->maxY > 0 ? pExaScr->info->maxY : 8192;
+    int size;
+
+    if (glyphs > exaGlyphCachePolicy[i].maxGlyphs)
+        size = exaGlyphCachePolicy[i].maxGlyphs;
+    else
+        size = max((int) glyphs, exaGlyphCachePolicy[i].minGlyphs);
+    /* every format shares one picture with at most two caches */
+    size = min(size, maxHeight / 2 / cache->glyphHeight * cache->columns);
+    size -= size % cache->columns;
+
+    return max(size, cache->columns);
+}
+
 void
 exaGlyphsInit(ScreenPtr pScreen)
 {
     ExaScreenPriv(pScreen);
-    int i = 0;
+    unsigned long budget = EXA_GLYPH_CACHE_DEFAULT_MEMORY;
+    int i;
 
     memset(pExaScr->glyphCaches, 0, sizeof(pExaScr->glyphCaches));
 
-    pExaScr->glyphCaches[i].format = PIXMAN_a8;
-    pExaScr->glyphCaches[i].glyphWidth = pExaScr->glyphCaches[i].glyphHeight =
-        16;
-    i++;
-    pExaScr->glyphCaches[i].format = PIXMAN_a8;
-    pExaScr->glyphCaches[i].glyphWidth = pExaScr->glyphCaches[i].glyphHeight =
-        32;
-    i++;
-    pExaScr->glyphCaches[i].format = PIXMAN_a8r8g8b8;
-    pExaScr->glyphCaches[i].glyphWidth = pExaScr->glyphCaches[i].glyphHeight =
-        16;
-    i++;
-    pExaScr->glyphCaches[i].format = PIXMAN_a8r8g8b8;
-    pExaScr->glyphCaches[i].glyphWidth = pExaScr->glyphCaches[i].glyphHeight =
-        32;
-    i++;
-
-    assert(i == EXA_NUM_GLYPH_CACHES);
+    if (pExaScr->info->memorySize > pExaScr->info->offScreenBase)
+        budget = pExaScr->info->memorySize - pExaScr->info->offScreenBase;
+    budget /= EXA_GLYPH_CACHE_SHARE;
 
     for (i = 0; i < EXA_NUM_GLYPH_CACHES; i++) {
-        pExaScr->glyphCaches[i].columns =
-            CACHE_PICTURE_WIDTH / pExaScr->glyphCaches[i].glyphWidth;
-        pExaScr->glyphCaches[i].size = 256;
-        pExaScr->glyphCaches[i].hashSize = 557;
+        ExaGlyphCachePtr cache = &pExaScr->glyphCaches[i];
+
+        cache->format = exaGlyphCachePolicy[i].format;
+        cache->glyphWidth = cache->glyphHeight =
+            exaGlyphCachePolicy[i].glyphSize;
+        cache->columns = CACHE_PICTURE_WIDTH / cache->glyphWidth;
+        cache->size = exaGlyphCacheSize(pExaScr, i, budget);
+        cache->hashSize = exaGlyphCacheHashSize(cache->size);
+
+        DBG_GLYPH_CACHE(("(%d,%d,%s): %d glyphs, %d hash entries\n",
+                         cache->glyphWidth, cache->glyphHeight,
+                         cache->format == PIXMAN_a8 ? "A" : "ARGB",
+                         cache->size, cache->hashSize));
     }
 }
 
@@ -220,7 +278,7 @@ exaRealizeGlyphCaches(ScreenPtr pScreen, unsigned int format)
         for (j = 0; j < cache->hashSize; j++)
             cache->hashEntries[j] = -1;
 
-        cache->evictionPosition = rand() % cache->size;
+        cache->lruHead = cache->lruTail = -1;
     }
 
     /* Each cache references the picture individually */
@@ -238,6 +296,19 @@ exaGlyphsFini(ScreenPtr pScreen)
     ExaScreenPriv(pScreen);
     int i;
 
+    for (i = 0; i < EXA_NUM_GLYPH_CACHES; i++) {
+        ExaGlyphCachePtr cache = &pExaScr->glyphCaches[i];
+
+        if (cache->hits || cache->misses)
+            LogMessageVerb(X_INFO, 3, "EXA(%d): %dx%d %s glyph cache: "
+                           "%lu hits, %lu misses, %lu evictions, "
+                           "%d of %d glyphs used\n", pScreen->myNum,
+                           cache->glyphWidth, cache->glyphHeight,
+                           cache->format == PIXMAN_a8 ? "A8" : "ARGB",
+                           cache->hits, cache->misses, cache->evictions,
+                           cache->glyphCount, cache->size);
+    }
+
     for (i = 0; i < EXA_NUM_GLYPH_CACHES; i++) {
         ExaGlyphCachePtr cache = &pExaScr->glyphCaches[i];
 
@@ -345,6 +416,46 @@ exaGlyphCacheHashRemove(ExaGlyphCachePtr cache, int pos)
     }
 }
 
+static void
+exaGlyphCacheLRUUnlink(ExaGlyphCachePtr cache, int pos)
+{
+    ExaCachedGlyphPtr glyph = &cache->glyphs[pos];
+
+    if (glyph->prev != -1)
+        cache->glyphs[glyph->prev].next = glyph->next;
+    else
+        cache->lruHead = glyph->next;
+
+    if (glyph->next != -1)
+        cache->glyphs[glyph->next].prev = glyph->prev;
+    else
+        cache->lruTail = glyph->prev;
+}
+
+/* Make pos the most recently used glyph; it must not be in the list yet */
+static void
+exaGlyphCacheLRUPush(ExaGlyphCachePtr cache, int pos)
+{
+    ExaCachedGlyphPtr glyph = &cache->glyphs[pos];
+
+    glyph->prev = -1;
+    glyph->next = cache->lruHead;
+    if (cache->lruHead != -1)
+        cache->glyphs[cache->lruHead].prev = pos;
+    else
+        cache->lruTail = pos;
+    cache->lruHead = pos;
+}
+
+static void
+exaGlyphCacheLRUTouch(ExaGlyphCachePtr cache, int pos)
+{
+    if (cache->lruHead == pos)
+        return;
+    exaGlyphCacheLRUUnlink(cache, pos);
+    exaGlyphCacheLRUPush(cache, pos);
+}
+
 #define CACHE_X(pos) (((pos) % cache->columns) * cache->glyphWidth)
 #define CACHE_Y(pos) (cache->yOffset + ((pos) / cache->columns) * cache->glyphHeight)
 
@@ -454,6 +565,8 @@ exaGlyphCacheBufferGlyph(ScreenPtr pScreen,
         DBG_GLYPH_CACHE(("  found existing glyph at %d\n", pos));
         x = CACHE_X(pos);
         y = CACHE_Y(pos);
+        exaGlyphCacheLRUTouch(cache, pos);
+        cache->hits++;
     }
     else {
         if (cache->glyphCount < cache->size) {
@@ -465,14 +578,16 @@ exaGlyphCacheBufferGlyph(ScreenPtr pScreen,
             DBG_GLYPH_CACHE(("  storing glyph in free space at %d\n", pos));
 
             exaGlyphCacheHashInsert(cache, pGlyph, pos);
+            exaGlyphCacheLRUPush(cache, pos);
 
         }
         else {
-            /* Need to evict an entry. We have to see if any glyphs
-             * already in the output buffer were at this position in
-             * the cache
+            /* Need to evict the least recently used entry. We have to see
+             * if any glyphs already in the output buffer were at this
+             * position in the cache; as every glyph buffered moves to the
+             * front, that only happens once the buffer used them all.
              */
-            pos = cache->evictionPosition;
+            pos = cache->lruTail;
             x = CACHE_X(pos);
             y = CACHE_Y(pos);
             DBG_GLYPH_CACHE(("  evicting glyph at %d\n", pos));
@@ -494,11 +609,11 @@ exaGlyphCacheBufferGlyph(ScreenPtr pScreen,
             /* OK, we're all set, swap in the new glyph */
             exaGlyphCacheHashRemove(cache, pos);
             exaGlyphCacheHashInsert(cache, pGlyph, pos);
-
-            /* And pick a new eviction position */
-            cache->evictionPosition = rand() % cache->size;
+            exaGlyphCacheLRUTouch(cache, pos);
+            cache->evictions++;
         }
 
+        cache->misses++;
         exaGlyphCacheUploadGlyph(pScreen, cache, x, y, pGlyph);
     }
 
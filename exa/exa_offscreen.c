@@ -22,8 +22,11 @@
 
 /** @file
  * This allocator allocates blocks of memory by maintaining a list of areas.
- * When allocating, the contiguous block of areas with the minimum eviction
- * cost is found and evicted in order to make room for the new allocation.
+ * Free areas are also kept in bins by size, so finding room does not walk
+ * the allocated ones, and removable areas in least recently used order.
+ * When there is no room, the oldest areas are tried first for eviction;
+ * only when none of them would make room is the contiguous block of areas
+ * with the minimum eviction cost found and evicted.
  */
 #include <dix-config.h>
 
@@ -39,6 +42,84 @@
 #define DBG_OFFSCREEN(a)
 #endif
 
+/* how many of the least recently used areas to try before a full scan */
+#define EXA_EVICT_CANDIDATES    16
+
+/* how many pixmaps one defragment pass may move */
+#define EXA_DEFRAG_MOVES        32
+
+/*
+ * Every area record handed out is really one of these; drivers only see
+ * the public part.
+ */
+typedef struct {
+    ExaOffscreenArea area;
+    struct xorg_list free;      /* pExaScr->offScreenFree[], while available */
+    struct xorg_list lru;       /* pExaScr->offScreenLRU, while removable */
+} ExaOffscreenAreaPrivRec, *ExaOffscreenAreaPrivPtr;
+
+#define ExaOffscreenAreaPriv(a) \
+    ((ExaOffscreenAreaPrivPtr) container_of(a, ExaOffscreenAreaPrivRec, area))
+
+static ExaOffscreenArea *
+exaOffscreenNewArea(void)
+{
+    ExaOffscreenAreaPrivPtr priv = calloc(1, sizeof(ExaOffscreenAreaPrivRec));
+
+    if (!priv)
+        return NULL;
+    xorg_list_init(&priv->free);
+    xorg_list_init(&priv->lru);
+    return &priv->area;
+}
+
+static int
+exaOffscreenBin(int size)
+{
+    return 31 - __builtin_clz(size);
+}
+
+static void
+exaOffscreenFreeInsert(ExaScreenPrivPtr pExaScr, ExaOffscreenArea * area)
+{
+    ExaOffscreenAreaPrivPtr priv = ExaOffscreenAreaPriv(area);
+
+    xorg_list_del(&priv->free);
+    xorg_list_add(&priv->free, &pExaScr->offScreenFree[exaOffscreenBin(area->size)]);
+}
+
+static void
+exaOffscreenFreeRemove(ExaOffscreenArea * area)
+{
+    xorg_list_del(&ExaOffscreenAreaPriv(area)->free);
+}
+
+static void
+exaOffscreenDestroyArea(ExaOffscreenArea * area)
+{
+    ExaOffscreenAreaPrivPtr priv = ExaOffscreenAreaPriv(area);
+
+    xorg_list_del(&priv->free);
+    xorg_list_del(&priv->lru);
+    free(priv);
+}
+
+/* Put the free areas back in their bins after their sizes changed */
+static void
+exaOffscreenRebin(ExaScreenPrivPtr pExaScr)
+{
+    ExaOffscreenArea *area;
+    int bin;
+
+    for (bin = 0; bin < EXA_OFFSCREEN_BINS; bin++)
+        xorg_list_init(&pExaScr->offScreenFree[bin]);
+    for (area = pExaScr->info->offScreenAreas; area; area = area->next) {
+        xorg_list_init(&ExaOffscreenAreaPriv(area)->free);
+        if (area->state == ExaOffscreenAvail)
+            exaOffscreenFreeInsert(pExaScr, area);
+    }
+}
+
 #if DEBUG_OFFSCREEN
 static void
 ExaOffscreenValidate(ScreenPtr pScreen)
@@ -140,6 +221,64 @@ exaFindAreaToEvict(ExaScreenPrivPtr pExaScr, int size, int align)
     return best;
 }
 
+/*
+ * First fit in the smallest bin which may hold the allocation; areas in
+ * the bins above it are all large enough short of alignment.
+ */
+static ExaOffscreenArea *
+exaFindFreeArea(ExaScreenPrivPtr pExaScr, int size, int align)
+{
+    ExaOffscreenAreaPrivPtr priv;
+    int bin, real_size;
+
+    for (bin = exaOffscreenBin(size); bin < EXA_OFFSCREEN_BINS; bin++) {
+        xorg_list_for_each_entry(priv, &pExaScr->offScreenFree[bin], free) {
+            ExaOffscreenArea *area = &priv->area;
+
+            /* adjust size to match alignment requirement */
+            real_size = size + (area->base_offset + area->size - size) % align;
+            if (real_size <= area->size)
+                return area;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Grow a block of unlocked areas around each of the least recently used
+ * areas until it would hold the allocation, and return the start of the
+ * first one which does.
+ */
+static ExaOffscreenArea *
+exaFindLRUAreaToEvict(ExaScreenPrivPtr pExaScr, int size, int align)
+{
+    ExaOffscreenAreaPrivPtr priv;
+    int need = size + align - 1;
+    int tries = 0;
+
+    xorg_list_for_each_entry(priv, &pExaScr->offScreenLRU, lru) {
+        ExaOffscreenArea *begin = &priv->area, *end;
+        int avail = 0;
+
+        if (tries++ == EXA_EVICT_CANDIDATES)
+            break;
+
+        for (end = begin; end && end->state != ExaOffscreenLocked &&
+             avail < need; end = end->next)
+            avail += end->size;
+
+        while (avail < need && begin != pExaScr->info->offScreenAreas &&
+               begin->prev->state != ExaOffscreenLocked) {
+            begin = begin->prev;
+            avail += begin->size;
+        }
+
+        if (avail >= need)
+            return begin;
+    }
+    return NULL;
+}
+
 /**
  * exaOffscreenAlloc allocates offscreen memory
  *
@@ -166,7 +305,7 @@ exaOffscreenAlloc(ScreenPtr pScreen, int size, int align,
     ExaOffscreenArea *area;
 
     ExaScreenPriv(pScreen);
-    int real_size = 0, largest_avail = 0;
+    int real_size = 0;
 
 #if DEBUG_OFFSCREEN
     static int number = 0;
@@ -193,24 +332,14 @@ exaOffscreenAlloc(ScreenPtr pScreen, int size, int align,
     }
 
     /* Try to find a free space that'll fit. */
-    for (area = pExaScr->info->offScreenAreas; area; area = area->next) {
-        /* skip allocated areas */
-        if (area->state != ExaOffscreenAvail)
-            continue;
-
-        /* adjust size to match alignment requirement */
+    area = exaFindFreeArea(pExaScr, size, align);
+    if (area)
         real_size = size + (area->base_offset + area->size - size) % align;
 
-        /* does it fit? */
-        if (real_size <= area->size)
-            break;
-
-        if (area->size > largest_avail)
-            largest_avail = area->size;
-    }
-
     if (!area) {
-        area = exaFindAreaToEvict(pExaScr, size, align);
+        area = exaFindLRUAreaToEvict(pExaScr, size, align);
+        if (!area)
+            area = exaFindAreaToEvict(pExaScr, size, align);
 
         if (!area) {
             DBG_OFFSCREEN(("Alloc 0x%x -> NOSPACE\n", size));
@@ -239,7 +368,7 @@ exaOffscreenAlloc(ScreenPtr pScreen, int size, int align,
 
     /* save extra space in new area */
     if (real_size < area->size) {
-        ExaOffscreenArea *new_area = calloc(1, sizeof(ExaOffscreenArea));
+        ExaOffscreenArea *new_area = exaOffscreenNewArea();
 
         if (!new_area)
             return NULL;
@@ -261,9 +390,11 @@ exaOffscreenAlloc(ScreenPtr pScreen, int size, int align,
         area->prev = new_area;
         area->base_offset = new_area->base_offset + new_area->size;
         area->size = real_size;
+        exaOffscreenFreeInsert(pExaScr, new_area);
     }
     else
         pExaScr->numOffscreenAvailable--;
+    exaOffscreenFreeRemove(area);
 
     /*
      * Mark this area as in use
@@ -275,6 +406,8 @@ exaOffscreenAlloc(ScreenPtr pScreen, int size, int align,
     area->privData = privData;
     area->save = save;
     area->last_use = pExaScr->offScreenCounter++;
+    if (!locked)
+        xorg_list_append(&ExaOffscreenAreaPriv(area)->lru, &pExaScr->offScreenLRU);
     area->offset = (area->base_offset + align - 1);
     area->offset -= area->offset % align;
     area->align = align;
@@ -398,7 +531,7 @@ ExaOffscreenMerge(ExaScreenPrivPtr pExaScr, ExaOffscreenArea * area)
         area->next->prev = area;
     else
         pExaScr->info->offScreenAreas->prev = area;
-    free(next);
+    exaOffscreenDestroyArea(next);
 
     pExaScr->numOffscreenAvailable--;
 }
@@ -431,6 +564,7 @@ exaOffscreenFree(ScreenPtr pScreen, ExaOffscreenArea * area)
     area->save = NULL;
     area->last_use = 0;
     area->eviction_cost = 0;
+    xorg_list_del(&ExaOffscreenAreaPriv(area)->lru);
     /*
      * Find previous area
      */
@@ -451,6 +585,9 @@ exaOffscreenFree(ScreenPtr pScreen, ExaOffscreenArea * area)
         ExaOffscreenMerge(pExaScr, area);
     }
 
+    /* its size changed */
+    exaOffscreenFreeInsert(pExaScr, area);
+
     ExaOffscreenValidate(pScreen);
     DBG_OFFSCREEN(("\tdone freeing\n"));
     return area;
@@ -466,12 +603,22 @@ ExaOffscreenMarkUsed(PixmapPtr pPixmap)
         return;
 
     pExaPixmap->area->last_use = pExaScr->offScreenCounter++;
+    if (pExaPixmap->area->state == ExaOffscreenRemovable) {
+        ExaOffscreenAreaPrivPtr priv = ExaOffscreenAreaPriv(pExaPixmap->area);
+
+        xorg_list_del(&priv->lru);
+        xorg_list_append(&priv->lru, &pExaScr->offScreenLRU);
+    }
 }
 
 /**
  * Defragment offscreen memory by compacting allocated areas at the end of it,
  * leaving the total amount of memory available as a single area at the
  * beginning (when there are no pinned allocations).
+ *
+ * A pass moves at most EXA_DEFRAG_MOVES pixmaps, so that it never holds up
+ * the server for long; defragPending tells the block handler to schedule
+ * another one soon.
  */
 _X_HIDDEN ExaOffscreenArea *
 ExaOffscreenDefragment(ScreenPtr pScreen)
@@ -479,9 +626,12 @@ ExaOffscreenDefragment(ScreenPtr pScreen)
     ExaScreenPriv(pScreen);
     ExaOffscreenArea *area, *largest_available = NULL;
     int largest_size = 0;
+    int moves = 0;
     PixmapPtr pDstPix;
     ExaPixmapPrivPtr pExaDstPix;
 
+    pExaScr->defragPending = FALSE;
+
     pDstPix = (*pScreen->CreatePixmap) (pScreen, 0, 0, 0, 0);
 
     if (!pDstPix)
@@ -608,8 +758,15 @@ ExaOffscreenDefragment(ScreenPtr pScreen)
         pExaSrcPix->fb_ptr = pExaDstPix->fb_ptr;
         pExaSrcPix->use_gpu_copy = save_use_gpu_copy;
         pSrcPix->devKind = save_pitch;
+
+        if (++moves == EXA_DEFRAG_MOVES) {
+            pExaScr->defragPending = TRUE;
+            break;
+        }
     }
 
+    exaOffscreenRebin(pExaScr);
+
     pDstPix->drawable.width = 0;
     pDstPix->drawable.height = 0;
     pDstPix->drawable.depth = 0;
@@ -635,9 +792,10 @@ Bool
 exaOffscreenInit(ScreenPtr pScreen)
 {
     ExaScreenPriv(pScreen);
+    int bin;
 
     /* Allocate a big free area */
-    ExaOffscreenArea *area = calloc(1, sizeof(ExaOffscreenArea));
+    ExaOffscreenArea *area = exaOffscreenNewArea();
     if (!area)
         return FALSE;
 
@@ -656,6 +814,12 @@ exaOffscreenInit(ScreenPtr pScreen)
     pExaScr->info->offScreenAreas = area;
     pExaScr->offScreenCounter = 1;
     pExaScr->numOffscreenAvailable = 1;
+    pExaScr->defragPending = FALSE;
+
+    for (bin = 0; bin < EXA_OFFSCREEN_BINS; bin++)
+        xorg_list_init(&pExaScr->offScreenFree[bin]);
+    xorg_list_init(&pExaScr->offScreenLRU);
+    exaOffscreenFreeInsert(pExaScr, area);
 
     ExaOffscreenValidate(pScreen);
 
@@ -671,6 +835,6 @@ ExaOffscreenFini(ScreenPtr pScreen)
     /* just free all of the area records */
     while ((area = pExaScr->info->offScreenAreas)) {
         pExaScr->info->offScreenAreas = area->next;
-        free(area);
+        exaOffscreenDestroyArea(area);
     }
 }
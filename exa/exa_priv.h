@@ -101,6 +101,7 @@ enum ExaMigrationHeuristic {
 
 typedef struct {
     unsigned char sha1[20];
+    int prev, next;             /* neighbours in the LRU list, -1 at the ends */
 } ExaCachedGlyphRec, *ExaCachedGlyphPtr;
 
 typedef struct {
@@ -109,7 +110,7 @@ typedef struct {
     int glyphWidth;
     int glyphHeight;
 
-    int size;                   /* Size of cache; eventually this should be dynamically determined */
+    int size;                   /* Size of cache, see exaGlyphCacheSize() */
 
     /* Hash table mapping from glyph sha1 to position in the glyph; we use
      * open addressing with a hash table size determined based on size and large
@@ -126,11 +127,18 @@ typedef struct {
     PicturePtr picture;         /* Where the glyphs of the cache are stored */
     int yOffset;                /* y location within the picture where the cache starts */
     int columns;                /* Number of columns the glyphs are laid out in */
-    int evictionPosition;       /* Next random position to evict a glyph */
+    int lruHead, lruTail;       /* most and least recently used glyph */
+
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
 } ExaGlyphCacheRec, *ExaGlyphCachePtr;
 
 #define EXA_NUM_GLYPH_CACHES 4
 
+/* free offscreen areas are binned by log2 of their size */
+#define EXA_OFFSCREEN_BINS 32
+
 #define EXA_FALLBACK_COPYWINDOW (1 << 0)
 #define EXA_ACCEL_COPYWINDOW (1 << 1)
 
@@ -178,6 +186,9 @@ typedef struct {
     unsigned numOffscreenAvailable;
     CARD32 lastDefragment;
     CARD32 nextDefragment;
+    Bool defragPending;         /* last defragment pass ran out of budget */
+    struct xorg_list offScreenFree[EXA_OFFSCREEN_BINS];
+    struct xorg_list offScreenLRU;      /* removable areas, oldest first */
     PixmapPtr deferred_mixed_pixmap;
 
     /* Reference counting for accessed pixmaps */
@@ -32,7 +32,7 @@
 
 #include "fb.h"
 #include "glyphstr_priv.h"
-#include "picturestr.h"
+#include "picturestr_priv.h"
 
 void
 fbComposite(CARD8 op,
@@ -69,6 +69,51 @@ fbComposite(CARD8 op,
     free_pixman_pict(pDst, dest);
 }
 
+/*
+ * Set up the pixman images once for the whole run.  If someone wrapped
+ * Composite after us, composite rectangle by rectangle through them.
+ */
+static void
+fbCompositeBatch(CARD8 op,
+                 PicturePtr pSrc,
+                 PicturePtr pMask,
+                 PicturePtr pDst, int nrect, PictCompositeRectPtr rects)
+{
+    pixman_image_t *src, *mask, *dest;
+    int src_xoff, src_yoff;
+    int msk_xoff, msk_yoff;
+    int dst_xoff, dst_yoff;
+
+    if (GetPictureScreen(pDst->pDrawable->pScreen)->Composite != fbComposite) {
+        miCompositeBatch(op, pSrc, pMask, pDst, nrect, rects);
+        return;
+    }
+
+    miCompositeSourceValidate(pSrc);
+    if (pMask)
+        miCompositeSourceValidate(pMask);
+
+    src = image_from_pict(pSrc, FALSE, &src_xoff, &src_yoff);
+    mask = image_from_pict(pMask, FALSE, &msk_xoff, &msk_yoff);
+    dest = image_from_pict(pDst, TRUE, &dst_xoff, &dst_yoff);
+
+    if (src && dest && !(pMask && !mask)) {
+        for (; nrect--; rects++)
+            pixman_image_composite(op, src, mask, dest,
+                                   rects->xSrc + src_xoff,
+                                   rects->ySrc + src_yoff,
+                                   rects->xMask + msk_xoff,
+                                   rects->yMask + msk_yoff,
+                                   rects->xDst + dst_xoff,
+                                   rects->yDst + dst_yoff,
+                                   rects->width, rects->height);
+    }
+
+    free_pixman_pict(pSrc, src);
+    free_pixman_pict(pMask, mask);
+    free_pixman_pict(pDst, dest);
+}
+
 static pixman_glyph_cache_t *glyphCache;
 
 void
@@ -277,6 +322,73 @@ create_conical_gradient_image(PictGradient * gradient)
                                                 gradient->nstops);
 }
 
+static struct {
+    unsigned long gradientHits;         /* gradient image reused */
+    unsigned long gradientMisses;       /* gradient image realized */
+    unsigned long imageHits;            /* drawable image reused */
+    unsigned long imageMisses;          /* drawable image validated */
+} cacheStats;
+
+/*
+ * Stops never change once a gradient picture is created, and everything
+ * else set_image_properties() applies again on each use, so the pixman
+ * image of a gradient is made once and kept in a picture private until
+ * the picture is freed.  Source pictures belong to no screen and never
+ * reach DestroyPicture, so the image is dropped from the callback render
+ * makes when the last reference to one goes away.
+ */
+static DevPrivateKeyRec fbGradientKeyRec;
+
+static void
+fbSourcePictureDestroyed(CallbackListPtr *pcbl, void *unused, void *data)
+{
+    PicturePtr pict = data;
+    pixman_image_t *image;
+
+    image = dixLookupPrivate(&pict->devPrivates, &fbGradientKeyRec);
+    if (image)
+        pixman_image_unref(image);
+}
+
+static Bool
+fbGradientInit(void)
+{
+    if (dixPrivateKeyRegistered(&fbGradientKeyRec))
+        return TRUE;
+    if (!dixRegisterPrivateKey(&fbGradientKeyRec, PRIVATE_PICTURE, 0))
+        return FALSE;
+    return AddCallback(&SourcePictureDestroyCallback,
+                       fbSourcePictureDestroyed, NULL);
+}
+
+static pixman_image_t *
+create_gradient_image(PicturePtr pict)
+{
+    PictGradient *gradient = &pict->pSourcePict->gradient;
+    pixman_image_t *image = NULL;
+
+    if (dixPrivateKeyRegistered(&fbGradientKeyRec)) {
+        image = dixLookupPrivate(&pict->devPrivates, &fbGradientKeyRec);
+        if (image) {
+            cacheStats.gradientHits++;
+            return pixman_image_ref(image);
+        }
+        cacheStats.gradientMisses++;
+    }
+
+    if (gradient->type == SourcePictTypeLinear)
+        image = create_linear_gradient_image(gradient);
+    else if (gradient->type == SourcePictTypeRadial)
+        image = create_radial_gradient_image(gradient);
+    else if (gradient->type == SourcePictTypeConical)
+        image = create_conical_gradient_image(gradient);
+
+    if (image && dixPrivateKeyRegistered(&fbGradientKeyRec))
+        dixSetPrivate(&pict->devPrivates, &fbGradientKeyRec,
+                      pixman_image_ref(image));
+    return image;
+}
+
 static pixman_image_t *
 create_bits_picture(PicturePtr pict, Bool has_clip, int *xoff, int *yoff)
 {
@@ -367,6 +479,10 @@ set_image_properties(pixman_image_t * image, PicturePtr pict, Bool has_clip,
         else
             pixman_image_set_transform(image, pict->transform);
     }
+    else if (pict->pSourcePict) {
+        /* a cached image may still carry an earlier transform */
+        pixman_image_set_transform(image, NULL);
+    }
 
     switch (pict->repeatType) {
     default:
@@ -433,6 +549,169 @@ set_image_properties(pixman_image_t * image, PicturePtr pict, Bool has_clip,
     pixman_image_set_source_clipping(image, TRUE);
 }
 
+#ifndef FB_ACCESS_WRAPPER
+
+/*
+ * The pixman image of a picture on a drawable, as validated by the last
+ * image_from_pict(), is kept in a picture private for the next composite.
+ * Anything which changes the picture goes through ValidatePicture, except
+ * for filters, so wrapping those two and DestroyPicture is enough to drop
+ * a stale image; what the drawable is backed by is checked on each use.
+ *
+ * Not for wfb, whose images hold on to access to the pixmap.
+ */
+typedef struct {
+    pixman_image_t *image;
+    PixmapPtr pixmap;
+    void *bits;
+    int devKind;
+    unsigned long serial;       /* of the picture's drawable */
+    unsigned long pixmapSerial;
+    Bool has_clip;
+    int xoff, yoff;
+} fbPictImageRec, *fbPictImagePtr;
+
+typedef struct {
+    DevPrivateKeyRec imageKeyRec;
+    ValidatePictureProcPtr ValidatePicture;
+    ChangePictureFilterProcPtr ChangePictureFilter;
+    DestroyPictureProcPtr DestroyPicture;
+} fbPictScreenRec, *fbPictScreenPtr;
+
+static DevPrivateKeyRec fbPictScreenKeyRec;
+
+static fbPictScreenPtr
+fbGetPictScreen(ScreenPtr pScreen)
+{
+    if (!dixPrivateKeyRegistered(&fbPictScreenKeyRec))
+        return NULL;
+    return dixGetPrivateAddr(&pScreen->devPrivates, &fbPictScreenKeyRec);
+}
+
+static fbPictImagePtr
+fbGetPictImage(PicturePtr pict)
+{
+    fbPictScreenPtr pPictScr = fbGetPictScreen(pict->pDrawable->pScreen);
+
+    if (!pPictScr || !dixPrivateKeyRegistered(&pPictScr->imageKeyRec))
+        return NULL;
+    return dixGetPrivateAddr(&pict->devPrivates, &pPictScr->imageKeyRec);
+}
+
+static void
+fbDropPictImage(PicturePtr pict)
+{
+    fbPictImagePtr cached = fbGetPictImage(pict);
+
+    if (cached && cached->image) {
+        pixman_image_unref(cached->image);
+        cached->image = NULL;
+    }
+}
+
+static void
+fbValidatePicture(PicturePtr pict, Mask mask)
+{
+    fbPictScreenPtr pPictScr = fbGetPictScreen(pict->pDrawable->pScreen);
+
+    fbDropPictImage(pict);
+    (*pPictScr->ValidatePicture) (pict, mask);
+}
+
+static int
+fbChangePictureFilter(PicturePtr pict, int filter, xFixed * params,
+                      int nparams)
+{
+    fbPictScreenPtr pPictScr = fbGetPictScreen(pict->pDrawable->pScreen);
+
+    fbDropPictImage(pict);
+    return (*pPictScr->ChangePictureFilter) (pict, filter, params, nparams);
+}
+
+static void
+fbDestroyPicture(PicturePtr pict)
+{
+    fbPictScreenPtr pPictScr = fbGetPictScreen(pict->pDrawable->pScreen);
+
+    fbDropPictImage(pict);
+    (*pPictScr->DestroyPicture) (pict);
+}
+
+static Bool
+fbPictImageInit(ScreenPtr pScreen)
+{
+    PictureScreenPtr ps = GetPictureScreen(pScreen);
+    fbPictScreenPtr pPictScr;
+
+    if (!dixRegisterPrivateKey(&fbPictScreenKeyRec, PRIVATE_SCREEN,
+                               sizeof(fbPictScreenRec)))
+        return FALSE;
+    pPictScr = fbGetPictScreen(pScreen);
+
+    if (!dixRegisterScreenSpecificPrivateKey(pScreen, &pPictScr->imageKeyRec,
+                                             PRIVATE_PICTURE,
+                                             sizeof(fbPictImageRec)))
+        return FALSE;
+
+    pPictScr->ValidatePicture = ps->ValidatePicture;
+    ps->ValidatePicture = fbValidatePicture;
+    pPictScr->ChangePictureFilter = ps->ChangePictureFilter;
+    ps->ChangePictureFilter = fbChangePictureFilter;
+    pPictScr->DestroyPicture = ps->DestroyPicture;
+    ps->DestroyPicture = fbDestroyPicture;
+    return TRUE;
+}
+
+static pixman_image_t *
+cached_bits_picture(PicturePtr pict, Bool has_clip, int *xoff, int *yoff)
+{
+    fbPictImagePtr cached = fbGetPictImage(pict);
+    DrawablePtr pDrawable = pict->pDrawable;
+    pixman_image_t *image;
+    PixmapPtr pixmap;
+    _X_UNUSED int pix_xoff, pix_yoff;
+
+    if (!cached)
+        return NULL;
+
+    fbGetDrawablePixmap(pDrawable, pixmap, pix_xoff, pix_yoff);
+
+    if (cached->image && cached->has_clip == has_clip &&
+        cached->serial == pDrawable->serialNumber &&
+        cached->pixmap == pixmap &&
+        cached->pixmapSerial == pixmap->drawable.serialNumber &&
+        cached->bits == pixmap->devPrivate.ptr &&
+        cached->devKind == pixmap->devKind) {
+        cacheStats.imageHits++;
+        *xoff = cached->xoff;
+        *yoff = cached->yoff;
+        return pixman_image_ref(cached->image);
+    }
+    cacheStats.imageMisses++;
+    fbDropPictImage(pict);
+
+    image = create_bits_picture(pict, has_clip, xoff, yoff);
+    if (!image)
+        return NULL;
+    set_image_properties(image, pict, has_clip, xoff, yoff, FALSE);
+
+    /* only keep what was made from a validated picture */
+    if (pict->serialNumber == pDrawable->serialNumber) {
+        cached->image = pixman_image_ref(image);
+        cached->pixmap = pixmap;
+        cached->bits = pixmap->devPrivate.ptr;
+        cached->devKind = pixmap->devKind;
+        cached->serial = pDrawable->serialNumber;
+        cached->pixmapSerial = pixmap->drawable.serialNumber;
+        cached->has_clip = has_clip;
+        cached->xoff = *xoff;
+        cached->yoff = *yoff;
+    }
+    return image;
+}
+
+#endif /* FB_ACCESS_WRAPPER */
+
 static pixman_image_t *
 image_from_pict_internal(PicturePtr pict, Bool has_clip, int *xoff, int *yoff,
                          Bool is_alpha_map)
@@ -443,6 +722,12 @@ image_from_pict_internal(PicturePtr pict, Bool has_clip, int *xoff, int *yoff,
         return NULL;
 
     if (pict->pDrawable) {
+#ifndef FB_ACCESS_WRAPPER
+        /* alpha maps are validated separately, leave those alone */
+        if (!is_alpha_map && !pict->alphaMap &&
+            (image = cached_bits_picture(pict, has_clip, xoff, yoff)))
+            return image;
+#endif
         image = create_bits_picture(pict, has_clip, xoff, yoff);
     }
     else if (pict->pSourcePict) {
@@ -452,14 +737,7 @@ image_from_pict_internal(PicturePtr pict, Bool has_clip, int *xoff, int *yoff,
             image = create_solid_fill_image(pict);
         }
         else {
-            PictGradient *gradient = &pict->pSourcePict->gradient;
-
-            if (sp->type == SourcePictTypeLinear)
-                image = create_linear_gradient_image(gradient);
-            else if (sp->type == SourcePictTypeRadial)
-                image = create_radial_gradient_image(gradient);
-            else if (sp->type == SourcePictTypeConical)
-                image = create_conical_gradient_image(gradient);
+            image = create_gradient_image(pict);
         }
         *xoff = *yoff = 0;
     }
@@ -479,8 +757,27 @@ image_from_pict(PicturePtr pict, Bool has_clip, int *xoff, int *yoff)
 void
 free_pixman_pict(PicturePtr pict, pixman_image_t * image)
 {
-    if (image)
-        pixman_image_unref(image);
+    if (!image)
+        return;
+
+    /* cached images must not keep the alpha map's drawable busy */
+    if (pict->alphaMap && pict->pSourcePict)
+        pixman_image_set_alpha_map(image, NULL, 0, 0);
+    pixman_image_unref(image);
+}
+
+void
+fbLogPictCacheStats(ScreenPtr pScreen)
+{
+    if (cacheStats.gradientHits || cacheStats.gradientMisses)
+        LogMessageVerb(X_INFO, 3, "fb: gradient images reused %lu times, "
+                       "realized %lu times\n", cacheStats.gradientHits,
+                       cacheStats.gradientMisses);
+    if (cacheStats.imageHits || cacheStats.imageMisses)
+        LogMessageVerb(X_INFO, 3, "fb: picture images reused %lu times, "
+                       "validated %lu times\n", cacheStats.imageHits,
+                       cacheStats.imageMisses);
+    memset(&cacheStats, 0, sizeof(cacheStats));
 }
 
 Bool
@@ -501,6 +798,14 @@ fbPictureInit(ScreenPtr pScreen, PictFormatPtr formats, int nformats)
     ps->AddTraps = fbAddTraps;
     ps->AddTriangles = fbAddTriangles;
     ps->Triangles = fbTriangles;
+    ps->CompositeBatch = fbCompositeBatch;
+
+    if (!fbGradientInit())
+        return FALSE;
+#ifndef FB_ACCESS_WRAPPER
+    if (!fbPictImageInit(pScreen))
+        return FALSE;
+#endif
 
     return TRUE;
 }
@@ -25,4 +25,9 @@ void fbTriangles(CARD8 op, PicturePtr pSrc, PicturePtr pDst,
                  PictFormatPtr maskFormat, INT16 xSrc, INT16 ySrc,
                  int ntris, xTriangle *tris);
 
+void fbDestroyShapeBand(void);
+
+/* log and reset the picture cache counters, from fbCloseScreen() */
+void fbLogPictCacheStats(ScreenPtr pScreen);
+
 #endif /* XORG_FBPICT_PRIV_H */
@@ -23,6 +23,7 @@
 #include <dix-config.h>
 
 #include "fb/fb_priv.h"
+#include "fb/fbpict_priv.h"
 #include "os/osdep.h"
 
 #undef CreateWindow
@@ -34,6 +35,8 @@ fbCloseScreen(ScreenPtr pScreen)
     DepthPtr depths = pScreen->allowedDepths;
 
     fbDestroyGlyphCache();
+    fbDestroyShapeBand();
+    fbLogPictCacheStats(pScreen);
     for (d = 0; d < pScreen->numDepths; d++)
         free(depths[d].vids);
     free(depths);
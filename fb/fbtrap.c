@@ -87,8 +87,196 @@ typedef void (*CompositeShapesFunc) (pixman_op_t op,
                                      int x_dst, int y_dst,
                                      int n_shapes, const uint8_t * shapes);
 
+typedef struct {
+    CompositeShapesFunc composite;
+    void (*bounds) (const uint8_t *shape, BoxPtr box);
+    void (*add) (pixman_image_t *mask, int x_off, int y_off,
+                 const uint8_t *shape);
+} FbShapeFuncsRec;
+
+/*
+ * Anti-aliased shapes are rasterized a band of rows at a time into a
+ * small mask which is composited and then reused for the next band,
+ * rather than into one mask covering all of them, which pixman would
+ * allocate, clear and walk for every request.  Bands without any shape
+ * are skipped, and each band only spans the shapes crossing it.
+ */
+#define FB_SHAPE_BAND_BYTES     (64 * 1024)
+
+static uint8_t *shapeBand;
+static int shapeBandSize;
+
+static Bool
+fbReserveShapeBand(int size)
+{
+    if (size <= shapeBandSize)
+        return TRUE;
+    free(shapeBand);
+    shapeBand = malloc(size);
+    shapeBandSize = shapeBand ? size : 0;
+    return shapeBand != NULL;
+}
+
+/* from fbCloseScreen() */
+void
+fbDestroyShapeBand(void)
+{
+    free(shapeBand);
+    shapeBand = NULL;
+    shapeBandSize = 0;
+}
+
+static void
+fbShapeBands(const FbShapeFuncsRec *funcs,
+             pixman_op_t op,
+             pixman_image_t *src,
+             pixman_image_t *dst,
+             int x_src, int y_src, int x_dst, int y_dst,
+             const BoxRec *extents,
+             int nshapes, int shape_size, const uint8_t *shapes,
+             const BoxRec *boxes)
+{
+    int stride = (extents->x2 - extents->x1 + 3) & ~3;
+    int rows = max(1, FB_SHAPE_BAND_BYTES / stride);
+    int y, i;
+
+    if (!fbReserveShapeBand(rows * stride))
+        return;
+
+    for (y = extents->y1; y < extents->y2; y += rows) {
+        int y2 = min(y + rows, extents->y2);
+        int x1 = extents->x2, x2 = extents->x1;
+        int band_stride;
+        pixman_image_t *mask;
+
+        for (i = 0; i < nshapes; i++) {
+            if (boxes[i].y1 < y2 && boxes[i].y2 > y) {
+                x1 = min(x1, boxes[i].x1);
+                x2 = max(x2, boxes[i].x2);
+            }
+        }
+        x1 = max(x1, extents->x1);
+        x2 = min(x2, extents->x2);
+        if (x1 >= x2)
+            continue;
+
+        band_stride = (x2 - x1 + 3) & ~3;
+        memset(shapeBand, 0, band_stride * (y2 - y));
+        mask = pixman_image_create_bits(PIXMAN_a8, x2 - x1, y2 - y,
+                                        (uint32_t *) shapeBand, band_stride);
+        if (!mask)
+            return;
+
+        for (i = 0; i < nshapes; i++)
+            if (boxes[i].y1 < y2 && boxes[i].y2 > y)
+                (*funcs->add) (mask, -x1, -y, shapes + i * shape_size);
+
+        pixman_image_composite(op, src, mask, dst,
+                               x_src + x1, y_src + y, 0, 0,
+                               x_dst + x1, y_dst + y, x2 - x1, y2 - y);
+        pixman_image_unref(mask);
+    }
+}
+
+/*
+ * Whether a zero mask leaves the destination alone.  The banded path only
+ * touches the bands which shapes cross, so ops like Src, In or Clear,
+ * which change the destination under a zero mask too, go through pixman
+ * in one piece.  So do the disjoint and conjoint ops, to keep it simple.
+ */
+static Bool
+fbShapeOpBounded(pixman_op_t op)
+{
+    switch (op) {
+    case PIXMAN_OP_CLEAR:
+    case PIXMAN_OP_SRC:
+    case PIXMAN_OP_IN:
+    case PIXMAN_OP_IN_REVERSE:
+    case PIXMAN_OP_OUT:
+    case PIXMAN_OP_ATOP_REVERSE:
+        return FALSE;
+    default:
+        return op < PIXMAN_OP_DISJOINT_CLEAR || op >= PIXMAN_OP_MULTIPLY;
+    }
+}
+
+static Bool
+fbIntersectShapeBox(BoxPtr box, const BoxRec *clip)
+{
+    box->x1 = max(box->x1, clip->x1);
+    box->y1 = max(box->y1, clip->y1);
+    box->x2 = min(box->x2, clip->x2);
+    box->y2 = min(box->y2, clip->y2);
+    return box->x1 < box->x2 && box->y1 < box->y2;
+}
+
+/*
+ * Returns FALSE if the shapes have to go through pixman in one piece:
+ * other mask depths, unbounded ops, and adding straight into an
+ * alpha-only destination, which pixman does without any mask.
+ */
+static Bool
+fbShapesBanded(const FbShapeFuncsRec *funcs,
+               pixman_op_t op,
+               PicturePtr pDst,
+               pixman_format_code_t format,
+               Bool separate,
+               pixman_image_t *src,
+               pixman_image_t *dst,
+               int x_src, int y_src, int x_dst, int y_dst,
+               int nshapes, int shape_size, const uint8_t *shapes)
+{
+    BoxRec clip = pDst->pCompositeClip->extents;
+    BoxRec extents, *boxes;
+    int i;
+
+    if (format != PIXMAN_a8 || !fbShapeOpBounded(op) ||
+        (op == PIXMAN_OP_ADD && pDst->format == PICT_a8))
+        return FALSE;
+
+    /* picture coordinates, like the shapes */
+    clip.x1 -= pDst->pDrawable->x;
+    clip.x2 -= pDst->pDrawable->x;
+    clip.y1 -= pDst->pDrawable->y;
+    clip.y2 -= pDst->pDrawable->y;
+
+    if (separate) {
+        for (i = 0; i < nshapes; i++) {
+            (*funcs->bounds) (shapes + i * shape_size, &extents);
+            if (!fbIntersectShapeBox(&extents, &clip))
+                continue;
+            fbShapeBands(funcs, op, src, dst, x_src, y_src, x_dst, y_dst,
+                         &extents, 1, shape_size, shapes + i * shape_size,
+                         &extents);
+        }
+        return TRUE;
+    }
+
+    boxes = reallocarray(NULL, nshapes, sizeof(BoxRec));
+    if (!boxes)
+        return FALSE;
+
+    extents.x1 = extents.y1 = MAXSHORT;
+    extents.x2 = extents.y2 = MINSHORT;
+    for (i = 0; i < nshapes; i++) {
+        (*funcs->bounds) (shapes + i * shape_size, &boxes[i]);
+        if (boxes[i].x1 >= boxes[i].x2 || boxes[i].y1 >= boxes[i].y2)
+            continue;
+        extents.x1 = min(extents.x1, boxes[i].x1);
+        extents.y1 = min(extents.y1, boxes[i].y1);
+        extents.x2 = max(extents.x2, boxes[i].x2);
+        extents.y2 = max(extents.y2, boxes[i].y2);
+    }
+    if (fbIntersectShapeBox(&extents, &clip))
+        fbShapeBands(funcs, op, src, dst, x_src, y_src, x_dst, y_dst,
+                     &extents, nshapes, shape_size, shapes, boxes);
+
+    free(boxes);
+    return TRUE;
+}
+
 static void
-fbShapes(CompositeShapesFunc composite,
+fbShapes(const FbShapeFuncsRec *funcs,
          pixman_op_t op,
          PicturePtr pSrc,
          PicturePtr pDst,
@@ -118,11 +306,17 @@ fbShapes(CompositeShapesFunc composite,
             else
                 format = PIXMAN_a8;
 
-            for (i = 0; i < nshapes; ++i) {
-                composite(op, src, dst, format,
-                          xSrc + src_xoff,
-                          ySrc + src_yoff,
-                          dst_xoff, dst_yoff, 1, shapes + i * shape_size);
+            if (!fbShapesBanded(funcs, op, pDst, format, TRUE, src, dst,
+                                xSrc + src_xoff, ySrc + src_yoff,
+                                dst_xoff, dst_yoff,
+                                nshapes, shape_size, shapes)) {
+                for (i = 0; i < nshapes; ++i) {
+                    (*funcs->composite) (op, src, dst, format,
+                                         xSrc + src_xoff,
+                                         ySrc + src_yoff,
+                                         dst_xoff, dst_yoff, 1,
+                                         shapes + i * shape_size);
+                }
             }
         }
         else {
@@ -141,9 +335,14 @@ fbShapes(CompositeShapesFunc composite,
                 break;
             }
 
-            composite(op, src, dst, format,
-                      xSrc + src_xoff,
-                      ySrc + src_yoff, dst_xoff, dst_yoff, nshapes, shapes);
+            if (!fbShapesBanded(funcs, op, pDst, format, FALSE, src, dst,
+                                xSrc + src_xoff, ySrc + src_yoff,
+                                dst_xoff, dst_yoff,
+                                nshapes, shape_size, shapes))
+                (*funcs->composite) (op, src, dst, format,
+                                     xSrc + src_xoff,
+                                     ySrc + src_yoff, dst_xoff, dst_yoff,
+                                     nshapes, shapes);
         }
 
         DamageRegionProcessPending(pDst->pDrawable);
@@ -153,6 +352,26 @@ fbShapes(CompositeShapesFunc composite,
     free_pixman_pict(pDst, dst);
 }
 
+static void
+fbTrapezoidBounds(const uint8_t *shape, BoxPtr box)
+{
+    miTrapezoidBounds(1, (xTrapezoid *) shape, box);
+}
+
+static void
+fbAddTrapezoid(pixman_image_t *mask, int x_off, int y_off,
+               const uint8_t *shape)
+{
+    pixman_add_trapezoids(mask, x_off, y_off, 1,
+                          (const pixman_trapezoid_t *) shape);
+}
+
+static const FbShapeFuncsRec fbTrapezoidFuncs = {
+    .composite = (CompositeShapesFunc) pixman_composite_trapezoids,
+    .bounds = fbTrapezoidBounds,
+    .add = fbAddTrapezoid,
+};
+
 void
 fbTrapezoids(CARD8 op,
              PicturePtr pSrc,
@@ -163,11 +382,31 @@ fbTrapezoids(CARD8 op,
     xSrc -= (traps[0].left.p1.x >> 16);
     ySrc -= (traps[0].left.p1.y >> 16);
 
-    fbShapes((CompositeShapesFunc) pixman_composite_trapezoids,
+    fbShapes(&fbTrapezoidFuncs,
              op, pSrc, pDst, maskFormat,
              xSrc, ySrc, ntrap, sizeof(xTrapezoid), (const uint8_t *) traps);
 }
 
+static void
+fbTriangleBounds(const uint8_t *shape, BoxPtr box)
+{
+    miTriangleBounds(1, (xTriangle *) shape, box);
+}
+
+static void
+fbAddTriangle(pixman_image_t *mask, int x_off, int y_off,
+              const uint8_t *shape)
+{
+    pixman_add_triangles(mask, x_off, y_off, 1,
+                         (const pixman_triangle_t *) shape);
+}
+
+static const FbShapeFuncsRec fbTriangleFuncs = {
+    .composite = (CompositeShapesFunc) pixman_composite_triangles,
+    .bounds = fbTriangleBounds,
+    .add = fbAddTriangle,
+};
+
 void
 fbTriangles(CARD8 op,
             PicturePtr pSrc,
@@ -178,7 +417,7 @@ fbTriangles(CARD8 op,
     xSrc -= (tris[0].p1.x >> 16);
     ySrc -= (tris[0].p1.y >> 16);
 
-    fbShapes((CompositeShapesFunc) pixman_composite_triangles,
+    fbShapes(&fbTriangleFuncs,
              op, pSrc, pDst, maskFormat,
              xSrc, ySrc, ntris, sizeof(xTriangle), (const uint8_t *) tris);
 }
@@ -52,6 +52,7 @@ KdKeyboardInfo *ephyrKbd;
 KdPointerInfo *ephyrMouse;
 Bool ephyrNoDRI = FALSE;
 Bool ephyrNoXV = FALSE;
+int ephyrUploadRate = -1;       /* -1 to follow the host's refresh rate */
 
 static int mouseState = 0;
 static Rotation ephyrRandr = RR_Rotate_0;
@@ -309,8 +310,63 @@ ephyrShadowUpdate(ScreenPtr pScreen, shadowBufPtr pBuf)
     hostx_paint_rect(screen, 0, 0, 0, 0, screen->width, screen->height, TRUE);
 }
 
+/* each box is one request to the host */
+#define EPHYR_UPLOAD_RECTS      16
+
+static inline int64_t
+ephyrBoxArea(const BoxRec *box)
+{
+    return (int64_t) (box->x2 - box->x1) * (box->y2 - box->y1);
+}
+
+/*
+ * Merge the damage into at most EPHYR_UPLOAD_RECTS boxes.  Each damaged
+ * box joins the box of the set it grows the least, so many small scattered
+ * updates cost a few requests and some extra pixels instead of a request
+ * each.  Neighbours which line up exactly are merged for free.
+ */
+static int
+ephyrCoalesceDamage(RegionPtr pRegion, BoxPtr boxes)
+{
+    int nbox = RegionNumRects(pRegion);
+    BoxPtr pbox = RegionRects(pRegion);
+    int n = 0;
+
+    while (nbox--) {
+        BoxRec box = *pbox++;
+        int64_t best_cost = INT64_MAX;
+        int i, best = -1;
+
+        for (i = 0; i < n; i++) {
+            BoxRec merged = {
+                .x1 = min(boxes[i].x1, box.x1),
+                .y1 = min(boxes[i].y1, box.y1),
+                .x2 = max(boxes[i].x2, box.x2),
+                .y2 = max(boxes[i].y2, box.y2),
+            };
+            int64_t cost = ephyrBoxArea(&merged) - ephyrBoxArea(&boxes[i]) -
+                ephyrBoxArea(&box);
+
+            if (cost < best_cost) {
+                best_cost = cost;
+                best = i;
+            }
+        }
+
+        if (best >= 0 && (best_cost <= 0 || n == EPHYR_UPLOAD_RECTS)) {
+            boxes[best].x1 = min(boxes[best].x1, box.x1);
+            boxes[best].y1 = min(boxes[best].y1, box.y1);
+            boxes[best].x2 = max(boxes[best].x2, box.x2);
+            boxes[best].y2 = max(boxes[best].y2, box.y2);
+        }
+        else
+            boxes[n++] = box;
+    }
+    return n;
+}
+
 static void
-ephyrInternalDamageRedisplay(ScreenPtr pScreen)
+ephyrInternalDamageRedisplay(ScreenPtr pScreen, void *timeout)
 {
     KdScreenPriv(pScreen);
     KdScreenInfo *screen = pScreenPriv->screen;
@@ -323,25 +379,48 @@ ephyrInternalDamageRedisplay(ScreenPtr pScreen)
     pRegion = DamageRegion(scrpriv->pDamage);
 
     if (RegionNotEmpty(pRegion)) {
-        int nbox;
-        BoxPtr pbox;
+        BoxRec boxes[EPHYR_UPLOAD_RECTS];
+        uint32_t bytes = 0;
+        int i, nbox;
 
         if (ephyr_glamor) {
             ephyr_glamor_damage_redisplay(scrpriv->glamor, pRegion);
-        } else {
-            nbox = RegionNumRects(pRegion);
-            pbox = RegionRects(pRegion);
-
-            while (nbox--) {
-                hostx_paint_rect(screen,
-                                 pbox->x1, pbox->y1,
-                                 pbox->x1, pbox->y1,
-                                 pbox->x2 - pbox->x1, pbox->y2 - pbox->y1,
-                                 nbox == 0);
-                pbox++;
+            DamageEmpty(scrpriv->pDamage);
+            return;
+        }
+
+        /* keep the damage and come back when the host wants a frame */
+        if (scrpriv->upload_interval) {
+            CARD32 now = GetTimeInMillis();
+            CARD32 since = now - scrpriv->last_upload;
+
+            if (since < scrpriv->upload_interval) {
+                AdjustWaitForDelay(timeout, scrpriv->upload_interval - since);
+                return;
             }
+            scrpriv->last_upload = now;
+        }
+
+        nbox = ephyrCoalesceDamage(pRegion, boxes);
+        for (i = 0; i < nbox; i++) {
+            int width = boxes[i].x2 - boxes[i].x1;
+            int height = boxes[i].y2 - boxes[i].y1;
+
+            hostx_paint_rect(screen,
+                             boxes[i].x1, boxes[i].y1,
+                             boxes[i].x1, boxes[i].y1,
+                             width, height, i == nbox - 1);
+            bytes += width * height * (screen->fb.bitsPerPixel >> 3);
         }
         DamageEmpty(scrpriv->pDamage);
+
+        scrpriv->upload_frames++;
+        scrpriv->upload_rects += nbox;
+        scrpriv->upload_bytes += bytes;
+        if (bytes > scrpriv->upload_max_bytes)
+            scrpriv->upload_max_bytes = bytes;
+        DebugF("Xephyr: screen %d uploaded %d rects, %u bytes\n",
+               scrpriv->mynum, nbox, bytes);
     }
 }
 
@@ -368,7 +447,7 @@ ephyrScreenBlockHandler(ScreenPtr pScreen, void *timeout)
     pScreen->BlockHandler = ephyrScreenBlockHandler;
 
     if (scrpriv->pDamage)
-        ephyrInternalDamageRedisplay(pScreen);
+        ephyrInternalDamageRedisplay(pScreen, timeout);
 
     if (hostx_has_queued_event()) {
         if (!QueueWorkProc(ephyrEventWorkProc, NULL, NULL))
@@ -393,6 +472,17 @@ ephyrSetInternalDamage(ScreenPtr pScreen)
 
     DamageRegister(&pPixmap->drawable, scrpriv->pDamage);
 
+    if (ephyrUploadRate < 0) {
+        int rate = hostx_get_refresh_rate();
+
+        scrpriv->upload_interval = 1000 / (rate > 0 ? rate : 60);
+    }
+    else if (ephyrUploadRate > 0)
+        scrpriv->upload_interval = max(1000 / ephyrUploadRate, 1);
+    else
+        scrpriv->upload_interval = 0;
+    scrpriv->last_upload = GetTimeInMillis() - scrpriv->upload_interval;
+
     return TRUE;
 }
 
@@ -864,7 +954,20 @@ ephyrScreenFini(KdScreenInfo * screen)
 void
 ephyrCloseScreen(ScreenPtr pScreen)
 {
+    KdScreenPriv(pScreen);
+    KdScreenInfo *screen = pScreenPriv->screen;
+    EphyrScrPriv *scrpriv = screen->driver;
+
     ephyrUnsetInternalDamage(pScreen);
+
+    if (scrpriv->upload_frames)
+        LogMessageVerb(X_INFO, 3, "Xephyr: screen %d uploaded %llu frames, "
+                       "%llu rects, %llu bytes, at most %u bytes per frame\n",
+                       scrpriv->mynum,
+                       (unsigned long long) scrpriv->upload_frames,
+                       (unsigned long long) scrpriv->upload_rects,
+                       (unsigned long long) scrpriv->upload_bytes,
+                       scrpriv->upload_max_bytes);
 }
 
 /*
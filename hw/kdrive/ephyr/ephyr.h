@@ -88,6 +88,14 @@ typedef struct _ephyrScrPriv {
 
     ScreenBlockHandlerProcPtr   BlockHandler;
 
+    /* host uploads of the damaged framebuffer */
+    CARD32 upload_interval;     /* ms between uploads, 0 for no pacing */
+    CARD32 last_upload;
+    uint64_t upload_frames;
+    uint64_t upload_rects;
+    uint64_t upload_bytes;
+    uint32_t upload_max_bytes;  /* largest single frame */
+
     struct ephyr_glamor *glamor;
 } EphyrScrPriv;
 
@@ -44,6 +44,7 @@ extern Bool kdHasKbd;
 extern Bool ephyr_glamor, ephyr_glamor_gles2, ephyr_glamor_skip_present;
 
 extern Bool ephyrNoXV;
+extern int ephyrUploadRate;
 
 void processScreenOrOutputArg(const char *screen_size, const char *output, char *parent_id);
 void processOutputArg(const char *output, char *parent_id);
@@ -133,6 +134,7 @@ ddxUseMsg(void)
         ("-fakexa              Simulate acceleration using software rendering\n");
     ErrorF("-verbosity <level>   Set log verbosity level\n");
     ErrorF("-noxv                do not use XV\n");
+    ErrorF("-upload-rate <hz>    Update the host window at most this often (default: host refresh rate, 0: on every change)\n");
     ErrorF("-name <name>         define the name in the WM_CLASS property\n");
     ErrorF
         ("-title <title>       set the window title in the WM_NAME property\n");
@@ -300,6 +302,16 @@ ddxProcessArgument(int argc, char **argv, int i)
         EPHYR_LOG("no XVideo enabled\n");
         return 1;
     }
+    else if (!strcmp(argv[i], "-upload-rate")) {
+        if (i + 1 < argc && argv[i + 1][0] != '-') {
+            ephyrUploadRate = atoi(argv[i + 1]);
+            return 2;
+        }
+        else {
+            UseMsg();
+            exit(1);
+        }
+    }
     else if (!strcmp(argv[i], "-name")) {
         if (i + 1 < argc && argv[i + 1][0] != '-') {
             hostx_use_resname(argv[i + 1], 1);
@@ -1135,6 +1135,27 @@ hostx_paint_rect(KdScreenInfo *screen,
     }
 }
 
+/* Refresh rate of the host screen in Hz, 0 if it doesn't say */
+int
+hostx_get_refresh_rate(void)
+{
+    xcb_randr_get_screen_info_reply_t *reply;
+    int rate;
+
+    if (!hostx_has_extension(&xcb_randr_id))
+        return 0;
+
+    reply = xcb_randr_get_screen_info_reply(HostX.conn,
+                                            xcb_randr_get_screen_info(HostX.conn,
+                                                                      HostX.winroot),
+                                            NULL);
+    if (!reply)
+        return 0;
+    rate = reply->rate;
+    free(reply);
+    return rate;
+}
+
 static void
 hostx_paint_debug_rect(KdScreenInfo *screen,
                        int x, int y, int width, int height)
@@ -149,6 +149,9 @@ hostx_paint_rect(KdScreenInfo *screen,
                  int sx, int sy, int dx, int dy, int width, int height,
                  Bool sync);
 
+int
+hostx_get_refresh_rate(void);
+
 Bool
 hostx_load_keymap(KeySymsPtr keySyms, CARD8 *modmap, XkbControlsPtr controls);
 
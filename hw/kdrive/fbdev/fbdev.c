@@ -456,6 +456,7 @@ fbdevSetShadow(ScreenPtr pScreen)
     KdScreenInfo *screen = pScreenPriv->screen;
     FbdevScrPriv *scrpriv = screen->driver;
     FbdevPriv *priv = screen->card->driver;
+    FbScreenConf *config = screen->card->closure;
     ShadowUpdateProc update;
     ShadowWindowProc window;
     int useYX = 0;
@@ -551,7 +552,13 @@ fbdevSetShadow(ScreenPtr pScreen)
         break;
     }
 
-    return KdShadowSet(pScreen, scrpriv->randr, update, window);
+    if (!KdShadowSet(pScreen, scrpriv->randr, update, window))
+        return FALSE;
+
+    if (config->fbShadowAsync && screen->fb.shadow &&
+        !shadowSetAsync(pScreen, TRUE))
+        LogMessage(X_WARNING, "Xfbdev: could not start the ShadowFB flush thread\n");
+    return TRUE;
 }
 
 #ifdef RANDR
@@ -632,6 +639,8 @@ fbdevRandRSetConfig(ScreenPtr pScreen,
     pScreen->mmWidth = newmmwidth;
     pScreen->mmHeight = newmmheight;
 
+    /* the flush thread may still be reading the shadow */
+    shadowFlushWait(pScreen);
     fbdevUnmapFramebuffer(screen);
 
     if (!fbdevMapFramebuffer(screen))
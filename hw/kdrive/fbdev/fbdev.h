@@ -55,6 +55,7 @@ typedef struct _fbdevScrPriv {
 typedef struct _fbScreenConf {
 const char *fbdevDevicePath;
 bool fbDisableShadow;
+bool fbShadowAsync;
 bool fbNoAccel;
 
 char *fbdev_glvnd_provider;
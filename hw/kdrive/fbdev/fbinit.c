@@ -35,6 +35,7 @@ static FbScreenConf *fbCurrScreen = NULL;
 static const FbScreenConf fbDefaultConfig = {
                                              .fbdevDevicePath = NULL,
                                              .fbDisableShadow = FALSE,
+                                             .fbShadowAsync = FALSE,
 
                                              .fbdev_glvnd_provider = NULL,
 
@@ -102,6 +103,8 @@ fbdevLogScreenInfo(const FbScreenConf *config, int screen_num)
                config->fbdevDevicePath ? config->fbdevDevicePath : "not passed");
     LogMessage(X_INFO, "Xfbdev(%d): ShadowFB %s\n", screen_num,
                config->fbDisableShadow ? "disabled" : "enabled");
+    LogMessage(X_INFO, "Xfbdev(%d): ShadowFB flush thread %s\n", screen_num,
+               config->fbShadowAsync ? "enabled" : "disabled");
     LogMessage(X_INFO, "Xfbdev(%d): HW Acceleration %s\n", screen_num,
                config->fbNoAccel ? "disabled" : "enabled");
 
@@ -179,6 +182,8 @@ ddxUseMsg(void)
         ("-drm-master          Enable master permissions on the fd used for dri\n");
     ErrorF
         ("-noshadow            Disable the ShadowFB layer if possible\n");
+    ErrorF
+        ("-shadowAsync         Copy the ShadowFB to the screen from a separate thread\n");
     ErrorF
         ("-noaccel             Disable hw acceleration (per screen)\n");
     ErrorF
@@ -231,6 +236,11 @@ ddxProcessArgument(int argc, char **argv, int i)
         return 1;
     }
 
+    if (!strcmp(argv[i], "-shadowAsync")) {
+        fbCurrScreen->fbShadowAsync = TRUE;
+        return 1;
+    }
+
     if (!strcmp(argv[i], "-noaccel")) {
         fbCurrScreen->fbNoAccel = TRUE;
         return 1;
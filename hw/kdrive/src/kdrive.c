@@ -267,6 +267,7 @@ ddxGiveUp(enum ExitCode error)
 
 Bool kdDumbDriver;
 Bool kdSoftCursor;
+int kdShadowTileSize;
 
 const char *
 KdParseFindNext(const char *cur, const char *delim, char *save, char *last)
@@ -462,6 +463,7 @@ KdUseMsg(void)
         ("-rawcoord        Don't transform pointer coordinates on rotation\n");
     ErrorF("-dumb            Disable hardware acceleration\n");
     ErrorF("-softCursor      Force software cursor\n");
+    ErrorF("-shadowTiles N   Skip unchanged NxN tiles in shadow updates\n");
     ErrorF("-videoTest       Start the server, pause momentarily and exit\n");
     ErrorF
         ("-origin X,Y      Locates the next screen in the virtual screen (Xinerama)\n");
@@ -528,6 +530,19 @@ KdProcessArgument(int argc, char **argv, int i)
         kdSoftCursor = TRUE;
         return 1;
     }
+    if (!strcmp(argv[i], "-shadowTiles")) {
+        char *end;
+        long size;
+
+        if ((i + 1) >= argc)
+            FatalError("Missing argument for option -shadowTiles.\n");
+        size = strtol(argv[i + 1], &end, 10);
+        if (end == argv[i + 1] || *end != '\0' || size <= 0 || size > 4096)
+            FatalError("Invalid tile size %s passed to -shadowTiles\n",
+                       argv[i + 1]);
+        kdShadowTileSize = size;
+        return 2;
+    }
     if (!strcmp(argv[i], "-videoTest")) {
         kdVideoTest = TRUE;
         return 1;
@@ -340,6 +340,7 @@ extern Bool kdDisableZaphod;
 extern Bool kdAllowZap;
 extern int kdVirtualTerminal;
 extern char *kdSwitchCmd;
+extern int kdShadowTileSize;
 
 /*
  * pointer to OS/platform specific callbacks from kdrive core back
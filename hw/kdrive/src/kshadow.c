@@ -65,6 +65,8 @@ KdShadowSet(ScreenPtr pScreen, int randr, ShadowUpdateProc update,
 
     shadowRemove(pScreen, pScreen->GetScreenPixmap(pScreen));
     if (screen->fb.shadow) {
+        if (kdShadowTileSize && !shadowTilesEnable(pScreen, kdShadowTileSize))
+            return FALSE;
         return shadowAdd(pScreen, pScreen->GetScreenPixmap(pScreen),
                          update, window, randr, 0);
     }
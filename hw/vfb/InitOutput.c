@@ -38,6 +38,7 @@ from The Open Group.
 
 #include "dix/colormap_priv.h"
 #include "dix/dix_priv.h"
+#include "dix/screen_hooks_priv.h"
 #include "dix/screenint_priv.h"
 #include "include/extinit.h"
 #include "mi/mi_priv.h"
@@ -64,6 +65,8 @@ from The Open Group.
 #endif                          /* HAVE_MMAP */
 #include <sys/stat.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #ifndef WIN32
 #include <sys/param.h>
 #endif
@@ -76,13 +79,17 @@ from The Open Group.
 #include "miline.h"
 #include "glx_extinit.h"
 #include "randrstr.h"
+#include "damage.h"
+#include "vfbdamage.h"
+#ifdef __linux__
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
 
 #ifdef GLAMOR
 #include "glamor.h"
 #include "glamor_egl.h"
-
-#include <unistd.h>
-#include <fcntl.h>
 #endif
 
 #define VFB_DEFAULT_WIDTH      1280
@@ -93,6 +100,7 @@ from The Open Group.
 #define VFB_DEFAULT_LINEBIAS      0
 #define VFB_DEFAULT_NUM_CRTCS     1
 #define XWD_WINDOW_NAME_LEN      60
+#define VFB_DAMAGE_RING_RECTS  4096
 
 typedef struct {
     int width;
@@ -120,10 +128,15 @@ typedef struct {
     Pixel whitePixel;
     unsigned int lineBias;
     CloseScreenProcPtr closeScreen;
+    ScreenBlockHandlerProcPtr blockHandler;
+
+    vfbDamageRingPtr pDamageRing;
+    DamagePtr pDamage;
 
 #ifdef HAVE_MMAP
     int mmap_fd;
     char mmap_file[MAXPATHLEN];
+    char damage_file[MAXPATHLEN];
 #endif
 
 #ifdef CONFIG_MITSHM
@@ -155,6 +168,7 @@ typedef enum { NORMAL_MEMORY_FB, SHARED_MEMORY_FB, MMAPPED_FILE_FB } fbMemType;
 static fbMemType fbmemtype = NORMAL_MEMORY_FB;
 static char needswap = 0;
 static Bool Render = TRUE;
+static Bool damageRing = FALSE;
 #ifdef GLAMOR
 static Bool use_glamor = FALSE;
 static char *render_node = NULL;
@@ -239,6 +253,11 @@ freeScreenInfo(vfbScreenInfoPtr pvfb)
             ErrorF("unlink %s failed, %s",
                    pvfb->mmap_file, strerror(errno));
         }
+        if (pvfb->pDamageRing && -1 == unlink(pvfb->damage_file)) {
+            perror("unlink");
+            ErrorF("unlink %s failed, %s",
+                   pvfb->damage_file, strerror(errno));
+        }
         break;
 #else                           /* HAVE_MMAP */
     case MMAPPED_FILE_FB:
@@ -251,6 +270,10 @@ freeScreenInfo(vfbScreenInfoPtr pvfb)
             perror("shmdt");
             ErrorF("shmdt failed, %s", strerror(errno));
         }
+        if (pvfb->pDamageRing && -1 == shmdt((char *) pvfb->pDamageRing)) {
+            perror("shmdt");
+            ErrorF("shmdt failed, %s", strerror(errno));
+        }
         break;
 #else /* CONFIG_MITSHM */
     case SHARED_MEMORY_FB:
@@ -315,6 +338,10 @@ ddxUseMsg(void)
     ErrorF("-shmem                 put framebuffers in shared memory\n");
 #endif /* CONFIG_MITSHM */
 
+#if defined(HAVE_MMAP) || defined(CONFIG_MITSHM)
+    ErrorF("-damagering            publish damaged rectangles next to the framebuffers\n");
+#endif
+
 #ifdef GLAMOR
     ErrorF("-glamor                enable glamor render acceleration\n");
     ErrorF("-dri </dev/dri/renderDxxx>  render device to use\n");
@@ -440,6 +467,13 @@ ddxProcessArgument(int argc, char *argv[], int i)
     }
 #endif /* CONFIG_MITSHM */
 
+#if defined(HAVE_MMAP) || defined(CONFIG_MITSHM)
+    if (strcmp(argv[i], "-damagering") == 0) {  /* -damagering */
+        damageRing = TRUE;
+        return 1;
+    }
+#endif
+
 #ifdef GLAMOR
     if (strcmp(argv[i], "-glamor") == 0) {
         use_glamor = TRUE;
@@ -592,10 +626,6 @@ vfbWakeupHandler(void *blockData, int result)
 static void
 vfbAllocateMmappedFramebuffer(vfbScreenInfoPtr pvfb)
 {
-#define DUMMY_BUFFER_SIZE 65536
-    char dummyBuffer[DUMMY_BUFFER_SIZE];
-    int currentFileSize, writeThisTime;
-
     snprintf(pvfb->mmap_file, sizeof(pvfb->mmap_file), "%s/Xvfb_screen%d",
              pfbdir, (int) (pvfb - vfbScreens));
     if (-1 == (pvfb->mmap_fd = open(pvfb->mmap_file, O_CREAT | O_RDWR, 0666))) {
@@ -604,19 +634,15 @@ vfbAllocateMmappedFramebuffer(vfbScreenInfoPtr pvfb)
         return;
     }
 
-    /* Extend the file to be the proper size */
-
-    memset(dummyBuffer, 0, DUMMY_BUFFER_SIZE);
-    for (currentFileSize = 0;
-         currentFileSize < pvfb->sizeInBytes;
-         currentFileSize += writeThisTime) {
-        writeThisTime = min(DUMMY_BUFFER_SIZE,
-                            pvfb->sizeInBytes - currentFileSize);
-        if (-1 == write(pvfb->mmap_fd, dummyBuffer, writeThisTime)) {
-            perror("write");
-            ErrorF("write %s failed, %s", pvfb->mmap_file, strerror(errno));
-            return;
-        }
+    /*
+     * Clear the file and extend it to the proper size.  It stays sparse,
+     * pages are only allocated once something is drawn on them.
+     */
+    if (-1 == ftruncate(pvfb->mmap_fd, 0) ||
+        -1 == ftruncate(pvfb->mmap_fd, pvfb->sizeInBytes)) {
+        perror("ftruncate");
+        ErrorF("ftruncate %s failed, %s", pvfb->mmap_file, strerror(errno));
+        return;
     }
 
     /* try to mmap the file */
@@ -795,6 +821,152 @@ vfbWriteXWDFileHeader(ScreenPtr pScreen)
     }
 }
 
+/* The damage ring lives next to the framebuffer, see vfbdamage.h */
+static void
+vfbAllocateDamageRing(vfbScreenInfoPtr pvfb)
+{
+    size_t size = sizeof(vfbDamageRing) +
+        VFB_DAMAGE_RING_RECTS * sizeof(vfbDamageRect);
+    vfbDamageRingPtr ring = NULL;
+
+    switch (fbmemtype) {
+#ifdef HAVE_MMAP
+    case MMAPPED_FILE_FB: {
+        int fd;
+
+        snprintf(pvfb->damage_file, sizeof(pvfb->damage_file),
+                 "%s/Xvfb_screen%d.damage", pfbdir, (int) (pvfb - vfbScreens));
+        fd = open(pvfb->damage_file, O_CREAT | O_TRUNC | O_RDWR, 0666);
+        if (fd == -1) {
+            ErrorF("open %s failed, %s\n", pvfb->damage_file, strerror(errno));
+            return;
+        }
+        if (ftruncate(fd, size) == -1) {
+            ErrorF("ftruncate %s failed, %s\n", pvfb->damage_file,
+                   strerror(errno));
+            close(fd);
+            unlink(pvfb->damage_file);
+            return;
+        }
+        ring = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_FILE | MAP_SHARED,
+                    fd, 0);
+        close(fd);
+        if (ring == MAP_FAILED) {
+            ErrorF("mmap %s failed, %s\n", pvfb->damage_file, strerror(errno));
+            unlink(pvfb->damage_file);
+            return;
+        }
+        break;
+    }
+#endif                          /* HAVE_MMAP */
+
+#ifdef CONFIG_MITSHM
+    case SHARED_MEMORY_FB: {
+        int shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0777);
+
+        if (shmid < 0) {
+            ErrorF("shmget %zu bytes failed, %s\n", size, strerror(errno));
+            return;
+        }
+        ring = shmat(shmid, 0, 0);
+        if (ring == (void *) -1) {
+            ErrorF("shmat failed, %s\n", strerror(errno));
+            return;
+        }
+        ErrorF("screen %d damage shmid %d\n", (int) (pvfb - vfbScreens), shmid);
+        break;
+    }
+#endif /* CONFIG_MITSHM */
+
+    default:
+        ErrorF("-damagering needs -fbdir or -shmem, ignored\n");
+        return;
+    }
+
+    memset(ring, 0, size);
+    ring->version = VFB_DAMAGE_VERSION;
+    ring->nrects = VFB_DAMAGE_RING_RECTS;
+    ring->width = pvfb->width;
+    ring->height = pvfb->height;
+    __atomic_store_n(&ring->magic, VFB_DAMAGE_MAGIC, __ATOMIC_RELEASE);
+
+    pvfb->pDamageRing = ring;
+}
+
+/*
+ * Append the damage accumulated since the last update to the ring and
+ * wake up whoever waits for it.
+ */
+static void
+vfbPublishDamage(ScreenPtr pScreen, vfbScreenInfoPtr pvfb)
+{
+    vfbDamageRingPtr ring = pvfb->pDamageRing;
+    RegionPtr region = DamageRegion(pvfb->pDamage);
+    int nbox = RegionNumRects(region);
+    BoxPtr pbox = RegionRects(region);
+    uint32_t head = ring->committed;
+
+    /* a consumer won't do better than the bounding box of that many */
+    if (nbox > VFB_DAMAGE_RING_RECTS / 4) {
+        pbox = RegionExtents(region);
+        nbox = 1;
+    }
+
+    /* readers check 'claimed' after copying to detect overwritten slots */
+    __atomic_store_n(&ring->claimed, head + nbox, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    for (; nbox--; pbox++, head++) {
+        vfbDamageRect *rect = &ring->rects[head & (VFB_DAMAGE_RING_RECTS - 1)];
+
+        rect->x = pbox->x1;
+        rect->y = pbox->y1;
+        rect->width = pbox->x2 - pbox->x1;
+        rect->height = pbox->y2 - pbox->y1;
+    }
+    ring->width = pScreen->width;
+    ring->height = pScreen->height;
+
+    __atomic_store_n(&ring->committed, head, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&ring->frame, 1, __ATOMIC_SEQ_CST);
+#ifdef __linux__
+    if (__atomic_load_n(&ring->waiters, __ATOMIC_SEQ_CST))
+        syscall(SYS_futex, &ring->frame, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#endif
+
+    DamageEmpty(pvfb->pDamage);
+}
+
+static void
+vfbScreenBlockHandler(ScreenPtr pScreen, void *timeout)
+{
+    vfbScreenInfoPtr pvfb = &vfbScreens[pScreen->myNum];
+
+    /* let the software cursor and friends finish drawing first */
+    pScreen->BlockHandler = pvfb->blockHandler;
+    (*pScreen->BlockHandler) (pScreen, timeout);
+    pvfb->blockHandler = pScreen->BlockHandler;
+    pScreen->BlockHandler = vfbScreenBlockHandler;
+
+    if (pvfb->pDamage && RegionNotEmpty(DamageRegion(pvfb->pDamage)))
+        vfbPublishDamage(pScreen, pvfb);
+}
+
+static void
+vfbCreateScreenResources(CallbackListPtr *pcbl, ScreenPtr pScreen, Bool *ret)
+{
+    vfbScreenInfoPtr pvfb = &vfbScreens[pScreen->myNum];
+
+    pvfb->pDamage = DamageCreate(NULL, NULL, DamageReportNone, TRUE,
+                                 pScreen, pScreen);
+    if (!pvfb->pDamage) {
+        *ret = FALSE;
+        return;
+    }
+    DamageRegister(&pScreen->GetScreenPixmap(pScreen)->drawable,
+                   pvfb->pDamage);
+}
+
 static Bool
 vfbCursorOffScreen(ScreenPtr *ppScreen, int *x, int *y)
 {
@@ -819,6 +991,15 @@ vfbCloseScreen(ScreenPtr pScreen)
 
     pScreen->CloseScreen = pvfb->closeScreen;
 
+    if (pvfb->pDamageRing) {
+        dixScreenUnhookPostCreateResources(pScreen, vfbCreateScreenResources);
+        pScreen->BlockHandler = pvfb->blockHandler;
+        if (pvfb->pDamage) {
+            DamageDestroy(pvfb->pDamage);
+            pvfb->pDamage = NULL;
+        }
+    }
+
     /*
      * fb overwrites miCloseScreen, so do this here
      */
@@ -1133,6 +1314,26 @@ vfbScreenInit(ScreenPtr pScreen, int argc, char **argv)
 
     miSetZeroLineBias(pScreen, pvfb->lineBias);
 
+    /*
+     * The framebuffer starts out zeroed, so when that is black,
+     * "-background none" leaves the root window alone and its memory
+     * untouched until a client draws.
+     */
+    if (pvfb->blackPixel == 0)
+        pScreen->canDoBGNoneRoot = TRUE;
+
+    if (damageRing) {
+        if (!pvfb->pDamageRing)
+            vfbAllocateDamageRing(pvfb);
+        if (pvfb->pDamageRing) {
+            if (!DamageSetup(pScreen))
+                return FALSE;
+            dixScreenHookPostCreateResources(pScreen, vfbCreateScreenResources);
+            pvfb->blockHandler = pScreen->BlockHandler;
+            pScreen->BlockHandler = vfbScreenBlockHandler;
+        }
+    }
+
     pvfb->closeScreen = pScreen->CloseScreen;
     pScreen->CloseScreen = vfbCloseScreen;
 
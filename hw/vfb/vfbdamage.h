@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Layout of the Xvfb damage ring (-damagering).
+ *
+ * Next to each screen's framebuffer, Xvfb publishes the rectangles which
+ * changed since the previous update, so that screen scrapers only need to
+ * copy those pixels instead of diffing the whole framebuffer.  The ring
+ * lives in <fbdir>/Xvfb_screen<n>.damage with -fbdir, or in a shared
+ * memory segment whose id is printed at startup with -shmem.
+ *
+ * The server appends the damaged boxes of every update to rects[] and
+ * then bumps 'frame'.  A consumer keeps its own 'tail', starting at the
+ * value of 'committed' when it attached, and for each update:
+ *
+ *   end = atomic_load_acquire(&ring->committed);
+ *   copy rects[tail % nrects] .. rects[(end - 1) % nrects] and the pixels;
+ *   atomic_thread_fence(acquire);
+ *   if (atomic_load(&ring->claimed) - tail > nrects)
+ *       the server lapped us: copy the whole screen instead;
+ *   tail = end;
+ *
+ * Counters are 32 bits and wrap, compare them by unsigned difference.
+ *
+ * On Linux, 'frame' is a futex: a consumer with nothing to do increments
+ * 'waiters', checks 'frame' once more and then FUTEX_WAITs on it (a shared,
+ * not private, futex), decrementing 'waiters' when it wakes.  Elsewhere
+ * consumers have to poll 'frame'.
+ */
+#ifndef _XSERVER_VFBDAMAGE_H
+#define _XSERVER_VFBDAMAGE_H
+
+#include <stdint.h>
+
+#define VFB_DAMAGE_MAGIC        0x44465658      /* "XVFD" */
+#define VFB_DAMAGE_VERSION      1
+
+typedef struct {
+    uint16_t x, y;
+    uint16_t width, height;
+} vfbDamageRect;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t nrects;            /* size of rects[], a power of two */
+    uint32_t width, height;     /* screen size at the last update */
+    uint32_t frame;             /* number of updates published */
+    uint32_t waiters;           /* consumers sleeping on frame */
+    uint32_t claimed;           /* rects the server started writing */
+    uint32_t committed;         /* rects the server finished writing */
+    uint32_t pad[7];
+    vfbDamageRect rects[];
+} vfbDamageRing, *vfbDamageRingPtr;
+
+#endif /* _XSERVER_VFBDAMAGE_H */
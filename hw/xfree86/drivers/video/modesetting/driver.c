@@ -158,6 +158,7 @@ static const OptionInfoRec Options[] = {
     {OPTION_USE_GAMMA_LUT, "UseGammaLUT", OPTV_BOOLEAN, {0}, FALSE},
     {OPTION_ASYNC_FLIP_SECONDARIES, "AsyncFlipSecondaries", OPTV_BOOLEAN, {0}, FALSE},
     {OPTION_TEARFREE, "TearFree", OPTV_BOOLEAN, {0}, FALSE},
+    {OPTION_ASYNC_SHADOW, "AsyncShadow", OPTV_BOOLEAN, {0}, FALSE},
     {-1, NULL, OPTV_NONE, {0}, FALSE}
 };
 
@@ -1356,6 +1357,9 @@ PreInit(ScrnInfoPtr pScrn, int flags)
                    ms->drmmode.shadow_enable ? "YES" : "NO");
 
         ms->drmmode.shadow_enable2 = msShouldDoubleShadow(pScrn, ms);
+        ms->drmmode.shadow_async = ms->drmmode.shadow_enable &&
+            xf86ReturnOptValBool(ms->drmmode.Options, OPTION_ASYNC_SHADOW,
+                                 FALSE);
     } else {
         if (!pScrn->is_gpu) {
             MessageType from = xf86GetOptValBool(ms->drmmode.Options, OPTION_VARIABLE_REFRESH,
@@ -1475,6 +1479,8 @@ PreInit(ScrnInfoPtr pScrn, int flags)
         ms->shadow.Remove       = LoaderSymbolFromModule(mod, "shadowRemove");
         ms->shadow.Update32to24 = LoaderSymbolFromModule(mod, "shadowUpdate32to24");
         ms->shadow.UpdatePacked = LoaderSymbolFromModule(mod, "shadowUpdatePacked");
+        ms->shadow.SetAsync     = LoaderSymbolFromModule(mod, "shadowSetAsync");
+        ms->shadow.FlushWait    = LoaderSymbolFromModule(mod, "shadowFlushWait");
     }
 
     return TRUE;
@@ -1782,6 +1788,17 @@ modesetCreateScreenResources(ScreenPtr pScreen)
         }
     }
 
+    if (ms->drmmode.shadow_async) {
+        /* DirtyFB and TearFree expect the front buffer current once the
+         * shadow block handler returns */
+        if (ms->dirty_enabled || ms->drmmode.tearfree_enable ||
+            !ms->shadow.SetAsync(pScreen, TRUE))
+            ms->drmmode.shadow_async = FALSE;
+        xf86DrvMsg(pScrn->scrnIndex, X_INFO,
+                   "Asynchronous shadow updates: %s\n",
+                   ms->drmmode.shadow_async ? "on" : "off");
+    }
+
     if (dixPrivateKeyRegistered(rrPrivKey)) {
         rrScrPrivPtr pScrPriv = rrGetScrPriv(pScreen);
 
@@ -72,6 +72,7 @@ typedef enum {
     OPTION_USE_GAMMA_LUT,
     OPTION_ASYNC_FLIP_SECONDARIES,
     OPTION_TEARFREE,
+    OPTION_ASYNC_SHADOW,
 } modesettingOpts;
 
 typedef struct
@@ -161,6 +162,8 @@ typedef struct _modesettingRec {
         void (*Remove)(ScreenPtr, PixmapPtr);
         void (*Update32to24)(ScreenPtr, shadowBufPtr);
         void (*UpdatePacked)(ScreenPtr, shadowBufPtr);
+        Bool (*SetAsync)(ScreenPtr, Bool);
+        void (*FlushWait)(ScreenPtr);
     } shadow;
 
 #ifdef GLAMOR
@@ -3919,6 +3919,10 @@ drmmode_xf86crtc_resize(ScrnInfoPtr scrn, int width, int height)
     xf86DrvMsg(scrn->scrnIndex, X_INFO,
                "Allocate new frame buffer %dx%d stride\n", width, height);
 
+    /* the flush thread may still be reading the old buffers */
+    if (drmmode->shadow_async)
+        ms->shadow.FlushWait(screen);
+
     old_width = scrn->virtualX;
     old_height = scrn->virtualY;
     old_pitch = gbm_bo_get_stride(drmmode->front_bo);
@@ -104,6 +104,8 @@ typedef struct {
     Bool glamor_gbm_device;
     Bool shadow_enable;
     Bool shadow_enable2;
+    /** Is Option "AsyncShadow" enabled? */
+    Bool shadow_async;
     /** Is Option "PageFlip" enabled? */
     Bool pageflip;
     Bool force_24_32;
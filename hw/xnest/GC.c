@@ -83,12 +83,15 @@ xnestCreateGC(GCPtr pGC)
 
     pGC->miTranslate = 1;
 
+    /* xnestCopyArea() turns exposures on when it needs them */
+    uint32_t exposures = 0;
+
     xnestGCPriv(pGC)->gc = xcb_generate_id(xnestUpstreamInfo.conn);
     xcb_create_gc(xnestUpstreamInfo.conn,
                   xnestGCPriv(pGC)->gc,
                   xnestDefaultDrawables[pGC->depth],
-                  0,
-                  NULL);
+                  XCB_GC_GRAPHICS_EXPOSURES,
+                  &exposures);
 
     return TRUE;
 }
@@ -155,8 +158,8 @@ xnestChangeGC(GCPtr pGC, unsigned long mask)
     if (mask & GCSubwindowMode)
         values.subwindow_mode = pGC->subWindowMode;
 
-    if (mask & GCGraphicsExposures)
-        values.graphics_exposures = pGC->graphicsExposures;
+    if (mask & GCGraphicsExposures)     /* upstream GCs keep them off */
+        mask &= ~GCGraphicsExposures;
 
     if (mask & GCClipXOrigin)
         values.clip_originX = pGC->clipOrg.x;
@@ -60,10 +60,38 @@ xnestGetSpans(DrawablePtr pDrawable, int maxWidth, DDXPointPtr pPoints,
     ErrorF("xnest warning: function xnestGetSpans not implemented\n");
 }
 
+/* answers only depend on the upstream screen, keep the recent ones */
+#define XNEST_BEST_SIZE_CACHE 16
+
+static struct {
+    unsigned long generation;
+    int screen;
+    int class;
+    unsigned short width, height;
+    unsigned short bestWidth, bestHeight;
+} bestSizeCache[XNEST_BEST_SIZE_CACHE];
+static int bestSizeNext;
+
 void
 xnestQueryBestSize(int class, unsigned short *pWidth, unsigned short *pHeight,
                    ScreenPtr pScreen)
 {
+    int i;
+
+    for (i = 0; i < XNEST_BEST_SIZE_CACHE; i++) {
+        if (bestSizeCache[i].generation == serverGeneration &&
+            bestSizeCache[i].screen == pScreen->myNum &&
+            bestSizeCache[i].class == class &&
+            bestSizeCache[i].width == *pWidth &&
+            bestSizeCache[i].height == *pHeight) {
+            *pWidth = bestSizeCache[i].bestWidth;
+            *pHeight = bestSizeCache[i].bestHeight;
+            xnestUpstreamInfo.stats.cache_hits++;
+            return;
+        }
+    }
+
+    xnestUpstreamInfo.stats.round_trips++;
     xcb_generic_error_t *err = NULL;
     xcb_query_best_size_reply_t *reply = xcb_query_best_size_reply(
         xnestUpstreamInfo.conn,
@@ -86,6 +114,15 @@ xnestQueryBestSize(int class, unsigned short *pWidth, unsigned short *pHeight,
         return;
     }
 
+    bestSizeCache[bestSizeNext].generation = serverGeneration;
+    bestSizeCache[bestSizeNext].screen = pScreen->myNum;
+    bestSizeCache[bestSizeNext].class = class;
+    bestSizeCache[bestSizeNext].width = *pWidth;
+    bestSizeCache[bestSizeNext].height = *pHeight;
+    bestSizeCache[bestSizeNext].bestWidth = reply->width;
+    bestSizeCache[bestSizeNext].bestHeight = reply->height;
+    bestSizeNext = (bestSizeNext + 1) % XNEST_BEST_SIZE_CACHE;
+
     *pWidth = reply->width;
     *pHeight = reply->height;
     free(reply);
@@ -115,6 +152,21 @@ xnestGetImage(DrawablePtr pDrawable, int x, int y, int w, int h,
               unsigned int format, unsigned long planeMask, char *pImage)
 {
     xcb_generic_error_t * err = NULL;
+
+    if (format == ZPixmap &&
+        xnest_upstream_get_image_shm(xnestDrawable(pDrawable), x, y, w, h,
+                                     planeMask, pImage,
+                                     PixmapBytePad(w, pDrawable->depth) * h,
+                                     &err)) {
+        if (err) {
+            if (err->error_code != BadMatch)
+                LogMessage(X_WARNING, "xnestGetImage: received error %d\n", err->error_code);
+            free(err);
+        }
+        return;
+    }
+
+    xnestUpstreamInfo.stats.round_trips++;
     xcb_get_image_reply_t *reply= xcb_get_image_reply(
         xnestUpstreamInfo.conn,
         xcb_get_image(
@@ -155,6 +207,8 @@ xnestBitBlitHelper(GCPtr pGC)
         if (!pReg || !pTmpReg)
             return NullRegion;
 
+        xnestUpstreamInfo.stats.expose_waits++;
+        xnestUpstreamInfo.stats.round_trips++;
         xcb_flush(xnestUpstreamInfo.conn);
 
         pending = TRUE;
@@ -201,16 +255,56 @@ xnestBitBlitHelper(GCPtr pGC)
     }
 }
 
+/*
+ * Upstream GCs have graphics exposures turned off, so that copies which
+ * cannot expose anything don't cost a round trip waiting for NoExpose.
+ * Only parts of a pixmap source outside of the pixmap can be exposed,
+ * window sources depend on what covers them upstream.
+ */
+static Bool
+xnestCopyMayExpose(DrawablePtr pSrcDrawable, GCPtr pGC,
+                   int srcx, int srcy, int width, int height)
+{
+    if (!pGC->graphicsExposures)
+        return FALSE;
+
+    if (pSrcDrawable->type == DRAWABLE_PIXMAP &&
+        srcx >= 0 && srcy >= 0 &&
+        srcx + width <= pSrcDrawable->width &&
+        srcy + height <= pSrcDrawable->height) {
+        xnestUpstreamInfo.stats.expose_local++;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static void
+xnestSetGraphicsExposures(GCPtr pGC, uint32_t exposures)
+{
+    xcb_change_gc(xnestUpstreamInfo.conn,
+                  xnest_upstream_gc(pGC),
+                  XCB_GC_GRAPHICS_EXPOSURES,
+                  &exposures);
+}
+
 RegionPtr
 xnestCopyArea(DrawablePtr pSrcDrawable, DrawablePtr pDstDrawable,
               GCPtr pGC, int srcx, int srcy, int width, int height,
               int dstx, int dsty)
 {
+    Bool expose = xnestCopyMayExpose(pSrcDrawable, pGC,
+                                     srcx, srcy, width, height);
+
+    if (expose)
+        xnestSetGraphicsExposures(pGC, TRUE);
     xcb_copy_area(xnestUpstreamInfo.conn,
                   xnestDrawable(pSrcDrawable),
                   xnestDrawable(pDstDrawable),
                   xnest_upstream_gc(pGC),
                   srcx, srcy, dstx, dsty, width, height);
+    if (!expose)
+        return NullRegion;
+    xnestSetGraphicsExposures(pGC, FALSE);
 
     return xnestBitBlitHelper(pGC);
 }
@@ -220,11 +314,19 @@ xnestCopyPlane(DrawablePtr pSrcDrawable, DrawablePtr pDstDrawable,
                GCPtr pGC, int srcx, int srcy, int width, int height,
                int dstx, int dsty, unsigned long plane)
 {
+    Bool expose = xnestCopyMayExpose(pSrcDrawable, pGC,
+                                     srcx, srcy, width, height);
+
+    if (expose)
+        xnestSetGraphicsExposures(pGC, TRUE);
     xcb_copy_plane(xnestUpstreamInfo.conn,
                    xnestDrawable(pSrcDrawable),
                    xnestDrawable(pDstDrawable),
                    xnest_upstream_gc(pGC),
                    srcx, srcy, dstx, dsty, width, height, plane);
+    if (!expose)
+        return NullRegion;
+    xnestSetGraphicsExposures(pGC, FALSE);
 
     return xnestBitBlitHelper(pGC);
 }
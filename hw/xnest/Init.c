@@ -151,6 +151,7 @@ void
 ddxGiveUp(enum ExitCode error)
 {
     xnestDoFullGeneration = TRUE;
+    xnest_upstream_log_stats();
     xnestCloseDisplay();
 }
 
@@ -5,9 +5,17 @@
 #include <dix-config.h>
 
 #include <stdbool.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include <xcb/xcb.h>
 #include <xcb/xcb_aux.h>
 #include <xcb/xcb_icccm.h>
+#ifdef XNEST_XCB_SHM
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <xcb/shm.h>
+#endif
 
 #include <X11/X.h>
 #include <X11/Xdefs.h>
@@ -26,6 +34,22 @@ struct xnest_upstream_info xnestUpstreamInfo = { 0 };
 xnest_visual_t *xnestVisualMap;
 int xnestNumVisualMap;
 
+static xcb_atom_t wm_colormap_windows_atom;
+
+#ifdef XNEST_XCB_SHM
+/* smaller images are cheaper to just send over the wire */
+#define XNEST_SHM_MIN_IMAGE     (16 * 1024)
+#define XNEST_SHM_MAX_IMAGE     (64 * 1024 * 1024)
+
+static struct {
+    enum { SHM_UNKNOWN, SHM_YES, SHM_NO } state;
+    bool fd_passing;
+    xcb_shm_seg_t seg;
+    uint8_t *addr;
+    size_t size;
+} xnestShm;
+#endif
+
 bool xnest_upstream_setup(const char* displayName)
 {
     xnestUpstreamInfo.conn = xcb_connect(displayName, &xnestUpstreamInfo.screenId);
@@ -42,9 +66,182 @@ bool xnest_upstream_setup(const char* displayName)
 
     xorg_list_init(&xnestUpstreamInfo.eventQueue.entry);
 
+    wm_colormap_windows_atom = XCB_ATOM_NONE;
+#ifdef XNEST_XCB_SHM
+    /* the old connection took the segment with it */
+    if (xnestShm.addr) {
+        if (xnestShm.fd_passing)
+            munmap(xnestShm.addr, xnestShm.size);
+        else
+            shmdt(xnestShm.addr);
+    }
+    memset(&xnestShm, 0, sizeof(xnestShm));
+#endif
+
     return TRUE;
 }
 
+#ifdef XNEST_XCB_SHM
+static void
+xnest_shm_free(void)
+{
+    xcb_shm_detach(xnestUpstreamInfo.conn, xnestShm.seg);
+    if (xnestShm.fd_passing)
+        munmap(xnestShm.addr, xnestShm.size);
+    else
+        shmdt(xnestShm.addr);
+    xnestShm.addr = NULL;
+    xnestShm.size = 0;
+}
+
+static bool
+xnest_shm_alloc(size_t size)
+{
+    xcb_connection_t *conn = xnestUpstreamInfo.conn;
+    xcb_generic_error_t *err = NULL;
+
+    xnestShm.seg = xcb_generate_id(conn);
+    xnestUpstreamInfo.stats.round_trips++;
+
+    if (xnestShm.fd_passing) {
+        xcb_shm_create_segment_reply_t *reply = xcb_shm_create_segment_reply(
+            conn, xcb_shm_create_segment(conn, xnestShm.seg, size, FALSE), &err);
+        int *fds;
+
+        free(err);
+        if (!reply)
+            return false;
+        fds = reply->nfd == 1 ? xcb_shm_create_segment_reply_fds(conn, reply) : NULL;
+        free(reply);
+        if (!fds) {
+            xcb_shm_detach(conn, xnestShm.seg);
+            return false;
+        }
+        xnestShm.addr = mmap(NULL, size, PROT_READ, MAP_SHARED, fds[0], 0);
+        close(fds[0]);
+        if (xnestShm.addr == MAP_FAILED) {
+            xnestShm.addr = NULL;
+            xcb_shm_detach(conn, xnestShm.seg);
+            return false;
+        }
+    } else {
+        int shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+
+        if (shmid == -1)
+            return false;
+        xnestShm.addr = shmat(shmid, NULL, 0);
+        /* goes away once both sides detached */
+        shmctl(shmid, IPC_RMID, NULL);
+        if (xnestShm.addr == (void *) -1) {
+            xnestShm.addr = NULL;
+            return false;
+        }
+        err = xcb_request_check(conn,
+                                xcb_shm_attach_checked(conn, xnestShm.seg,
+                                                       shmid, FALSE));
+        if (err) {
+            free(err);
+            shmdt(xnestShm.addr);
+            xnestShm.addr = NULL;
+            return false;
+        }
+    }
+    xnestShm.size = size;
+    return true;
+}
+
+/* Is the upstream server on this machine and does it talk MIT-SHM? */
+static bool
+xnest_shm_probe(void)
+{
+    xcb_connection_t *conn = xnestUpstreamInfo.conn;
+    const xcb_query_extension_reply_t *ext;
+    xcb_shm_query_version_reply_t *reply;
+
+    ext = xcb_get_extension_data(conn, &xcb_shm_id);
+    if (!ext || !ext->present)
+        return false;
+
+    xnestUpstreamInfo.stats.round_trips++;
+    reply = xcb_shm_query_version_reply(conn, xcb_shm_query_version(conn), NULL);
+    if (!reply)
+        return false;
+    xnestShm.fd_passing = reply->major_version > 1 ||
+        (reply->major_version == 1 && reply->minor_version >= 2);
+    free(reply);
+
+    /* a remote server fails to attach our segment */
+    if (!xnest_shm_alloc(XNEST_SHM_MIN_IMAGE) && xnestShm.fd_passing) {
+        xnestShm.fd_passing = false;
+        if (!xnest_shm_alloc(XNEST_SHM_MIN_IMAGE))
+            return false;
+    }
+    return xnestShm.addr != NULL;
+}
+
+bool
+xnest_upstream_get_image_shm(uint32_t drawable, int x, int y, int w, int h,
+                             uint32_t plane_mask, void *dst, size_t len,
+                             xcb_generic_error_t **err)
+{
+    xcb_connection_t *conn = xnestUpstreamInfo.conn;
+    xcb_shm_get_image_reply_t *reply;
+
+    if (len < XNEST_SHM_MIN_IMAGE || len > XNEST_SHM_MAX_IMAGE)
+        return false;
+
+    if (xnestShm.state == SHM_UNKNOWN)
+        xnestShm.state = xnest_shm_probe() ? SHM_YES : SHM_NO;
+    if (xnestShm.state == SHM_NO)
+        return false;
+
+    if (xnestShm.size < len) {
+        xnest_shm_free();
+        if (!xnest_shm_alloc(len)) {
+            xnestShm.state = SHM_NO;
+            return false;
+        }
+    }
+
+    xnestUpstreamInfo.stats.round_trips++;
+    reply = xcb_shm_get_image_reply(conn,
+                                    xcb_shm_get_image(conn, drawable, x, y, w, h,
+                                                      plane_mask,
+                                                      XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                                      xnestShm.seg, 0),
+                                    err);
+    if (reply) {
+        memcpy(dst, xnestShm.addr, min(reply->size, len));
+        xnestUpstreamInfo.stats.shm_images++;
+        free(reply);
+    }
+    return true;
+}
+#else
+bool
+xnest_upstream_get_image_shm(uint32_t drawable, int x, int y, int w, int h,
+                             uint32_t plane_mask, void *dst, size_t len,
+                             xcb_generic_error_t **err)
+{
+    return false;
+}
+#endif /* XNEST_XCB_SHM */
+
+void
+xnest_upstream_log_stats(void)
+{
+    const struct xnest_upstream_stats *stats = &xnestUpstreamInfo.stats;
+
+    LogMessageVerb(X_INFO, 3, "Xnest: %llu upstream round trips, "
+                   "%llu copies waited for exposures, %llu did not have to, "
+                   "%llu cached replies, %llu shared memory images\n",
+                   (unsigned long long) stats->round_trips,
+                   (unsigned long long) stats->expose_waits,
+                   (unsigned long long) stats->expose_local,
+                   (unsigned long long) stats->cache_hits,
+                   (unsigned long long) stats->shm_images);
+}
+
 /* retrieve upstream GC XID for our xserver GC */
 uint32_t xnest_upstream_gc(GCPtr pGC) {
     if (pGC == NULL) return 0;
@@ -63,25 +260,30 @@ void xnest_wm_colormap_windows(
     xcb_window_t *windows,
     int count)
 {
-    xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(
-        conn,
-        xcb_intern_atom(
-            conn, 0,
-            sizeof(WM_COLORMAP_WINDOWS)-1,
-            WM_COLORMAP_WINDOWS),
-        NULL);
-
-    if (!reply)
-        return;
+    if (wm_colormap_windows_atom == XCB_ATOM_NONE) {
+        xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(
+            conn,
+            xcb_intern_atom(
+                conn, 0,
+                sizeof(WM_COLORMAP_WINDOWS)-1,
+                WM_COLORMAP_WINDOWS),
+            NULL);
+
+        xnestUpstreamInfo.stats.round_trips++;
+        if (!reply)
+            return;
+        wm_colormap_windows_atom = reply->atom;
+        free(reply);
+    }
+    else
+        xnestUpstreamInfo.stats.cache_hits++;
 
     xcb_icccm_set_wm_colormap_windows_checked(
         conn,
         w,
-        reply->atom,
+        wm_colormap_windows_atom,
         count,
         (xcb_window_t*)windows);
-
-    free(reply);
 }
 
 uint32_t xnest_create_bitmap_from_data(
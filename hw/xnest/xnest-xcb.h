@@ -15,12 +15,22 @@ struct xnest_event_queue {
     xcb_generic_event_t *event;
 };
 
+/* what it cost to talk to the upstream server, logged on exit */
+struct xnest_upstream_stats {
+    uint64_t round_trips;       /* requests we had to wait for */
+    uint64_t expose_waits;      /* copies waiting for GraphicsExpose */
+    uint64_t expose_local;      /* copies known not to expose anything */
+    uint64_t cache_hits;        /* queries answered without asking */
+    uint64_t shm_images;        /* GetImage through shared memory */
+};
+
 struct xnest_upstream_info {
     xcb_connection_t *conn;
     int screenId;
     const xcb_screen_t *screenInfo;
     const xcb_setup_t *setup;
     struct xnest_event_queue eventQueue;
+    struct xnest_upstream_stats stats;
 };
 
 extern struct xnest_upstream_info xnestUpstreamInfo;
@@ -31,6 +41,13 @@ bool xnest_upstream_setup(const char* displayName);
 /* retrieve upstream GC XID for our xserver GC */
 uint32_t xnest_upstream_gc(GCPtr pGC);
 
+/* ZPixmap GetImage through MIT-SHM, false if the caller has to do it */
+bool xnest_upstream_get_image_shm(uint32_t drawable, int x, int y, int w, int h,
+                                  uint32_t plane_mask, void *dst, size_t len,
+                                  xcb_generic_error_t **err);
+
+void xnest_upstream_log_stats(void);
+
 typedef struct {
     xcb_visualtype_t *upstreamVisual;
     xcb_depth_t *upstreamDepth;
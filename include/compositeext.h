@@ -34,4 +34,15 @@ extern _X_EXPORT Bool compIsAlternateVisual(ScreenPtr pScreen, XID visual);
 
 extern _X_EXPORT RESTYPE CompositeClientWindowType;
 
+/* Counters for the per-screen pool of window backing pixmaps */
+typedef struct _CompositePixmapPoolStats {
+    unsigned long allocated;    /* backing pixmaps created */
+    unsigned long reused;       /* allocations satisfied from the pool */
+    unsigned long released;     /* pixmaps returned to the pool */
+    unsigned long expired;      /* pooled pixmaps freed unused */
+} CompositePixmapPoolStatsRec, *CompositePixmapPoolStatsPtr;
+
+extern _X_EXPORT void CompositeGetPixmapPoolStats(ScreenPtr pScreen,
+                                                  CompositePixmapPoolStatsPtr pStats);
+
 #endif                          /* _COMPOSITEEXT_H_ */
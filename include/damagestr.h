@@ -67,6 +67,8 @@ typedef struct _damageScrPriv {
 
     /* Table of wrappable function pointers */
     DamageScreenFuncsRec funcs;
+
+    CompositeBatchProcPtr CompositeBatch;
 } DamageScrPrivRec, *DamageScrPrivPtr;
 
 typedef struct _damageGCPriv {
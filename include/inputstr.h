@@ -512,6 +512,8 @@ typedef struct _SpriteInfoRec {
         CursorPtr pCursor;
         ScreenPtr pScreen;
         int elt;
+        CARD32 time;            /* when the next frame is due */
+        Bool pending;           /* a next frame is due at all */
     } anim;
 } SpriteInfoRec, *SpriteInfoPtr;
 
@@ -48,6 +48,7 @@ typedef struct _SyncCounter {
     SyncObject sync;            /* Common sync object data */
     int64_t value;              /* counter value */
     struct _SysCounterInfo *pSysCounterInfo; /* NULL if not a system counter */
+    struct _SyncTriggerIndex *pIndex; /* pTriglist sorted by test value */
 } SyncCounter;
 
 struct _SyncFence {
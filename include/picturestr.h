@@ -211,6 +211,19 @@ typedef void (*CompositeProcPtr) (CARD8 op,
                                   INT16 xDst,
                                   INT16 yDst, CARD16 width, CARD16 height);
 
+typedef struct _PictCompositeRect {
+    INT16 xSrc, ySrc;
+    INT16 xMask, yMask;
+    INT16 xDst, yDst;
+    CARD16 width, height;
+} PictCompositeRectRec, *PictCompositeRectPtr;
+
+typedef void (*CompositeBatchProcPtr) (CARD8 op,
+                                       PicturePtr pSrc,
+                                       PicturePtr pMask,
+                                       PicturePtr pDst,
+                                       int nrect, PictCompositeRectPtr rects);
+
 typedef void (*GlyphsProcPtr) (CARD8 op,
                                PicturePtr pSrc,
                                PicturePtr pDst,
@@ -336,9 +349,18 @@ typedef struct _PictureScreen {
     RealizeGlyphProcPtr RealizeGlyph;
     UnrealizeGlyphProcPtr UnrealizeGlyph;
 
-#define PICTURE_SCREEN_VERSION 2
+    /* PICTURE_SCREEN_VERSION 2 */
     TriStripProcPtr TriStrip;
     TriFanProcPtr TriFan;
+
+#define PICTURE_SCREEN_VERSION 3
+    /**
+     * Composite a run of rectangles between the same pictures with the
+     * same op, as if Composite had been called for each of them in turn.
+     * Layers wrapping Composite without knowing about this hook must not
+     * be bypassed, see miCompositeBatch.
+     */
+    CompositeBatchProcPtr CompositeBatch;
 } PictureScreenRec, *PictureScreenPtr;
 
 extern _X_EXPORT DevPrivateKeyRec PictureScreenPrivateKeyRec;
@@ -441,6 +463,12 @@ CompositePicture(CARD8 op,
                  INT16 yMask,
                  INT16 xDst, INT16 yDst, CARD16 width, CARD16 height);
 
+extern _X_EXPORT void
+CompositePictureBatch(CARD8 op,
+                      PicturePtr pSrc,
+                      PicturePtr pMask,
+                      PicturePtr pDst, int nrect, PictCompositeRectPtr rects);
+
 extern _X_EXPORT void
 CompositeGlyphs(CARD8 op,
                 PicturePtr pSrc,
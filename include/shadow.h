@@ -24,6 +24,8 @@
 #ifndef _SHADOW_H_
 #define _SHADOW_H_
 
+#include <stdint.h>
+
 #include "scrnintstr.h"
 
 #include "picturestr.h"
@@ -31,6 +33,8 @@
 #include "damage.h"
 #include "damagestr.h"
 typedef struct _shadowBuf *shadowBufPtr;
+typedef struct _shadowTiles *shadowTilesPtr;
+typedef struct _shadowThread *shadowThreadPtr;
 
 typedef void (*ShadowUpdateProc) (ScreenPtr pScreen, shadowBufPtr pBuf);
 
@@ -43,6 +47,15 @@ typedef void *(*ShadowWindowProc) (ScreenPtr pScreen,
                                    CARD32 offset,
                                    int mode, CARD32 *size, void *closure);
 
+/* Per-screen update timing, see shadowGetFlushStats() */
+typedef struct _shadowFlushStats {
+    uint64_t frames;            /* update procs run */
+    uint64_t skipped;           /* redisplays deferred by a busy flush thread */
+    uint64_t lastUsec;          /* duration of the most recent update */
+    uint64_t maxUsec;
+    uint64_t totalUsec;
+} shadowFlushStatsRec, *shadowFlushStatsPtr;
+
 typedef struct _shadowBuf {
     DamagePtr pDamage;
     ShadowUpdateProc update;
@@ -55,8 +68,22 @@ typedef struct _shadowBuf {
     GetImageProcPtr GetImage;
     void *_dummy1; // required in place of a removed field for ABI compatibility
     ScreenBlockHandlerProcPtr BlockHandler;
+
+    /* optional tile bitmap, see shadowTilesEnable() */
+    shadowTilesPtr tiles;
+
+    /* optional flush thread, see shadowSetAsync() */
+    shadowThreadPtr thread;
+    shadowFlushStatsRec flush;
 } shadowBufRec;
 
+/* Counters accumulated by the tile tracker */
+typedef struct _shadowTileStats {
+    uint64_t tilesDamaged;      /* tiles touched by drawing */
+    uint64_t tilesChanged;      /* tiles whose contents actually changed */
+    uint64_t bytesChanged;      /* shadow bytes covered by changed tiles */
+} shadowTileStatsRec, *shadowTileStatsPtr;
+
 /* Match defines from randr extension */
 #define SHADOW_ROTATE_0	    1
 #define SHADOW_ROTATE_90    2
@@ -81,6 +108,46 @@ shadowAdd(ScreenPtr pScreen,
 extern _X_EXPORT void
  shadowRemove(ScreenPtr pScreen, PixmapPtr pPixmap);
 
+/*
+ * Track damage in a bitmap of tileSize x tileSize tiles.  Before each
+ * update, tiles whose contents did not change since the last update
+ * are dropped from the damage region handed to the update proc, which
+ * may walk the remaining tiles with shadowTilesNext().  Tiles are
+ * compared by checksum and then against a copy of their contents, so
+ * this keeps a second copy of the shadow pixmap.
+ */
+extern _X_EXPORT Bool
+ shadowTilesEnable(ScreenPtr pScreen, int tileSize);
+
+extern _X_EXPORT void
+ shadowTilesDisable(ScreenPtr pScreen);
+
+extern _X_EXPORT Bool
+ shadowTilesNext(shadowBufPtr pBuf, int *tile, BoxPtr pBox);
+
+extern _X_EXPORT void
+ shadowTilesGetStats(ScreenPtr pScreen, shadowTileStatsPtr pStats);
+
+/*
+ * Run the update proc on a separate thread.  The block handler hands it
+ * a snapshot of the damage and returns to dispatch; damage drawn while a
+ * flush is running is picked up by the next one.  The update and window
+ * procs must not touch server state other than the shadow pixmap, the
+ * damage region passed in and their own closure.
+ */
+extern _X_EXPORT Bool
+ shadowSetAsync(ScreenPtr pScreen, Bool enable);
+
+/*
+ * Wait for a running flush to finish.  Drivers must call this before
+ * freeing or remapping anything the update or window procs use.
+ */
+extern _X_EXPORT void
+ shadowFlushWait(ScreenPtr pScreen);
+
+extern _X_EXPORT void
+ shadowGetFlushStats(ScreenPtr pScreen, shadowFlushStatsPtr pStats);
+
 extern _X_EXPORT void
  shadowUpdateAfb4(ScreenPtr pScreen, shadowBufPtr pBuf);
 
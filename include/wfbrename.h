@@ -39,6 +39,7 @@
 #define fbCreatePixmap wfbCreatePixmap
 #define fbCreateWindow wfbCreateWindow
 #define fbDestroyGlyphCache wfbDestroyGlyphCache
+#define fbDestroyShapeBand wfbDestroyShapeBand
 #define fbDestroyPixmap wfbDestroyPixmap
 #define fbDestroyWindow wfbDestroyWindow
 #define fbDoCopy wfbDoCopy
@@ -67,6 +68,7 @@
 #define fbInitializeColormap wfbInitializeColormap
 #define fbInitVisuals wfbInitVisuals
 #define fbListInstalledColormaps wfbListInstalledColormaps
+#define fbLogPictCacheStats wfbLogPictCacheStats
 #define FbMergeRopBits wFbMergeRopBits
 #define fbOddTile wfbOddTile
 #define fbOver wfbOver
@@ -78,9 +78,9 @@
 /* XXX This is a compile-time option that changes abi XXX */
 /* TODO: Remove this toggle in 26.0 */
 #ifdef CONFIG_LEGACY_NVIDIA_PADDING
-#define ABI_VIDEODRV_VERSION	SET_ABI_VERSION(28, 1)
+#define ABI_VIDEODRV_VERSION	SET_ABI_VERSION(28, 3)
 #else
-#define ABI_VIDEODRV_VERSION    SET_ABI_VERSION(28, 0)
+#define ABI_VIDEODRV_VERSION    SET_ABI_VERSION(28, 2)
 #endif
 #define ABI_XINPUT_VERSION	SET_ABI_VERSION(26, 0)
 #define ABI_EXTENSION_VERSION	SET_ABI_VERSION(11, 0)
@@ -33,6 +33,9 @@ static inline ColormapPtr GetInstalledmiColormap(ScreenPtr s) {
 void miScreenClose(ScreenPtr pScreen);
 
 void miWideArc(DrawablePtr pDraw, GCPtr pGC, int narcs, xArc * parcs);
+void miArcCacheFree(void);
+void miPolyFreeStorage(void);
+void miFreeDrawCaches(void);
 void miStepDash(int dist, int * pDashIndex, unsigned char * pDash,
                 int numInDashList, int *pDashOffset);
 
@@ -223,8 +223,29 @@ typedef struct {
     miArcSpan *spans;
     int count1, count2, k;
     char top, bot, hole;
+    char cached;                /* owned by arcCache, don't free */
 } miArcSpanData;
 
+/*
+ * The outline of a wide ellipse only depends on its size and the line
+ * width, drawings with many arcs tend to use few of those.  Outlines are
+ * kept in a direct mapped cache; big ones are cheap to recompute compared
+ * to drawing them and are not kept.  With 8 byte spans, the cache holds
+ * at most 256 * (256 + 2) * 8 bytes, about 530 kB, until the screens close.
+ */
+#define ARC_CACHE_SIZE          256     /* a power of two */
+#define ARC_CACHE_MAX_SPANS     256
+
+typedef struct {
+    CARD16 width, height, lw;
+    miArcSpanData *spdata;
+} miArcCacheRec;
+
+static miArcCacheRec arcCache[ARC_CACHE_SIZE];
+
+/* spans handed to one FillSpans call when filling full ellipses */
+#define ARC_BATCH_SPANS         4096
+
 static void fillSpans(DrawablePtr pDrawable, GCPtr pGC);
 static void newFinalSpan(int y, int xmin, int xmax);
 static miArcSpanData *drawArc(xArc * tarc, int l, int a0, int a1,
@@ -747,10 +768,17 @@ tailX(double K,
 static miArcSpanData *
 miComputeWideEllipse(int lw, xArc * parc)
 {
+    miArcCacheRec *cent;
     int k;
 
     if (!lw)
         lw = 1;
+    cent = &arcCache[(parc->width * 31 + parc->height * 7 + lw) &
+                     (ARC_CACHE_SIZE - 1)];
+    if (cent->spdata && cent->width == parc->width &&
+        cent->height == parc->height && cent->lw == lw)
+        return cent->spdata;
+
     k = (parc->height >> 1) + ((lw - 1) >> 1);
     miArcSpanData *spdata = calloc(1, sizeof(miArcSpanData) + sizeof(miArcSpan) * (k + 2));
     if (!spdata)
@@ -763,13 +791,44 @@ miComputeWideEllipse(int lw, xArc * parc)
         miComputeCircleSpans(lw, parc, spdata);
     else
         miComputeEllipseSpans(lw, parc, spdata);
+
+    if (k <= ARC_CACHE_MAX_SPANS) {
+        free(cent->spdata);
+        cent->width = parc->width;
+        cent->height = parc->height;
+        cent->lw = lw;
+        cent->spdata = spdata;
+        spdata->cached = TRUE;
+    }
     return spdata;
 }
 
 static void
-miFillWideEllipse(DrawablePtr pDraw, GCPtr pGC, xArc * parc)
+miFreeWideEllipse(miArcSpanData *spdata)
+{
+    if (spdata && !spdata->cached)
+        free(spdata);
+}
+
+void
+miArcCacheFree(void)
+{
+    int i;
+
+    for (i = 0; i < ARC_CACHE_SIZE; i++) {
+        free(arcCache[i].spdata);
+        arcCache[i].spdata = NULL;
+    }
+}
+
+/*
+ * Store the spans of a full wide ellipse in points and widths, which have
+ * room for (parc->height + lineWidth) * 2 spans, and return their number.
+ */
+static int
+miWideEllipseSpans(DrawablePtr pDraw, GCPtr pGC, xArc * parc,
+                   DDXPointPtr points, int *widths)
 {
-    DDXPointPtr points;
     DDXPointPtr pts;
     int *wids;
     miArcSpanData *spdata;
@@ -777,17 +836,9 @@ miFillWideEllipse(DrawablePtr pDraw, GCPtr pGC, xArc * parc)
     int xorg, yorgu, yorgl;
     int n;
 
-    yorgu = parc->height + pGC->lineWidth;
-    n = (sizeof(int) * 2) * yorgu;
-    int *widths = calloc(1, n + (sizeof(xPoint) * 2) * yorgu);
-    if (!widths)
-        return;
-    points = (DDXPointPtr) ((char *) widths + n);
     spdata = miComputeWideEllipse((int) pGC->lineWidth, parc);
-    if (!spdata) {
-        free(widths);
-        return;
-    }
+    if (!spdata)
+        return 0;
     pts = points;
     wids = widths;
     span = spdata->spans;
@@ -866,9 +917,48 @@ miFillWideEllipse(DrawablePtr pDraw, GCPtr pGC, xArc * parc)
             wids += 2;
         }
     }
-    free(spdata);
-    (*pGC->ops->FillSpans) (pDraw, pGC, pts - points, points, widths, FALSE);
+    miFreeWideEllipse(spdata);
+    return pts - points;
+}
 
+/*
+ * Fill a run of full wide ellipses with as few FillSpans calls as possible.
+ * The spans of different arcs are passed on as they are: the protocol only
+ * keeps an arc from touching a pixel twice, not a PolyArc.
+ */
+static void
+miFillWideEllipses(DrawablePtr pDraw, GCPtr pGC, int narcs, xArc * parcs)
+{
+    DDXPointPtr points = NULL;
+    int *widths = NULL;
+    int size = 0, count = 0;
+
+    for (; --narcs >= 0; parcs++) {
+        int n = (parcs->height + pGC->lineWidth) * 2;
+
+        if (count + n > size) {
+            if (count)
+                (*pGC->ops->FillSpans) (pDraw, pGC, count, points, widths,
+                                        FALSE);
+            count = 0;
+            if (n > size) {
+                free(points);
+                free(widths);
+                size = max(n, ARC_BATCH_SPANS);
+                points = calloc(size, sizeof(xPoint));
+                widths = calloc(size, sizeof(int));
+                if (!points || !widths)
+                    goto out;
+            }
+        }
+        count += miWideEllipseSpans(pDraw, pGC, parcs,
+                                    &points[count], &widths[count]);
+    }
+    if (count)
+        (*pGC->ops->FillSpans) (pDraw, pGC, count, points, widths, FALSE);
+
+out:
+    free(points);
     free(widths);
 }
 
@@ -907,19 +997,24 @@ miWideArc(DrawablePtr pDraw, GCPtr pGC, int narcs, xArc * parcs)
         for (i = narcs, parc = parcs; --i >= 0; parc++) {
             miArcSpanData *spdata;
             spdata = miArcSegment(pDraw, pGC, *parc, NULL, NULL, NULL);
-            free(spdata);
+            miFreeWideEllipse(spdata);
         }
         fillSpans(pDraw, pGC);
         return;
     }
 
     if ((pGC->lineStyle == LineSolid) && narcs) {
-        while (parcs->width && parcs->height &&
-               (parcs->angle2 >= FULLCIRCLE || parcs->angle2 <= -FULLCIRCLE)) {
-            miFillWideEllipse(pDraw, pGC, parcs);
-            if (!--narcs)
+        for (i = 0; i < narcs; i++) {
+            parc = &parcs[i];
+            if (!parc->width || !parc->height ||
+                (parc->angle2 < FULLCIRCLE && parc->angle2 > -FULLCIRCLE))
+                break;
+        }
+        if (i) {
+            miFillWideEllipses(pDraw, pGC, i, parcs);
+            if (!(narcs -= i))
                 return;
-            parcs++;
+            parcs += i;
         }
     }
 
@@ -1039,7 +1134,7 @@ miWideArc(DrawablePtr pDraw, GCPtr pGC, int narcs, xArc * parcs)
             if (spdata) {
                 if (lastArc.width != arcData->arc.width ||
                     lastArc.height != arcData->arc.height) {
-                    free(spdata);
+                    miFreeWideEllipse(spdata);
                     spdata = NULL;
                 }
             }
@@ -1103,7 +1198,7 @@ miWideArc(DrawablePtr pDraw, GCPtr pGC, int narcs, xArc * parcs)
                 }
             }
         }
-        free(spdata);
+        miFreeWideEllipse(spdata);
         spdata = NULL;
     }
     miFreeArcs(polyArcs, pGC);
@@ -69,6 +69,8 @@ typedef struct {
     GCPtr pSaveGC, pRestoreGC;
     PixmapPtr pSave;
     PicturePtr pRootPicture;
+    PixmapPtr pMove;            /* scratch for moving the cursor in place */
+    PicturePtr pMovePicture;
 } miDCBufferRec, *miDCBufferPtr;
 
 #define miGetDCDevice(dev, screen) \
@@ -427,6 +429,106 @@ bool miDCRestoreUnderCursor(DeviceIntPtr pDev, ScreenPtr pScreen,
     return TRUE;
 }
 
+/*
+ * Move a cursor which is up from the area saved in pOld to the one in pNew
+ * without taking it down first: the union of both areas is composed off
+ * screen, restoring what was under the old cursor, saving what will be
+ * under the new one and drawing the cursor, and then copied to the screen
+ * in one go.  Returns FALSE, with the screen untouched, if that can't be
+ * done; the caller then takes the cursor down and puts it up again.
+ */
+bool miDCMoveCursor(DeviceIntPtr pDev, ScreenPtr pScreen, CursorPtr pCursor,
+                    BoxPtr pOld, BoxPtr pNew, int x, int y,
+                    unsigned long source, unsigned long mask)
+{
+    miDCScreenPtr pScreenPriv = dixLookupPrivate(&pScreen->devPrivates, miDCScreenKey);
+    miDCBufferPtr pBuffer;
+    PixmapPtr pSave, pMove;
+    WindowPtr pWin;
+    GCPtr pGC;
+    BoxRec box;
+    int w, h;
+
+    if (!miDCRealize(pScreen, pCursor))
+        return FALSE;
+
+    pWin = pScreen->root;
+    pBuffer = miGetDCDevice(pDev, pScreen);
+    pSave = pBuffer->pSave;
+    if (!pSave ||
+        pSave->drawable.width < pOld->x2 - pOld->x1 ||
+        pSave->drawable.height < pOld->y2 - pOld->y1 ||
+        pSave->drawable.width < pNew->x2 - pNew->x1 ||
+        pSave->drawable.height < pNew->y2 - pNew->y1)
+        return FALSE;
+
+    box.x1 = min(pOld->x1, pNew->x1);
+    box.y1 = min(pOld->y1, pNew->y1);
+    box.x2 = max(pOld->x2, pNew->x2);
+    box.y2 = max(pOld->y2, pNew->y2);
+    w = box.x2 - box.x1;
+    h = box.y2 - box.y1;
+
+    pMove = pBuffer->pMove;
+    if (!pMove || pMove->drawable.width < w || pMove->drawable.height < h) {
+        if (pBuffer->pMovePicture)
+            FreePicture(pBuffer->pMovePicture, 0);
+        pBuffer->pMovePicture = NULL;
+        dixDestroyPixmap(pMove, 0);
+        pBuffer->pMove = pMove =
+            (*pScreen->CreatePixmap) (pScreen, w, h, pScreen->rootDepth, 0);
+        if (!pMove)
+            return FALSE;
+    }
+    if (pScreenPriv->pPicture &&
+        !EnsurePicture(pBuffer->pMovePicture, &pMove->drawable, pWin))
+        return FALSE;
+
+    /* what the screen will look like without the cursor */
+    pGC = pBuffer->pSaveGC;
+    if (pMove->drawable.serialNumber != pGC->serialNumber)
+        ValidateGC((DrawablePtr) pMove, pGC);
+    (void) (*pGC->ops->CopyArea) ((DrawablePtr) pWin, (DrawablePtr) pMove, pGC,
+                                  box.x1, box.y1, w, h, 0, 0);
+    (void) (*pGC->ops->CopyArea) ((DrawablePtr) pSave, (DrawablePtr) pMove, pGC,
+                                  0, 0,
+                                  pOld->x2 - pOld->x1, pOld->y2 - pOld->y1,
+                                  pOld->x1 - box.x1, pOld->y1 - box.y1);
+
+    /* save under the new position */
+    if (pSave->drawable.serialNumber != pGC->serialNumber)
+        ValidateGC((DrawablePtr) pSave, pGC);
+    (void) (*pGC->ops->CopyArea) ((DrawablePtr) pMove, (DrawablePtr) pSave, pGC,
+                                  pNew->x1 - box.x1, pNew->y1 - box.y1,
+                                  pNew->x2 - pNew->x1, pNew->y2 - pNew->y1,
+                                  0, 0);
+
+    if (pScreenPriv->pPicture) {
+        CompositePicture(PictOpOver,
+                         pScreenPriv->pPicture,
+                         NULL,
+                         pBuffer->pMovePicture,
+                         0, 0, 0, 0,
+                         x - box.x1, y - box.y1,
+                         pCursor->bits->width, pCursor->bits->height);
+    }
+    else
+    {
+        miDCPutBits((DrawablePtr) pMove,
+                    pBuffer->pSourceGC, pBuffer->pMaskGC,
+                    x - box.x1, y - box.y1,
+                    pCursor->bits->width, pCursor->bits->height,
+                    source, mask);
+    }
+
+    pGC = pBuffer->pRestoreGC;
+    if (pWin->drawable.serialNumber != pGC->serialNumber)
+        ValidateGC((DrawablePtr) pWin, pGC);
+    (void) (*pGC->ops->CopyArea) ((DrawablePtr) pMove, (DrawablePtr) pWin, pGC,
+                                  0, 0, w, h, box.x1, box.y1);
+    return TRUE;
+}
+
 bool miDCDeviceInitialize(DeviceIntPtr pDev, ScreenPtr pScreen)
 {
     miDCBufferPtr pBuffer;
@@ -463,6 +565,8 @@ bool miDCDeviceInitialize(DeviceIntPtr pDev, ScreenPtr pScreen)
 
         /* (re)allocated lazily depending on the cursor size */
         pBuffer->pSave = NULL;
+        pBuffer->pMove = NULL;
+        pBuffer->pMovePicture = NULL;
 
         continue;
 
@@ -498,7 +602,11 @@ miDCDeviceCleanup(DeviceIntPtr pDev, ScreenPtr pScreen)
          * is freed when that root window is destroyed, so don't
          * free it again here. */
 
+        if (pBuffer->pMovePicture)
+            FreePicture(pBuffer->pMovePicture, 0);
+
         dixDestroyPixmap(pBuffer->pSave, 0);
+        dixDestroyPixmap(pBuffer->pMove, 0);
         free(pBuffer);
         dixSetScreenPrivate(&pDev->devPrivates, miDCDeviceKey, walkScreen, NULL);
     });
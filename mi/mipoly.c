@@ -51,6 +51,9 @@ SOFTWARE.
 #include <dix-config.h>
 
 #include <X11/X.h>
+
+#include "mi/mi_priv.h"
+
 #include "windowstr.h"
 #include "gcstruct.h"
 #include "pixmapstr.h"
@@ -59,6 +62,18 @@ SOFTWARE.
 #include "mipoly.h"
 #include "regionstr.h"
 
+/*
+ * FillPoly requests tend to come in streams of polygons of similar size, as
+ * from mapping and plotting clients, so the edge table storage of one is
+ * kept for the next.  Polygons with more than POLY_KEEP_EDGES edges get
+ * storage of their own.
+ */
+#define POLY_KEEP_EDGES         1024
+#define POLY_KEEP_SLLBLOCKS     (POLY_KEEP_EDGES / SLLSPERBLOCK + 1)
+
+static EdgeTableEntry *polyETEs;
+static ScanLineListBlock polySLLBlock;
+
 /*
  * Insert the given edge into the edge table.  First we must find the correct
  * bucket in the Edge table, then find the right slot in the bucket.  Finally,
@@ -87,11 +102,14 @@ miInsertEdgeInET(EdgeTable * ET, EdgeTableEntry * ETE, int scanline,
      */
     if ((!pSLL) || (pSLL->scanline > scanline)) {
         if (*iSLLBlock > SLLSPERBLOCK - 1) {
-            tmpSLLBlock = calloc(1, sizeof(ScanLineListBlock));
-            if (!tmpSLLBlock)
-                return FALSE;
-            (*SLLBlock)->next = tmpSLLBlock;
-            tmpSLLBlock->next = NULL;
+            /* blocks left over from a previous polygon are reused */
+            tmpSLLBlock = (*SLLBlock)->next;
+            if (!tmpSLLBlock) {
+                tmpSLLBlock = calloc(1, sizeof(ScanLineListBlock));
+                if (!tmpSLLBlock)
+                    return FALSE;
+                (*SLLBlock)->next = tmpSLLBlock;
+            }
             *SLLBlock = tmpSLLBlock;
             *iSLLBlock = 0;
         }
@@ -121,11 +139,22 @@ miInsertEdgeInET(EdgeTable * ET, EdgeTableEntry * ETE, int scanline,
     return TRUE;
 }
 
+/*
+ * Free all but the first 'keep' blocks of the chain.
+ */
 static void
-miFreeStorage(ScanLineListBlock * pSLLBlock)
+miFreeStorage(ScanLineListBlock * pSLLBlock, int keep)
 {
     ScanLineListBlock *tmpSLLBlock;
 
+    while (pSLLBlock && --keep > 0)
+        pSLLBlock = pSLLBlock->next;
+    if (!pSLLBlock)
+        return;
+
+    tmpSLLBlock = pSLLBlock->next;
+    pSLLBlock->next = NULL;
+    pSLLBlock = tmpSLLBlock;
     while (pSLLBlock) {
         tmpSLLBlock = pSLLBlock->next;
         free(pSLLBlock);
@@ -183,7 +212,6 @@ miCreateETandAET(int count, DDXPointPtr pts, EdgeTable * ET,
     ET->scanlines.next = NULL;
     ET->ymax = MININT;
     ET->ymin = MAXINT;
-    pSLLBlock->next = NULL;
 
     PrevPt = &pts[count - 1];
 
@@ -219,10 +247,8 @@ miCreateETandAET(int count, DDXPointPtr pts, EdgeTable * ET,
             dy = bottom->y - top->y;
             BRESINITPGONSTRUCT(dy, top->x, bottom->x, pETEs->bres);
 
-            if (!miInsertEdgeInET(ET, pETEs, top->y, &pSLLBlock, &iSLLBlock)) {
-                miFreeStorage(pSLLBlock->next);
+            if (!miInsertEdgeInET(ET, pETEs, top->y, &pSLLBlock, &iSLLBlock))
                 return FALSE;
-            }
 
             ET->ymax = max(ET->ymax, PrevPt->y);
             ET->ymin = min(ET->ymin, PrevPt->y);
@@ -393,10 +419,12 @@ miFillConvexPoly(DrawablePtr dst, GCPtr pgc, int count, DDXPointPtr ptsIn)
     int dy;                     /* delta y                        */
     int y;                      /* current scanline               */
     int left, right;            /* indices to first endpoints     */
-    int i;                      /* loop counter                   */
+    int i, n;                   /* loop counters                  */
     int nextleft, nextright;    /* indices to second endpoints    */
-    DDXPointPtr ptsOut, FirstPoint;     /* output buffer               */
-    int *width, *FirstWidth;    /* output buffer                  */
+    DDXPointPtr ptsOut;         /* ptr to output buffers          */
+    int *width;
+    xPoint FirstPoint[NUMPTSTOBUFFER];     /* the output buffers */
+    int FirstWidth[NUMPTSTOBUFFER];
     int imin;                   /* index of smallest vertex (in y) */
     int ymin;                   /* y-extents of polygon            */
     int ymax;
@@ -410,13 +438,8 @@ miFillConvexPoly(DrawablePtr dst, GCPtr pgc, int count, DDXPointPtr ptsIn)
     dy = ymax - ymin + 1;
     if ((count < 3) || (dy < 0))
         return TRUE;
-    ptsOut = FirstPoint = calloc(dy, sizeof(xPoint));
-    width = FirstWidth = calloc(dy, sizeof(int));
-    if (!FirstPoint || !FirstWidth) {
-        free(FirstWidth);
-        free(FirstPoint);
-        return FALSE;
-    }
+    ptsOut = FirstPoint;
+    width = FirstWidth;
 
     nextleft = nextright = imin;
     y = ptsIn[nextleft].y;
@@ -477,30 +500,63 @@ miFillConvexPoly(DrawablePtr dst, GCPtr pgc, int count, DDXPointPtr ptsIn)
          */
         i = min(ptsIn[nextleft].y, ptsIn[nextright].y) - y;
         /* in case we're called with non-convex polygon */
-        if (i < 0) {
-            free(FirstWidth);
-            free(FirstPoint);
+        if (i < 0)
             return TRUE;
-        }
-        while (i-- > 0) {
-            ptsOut->y = y;
+        while (i > 0) {
+            n = min(i, FirstPoint + NUMPTSTOBUFFER - ptsOut);
+            i -= n;
 
-            /*
-             *  reverse the edges if necessary
-             */
-            if (xl < xr) {
-                *(width++) = xr - xl;
-                (ptsOut++)->x = xl;
+            if (ml == 0 && incr2l == 0 && mr == 0 && incr2r == 0) {
+                /*
+                 *  both edges are vertical, as in rectangles and
+                 *  most of the polygons of maps: the same span
+                 *  all the way down, without stepping the edges.
+                 */
+                int x = min(xl, xr);
+                int w = abs(xr - xl);
+                int j;
+
+                for (j = 0; j < n; j++) {
+                    ptsOut[j].x = x;
+                    ptsOut[j].y = y + j;
+                    width[j] = w;
+                }
+                ptsOut += n;
+                width += n;
+                y += n;
             }
             else {
-                *(width++) = xl - xr;
-                (ptsOut++)->x = xr;
+                while (n-- > 0) {
+                    ptsOut->y = y;
+
+                    /*
+                     *  reverse the edges if necessary
+                     */
+                    if (xl < xr) {
+                        *(width++) = xr - xl;
+                        (ptsOut++)->x = xl;
+                    }
+                    else {
+                        *(width++) = xl - xr;
+                        (ptsOut++)->x = xr;
+                    }
+                    y++;
+
+                    /* increment down the edges */
+                    BRESINCRPGON(dl, xl, ml, m1l, incr1l, incr2l);
+                    BRESINCRPGON(dr, xr, mr, m1r, incr1r, incr2r);
+                }
             }
-            y++;
 
-            /* increment down the edges */
-            BRESINCRPGON(dl, xl, ml, m1l, incr1l, incr2l);
-            BRESINCRPGON(dr, xr, mr, m1r, incr1r, incr2r);
+            /*
+             *  send out the buffer when its full
+             */
+            if (ptsOut == FirstPoint + NUMPTSTOBUFFER) {
+                (*pgc->ops->FillSpans) (dst, pgc, NUMPTSTOBUFFER,
+                                        FirstPoint, FirstWidth, 1);
+                ptsOut = FirstPoint;
+                width = FirstWidth;
+            }
         }
     } while (y != ymax);
 
@@ -509,8 +565,6 @@ miFillConvexPoly(DrawablePtr dst, GCPtr pgc, int count, DDXPointPtr ptsIn)
      */
     (*pgc->ops->FillSpans) (dst, pgc,
                             ptsOut - FirstPoint, FirstPoint, FirstWidth, 1);
-    free(FirstWidth);
-    free(FirstPoint);
     return TRUE;
 }
 
@@ -536,18 +590,26 @@ miFillGeneralPoly(DrawablePtr dst, GCPtr pgc, int count, DDXPointPtr ptsIn)
     EdgeTable ET;               /* Edge Table header node  */
     EdgeTableEntry AET;         /* Active ET header node   */
     EdgeTableEntry *pETEs;      /* Edge Table Entries buff */
-    ScanLineListBlock SLLBlock; /* header for ScanLineList */
     int fixWAET = 0;
 
     if (count < 3)
         return TRUE;
 
-    if (!(pETEs = calloc(count, sizeof(EdgeTableEntry))))
+    if (count <= POLY_KEEP_EDGES) {
+        if (!polyETEs)
+            polyETEs = calloc(POLY_KEEP_EDGES, sizeof(EdgeTableEntry));
+        pETEs = polyETEs;
+    }
+    else
+        pETEs = calloc(count, sizeof(EdgeTableEntry));
+    if (!pETEs)
         return FALSE;
     ptsOut = FirstPoint;
     width = FirstWidth;
-    if (!miCreateETandAET(count, ptsIn, &ET, &AET, pETEs, &SLLBlock)) {
-        free(pETEs);
+    if (!miCreateETandAET(count, ptsIn, &ET, &AET, pETEs, &polySLLBlock)) {
+        if (pETEs != polyETEs)
+            free(pETEs);
+        miFreeStorage(&polySLLBlock, POLY_KEEP_SLLBLOCKS);
         return FALSE;
     }
     pSLL = ET.scanlines.next;
@@ -663,11 +725,49 @@ miFillGeneralPoly(DrawablePtr dst, GCPtr pgc, int count, DDXPointPtr ptsIn)
      *     Get any spans that we missed by buffering
      */
     (*pgc->ops->FillSpans) (dst, pgc, nPts, FirstPoint, FirstWidth, 1);
-    free(pETEs);
-    miFreeStorage(SLLBlock.next);
+    if (pETEs != polyETEs)
+        free(pETEs);
+    miFreeStorage(&polySLLBlock, POLY_KEEP_SLLBLOCKS);
     return TRUE;
 }
 
+void
+miPolyFreeStorage(void)
+{
+    free(polyETEs);
+    polyETEs = NULL;
+    miFreeStorage(&polySLLBlock, 1);
+}
+
+/*
+ * Whether every scanline crosses the outline of the polygon just twice,
+ * which is when its vertices go down and back up in y only once.  Both
+ * fill rules then fill between the two crossings, which miFillConvexPoly
+ * does without building and sorting an edge table.
+ */
+static Bool
+miPolyIsYMonotone(int count, DDXPointPtr pts)
+{
+    DDXPointPtr prev = &pts[count - 1];
+    int first = 0, dir = 0, turns = 0;
+    int i, d;
+
+    for (i = 0; i < count; prev = &pts[i++]) {
+        d = pts[i].y - prev->y;
+        if (d == 0)
+            continue;
+        d = d > 0 ? 1 : -1;
+        if (!first)
+            first = d;
+        else if (d != dir && ++turns > 2)
+            return FALSE;
+        dir = d;
+    }
+    if (first != dir)
+        turns++;
+    return turns == 2;
+}
+
 /*
  *  Draw polygons.  This routine translates the point by the origin if
  *  pGC->miTranslate is non-zero, and calls to the appropriate routine to
@@ -715,7 +815,7 @@ miFillPolygon(DrawablePtr dst, GCPtr pgc,
             }
         }
     }
-    if (shape == Convex)
+    if (shape == Convex || (count >= 3 && miPolyIsYMonotone(count, pPts)))
         miFillConvexPoly(dst, pgc, count, pPts);
     else
         miFillGeneralPoly(dst, pgc, count, pPts);
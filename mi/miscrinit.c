@@ -127,6 +127,18 @@ miCloseScreen(ScreenPtr pScreen)
     return TRUE;
 }
 
+/*
+ * Free what the drawing code keeps around from one request to the next.
+ * It is shared by all screens, so this is called once the screens are
+ * gone, at server reset.
+ */
+void
+miFreeDrawCaches(void)
+{
+    miArcCacheFree();
+    miPolyFreeStorage();
+}
+
 static Bool
 miSaveScreen(ScreenPtr pScreen, int on)
 {
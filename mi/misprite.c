@@ -63,6 +63,7 @@ typedef struct {
     Bool isUp;                  /* cursor in frame buffer */
     Bool shouldBeUp;            /* cursor should be displayed */
     Bool checkPixels;           /* check colormap collision */
+    Bool moved;                 /* x, y changed since it was put up */
     ScreenPtr pScreen;
 } miCursorInfoRec, *miCursorInfoPtr;
 
@@ -91,6 +92,8 @@ typedef struct {
     DamagePtr pDamage;          /* damage tracking structure */
     Bool damageRegistered;
     int numberOfCursors;
+    unsigned long movesInPlace; /* moves drawn with one copy to the screen */
+    unsigned long movesRedrawn; /* moves which took the cursor down */
 } miSpriteScreenRec, *miSpriteScreenPtr;
 
 #define SOURCE_COLOR	0
@@ -239,6 +242,7 @@ miPointerSpriteFuncRec miSpritePointerFuncs = {
 static void miSpriteRemoveCursor(DeviceIntPtr pDev, ScreenPtr pScreen);
 static void miSpriteSaveUnderCursor(DeviceIntPtr pDev, ScreenPtr pScreen);
 static void miSpriteRestoreCursor(DeviceIntPtr pDev, ScreenPtr pScreen);
+static void miSpriteMoveUpCursor(DeviceIntPtr pDev, ScreenPtr pScreen);
 
 static void
 miSpriteRegisterBlockHandler(ScreenPtr pScreen, miSpriteScreenPtr pScreenPriv)
@@ -353,6 +357,12 @@ static void miSpriteCloseScreen(CallbackListPtr *pcbl, ScreenPtr pScreen, void *
     pScreen->InstallColormap = pScreenPriv->InstallColormap;
     pScreen->StoreColors = pScreenPriv->StoreColors;
 
+    if (pScreenPriv->movesInPlace || pScreenPriv->movesRedrawn)
+        LogMessageVerb(X_INFO, 3, "misprite: screen %d moved the cursor %lu "
+                       "times in place and %lu times by redrawing it\n",
+                       pScreen->myNum, pScreenPriv->movesInPlace,
+                       pScreenPriv->movesRedrawn);
+
     DamageDestroy(pScreenPriv->pDamage);
 
     dixSetPrivate(&pScreen->devPrivates, &miSpriteScreenKeyRec, NULL);
@@ -428,6 +438,16 @@ miSpriteBlockHandler(ScreenPtr pScreen, void *timeout)
 
     SCREEN_PROLOGUE(pPriv, pScreen, BlockHandler);
 
+    for (pDev = inputInfo.devices; pDev; pDev = pDev->next) {
+        if (DevHasCursor(pDev)) {
+            pCursorInfo = GetSprite(pDev);
+            if (pCursorInfo && pCursorInfo->isUp && pCursorInfo->moved &&
+                pCursorInfo->pScreen == pScreen) {
+                SPRITE_DEBUG(("BlockHandler move\n"));
+                miSpriteMoveUpCursor(pDev, pScreen);
+            }
+        }
+    }
     for (pDev = inputInfo.devices; pDev; pDev = pDev->next) {
         if (DevHasCursor(pDev)) {
             pCursorInfo = GetSprite(pDev);
@@ -656,6 +676,19 @@ miSpriteSetCursor(DeviceIntPtr pDev, ScreenPtr pScreen,
         pPointer->pCursor == pCursor && !pPointer->checkPixels) {
         return;
     }
+    if (pPointer->isUp && pPointer->pScreen == pScreen &&
+        pPointer->pCursor == pCursor && !pPointer->checkPixels) {
+        /*
+         * Only the position changed: leave the cursor where it is until
+         * the block handler, so that all the motion of one round of
+         * requests and events costs a single update of the screen.
+         */
+        pPointer->x = x;
+        pPointer->y = y;
+        pPointer->moved = TRUE;
+        miSpriteRegisterBlockHandler(pScreen, pScreenPriv);
+        return;
+    }
     pPointer->x = x;
     pPointer->y = y;
     if (pPointer->checkPixels || pPointer->pCursor != pCursor) {
@@ -663,7 +696,6 @@ miSpriteSetCursor(DeviceIntPtr pDev, ScreenPtr pScreen,
         miSpriteFindColors(pPointer, pScreen);
     }
     if (pPointer->isUp) {
-        /* TODO: reimplement flicker-free MoveCursor */
         SPRITE_DEBUG(("SetCursor remove %d\n", pDev->id));
         miSpriteRemoveCursor(pDev, pScreen);
     }
@@ -705,6 +737,7 @@ miSpriteDeviceCursorInitialize(DeviceIntPtr pDev, ScreenPtr pScreen)
         pCursorInfo->isUp = FALSE;
         pCursorInfo->shouldBeUp = FALSE;
         pCursorInfo->checkPixels = TRUE;
+        pCursorInfo->moved = FALSE;
         pCursorInfo->pScreen = FALSE;
     }
 
@@ -741,6 +774,7 @@ miSpriteRemoveCursor(DeviceIntPtr pDev, ScreenPtr pScreen)
     pCursorInfo = GetSprite(pDev);
 
     miSpriteIsDown(pCursorInfo);
+    pCursorInfo->moved = FALSE;
     miSpriteRegisterBlockHandler(pScreen, pScreenPriv);
     miSpriteDisableDamage(pScreen, pScreenPriv);
     if (!miDCRestoreUnderCursor(pDev,
@@ -831,6 +865,61 @@ miSpriteRestoreCursor(DeviceIntPtr pDev, ScreenPtr pScreen)
     DamageDrawInternal(pScreen, FALSE);
 }
 
+/*
+ * Called from the block handler for a cursor which is up but was moved:
+ * when the old and the new position overlap, update the screen in one copy
+ * instead of taking the cursor down and putting it up again.  With several
+ * cursors on the screen one may be drawn over another, which only taking
+ * them all down and putting them up in turn gets right.
+ */
+
+static void
+miSpriteMoveUpCursor(DeviceIntPtr pDev, ScreenPtr pScreen)
+{
+    miSpriteScreenPtr pScreenPriv;
+    miCursorInfoPtr pCursorInfo;
+    CursorPtr pCursor;
+    BoxRec old;
+    Bool moved = FALSE;
+
+    if (InputDevIsFloating(pDev))
+        return;
+
+    pScreenPriv = GetSpriteScreen(pScreen);
+    pCursorInfo = GetSprite(pDev);
+    pCursor = pCursorInfo->pCursor;
+
+    old = pCursorInfo->saved;
+    miSpriteComputeSaved(pDev, pScreen);
+    pCursorInfo->moved = FALSE;
+
+    if (pScreenPriv->numberOfCursors == 1 &&
+        BOX_OVERLAP(&old, pCursorInfo->saved.x1, pCursorInfo->saved.y1,
+                    pCursorInfo->saved.x2, pCursorInfo->saved.y2)) {
+        DamageDrawInternal(pScreen, TRUE);
+        miSpriteDisableDamage(pScreen, pScreenPriv);
+        SPRITE_DEBUG(("MoveUpCursor %d\n", pDev->id));
+        moved = miDCMoveCursor(pDev, pScreen, pCursor,
+                               &old, &pCursorInfo->saved,
+                               pCursorInfo->x - (int) pCursor->bits->xhot,
+                               pCursorInfo->y - (int) pCursor->bits->yhot,
+                               pScreenPriv->colors[SOURCE_COLOR].pixel,
+                               pScreenPriv->colors[MASK_COLOR].pixel);
+        miSpriteEnableDamage(pScreen, pScreenPriv);
+        DamageDrawInternal(pScreen, FALSE);
+    }
+
+    if (moved) {
+        pScreenPriv->movesInPlace++;
+    }
+    else {
+        /* the save area still holds what was under the old position */
+        pCursorInfo->saved = old;
+        pScreenPriv->movesRedrawn++;
+        miSpriteRemoveCursor(pDev, pScreen);
+    }
+}
+
 /*
  * compute the desired area of the screen to save
  */
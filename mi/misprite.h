@@ -46,6 +46,9 @@ bool miDCSaveUnderCursor(DeviceIntPtr pDev, ScreenPtr pScreen,
                          int x, int y, int w, int h);
 bool miDCRestoreUnderCursor(DeviceIntPtr pDev, ScreenPtr pScreen,
                             int x, int y, int w, int h);
+bool miDCMoveCursor(DeviceIntPtr pDev, ScreenPtr pScreen, CursorPtr pCursor,
+                    BoxPtr pOld, BoxPtr pNew, int x, int y,
+                    unsigned long source, unsigned long mask);
 bool miDCDeviceInitialize(DeviceIntPtr pDev, ScreenPtr pScreen);
 void miDCDeviceCleanup(DeviceIntPtr pDev, ScreenPtr pScreen);
 
@@ -270,6 +270,35 @@ miComputeClips(WindowPtr pParent,
     dx = pParent->drawable.x - pParent->valdata->before.oldAbsCorner.x;
     dy = pParent->drawable.y - pParent->valdata->before.oldAbsCorner.y;
 
+    /*
+     * A redirected window is clipped to its own borderSize, not by its
+     * siblings.  When it was only marked because a sibling moved or was
+     * restacked across it, nothing inside its pixmap changes: keep the
+     * clip lists of the whole subtree and just reset the exposures.
+     */
+    if ((kind == VTMove || kind == VTStack) && !dx && !dy &&
+        oldVis == newVis && pParent->redirectDraw != RedirectDrawNone) {
+        pChild = pParent;
+        while (1) {
+            if (pChild->viewable) {
+                if (pChild->valdata) {
+                    RegionNull(&pChild->valdata->after.borderExposed);
+                    RegionNull(&pChild->valdata->after.exposed);
+                }
+                if (pChild->firstChild) {
+                    pChild = pChild->firstChild;
+                    continue;
+                }
+            }
+            while (!pChild->nextSib && (pChild != pParent))
+                pChild = pChild->parent;
+            if (pChild == pParent)
+                break;
+            pChild = pChild->nextSib;
+        }
+        return;
+    }
+
     /*
      * avoid computations when dealing with simple operations
      */
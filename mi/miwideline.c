@@ -414,8 +414,6 @@ miFillUniqueSpanGroup(DrawablePtr pDraw, GCPtr pGC, SpanGroup * spanGroup)
 {
     int i;
     Spans *spans;
-    Spans *yspans;
-    int *ysizes;
     int ymin, ylength;
 
     /* Outgoing spans for one big call to FillSpans */
@@ -435,121 +433,99 @@ miFillUniqueSpanGroup(DrawablePtr pDraw, GCPtr pGC, SpanGroup * spanGroup)
         free(spans->widths);
     }
     else {
-        /* Yuck.  Gross.  Radix sort into y buckets, then sort x and uniquify */
-        /* This seems to be the fastest thing to do.  I've tried sorting on
-           both x and y at the same time rather than creating into all those
-           y buckets, but it was somewhat slower. */
+        /*
+         * Counting sort on y into one buffer: count the spans of each row,
+         * place every row at its offset, then sort each row by x and
+         * uniquify it in place, rows only ever move towards the front.
+         */
+        int *rows;
 
         ymin = spanGroup->ymin;
         ylength = spanGroup->ymax - ymin + 1;
 
-        /* Allocate Spans for y buckets */
-        yspans = calloc(ylength, sizeof(Spans));
-        ysizes = calloc(ylength, sizeof(int));
-
-        if (!yspans || !ysizes) {
-            free(yspans);
-            free(ysizes);
+        rows = calloc(ylength, sizeof(int));
+        if (!rows) {
             miDisposeSpanGroup(spanGroup);
             return;
         }
 
-        for (i = 0; i != ylength; i++) {
-            ysizes[i] = 0;
-            yspans[i].count = 0;
-            yspans[i].points = NULL;
-            yspans[i].widths = NULL;
-        }
-
-        /* Go through every single span and put it into the correct bucket */
         count = 0;
         for (i = 0, spans = spanGroup->group;
              i != spanGroup->count; i++, spans++) {
-            int index;
             int j;
 
-            for (j = 0, points = spans->points, widths = spans->widths;
-                 j != spans->count; j++, points++, widths++) {
-                index = points->y - ymin;
+            for (j = 0; j != spans->count; j++) {
+                int index = spans->points[j].y - ymin;
+
                 if (index >= 0 && index < ylength) {
-                    Spans *newspans = &(yspans[index]);
-
-                    if (newspans->count == ysizes[index]) {
-                        DDXPointPtr newpoints;
-                        int *newwidths;
-
-                        ysizes[index] = (ysizes[index] + 8) * 2;
-                        newpoints = reallocarray(newspans->points,
-                                                 ysizes[index],
-                                                 sizeof(xPoint));
-                        newwidths = reallocarray(newspans->widths,
-                                                 ysizes[index], sizeof(int));
-                        if (!newpoints || !newwidths) {
-                            for (i = 0; i < ylength; i++) {
-                                free(yspans[i].points);
-                                free(yspans[i].widths);
-                            }
-                            free(yspans);
-                            free(ysizes);
-                            free(newpoints);
-                            free(newwidths);
-                            miDisposeSpanGroup(spanGroup);
-                            return;
-                        }
-                        newspans->points = newpoints;
-                        newspans->widths = newwidths;
-                    }
-                    newspans->points[newspans->count] = *points;
-                    newspans->widths[newspans->count] = *widths;
-                    (newspans->count)++;
-                }               /* if y value of span in range */
-            }                   /* for j through spans */
-            count += spans->count;
-            free(spans->points);
-            spans->points = NULL;
-            free(spans->widths);
-            spans->widths = NULL;
-        }                       /* for i thorough Spans */
+                    rows[index]++;
+                    count++;
+                }
+            }
+        }
 
-        /* Now sort by x and uniquify each bucket into the final array */
         points = calloc(count, sizeof(xPoint));
         widths = calloc(count, sizeof(int));
         if (!points || !widths) {
-            for (i = 0; i < ylength; i++) {
-                free(yspans[i].points);
-                free(yspans[i].widths);
-            }
-            free(yspans);
-            free(ysizes);
             free(points);
             free(widths);
+            free(rows);
+            miDisposeSpanGroup(spanGroup);
             return;
         }
-        count = 0;
-        for (i = 0; i != ylength; i++) {
-            int ycount = yspans[i].count;
 
-            if (ycount > 0) {
-                if (ycount > 1) {
-                    QuickSortSpansX(yspans[i].points, yspans[i].widths, ycount);
-                    count += UniquifySpansX
-                        (&(yspans[i]), &(points[count]), &(widths[count]));
-                }
-                else {
-                    points[count] = yspans[i].points[0];
-                    widths[count] = yspans[i].widths[0];
-                    count++;
+        /* rows[i] becomes the end of row i once every span is placed */
+        for (i = 0, count = 0; i != ylength; i++) {
+            int n = rows[i];
+
+            rows[i] = count;
+            count += n;
+        }
+        for (i = 0, spans = spanGroup->group;
+             i != spanGroup->count; i++, spans++) {
+            int j;
+
+            for (j = 0; j != spans->count; j++) {
+                int index = spans->points[j].y - ymin;
+
+                if (index >= 0 && index < ylength) {
+                    points[rows[index]] = spans->points[j];
+                    widths[rows[index]] = spans->widths[j];
+                    rows[index]++;
                 }
-                free(yspans[i].points);
-                free(yspans[i].widths);
+            }
+            free(spans->points);
+            spans->points = NULL;
+            free(spans->widths);
+            spans->widths = NULL;
+        }
+
+        count = 0;
+        for (i = 0; i != ylength; i++) {
+            int first = i ? rows[i - 1] : 0;
+            int ycount = rows[i] - first;
+
+            if (ycount > 1) {
+                Spans row = {
+                    .count = ycount,
+                    .points = &points[first],
+                    .widths = &widths[first],
+                };
+
+                QuickSortSpansX(row.points, row.widths, ycount);
+                count += UniquifySpansX(&row, &points[count], &widths[count]);
+            }
+            else if (ycount == 1) {
+                points[count] = points[first];
+                widths[count] = widths[first];
+                count++;
             }
         }
 
         (*pGC->ops->FillSpans) (pDraw, pGC, count, points, widths, TRUE);
         free(points);
         free(widths);
-        free(yspans);
-        free(ysizes);           /* use (DE)xalloc for these? */
+        free(rows);
     }
 
     spanGroup->count = 0;
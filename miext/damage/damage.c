@@ -513,6 +513,70 @@ damageComposite(CARD8 op,
     wrap(pScrPriv, ps, Composite, damageComposite);
 }
 
+/*
+ * Report the damage of the whole run at once, then hand it down as a
+ * run.  Composite is unwrapped as well so that the layer below sees its
+ * own Composite in place and knows nobody else needs to see each rect.
+ */
+static void
+damageCompositeBatch(CARD8 op,
+                     PicturePtr pSrc,
+                     PicturePtr pMask,
+                     PicturePtr pDst, int nrect, PictCompositeRectPtr rects)
+{
+    ScreenPtr pScreen = pDst->pDrawable->pScreen;
+    PictureScreenPtr ps = GetPictureScreen(pScreen);
+
+    damageScrPriv(pScreen);
+
+    if (ps->Composite != damageComposite) {
+        miCompositeBatch(op, pSrc, pMask, pDst, nrect, rects);
+        return;
+    }
+
+    if (checkPictureDamage(pDst)) {
+        RegionRec region;
+        int i;
+
+        RegionNull(&region);
+        for (i = 0; i < nrect; i++) {
+            BoxRec box;
+
+            box.x1 = rects[i].xDst + pDst->pDrawable->x;
+            box.y1 = rects[i].yDst + pDst->pDrawable->y;
+            box.x2 = box.x1 + rects[i].width;
+            box.y2 = box.y1 + rects[i].height;
+            TRIM_PICTURE_BOX(box, pDst);
+            if (BOX_NOT_EMPTY(box)) {
+                RegionRec piece;
+
+                RegionInit(&piece, &box, 1);
+                RegionAppend(&region, &piece);
+                RegionUninit(&piece);
+            }
+        }
+        if (RegionNotEmpty(&region)) {
+            Bool overlap;
+
+            RegionValidate(&region, &overlap);
+            damageRegionAppend(pDst->pDrawable, &region, TRUE,
+                               pDst->subWindowMode);
+        }
+        RegionUninit(&region);
+    }
+    /* see damageComposite */
+    if (pSrc->pDrawable && WindowDrawable(pSrc->pDrawable->type))
+        miCompositeSourceValidate(pSrc);
+    if (pMask && pMask->pDrawable && WindowDrawable(pMask->pDrawable->type))
+        miCompositeSourceValidate(pMask);
+    unwrap(pScrPriv, ps, Composite);
+    unwrap(pScrPriv, ps, CompositeBatch);
+    (*ps->CompositeBatch) (op, pSrc, pMask, pDst, nrect, rects);
+    damageRegionProcessPending(pDst->pDrawable);
+    wrap(pScrPriv, ps, CompositeBatch, damageCompositeBatch);
+    wrap(pScrPriv, ps, Composite, damageComposite);
+}
+
 static void
 damageGlyphs(CARD8 op,
              PicturePtr pSrc,
@@ -1678,6 +1742,7 @@ DamageSetup(ScreenPtr pScreen)
         wrap(pScrPriv, ps, Glyphs, damageGlyphs);
         wrap(pScrPriv, ps, Composite, damageComposite);
         wrap(pScrPriv, ps, AddTraps, damageAddTraps);
+        wrap(pScrPriv, ps, CompositeBatch, damageCompositeBatch);
     }
 
     pScrPriv->funcs = miFuncs;
@@ -35,13 +35,9 @@
 #include    "globals.h"
 #include    "gcstruct.h"
 #include    "shadow.h"
+#include    "shadow_priv.h"
 
-static DevPrivateKeyRec shadowScrPrivateKeyRec;
-#define shadowScrPrivateKey (&shadowScrPrivateKeyRec)
-
-#define shadowGetBuf(pScr) ((shadowBufPtr) \
-    dixLookupPrivate(&(pScr)->devPrivates, shadowScrPrivateKey))
-#define shadowBuf(pScr)            shadowBufPtr pBuf = shadowGetBuf(pScr)
+DevPrivateKeyRec shadowScrPrivateKeyRec;
 
 #define wrap(priv, real, mem) {\
     priv->mem = real->mem; \
@@ -62,8 +58,16 @@ shadowRedisplay(ScreenPtr pScreen)
         return;
     pRegion = DamageRegion(pBuf->pDamage);
     if (RegionNotEmpty(pRegion)) {
-        (*pBuf->update) (pScreen, pBuf);
+        if (pBuf->thread) {
+            shadowThreadQueue(pScreen, pBuf);
+            return;
+        }
+        /* drop damaged tiles whose contents did not actually change */
+        if (!pBuf->tiles || shadowTilesFilter(pScreen, pBuf))
+            shadowFlushUpdate(pScreen, pBuf);
         DamageEmpty(pBuf->pDamage);
+        if (pBuf->tiles)
+            shadowTilesClear(pBuf);
     }
 }
 
@@ -88,8 +92,11 @@ shadowGetImage(DrawablePtr pDrawable, int sx, int sy, int w, int h,
     shadowBuf(pScreen);
 
     /* Many apps use GetImage to sync with the visible frame buffer */
-    if (pDrawable->type == DRAWABLE_WINDOW)
+    if (pDrawable->type == DRAWABLE_WINDOW) {
+        shadowFlushWait(pScreen);
         shadowRedisplay(pScreen);
+        shadowFlushWait(pScreen);
+    }
     unwrap(pBuf, pScreen, GetImage);
     pScreen->GetImage(pDrawable, sx, sy, w, h, format, planeMask, pdstLine);
     wrap(pBuf, pScreen, GetImage);
@@ -102,7 +109,32 @@ static void shadowCloseScreen(CallbackListPtr *pcbl, ScreenPtr pScreen, void *un
     shadowBuf(pScreen);
     unwrap(pBuf, pScreen, GetImage);
     unwrap(pBuf, pScreen, BlockHandler);
+    shadowSetAsync(pScreen, FALSE);
     shadowRemove(pScreen, pBuf->pPixmap);
+    if (pBuf->flush.frames) {
+        shadowFlushStatsRec stats;
+
+        shadowGetFlushStats(pScreen, &stats);
+        LogMessageVerb(X_INFO, 3, "shadow: screen %d: %llu updates, "
+                       "%llu deferred, %llu us on average, at most %llu us\n",
+                       pScreen->myNum,
+                       (unsigned long long) stats.frames,
+                       (unsigned long long) stats.skipped,
+                       (unsigned long long) (stats.totalUsec / stats.frames),
+                       (unsigned long long) stats.maxUsec);
+    }
+    if (pBuf->tiles) {
+        shadowTileStatsRec stats;
+
+        shadowTilesGetStats(pScreen, &stats);
+        LogMessageVerb(X_INFO, 3, "shadow: screen %d: %llu tiles damaged, "
+                       "%llu changed, %llu bytes changed\n",
+                       pScreen->myNum,
+                       (unsigned long long) stats.tilesDamaged,
+                       (unsigned long long) stats.tilesChanged,
+                       (unsigned long long) stats.bytesChanged);
+    }
+    shadowTilesFree(pBuf);
     DamageDestroy(pBuf->pDamage);
     dixDestroyPixmap(pBuf->pPixmap, 0);
     free(pBuf);
@@ -138,6 +170,8 @@ shadowSetup(ScreenPtr pScreen)
     pBuf->pPixmap = 0;
     pBuf->closure = 0;
     pBuf->randr = 0;
+    pBuf->tiles = 0;
+    pBuf->thread = 0;
 
     dixSetPrivate(&pScreen->devPrivates, shadowScrPrivateKey, pBuf);
     return TRUE;
@@ -167,11 +201,14 @@ shadowAdd(ScreenPtr pScreen, PixmapPtr pPixmap, ShadowUpdateProc update,
         randr = SHADOW_ROTATE_270;
         break;
     }
+    shadowFlushWait(pScreen);
     pBuf->update = update;
     pBuf->window = window;
     pBuf->randr = randr;
     pBuf->closure = closure;
     pBuf->pPixmap = pPixmap;
+    if (pBuf->tiles)
+        shadowTilesReset(pBuf);
     DamageRegister(&pPixmap->drawable, pBuf->pDamage);
     return TRUE;
 }
@@ -181,6 +218,7 @@ shadowRemove(ScreenPtr pScreen, PixmapPtr pPixmap)
 {
     shadowBuf(pScreen);
 
+    shadowFlushWait(pScreen);
     if (pBuf->pPixmap) {
         DamageUnregister(pBuf->pDamage);
         pBuf->update = 0;
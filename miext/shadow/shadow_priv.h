@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Copyright © 2000 Keith Packard
+ */
+#ifndef _XSERVER_SHADOW_PRIV_H
+#define _XSERVER_SHADOW_PRIV_H
+
+#include <stddef.h>
+
+#include "shadow.h"
+
+extern DevPrivateKeyRec shadowScrPrivateKeyRec;
+#define shadowScrPrivateKey (&shadowScrPrivateKeyRec)
+
+#define shadowGetBuf(pScr) ((shadowBufPtr) \
+    dixLookupPrivate(&(pScr)->devPrivates, shadowScrPrivateKey))
+#define shadowBuf(pScr)            shadowBufPtr pBuf = shadowGetBuf(pScr)
+
+/* shblit.c */
+typedef void (*ShadowBlitProc) (void *dst, ptrdiff_t dstPitch,
+                                const void *src, ptrdiff_t over,
+                                ptrdiff_t down, int width, int height);
+
+const char *shadowBlitSelect(const char *name);
+Bool shadowUpdateBlit(ScreenPtr pScreen, shadowBufPtr pBuf, int randr);
+
+/* shthread.c */
+void shadowThreadQueue(ScreenPtr pScreen, shadowBufPtr pBuf);
+void shadowFlushUpdate(ScreenPtr pScreen, shadowBufPtr pBuf);
+
+/* shtiles.c */
+Bool shadowTilesFilter(ScreenPtr pScreen, shadowBufPtr pBuf);
+void shadowTilesClear(shadowBufPtr pBuf);
+void shadowTilesReset(shadowBufPtr pBuf);
+void shadowTilesFree(shadowBufPtr pBuf);
+
+#endif /* _XSERVER_SHADOW_PRIV_H */
@@ -0,0 +1,720 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Pixel kernels for packed 16 and 32 bpp shadow updates.
+ *
+ * Every packed update, rotated or not, boils down to walking a screen
+ * rectangle row by row while the matching shadow pixel moves by a fixed
+ * step per screen column ("over") and per screen row ("down").  For 0
+ * and 180 degrees the shadow is read along its rows; for 90 and 270 it
+ * is read down its columns, which is where the generic per-pixel loops
+ * spend most of their time.  Here the rectangle is cut into tiles small
+ * enough to stay in cache, and the rotated cases transpose small blocks
+ * in vector registers.  The kernel set is picked at runtime from what
+ * the CPU supports.
+ */
+#include <dix-config.h>
+
+#include <stddef.h>
+#include <string.h>
+#include <X11/X.h>
+
+#include "scrnintstr.h"
+#include "regionstr.h"
+#include "shadow.h"
+#include "shadow_priv.h"
+#include "fb.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SHADOW_BLIT_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SHADOW_BLIT_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* tile edge in pixels; 32x32 tiles of 32 bpp pixels fit nicely in L1 */
+#define SHADOW_BLIT_TILE    32
+
+/* screen rows mapped and written as one block */
+#define SHADOW_BLIT_ROWS    SHADOW_BLIT_TILE
+
+/*
+ * Generic kernels.  dst is the first screen pixel of the rectangle,
+ * dstPitch the distance between screen rows in bytes, src the shadow
+ * pixel landing on dst and over/down the shadow steps in pixels.
+ */
+#define SHADOW_BLIT_C(name, Data)                                       \
+static void                                                             \
+name(void *dst, ptrdiff_t dstPitch, const void *src,                    \
+     ptrdiff_t over, ptrdiff_t down, int width, int height)             \
+{                                                                       \
+    const Data *s = src;                                                \
+    int tx, ty, x, y;                                                   \
+                                                                        \
+    if (over == 1) {                                                    \
+        for (y = 0; y < height; y++)                                    \
+            memcpy((CARD8 *) dst + y * dstPitch, s + y * down,          \
+                   width * sizeof(Data));                               \
+        return;                                                         \
+    }                                                                   \
+    for (ty = 0; ty < height; ty += SHADOW_BLIT_TILE) {                 \
+        int th = min(SHADOW_BLIT_TILE, height - ty);                    \
+                                                                        \
+        for (tx = 0; tx < width; tx += SHADOW_BLIT_TILE) {              \
+            int tw = min(SHADOW_BLIT_TILE, width - tx);                 \
+                                                                        \
+            for (y = ty; y < ty + th; y++) {                            \
+                Data *d = (Data *) ((CARD8 *) dst + y * dstPitch);      \
+                const Data *sl = s + y * down;                          \
+                                                                        \
+                for (x = tx; x < tx + tw; x++)                          \
+                    d[x] = sl[x * over];                                \
+            }                                                           \
+        }                                                               \
+    }                                                                   \
+}
+
+SHADOW_BLIT_C(shadowBlit16_c, CARD16)
+SHADOW_BLIT_C(shadowBlit32_c, CARD32)
+
+#ifdef SHADOW_BLIT_X86
+
+#define SHADOW_SSE2 __attribute__((target("sse2")))
+#define SHADOW_AVX2 __attribute__((target("avx2")))
+
+static inline SHADOW_SSE2 __m128i
+shadowLoadColumn32_sse2(const CARD32 *s, ptrdiff_t down)
+{
+    /* four pixels of one shadow column, in screen row order */
+    if (down == 1)
+        return _mm_loadu_si128((const __m128i *) s);
+    return _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) (s - 3)),
+                             _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+static inline SHADOW_SSE2 __m128i
+shadowReverse16_sse2(__m128i v)
+{
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    return _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+static inline SHADOW_SSE2 __m128i
+shadowLoadColumn16_sse2(const CARD16 *s, ptrdiff_t down)
+{
+    if (down == 1)
+        return _mm_loadu_si128((const __m128i *) s);
+    return shadowReverse16_sse2(_mm_loadu_si128((const __m128i *) (s - 7)));
+}
+
+static SHADOW_SSE2 void
+shadowBlit32_sse2(void *dst, ptrdiff_t dstPitch, const void *src,
+                  ptrdiff_t over, ptrdiff_t down, int width, int height)
+{
+    const CARD32 *s = src;
+    int tx, ty, x, y;
+
+    if (over == -1) {
+        for (y = 0; y < height; y++) {
+            CARD32 *d = (CARD32 *) ((CARD8 *) dst + y * dstPitch);
+            const CARD32 *sl = s + y * down;
+
+            for (x = 0; x + 4 <= width; x += 4) {
+                __m128i v = _mm_loadu_si128((const __m128i *) (sl - x - 3));
+
+                _mm_storeu_si128((__m128i *) (d + x),
+                                 _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3)));
+            }
+            for (; x < width; x++)
+                d[x] = sl[-x];
+        }
+        return;
+    }
+    if (down != 1 && down != -1) {
+        shadowBlit32_c(dst, dstPitch, src, over, down, width, height);
+        return;
+    }
+
+    /* rotated: screen rows run down shadow columns, transpose 4x4 blocks */
+    for (ty = 0; ty < height; ty += SHADOW_BLIT_TILE) {
+        int th = min(SHADOW_BLIT_TILE, height - ty);
+        int bh = th & ~3;
+
+        for (tx = 0; tx < width; tx += SHADOW_BLIT_TILE) {
+            int tw = min(SHADOW_BLIT_TILE, width - tx);
+            int bw = tw & ~3;
+
+            for (y = ty; y < ty + bh; y += 4) {
+                CARD32 *d = (CARD32 *) ((CARD8 *) dst + y * dstPitch);
+
+                for (x = tx; x < tx + bw; x += 4) {
+                    const CARD32 *sp = s + y * down + x * over;
+                    __m128i c0 = shadowLoadColumn32_sse2(sp, down);
+                    __m128i c1 = shadowLoadColumn32_sse2(sp + over, down);
+                    __m128i c2 = shadowLoadColumn32_sse2(sp + 2 * over, down);
+                    __m128i c3 = shadowLoadColumn32_sse2(sp + 3 * over, down);
+                    __m128i a = _mm_unpacklo_epi32(c0, c1);
+                    __m128i b = _mm_unpacklo_epi32(c2, c3);
+                    __m128i c = _mm_unpackhi_epi32(c0, c1);
+                    __m128i e = _mm_unpackhi_epi32(c2, c3);
+
+                    _mm_storeu_si128((__m128i *) (d + x),
+                                     _mm_unpacklo_epi64(a, b));
+                    _mm_storeu_si128((__m128i *) ((CARD8 *) (d + x) + dstPitch),
+                                     _mm_unpackhi_epi64(a, b));
+                    _mm_storeu_si128((__m128i *) ((CARD8 *) (d + x) + 2 * dstPitch),
+                                     _mm_unpacklo_epi64(c, e));
+                    _mm_storeu_si128((__m128i *) ((CARD8 *) (d + x) + 3 * dstPitch),
+                                     _mm_unpackhi_epi64(c, e));
+                }
+            }
+            /* ragged right and bottom edges of the tile */
+            for (y = ty; y < ty + th; y++) {
+                CARD32 *d = (CARD32 *) ((CARD8 *) dst + y * dstPitch);
+                const CARD32 *sl = s + y * down;
+
+                for (x = (y < ty + bh) ? tx + bw : tx; x < tx + tw; x++)
+                    d[x] = sl[x * over];
+            }
+        }
+    }
+}
+
+static SHADOW_SSE2 void
+shadowBlit16_sse2(void *dst, ptrdiff_t dstPitch, const void *src,
+                  ptrdiff_t over, ptrdiff_t down, int width, int height)
+{
+    const CARD16 *s = src;
+    int tx, ty, x, y, i;
+
+    if (over == -1) {
+        for (y = 0; y < height; y++) {
+            CARD16 *d = (CARD16 *) ((CARD8 *) dst + y * dstPitch);
+            const CARD16 *sl = s + y * down;
+
+            for (x = 0; x + 8 <= width; x += 8) {
+                __m128i v = _mm_loadu_si128((const __m128i *) (sl - x - 7));
+
+                _mm_storeu_si128((__m128i *) (d + x), shadowReverse16_sse2(v));
+            }
+            for (; x < width; x++)
+                d[x] = sl[-x];
+        }
+        return;
+    }
+    if (down != 1 && down != -1) {
+        shadowBlit16_c(dst, dstPitch, src, over, down, width, height);
+        return;
+    }
+
+    /* rotated: transpose 8x8 blocks */
+    for (ty = 0; ty < height; ty += SHADOW_BLIT_TILE) {
+        int th = min(SHADOW_BLIT_TILE, height - ty);
+        int bh = th & ~7;
+
+        for (tx = 0; tx < width; tx += SHADOW_BLIT_TILE) {
+            int tw = min(SHADOW_BLIT_TILE, width - tx);
+            int bw = tw & ~7;
+
+            for (y = ty; y < ty + bh; y += 8) {
+                CARD8 *d = (CARD8 *) dst + y * dstPitch;
+
+                for (x = tx; x < tx + bw; x += 8) {
+                    const CARD16 *sp = s + y * down + x * over;
+                    __m128i c[8], a[8], b[8];
+
+                    for (i = 0; i < 8; i++)
+                        c[i] = shadowLoadColumn16_sse2(sp + i * over, down);
+
+                    a[0] = _mm_unpacklo_epi16(c[0], c[1]);
+                    a[1] = _mm_unpacklo_epi16(c[2], c[3]);
+                    a[2] = _mm_unpacklo_epi16(c[4], c[5]);
+                    a[3] = _mm_unpacklo_epi16(c[6], c[7]);
+                    a[4] = _mm_unpackhi_epi16(c[0], c[1]);
+                    a[5] = _mm_unpackhi_epi16(c[2], c[3]);
+                    a[6] = _mm_unpackhi_epi16(c[4], c[5]);
+                    a[7] = _mm_unpackhi_epi16(c[6], c[7]);
+
+                    b[0] = _mm_unpacklo_epi32(a[0], a[1]);
+                    b[1] = _mm_unpacklo_epi32(a[2], a[3]);
+                    b[2] = _mm_unpackhi_epi32(a[0], a[1]);
+                    b[3] = _mm_unpackhi_epi32(a[2], a[3]);
+                    b[4] = _mm_unpacklo_epi32(a[4], a[5]);
+                    b[5] = _mm_unpacklo_epi32(a[6], a[7]);
+                    b[6] = _mm_unpackhi_epi32(a[4], a[5]);
+                    b[7] = _mm_unpackhi_epi32(a[6], a[7]);
+
+                    for (i = 0; i < 4; i++) {
+                        CARD16 *row = (CARD16 *) (d + 2 * i * dstPitch) + x;
+
+                        _mm_storeu_si128((__m128i *) row,
+                                         _mm_unpacklo_epi64(b[2 * i], b[2 * i + 1]));
+                        _mm_storeu_si128((__m128i *) ((CARD8 *) row + dstPitch),
+                                         _mm_unpackhi_epi64(b[2 * i], b[2 * i + 1]));
+                    }
+                }
+            }
+            for (y = ty; y < ty + th; y++) {
+                CARD16 *d = (CARD16 *) ((CARD8 *) dst + y * dstPitch);
+                const CARD16 *sl = s + y * down;
+
+                for (x = (y < ty + bh) ? tx + bw : tx; x < tx + tw; x++)
+                    d[x] = sl[x * over];
+            }
+        }
+    }
+}
+
+static SHADOW_AVX2 void
+shadowBlit32_avx2(void *dst, ptrdiff_t dstPitch, const void *src,
+                  ptrdiff_t over, ptrdiff_t down, int width, int height)
+{
+    const CARD32 *s = src;
+    int x, y;
+
+    if (over == -1) {
+        const __m256i rev = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+
+        for (y = 0; y < height; y++) {
+            CARD32 *d = (CARD32 *) ((CARD8 *) dst + y * dstPitch);
+            const CARD32 *sl = s + y * down;
+
+            for (x = 0; x + 8 <= width; x += 8) {
+                __m256i v = _mm256_loadu_si256((const __m256i *) (sl - x - 7));
+
+                _mm256_storeu_si256((__m256i *) (d + x),
+                                    _mm256_permutevar8x32_epi32(v, rev));
+            }
+            for (; x < width; x++)
+                d[x] = sl[-x];
+        }
+        return;
+    }
+    /* 8x8 transposes in ymm registers measured slower than 4x4 SSE2 ones */
+    shadowBlit32_sse2(dst, dstPitch, src, over, down, width, height);
+}
+
+#endif /* SHADOW_BLIT_X86 */
+
+#ifdef SHADOW_BLIT_NEON
+
+static inline uint32x4_t
+shadowLoadColumn32_neon(const CARD32 *s, ptrdiff_t down)
+{
+    uint32x4_t v;
+
+    if (down == 1)
+        return vld1q_u32(s);
+    v = vrev64q_u32(vld1q_u32(s - 3));
+    return vcombine_u32(vget_high_u32(v), vget_low_u32(v));
+}
+
+static inline uint16x4_t
+shadowLoadColumn16_neon(const CARD16 *s, ptrdiff_t down)
+{
+    if (down == 1)
+        return vld1_u16(s);
+    return vrev64_u16(vld1_u16(s - 3));
+}
+
+static void
+shadowBlit32_neon(void *dst, ptrdiff_t dstPitch, const void *src,
+                  ptrdiff_t over, ptrdiff_t down, int width, int height)
+{
+    const CARD32 *s = src;
+    int tx, ty, x, y;
+
+    if (over == -1) {
+        for (y = 0; y < height; y++) {
+            CARD32 *d = (CARD32 *) ((CARD8 *) dst + y * dstPitch);
+            const CARD32 *sl = s + y * down;
+
+            for (x = 0; x + 4 <= width; x += 4) {
+                uint32x4_t v = vrev64q_u32(vld1q_u32(sl - x - 3));
+
+                vst1q_u32(d + x, vcombine_u32(vget_high_u32(v), vget_low_u32(v)));
+            }
+            for (; x < width; x++)
+                d[x] = sl[-x];
+        }
+        return;
+    }
+    if (down != 1 && down != -1) {
+        shadowBlit32_c(dst, dstPitch, src, over, down, width, height);
+        return;
+    }
+
+    for (ty = 0; ty < height; ty += SHADOW_BLIT_TILE) {
+        int th = min(SHADOW_BLIT_TILE, height - ty);
+        int bh = th & ~3;
+
+        for (tx = 0; tx < width; tx += SHADOW_BLIT_TILE) {
+            int tw = min(SHADOW_BLIT_TILE, width - tx);
+            int bw = tw & ~3;
+
+            for (y = ty; y < ty + bh; y += 4) {
+                CARD8 *d = (CARD8 *) dst + y * dstPitch;
+
+                for (x = tx; x < tx + bw; x += 4) {
+                    const CARD32 *sp = s + y * down + x * over;
+                    uint32x4x2_t p = vtrnq_u32(shadowLoadColumn32_neon(sp, down),
+                                               shadowLoadColumn32_neon(sp + over, down));
+                    uint32x4x2_t q = vtrnq_u32(shadowLoadColumn32_neon(sp + 2 * over, down),
+                                               shadowLoadColumn32_neon(sp + 3 * over, down));
+
+                    vst1q_u32((CARD32 *) d + x,
+                              vcombine_u32(vget_low_u32(p.val[0]), vget_low_u32(q.val[0])));
+                    vst1q_u32((CARD32 *) (d + dstPitch) + x,
+                              vcombine_u32(vget_low_u32(p.val[1]), vget_low_u32(q.val[1])));
+                    vst1q_u32((CARD32 *) (d + 2 * dstPitch) + x,
+                              vcombine_u32(vget_high_u32(p.val[0]), vget_high_u32(q.val[0])));
+                    vst1q_u32((CARD32 *) (d + 3 * dstPitch) + x,
+                              vcombine_u32(vget_high_u32(p.val[1]), vget_high_u32(q.val[1])));
+                }
+            }
+            for (y = ty; y < ty + th; y++) {
+                CARD32 *d = (CARD32 *) ((CARD8 *) dst + y * dstPitch);
+                const CARD32 *sl = s + y * down;
+
+                for (x = (y < ty + bh) ? tx + bw : tx; x < tx + tw; x++)
+                    d[x] = sl[x * over];
+            }
+        }
+    }
+}
+
+static void
+shadowBlit16_neon(void *dst, ptrdiff_t dstPitch, const void *src,
+                  ptrdiff_t over, ptrdiff_t down, int width, int height)
+{
+    const CARD16 *s = src;
+    int tx, ty, x, y;
+
+    if (over == -1) {
+        for (y = 0; y < height; y++) {
+            CARD16 *d = (CARD16 *) ((CARD8 *) dst + y * dstPitch);
+            const CARD16 *sl = s + y * down;
+
+            for (x = 0; x + 8 <= width; x += 8) {
+                uint16x8_t v = vrev64q_u16(vld1q_u16(sl - x - 7));
+
+                vst1q_u16(d + x, vcombine_u16(vget_high_u16(v), vget_low_u16(v)));
+            }
+            for (; x < width; x++)
+                d[x] = sl[-x];
+        }
+        return;
+    }
+    if (down != 1 && down != -1) {
+        shadowBlit16_c(dst, dstPitch, src, over, down, width, height);
+        return;
+    }
+
+    for (ty = 0; ty < height; ty += SHADOW_BLIT_TILE) {
+        int th = min(SHADOW_BLIT_TILE, height - ty);
+        int bh = th & ~3;
+
+        for (tx = 0; tx < width; tx += SHADOW_BLIT_TILE) {
+            int tw = min(SHADOW_BLIT_TILE, width - tx);
+            int bw = tw & ~3;
+
+            for (y = ty; y < ty + bh; y += 4) {
+                CARD8 *d = (CARD8 *) dst + y * dstPitch;
+
+                for (x = tx; x < tx + bw; x += 4) {
+                    const CARD16 *sp = s + y * down + x * over;
+                    uint16x4x2_t p = vtrn_u16(shadowLoadColumn16_neon(sp, down),
+                                              shadowLoadColumn16_neon(sp + over, down));
+                    uint16x4x2_t q = vtrn_u16(shadowLoadColumn16_neon(sp + 2 * over, down),
+                                              shadowLoadColumn16_neon(sp + 3 * over, down));
+                    uint32x2x2_t r = vtrn_u32(vreinterpret_u32_u16(p.val[0]),
+                                              vreinterpret_u32_u16(q.val[0]));
+                    uint32x2x2_t t = vtrn_u32(vreinterpret_u32_u16(p.val[1]),
+                                              vreinterpret_u32_u16(q.val[1]));
+
+                    vst1_u16((CARD16 *) d + x, vreinterpret_u16_u32(r.val[0]));
+                    vst1_u16((CARD16 *) (d + dstPitch) + x, vreinterpret_u16_u32(t.val[0]));
+                    vst1_u16((CARD16 *) (d + 2 * dstPitch) + x, vreinterpret_u16_u32(r.val[1]));
+                    vst1_u16((CARD16 *) (d + 3 * dstPitch) + x, vreinterpret_u16_u32(t.val[1]));
+                }
+            }
+            for (y = ty; y < ty + th; y++) {
+                CARD16 *d = (CARD16 *) ((CARD8 *) dst + y * dstPitch);
+                const CARD16 *sl = s + y * down;
+
+                for (x = (y < ty + bh) ? tx + bw : tx; x < tx + tw; x++)
+                    d[x] = sl[x * over];
+            }
+        }
+    }
+}
+
+#endif /* SHADOW_BLIT_NEON */
+
+typedef struct _shadowBlitFuncs {
+    const char *name;
+    ShadowBlitProc blit16;
+    ShadowBlitProc blit32;
+} shadowBlitFuncsRec;
+
+static const shadowBlitFuncsRec shadowBlitTable[] = {
+#ifdef SHADOW_BLIT_X86
+    { "avx2", shadowBlit16_sse2, shadowBlit32_avx2 },
+    { "sse2", shadowBlit16_sse2, shadowBlit32_sse2 },
+#endif
+#ifdef SHADOW_BLIT_NEON
+    { "neon", shadowBlit16_neon, shadowBlit32_neon },
+#endif
+    { "c", shadowBlit16_c, shadowBlit32_c },
+};
+
+static const shadowBlitFuncsRec *shadowBlitFuncs;
+
+static Bool
+shadowBlitSupported(const char *name)
+{
+#ifdef SHADOW_BLIT_X86
+    __builtin_cpu_init();
+    if (!strcmp(name, "avx2"))
+        return __builtin_cpu_supports("avx2");
+    if (!strcmp(name, "sse2"))
+        return __builtin_cpu_supports("sse2");
+#endif
+    return TRUE;
+}
+
+/*
+ * Select a kernel set by name, or the best one the CPU supports when
+ * name is NULL.  Returns the name of the set in use, or NULL if the
+ * requested one is not available.
+ */
+const char *
+shadowBlitSelect(const char *name)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(shadowBlitTable); i++) {
+        if (name && strcmp(name, shadowBlitTable[i].name))
+            continue;
+        if (!shadowBlitSupported(shadowBlitTable[i].name))
+            continue;
+        shadowBlitFuncs = &shadowBlitTable[i];
+        return shadowBlitFuncs->name;
+    }
+    return NULL;
+}
+
+/*
+ * Copy one screen row piecewise, for window procs which only map part
+ * of a scanline at a time.
+ */
+static Bool
+shadowBlitRowPieces(ScreenPtr pScreen, shadowBufPtr pBuf, ShadowBlitProc blit,
+                    int Bpp, int scr_x, int scr_y, int width,
+                    const CARD8 *src, ptrdiff_t over)
+{
+    while (width) {
+        CARD32 winSize;
+        CARD8 *win = (*pBuf->window) (pScreen, scr_y, scr_x * Bpp,
+                                      SHADOW_WINDOW_WRITE, &winSize,
+                                      pBuf->closure);
+        int n;
+
+        if (!win)
+            return FALSE;
+        n = min(width, (int) (winSize / Bpp));
+        if (n <= 0)
+            return FALSE;
+        (*blit) (win, 0, src, over, 0, n, 1);
+        src += n * over * Bpp;
+        scr_x += n;
+        width -= n;
+    }
+    return TRUE;
+}
+
+/*
+ * Push the damaged region of a 16 or 32 bpp shadow to the screen for
+ * the given SHADOW_ROTATE_* / SHADOW_REFLECT_* combination.  Returns
+ * FALSE when the shadow depth is not handled here, so the caller can
+ * fall back to its generic loop.
+ */
+Bool
+shadowUpdateBlit(ScreenPtr pScreen, shadowBufPtr pBuf, int randr)
+{
+    RegionPtr damage = DamageRegion(pBuf->pDamage);
+    PixmapPtr pShadow = pBuf->pPixmap;
+    int nbox = RegionNumRects(damage);
+    BoxPtr pbox = RegionRects(damage);
+    FbBits *shaBits;
+    FbStride shaStride;
+    int shaBpp;
+    _X_UNUSED int shaXoff, shaYoff;
+    int shaWidth = pShadow->drawable.width;
+    int shaHeight = pShadow->drawable.height;
+    ShadowBlitProc blit;
+    ptrdiff_t pixStride, over, down;
+    int x_dir, y_dir, o_x_dir, o_y_dir;
+    int Bpp;
+
+    fbGetDrawable(&pShadow->drawable, shaBits, shaStride, shaBpp, shaXoff,
+                  shaYoff);
+
+    if (!shadowBlitFuncs)
+        shadowBlitSelect(NULL);
+
+    switch (shaBpp) {
+    case 16:
+        blit = shadowBlitFuncs->blit16;
+        break;
+    case 32:
+        blit = shadowBlitFuncs->blit32;
+        break;
+    default:
+        return FALSE;
+    }
+    Bpp = shaBpp >> 3;
+    pixStride = shaStride * sizeof(FbBits) / Bpp;
+
+    /* same walk as shadowUpdateRotatePacked: 1 is x, 2 is y */
+    o_x_dir = 1;
+    o_y_dir = 2;
+    if (randr & SHADOW_REFLECT_X)
+        o_x_dir = -o_x_dir;
+    if (randr & SHADOW_REFLECT_Y)
+        o_y_dir = -o_y_dir;
+    switch (randr & SHADOW_ROTATE_ALL) {
+    case SHADOW_ROTATE_0:
+    default:
+        x_dir = o_x_dir;
+        y_dir = o_y_dir;
+        break;
+    case SHADOW_ROTATE_90:
+        x_dir = o_y_dir;
+        y_dir = -o_x_dir;
+        break;
+    case SHADOW_ROTATE_180:
+        x_dir = -o_x_dir;
+        y_dir = -o_y_dir;
+        break;
+    case SHADOW_ROTATE_270:
+        x_dir = -o_y_dir;
+        y_dir = o_x_dir;
+        break;
+    }
+    over = (x_dir == 1 || x_dir == -1) ? x_dir : (x_dir / 2) * pixStride;
+    down = (y_dir == 1 || y_dir == -1) ? y_dir : (y_dir / 2) * pixStride;
+
+    while (nbox--) {
+        int scr_x1 = 0, scr_x2 = 0, scr_y1 = 0, scr_y2 = 0;
+        int sha_x = 0, sha_y = 0;
+        int width, height, y;
+        const CARD8 *src;
+
+        switch (x_dir) {
+        case 1:
+            scr_x1 = pbox->x1;
+            scr_x2 = pbox->x2;
+            sha_x = pbox->x1;
+            break;
+        case -1:
+            scr_x1 = shaWidth - pbox->x2;
+            scr_x2 = shaWidth - pbox->x1;
+            sha_x = pbox->x2 - 1;
+            break;
+        case 2:
+            scr_x1 = pbox->y1;
+            scr_x2 = pbox->y2;
+            sha_y = pbox->y1;
+            break;
+        case -2:
+            scr_x1 = shaHeight - pbox->y2;
+            scr_x2 = shaHeight - pbox->y1;
+            sha_y = pbox->y2 - 1;
+            break;
+        }
+        switch (y_dir) {
+        case 1:
+            scr_y1 = pbox->x1;
+            scr_y2 = pbox->x2;
+            sha_x = pbox->x1;
+            break;
+        case -1:
+            scr_y1 = shaWidth - pbox->x2;
+            scr_y2 = shaWidth - pbox->x1;
+            sha_x = pbox->x2 - 1;
+            break;
+        case 2:
+            scr_y1 = pbox->y1;
+            scr_y2 = pbox->y2;
+            sha_y = pbox->y1;
+            break;
+        case -2:
+            scr_y1 = shaHeight - pbox->y2;
+            scr_y2 = shaHeight - pbox->y1;
+            sha_y = pbox->y2 - 1;
+            break;
+        }
+        pbox++;
+
+        width = scr_x2 - scr_x1;
+        height = scr_y2 - scr_y1;
+        src = (const CARD8 *) shaBits + (sha_y * pixStride + sha_x) * Bpp;
+
+        for (y = 0; y < height;) {
+            CARD8 *first, *win;
+            CARD32 winSize;
+            ptrdiff_t pitch = 0;
+            int n;
+
+            first = (*pBuf->window) (pScreen, scr_y1 + y, scr_x1 * Bpp,
+                                     SHADOW_WINDOW_WRITE, &winSize,
+                                     pBuf->closure);
+            if (!first)
+                return TRUE;
+            if (winSize < width * Bpp) {
+                if (!shadowBlitRowPieces(pScreen, pBuf, blit, Bpp,
+                                         scr_x1, scr_y1 + y, width,
+                                         src + y * down * Bpp, over))
+                    return TRUE;
+                y++;
+                continue;
+            }
+
+            /*
+             * Map following rows as long as they lie at a constant
+             * pitch in one mapping, so they can be written as a block.
+             */
+            for (n = 1; n < SHADOW_BLIT_ROWS && y + n < height; n++) {
+                win = (*pBuf->window) (pScreen, scr_y1 + y + n, scr_x1 * Bpp,
+                                       SHADOW_WINDOW_WRITE, &winSize,
+                                       pBuf->closure);
+                if (!win || winSize < width * Bpp)
+                    break;
+                if (n == 1)
+                    pitch = win - first;
+                if (pitch < width * Bpp || win != first + n * pitch)
+                    break;
+            }
+            if (n < SHADOW_BLIT_ROWS && y + n < height) {
+                /* remap the block start in case the mapping moved on */
+                win = (*pBuf->window) (pScreen, scr_y1 + y, scr_x1 * Bpp,
+                                       SHADOW_WINDOW_WRITE, &winSize,
+                                       pBuf->closure);
+                if (!win)
+                    return TRUE;
+                if (win != first) {
+                    first = win;
+                    n = 1;
+                }
+            }
+
+            (*blit) (first, pitch, src + y * down * Bpp, over, down, width, n);
+            y += n;
+        }
+    }
+    return TRUE;
+}
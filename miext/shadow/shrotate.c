@@ -34,6 +34,7 @@
 #include    "globals.h"
 #include    "gcstruct.h"
 #include    "shadow.h"
+#include    "shadow_priv.h"
 #include    "fb.h"
 
 /*
@@ -76,6 +77,10 @@ shadowUpdateRotatePacked(ScreenPtr pScreen, shadowBufPtr pBuf)
     int x_dir;
     int y_dir;
 
+    /* 16 and 32 bpp have blocked and vectorized kernels */
+    if (shadowUpdateBlit(pScreen, pBuf, pBuf->randr))
+        return;
+
     fbGetDrawable(&pShadow->drawable, shaBits, shaStride, shaBpp, shaXoff,
                   shaYoff);
     pixelsPerBits = (sizeof(FbBits) * 8) / shaBpp;
@@ -38,12 +38,14 @@
 #include    "globals.h"
 #include    "gcstruct.h"
 #include    "shadow.h"
+#include    "shadow_priv.h"
 #include    "fb.h"
 
 #define DANDEBUG         0
 
 #if ROTATE == 270
 
+#define SHADOW_ROTATE       SHADOW_ROTATE_270
 #define SCRLEFT(x,y,w,h)    (pScreen->height - ((y) + (h)))
 #define SCRY(x,y,w,h)	    (x)
 #define SCRWIDTH(x,y,w,h)   (h)
@@ -55,6 +57,7 @@
 
 #elif ROTATE == 90
 
+#define SHADOW_ROTATE       SHADOW_ROTATE_90
 #define SCRLEFT(x,y,w,h)    (y)
 #define SCRY(x,y,w,h)	    (pScreen->width - ((x) + (w)) - 1)
 #define SCRWIDTH(x,y,w,h)   (h)
@@ -66,6 +69,7 @@
 
 #elif ROTATE == 180
 
+#define SHADOW_ROTATE       SHADOW_ROTATE_180
 #define SCRLEFT(x,y,w,h)    (pScreen->width - ((x) + (w)))
 #define SCRY(x,y,w,h)	    (pScreen->height - ((y) + (h)) - 1)
 #define SCRWIDTH(x,y,w,h)   (w)
@@ -77,6 +81,7 @@
 
 #else
 
+#define SHADOW_ROTATE       SHADOW_ROTATE_0
 #define SCRLEFT(x,y,w,h)    (x)
 #define SCRY(x,y,w,h)	    (y)
 #define SCRWIDTH(x,y,w,h)   (w)
@@ -106,6 +111,12 @@ FUNC(ScreenPtr pScreen, shadowBufPtr pBuf)
     Data *winBase = NULL, *win;
     CARD32 winSize;
 
+    /* 16 and 32 bpp have blocked and vectorized kernels */
+    if (sizeof(Data) > 1 &&
+        pShadow->drawable.bitsPerPixel == sizeof(Data) * 8 &&
+        shadowUpdateBlit(pScreen, pBuf, SHADOW_ROTATE))
+        return;
+
     fbGetDrawable(&pShadow->drawable, shaBits, shaStride, shaBpp, shaXoff,
                   shaYoff);
     shaBase = (Data *) shaBits;
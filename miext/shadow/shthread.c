@@ -0,0 +1,391 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Flush the shadow framebuffer from a separate thread.
+ *
+ * The block handler copies the damaged scanlines of the shadow pixmap into
+ * a private one, takes a snapshot of the damage region, empties the real
+ * one and wakes the flush thread.  The thread runs the update proc on the
+ * copies while the main loop goes back to dispatching requests, so drawing
+ * to the shadow pixmap meanwhile never tears the frame being flushed.
+ * Only one flush is in flight at a time: a redisplay which finds the
+ * thread busy leaves the damage where it is and asks to be woken when
+ * the flush completes, so rendering done during a flush always ends up
+ * in the next one.
+ */
+#include <dix-config.h>
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#ifdef SHADOW_THREAD
+#include <pthread.h>
+#endif
+#include <X11/X.h>
+
+#include "scrnintstr.h"
+#include "pixmapstr.h"
+#include "regionstr.h"
+#include "shadow.h"
+#include "shadow_priv.h"
+
+static void
+shadowFlushRecord(shadowBufPtr pBuf, CARD64 usec)
+{
+    pBuf->flush.frames++;
+    pBuf->flush.lastUsec = usec;
+    pBuf->flush.totalUsec += usec;
+    if (usec > pBuf->flush.maxUsec)
+        pBuf->flush.maxUsec = usec;
+}
+
+/* Run the update proc and record how long it took */
+void
+shadowFlushUpdate(ScreenPtr pScreen, shadowBufPtr pBuf)
+{
+    CARD64 start = GetTimeInMicros();
+
+    (*pBuf->update) (pScreen, pBuf);
+    shadowFlushRecord(pBuf, GetTimeInMicros() - start);
+}
+
+#ifdef SHADOW_THREAD
+
+typedef enum {
+    SHADOW_THREAD_IDLE,
+    SHADOW_THREAD_BUSY,
+    SHADOW_THREAD_EXIT,
+} shadowThreadState;
+
+typedef struct _shadowThread {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    shadowThreadState state;
+    Bool wake;                  /* main loop skipped a frame, notify it */
+    int pipe[2];
+
+    ScreenPtr pScreen;
+    shadowBufPtr pBuf;
+    shadowBufRec frame;         /* what the update proc sees */
+    DamageRec snapshot;         /* only the damage region is used */
+    PixmapPtr pSnapshot;        /* damaged scanlines of the shadow pixmap */
+} shadowThreadRec;
+
+static void
+shadowThreadNotify(int fd, int ready, void *data)
+{
+    char buf[16];
+
+    while (read(fd, buf, sizeof(buf)) > 0)
+        ;
+    /* the block handler will redisplay what was left behind */
+}
+
+static void *
+shadowThreadMain(void *data)
+{
+    shadowThreadPtr pThread = data;
+
+#if defined(HAVE_PTHREAD_SETNAME_NP_WITH_TID)
+    pthread_setname_np(pthread_self(), "ShadowFlush");
+#elif defined(HAVE_PTHREAD_SETNAME_NP_WITHOUT_TID)
+    pthread_setname_np("ShadowFlush");
+#endif
+
+    pthread_mutex_lock(&pThread->lock);
+    for (;;) {
+        CARD64 start, usec;
+
+        while (pThread->state == SHADOW_THREAD_IDLE)
+            pthread_cond_wait(&pThread->cond, &pThread->lock);
+        if (pThread->state == SHADOW_THREAD_EXIT)
+            break;
+        pthread_mutex_unlock(&pThread->lock);
+
+        start = GetTimeInMicros();
+        (*pThread->frame.update) (pThread->pScreen, &pThread->frame);
+        usec = GetTimeInMicros() - start;
+
+        pthread_mutex_lock(&pThread->lock);
+        shadowFlushRecord(pThread->pBuf, usec);
+        pThread->state = SHADOW_THREAD_IDLE;
+        pthread_cond_broadcast(&pThread->cond);
+        if (pThread->wake) {
+            char byte = 0;
+
+            pThread->wake = FALSE;
+            while (write(pThread->pipe[1], &byte, 1) < 0 && errno == EINTR)
+                ;
+        }
+    }
+    pthread_mutex_unlock(&pThread->lock);
+    return NULL;
+}
+
+/*
+ * Copy the scanlines covered by the snapshot damage from the shadow pixmap
+ * to the private one.  Whole scanlines, as update procs may read past the
+ * edges of the damaged boxes to align to words or pixel groups.
+ */
+static Bool
+shadowThreadCopy(ScreenPtr pScreen, shadowThreadPtr pThread, PixmapPtr pShadow)
+{
+    PixmapPtr pSnapshot = pThread->pSnapshot;
+    BoxPtr pbox = RegionRects(&pThread->snapshot.damage);
+    int nbox = RegionNumRects(&pThread->snapshot.damage);
+    char *src, *dst;
+    int stride, y1, y2;
+
+    if (pSnapshot &&
+        (pSnapshot->drawable.width != pShadow->drawable.width ||
+         pSnapshot->drawable.height != pShadow->drawable.height ||
+         pSnapshot->drawable.depth != pShadow->drawable.depth)) {
+        dixDestroyPixmap(pSnapshot, 0);
+        pSnapshot = pThread->pSnapshot = NULL;
+    }
+    if (!pSnapshot) {
+        pSnapshot = (*pScreen->CreatePixmap) (pScreen,
+                                              pShadow->drawable.width,
+                                              pShadow->drawable.height,
+                                              pShadow->drawable.depth, 0);
+        if (!pSnapshot)
+            return FALSE;
+        if (pSnapshot->drawable.bitsPerPixel !=
+            pShadow->drawable.bitsPerPixel) {
+            dixDestroyPixmap(pSnapshot, 0);
+            return FALSE;
+        }
+        pThread->pSnapshot = pSnapshot;
+    }
+
+    /* the driver may have picked the stride of the shadow pixmap */
+    stride = min(pSnapshot->devKind, pShadow->devKind);
+
+    /* boxes come in bands sorted by y, copy each run of scanlines once */
+    while (nbox) {
+        y1 = max(pbox->y1, 0);
+        y2 = pbox->y2;
+        while (nbox && pbox->y1 <= y2) {
+            y2 = max(y2, pbox->y2);
+            pbox++;
+            nbox--;
+        }
+        y2 = min(y2, pShadow->drawable.height);
+
+        src = (char *) pShadow->devPrivate.ptr + y1 * pShadow->devKind;
+        dst = (char *) pSnapshot->devPrivate.ptr + y1 * pSnapshot->devKind;
+        for (; y1 < y2; y1++) {
+            memcpy(dst, src, stride);
+            src += pShadow->devKind;
+            dst += pSnapshot->devKind;
+        }
+    }
+    return TRUE;
+}
+
+/*
+ * Hand the current damage to the flush thread.  Called from
+ * shadowRedisplay() with a non-empty damage region.
+ */
+void
+shadowThreadQueue(ScreenPtr pScreen, shadowBufPtr pBuf)
+{
+    shadowThreadPtr pThread = pBuf->thread;
+    RegionPtr damage = DamageRegion(pBuf->pDamage);
+
+    pthread_mutex_lock(&pThread->lock);
+    if (pThread->state != SHADOW_THREAD_IDLE) {
+        pBuf->flush.skipped++;
+        pThread->wake = TRUE;
+        pthread_mutex_unlock(&pThread->lock);
+        return;
+    }
+    pthread_mutex_unlock(&pThread->lock);
+
+    /* The thread is idle, the frame and the tile bitmaps are ours again */
+    if (pBuf->tiles) {
+        shadowTilesClear(pBuf);
+        if (!shadowTilesFilter(pScreen, pBuf)) {
+            DamageEmpty(pBuf->pDamage);
+            return;
+        }
+    }
+
+    if (!RegionCopy(&pThread->snapshot.damage, damage) ||
+        !shadowThreadCopy(pScreen, pThread, pBuf->pPixmap)) {
+        /* out of memory; flush synchronously rather than lose damage */
+        shadowFlushUpdate(pScreen, pBuf);
+        DamageEmpty(pBuf->pDamage);
+        return;
+    }
+    DamageEmpty(pBuf->pDamage);
+
+    pThread->frame = *pBuf;
+    pThread->frame.pDamage = &pThread->snapshot;
+    pThread->frame.pPixmap = pThread->pSnapshot;
+
+    pthread_mutex_lock(&pThread->lock);
+    pThread->state = SHADOW_THREAD_BUSY;
+    pthread_cond_signal(&pThread->cond);
+    pthread_mutex_unlock(&pThread->lock);
+}
+
+static void
+shadowThreadWait(shadowThreadPtr pThread)
+{
+    pthread_mutex_lock(&pThread->lock);
+    while (pThread->state == SHADOW_THREAD_BUSY)
+        pthread_cond_wait(&pThread->cond, &pThread->lock);
+    pthread_mutex_unlock(&pThread->lock);
+}
+
+static void
+shadowThreadDestroy(shadowThreadPtr pThread)
+{
+    pthread_mutex_lock(&pThread->lock);
+    while (pThread->state == SHADOW_THREAD_BUSY)
+        pthread_cond_wait(&pThread->cond, &pThread->lock);
+    pThread->state = SHADOW_THREAD_EXIT;
+    pthread_cond_signal(&pThread->cond);
+    pthread_mutex_unlock(&pThread->lock);
+    pthread_join(pThread->thread, NULL);
+
+    RemoveNotifyFd(pThread->pipe[0]);
+    close(pThread->pipe[0]);
+    close(pThread->pipe[1]);
+    RegionUninit(&pThread->snapshot.damage);
+    if (pThread->pSnapshot)
+        dixDestroyPixmap(pThread->pSnapshot, 0);
+    pthread_cond_destroy(&pThread->cond);
+    pthread_mutex_destroy(&pThread->lock);
+    free(pThread);
+}
+
+static shadowThreadPtr
+shadowThreadCreate(ScreenPtr pScreen, shadowBufPtr pBuf)
+{
+    shadowThreadPtr pThread = calloc(1, sizeof(shadowThreadRec));
+    sigset_t set, old;
+    int i;
+
+    if (!pThread)
+        return NULL;
+
+    if (pipe(pThread->pipe) < 0) {
+        free(pThread);
+        return NULL;
+    }
+    for (i = 0; i < 2; i++) {
+        fcntl(pThread->pipe[i], F_SETFL, O_NONBLOCK);
+        fcntl(pThread->pipe[i], F_SETFD, FD_CLOEXEC);
+    }
+
+    pthread_mutex_init(&pThread->lock, NULL);
+    pthread_cond_init(&pThread->cond, NULL);
+    pThread->state = SHADOW_THREAD_IDLE;
+    pThread->pScreen = pScreen;
+    pThread->pBuf = pBuf;
+    RegionNull(&pThread->snapshot.damage);
+
+    /* signals are for the main thread */
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, &old);
+    i = pthread_create(&pThread->thread, NULL, shadowThreadMain, pThread);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (i != 0) {
+        close(pThread->pipe[0]);
+        close(pThread->pipe[1]);
+        pthread_cond_destroy(&pThread->cond);
+        pthread_mutex_destroy(&pThread->lock);
+        free(pThread);
+        return NULL;
+    }
+
+    SetNotifyFd(pThread->pipe[0], shadowThreadNotify, X_NOTIFY_READ, NULL);
+    return pThread;
+}
+
+Bool
+shadowSetAsync(ScreenPtr pScreen, Bool enable)
+{
+    shadowBuf(pScreen);
+
+    if (!pBuf)
+        return FALSE;
+
+    if (!enable) {
+        if (pBuf->thread) {
+            shadowThreadDestroy(pBuf->thread);
+            pBuf->thread = NULL;
+            if (pBuf->tiles)
+                shadowTilesClear(pBuf);
+        }
+        return TRUE;
+    }
+
+    if (!pBuf->thread)
+        pBuf->thread = shadowThreadCreate(pScreen, pBuf);
+    return pBuf->thread != NULL;
+}
+
+void
+shadowFlushWait(ScreenPtr pScreen)
+{
+    shadowBuf(pScreen);
+
+    if (pBuf && pBuf->thread)
+        shadowThreadWait(pBuf->thread);
+}
+
+void
+shadowGetFlushStats(ScreenPtr pScreen, shadowFlushStatsPtr pStats)
+{
+    shadowBuf(pScreen);
+
+    if (!pBuf) {
+        memset(pStats, 0, sizeof(*pStats));
+        return;
+    }
+
+    if (pBuf->thread)
+        pthread_mutex_lock(&pBuf->thread->lock);
+    *pStats = pBuf->flush;
+    if (pBuf->thread)
+        pthread_mutex_unlock(&pBuf->thread->lock);
+}
+
+#else /* SHADOW_THREAD */
+
+void
+shadowThreadQueue(ScreenPtr pScreen, shadowBufPtr pBuf)
+{
+}
+
+Bool
+shadowSetAsync(ScreenPtr pScreen, Bool enable)
+{
+    /* no threads on this platform, always flush from the block handler */
+    return !enable;
+}
+
+void
+shadowFlushWait(ScreenPtr pScreen)
+{
+}
+
+void
+shadowGetFlushStats(ScreenPtr pScreen, shadowFlushStatsPtr pStats)
+{
+    shadowBuf(pScreen);
+
+    if (pBuf)
+        *pStats = pBuf->flush;
+    else
+        memset(pStats, 0, sizeof(*pStats));
+}
+
+#endif /* SHADOW_THREAD */
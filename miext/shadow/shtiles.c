@@ -0,0 +1,395 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Tile bitmap damage tracking for shadow framebuffers.
+ *
+ * Drawing marks the tiles it touches in a bitmap.  Before the update
+ * proc runs, every marked tile is checksummed; tiles which hash the
+ * same as at the previous update, and still match the copy kept from it,
+ * are dropped from the damage region, so uploads are proportional to
+ * what actually changed on screen rather than to what was drawn.
+ */
+#include <dix-config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <X11/X.h>
+
+#include "scrnintstr.h"
+#include "regionstr.h"
+#include "shadow.h"
+#include "shadow_priv.h"
+#include "fb.h"
+
+#define SHADOW_TILE_DEFAULT     64
+#define SHADOW_TILE_MAX         4096
+#define SHADOW_TILE_WORD_BITS   32
+
+typedef struct _shadowTiles {
+    int tileSize;
+    int width, height;          /* shadow pixmap size the bitmaps cover */
+    int bpp;
+    int cols, rows;
+    int nwords;
+    size_t tileBytes;           /* bytes of one whole tile */
+    uint32_t *pending;          /* marked from the damage region */
+    uint32_t *dirty;            /* tiles changed in the current update */
+    uint64_t *sums;             /* checksum of each tile at last update */
+    CARD8 *copies;              /* contents of each tile at last update */
+    xRectangle *rects;          /* scratch for the changed tiles */
+    shadowTileStatsRec stats;
+} shadowTilesRec;
+
+static void
+shadowTilesFreeBitmaps(shadowTilesPtr pTiles)
+{
+    free(pTiles->pending);
+    free(pTiles->dirty);
+    free(pTiles->sums);
+    free(pTiles->copies);
+    free(pTiles->rects);
+    pTiles->pending = NULL;
+    pTiles->dirty = NULL;
+    pTiles->sums = NULL;
+    pTiles->copies = NULL;
+    pTiles->rects = NULL;
+    pTiles->width = pTiles->height = pTiles->bpp = 0;
+    pTiles->cols = pTiles->rows = 0;
+    pTiles->nwords = 0;
+}
+
+/* (Re)allocate the bitmaps when the shadow pixmap changed size */
+static Bool
+shadowTilesRealize(shadowTilesPtr pTiles, PixmapPtr pPixmap)
+{
+    int width = pPixmap->drawable.width;
+    int height = pPixmap->drawable.height;
+    int bpp = pPixmap->drawable.bitsPerPixel;
+    int ntiles;
+
+    if (pTiles->sums && pTiles->width == width && pTiles->height == height &&
+        pTiles->bpp == bpp)
+        return TRUE;
+
+    shadowTilesFreeBitmaps(pTiles);
+
+    pTiles->cols = (width + pTiles->tileSize - 1) / pTiles->tileSize;
+    pTiles->rows = (height + pTiles->tileSize - 1) / pTiles->tileSize;
+    ntiles = pTiles->cols * pTiles->rows;
+    pTiles->nwords = (ntiles + SHADOW_TILE_WORD_BITS - 1) / SHADOW_TILE_WORD_BITS;
+    pTiles->tileBytes = (size_t) pTiles->tileSize *
+        ((pTiles->tileSize * bpp + 7) >> 3);
+
+    pTiles->pending = calloc(pTiles->nwords, sizeof(uint32_t));
+    pTiles->dirty = calloc(pTiles->nwords, sizeof(uint32_t));
+    pTiles->sums = calloc(ntiles, sizeof(uint64_t));
+    pTiles->copies = calloc(ntiles, pTiles->tileBytes);
+    pTiles->rects = calloc(ntiles, sizeof(xRectangle));
+    if (!pTiles->pending || !pTiles->dirty || !pTiles->sums ||
+        !pTiles->copies || !pTiles->rects) {
+        shadowTilesFreeBitmaps(pTiles);
+        return FALSE;
+    }
+    pTiles->width = width;
+    pTiles->height = height;
+    pTiles->bpp = bpp;
+    return TRUE;
+}
+
+static inline void
+shadowTilesSetBit(uint32_t *bits, int tile)
+{
+    bits[tile / SHADOW_TILE_WORD_BITS] |= 1U << (tile % SHADOW_TILE_WORD_BITS);
+}
+
+static void
+shadowTilesMarkBox(shadowTilesPtr pTiles, const BoxRec *pBox)
+{
+    int x1 = max(pBox->x1, 0);
+    int y1 = max(pBox->y1, 0);
+    int x2 = min(pBox->x2, pTiles->width);
+    int y2 = min(pBox->y2, pTiles->height);
+    int col, row, col1, col2, row1, row2;
+
+    if (x1 >= x2 || y1 >= y2)
+        return;
+
+    col1 = x1 / pTiles->tileSize;
+    col2 = (x2 - 1) / pTiles->tileSize;
+    row1 = y1 / pTiles->tileSize;
+    row2 = (y2 - 1) / pTiles->tileSize;
+
+    for (row = row1; row <= row2; row++)
+        for (col = col1; col <= col2; col++)
+            shadowTilesSetBit(pTiles->pending, row * pTiles->cols + col);
+}
+
+static void
+shadowTilesBox(shadowTilesPtr pTiles, int tile, BoxPtr pBox)
+{
+    int col = tile % pTiles->cols;
+    int row = tile / pTiles->cols;
+
+    pBox->x1 = col * pTiles->tileSize;
+    pBox->y1 = row * pTiles->tileSize;
+    pBox->x2 = min(pBox->x1 + pTiles->tileSize, pTiles->width);
+    pBox->y2 = min(pBox->y1 + pTiles->tileSize, pTiles->height);
+}
+
+/*
+ * 64-bit FNV-1a style hash over the bytes of one tile.  Whole words are
+ * folded in at once; tiles start on a word boundary as long as the tile
+ * size is a multiple of 32 pixels, only the right screen edge may leave
+ * a ragged tail.
+ */
+static uint64_t
+shadowTilesChecksum(PixmapPtr pShadow, const BoxRec *pBox)
+{
+    FbBits *shaBase;
+    FbStride shaStride;
+    int shaBpp;
+    _X_UNUSED int shaXoff, shaYoff;
+    uint64_t sum = 0xcbf29ce484222325ULL;
+    int y, i;
+
+    fbGetDrawable(&pShadow->drawable, shaBase, shaStride, shaBpp, shaXoff,
+                  shaYoff);
+
+    int xbyte1 = (pBox->x1 * shaBpp) >> 3;
+    int xbyte2 = (pBox->x2 * shaBpp + 7) >> 3;
+    int nwords = (xbyte2 - xbyte1) / sizeof(uint32_t);
+    int ntail = (xbyte2 - xbyte1) % sizeof(uint32_t);
+
+    for (y = pBox->y1; y < pBox->y2; y++) {
+        const CARD8 *line = (const CARD8 *) (shaBase + y * shaStride) + xbyte1;
+        const uint32_t *words = (const uint32_t *) line;
+
+        for (i = 0; i < nwords; i++) {
+            sum ^= words[i];
+            sum *= 0x100000001b3ULL;
+        }
+        line += nwords * sizeof(uint32_t);
+        for (i = 0; i < ntail; i++) {
+            sum ^= line[i];
+            sum *= 0x100000001b3ULL;
+        }
+    }
+    return sum;
+}
+
+/*
+ * Compare a tile with its copy from the previous update and bring the
+ * copy up to date.  Returns TRUE if the tile changed; with changed
+ * already TRUE, just copies.  Equal checksums are always confirmed here,
+ * a hash collision must not drop a real update.
+ */
+static Bool
+shadowTilesRefresh(shadowTilesPtr pTiles, PixmapPtr pShadow, int tile,
+                   const BoxRec *pBox, Bool changed)
+{
+    CARD8 *copy = pTiles->copies + tile * pTiles->tileBytes;
+    FbBits *shaBase;
+    FbStride shaStride;
+    int shaBpp;
+    _X_UNUSED int shaXoff, shaYoff;
+    int y;
+
+    fbGetDrawable(&pShadow->drawable, shaBase, shaStride, shaBpp, shaXoff,
+                  shaYoff);
+
+    int xbyte1 = (pBox->x1 * shaBpp) >> 3;
+    int len = ((pBox->x2 * shaBpp + 7) >> 3) - xbyte1;
+
+    for (y = pBox->y1; y < pBox->y2; y++) {
+        const CARD8 *line = (const CARD8 *) (shaBase + y * shaStride) + xbyte1;
+
+        if (changed || memcmp(copy, line, len)) {
+            memcpy(copy, line, len);
+            changed = TRUE;
+        }
+        copy += len;
+    }
+    return changed;
+}
+
+/*
+ * Turn the pending marks into this update's dirty set, and shrink the
+ * damage region to the tiles which really changed.  Returns FALSE when
+ * nothing is left to update.
+ */
+Bool
+shadowTilesFilter(ScreenPtr pScreen, shadowBufPtr pBuf)
+{
+    shadowTilesPtr pTiles = pBuf->tiles;
+    PixmapPtr pShadow = pBuf->pPixmap;
+    RegionPtr damage = DamageRegion(pBuf->pDamage);
+    int nbox = RegionNumRects(damage);
+    BoxPtr pbox = RegionRects(damage);
+    xRectangle *rects;
+    int nrects = 0;
+    RegionPtr changed;
+    int w;
+
+    if (!pShadow || !shadowTilesRealize(pTiles, pShadow))
+        return TRUE;
+
+    while (nbox--)
+        shadowTilesMarkBox(pTiles, pbox++);
+
+    rects = pTiles->rects;
+    for (w = 0; w < pTiles->nwords; w++) {
+        uint32_t bits = pTiles->pending[w];
+
+        pTiles->pending[w] = 0;
+
+        while (bits) {
+            int tile = w * SHADOW_TILE_WORD_BITS + __builtin_ctz(bits);
+            BoxRec box;
+            uint64_t sum;
+
+            bits &= bits - 1;
+            pTiles->stats.tilesDamaged++;
+
+            shadowTilesBox(pTiles, tile, &box);
+            sum = shadowTilesChecksum(pShadow, &box);
+            if (!shadowTilesRefresh(pTiles, pShadow, tile, &box,
+                                    sum != pTiles->sums[tile]))
+                continue;
+
+            pTiles->sums[tile] = sum;
+            pTiles->dirty[w] |= 1U << (tile % SHADOW_TILE_WORD_BITS);
+            pTiles->stats.tilesChanged++;
+            pTiles->stats.bytesChanged += (uint64_t) (box.y2 - box.y1) *
+                (((box.x2 - box.x1) * pShadow->drawable.bitsPerPixel + 7) >> 3);
+
+            /* tiles come in row order, so extend a run along the row */
+            if (nrects && rects[nrects - 1].y == box.y1 &&
+                rects[nrects - 1].x + rects[nrects - 1].width == box.x1) {
+                rects[nrects - 1].width += box.x2 - box.x1;
+            } else {
+                rects[nrects].x = box.x1;
+                rects[nrects].y = box.y1;
+                rects[nrects].width = box.x2 - box.x1;
+                rects[nrects].height = box.y2 - box.y1;
+                nrects++;
+            }
+        }
+    }
+
+    changed = RegionFromRects(nrects, rects, CT_YXBANDED);
+    if (!changed)
+        return TRUE;
+
+    RegionIntersect(damage, damage, changed);
+    RegionDestroy(changed);
+    return RegionNotEmpty(damage);
+}
+
+void
+shadowTilesClear(shadowBufPtr pBuf)
+{
+    shadowTilesPtr pTiles = pBuf->tiles;
+
+    if (pTiles->dirty)
+        memset(pTiles->dirty, 0, pTiles->nwords * sizeof(uint32_t));
+}
+
+/* The shadow contents are unknown again, e.g. after shadowAdd */
+void
+shadowTilesReset(shadowBufPtr pBuf)
+{
+    shadowTilesFreeBitmaps(pBuf->tiles);
+}
+
+void
+shadowTilesFree(shadowBufPtr pBuf)
+{
+    if (!pBuf->tiles)
+        return;
+    shadowTilesFreeBitmaps(pBuf->tiles);
+    free(pBuf->tiles);
+    pBuf->tiles = NULL;
+}
+
+Bool
+shadowTilesEnable(ScreenPtr pScreen, int tileSize)
+{
+    shadowBuf(pScreen);
+
+    if (!pBuf)
+        return FALSE;
+
+    if (tileSize <= 0)
+        tileSize = SHADOW_TILE_DEFAULT;
+    tileSize = min(tileSize, SHADOW_TILE_MAX);
+    /* keep tiles word aligned in the shadow for any depth */
+    tileSize = (tileSize + 31) & ~31;
+
+    shadowFlushWait(pScreen);
+    if (pBuf->tiles) {
+        if (pBuf->tiles->tileSize == tileSize)
+            return TRUE;
+        shadowTilesFree(pBuf);
+    }
+
+    pBuf->tiles = calloc(1, sizeof(shadowTilesRec));
+    if (!pBuf->tiles)
+        return FALSE;
+    pBuf->tiles->tileSize = tileSize;
+    return TRUE;
+}
+
+void
+shadowTilesDisable(ScreenPtr pScreen)
+{
+    shadowBuf(pScreen);
+
+    shadowFlushWait(pScreen);
+    if (pBuf)
+        shadowTilesFree(pBuf);
+}
+
+/*
+ * Walk the tiles changed in the current update; meant to be called from
+ * an update proc.  Start with *tile = 0.
+ */
+Bool
+shadowTilesNext(shadowBufPtr pBuf, int *tile, BoxPtr pBox)
+{
+    shadowTilesPtr pTiles = pBuf->tiles;
+    int ntiles;
+    int t;
+
+    if (!pTiles || !pTiles->dirty)
+        return FALSE;
+
+    ntiles = pTiles->cols * pTiles->rows;
+    for (t = *tile; t < ntiles; t++) {
+        uint32_t bits = pTiles->dirty[t / SHADOW_TILE_WORD_BITS] >>
+            (t % SHADOW_TILE_WORD_BITS);
+
+        if (!bits) {
+            /* skip to the next word */
+            t |= SHADOW_TILE_WORD_BITS - 1;
+            continue;
+        }
+        t += __builtin_ctz(bits);
+        if (t >= ntiles)
+            break;
+        shadowTilesBox(pTiles, t, pBox);
+        *tile = t + 1;
+        return TRUE;
+    }
+    *tile = ntiles;
+    return FALSE;
+}
+
+void
+shadowTilesGetStats(ScreenPtr pScreen, shadowTileStatsPtr pStats)
+{
+    shadowBuf(pScreen);
+
+    if (pBuf && pBuf->tiles)
+        *pStats = pBuf->tiles->stats;
+    else
+        memset(pStats, 0, sizeof(*pStats));
+}
@@ -23,6 +23,8 @@
 
 #include <dix-config.h>
 
+#include "dix/screen_hooks_priv.h"
+
 #include "scrnintstr.h"
 #include "misync_priv.h"
 #include "misyncstr.h"
@@ -130,13 +132,18 @@ miSyncDestroyFence(SyncFence * pFence)
     dixFreeObjectWithPrivates(pFence, PRIVATE_SYNC_FENCE);
 }
 
+/*  Fire the triggers of a fence which just became triggered.  Firing an
+ *  Await takes all of its triggers off their fences, so start over after
+ *  each one; the trigger that fired is gone from the head of the list.
+ */
 void
-miSyncTriggerFence(SyncFence * pFence)
+miSyncFenceFireTriggers(SyncFence * pFence)
 {
+    SyncScreenPrivPtr pScreenPriv = SYNC_SCREEN_PRIV(pFence->pScreen);
     SyncTriggerList *ptl;
     Bool triggered;
 
-    pFence->funcs.SetTriggered(pFence);
+    pScreenPriv->stats.triggered++;
 
     /* run through triggers to see if any fired */
     do {
@@ -144,6 +151,7 @@ miSyncTriggerFence(SyncFence * pFence)
         for (ptl = pFence->sync.pTriglist; ptl; ptl = ptl->next) {
             if ((*ptl->pTrigger->CheckTrigger) (ptl->pTrigger, 0)) {
                 (*ptl->pTrigger->TriggerFired) (ptl->pTrigger);
+                pScreenPriv->stats.fired++;
                 triggered = TRUE;
                 break;
             }
@@ -151,6 +159,30 @@ miSyncTriggerFence(SyncFence * pFence)
     } while (triggered);
 }
 
+void
+miSyncTriggerFence(SyncFence * pFence)
+{
+    pFence->funcs.SetTriggered(pFence);
+
+    miSyncFenceFireTriggers(pFence);
+}
+
+static void
+miSyncCloseScreen(CallbackListPtr *pcbl, ScreenPtr pScreen, void *unused)
+{
+    SyncScreenPrivPtr pScreenPriv = SYNC_SCREEN_PRIV(pScreen);
+
+    if (pScreenPriv->stats.triggered)
+        LogMessageVerb(X_INFO, 3, "sync: screen %d triggered %llu fences, "
+                       "fired %llu triggers, woke up for %llu fd fences\n",
+                       pScreen->myNum,
+                       (unsigned long long) pScreenPriv->stats.triggered,
+                       (unsigned long long) pScreenPriv->stats.fired,
+                       (unsigned long long) pScreenPriv->stats.wakeups);
+
+    dixScreenUnhookClose(pScreen, miSyncCloseScreen);
+}
+
 SyncScreenFuncsPtr
 miSyncGetScreenFuncs(ScreenPtr pScreen)
 {
@@ -179,6 +211,7 @@ miSyncSetup(ScreenPtr pScreen)
 
     if (!pScreenPriv->funcs.CreateFence) {
         pScreenPriv->funcs = miSyncScreenFuncs;
+        dixScreenHookClose(pScreen, miSyncCloseScreen);
     }
 
     return TRUE;
@@ -10,9 +10,16 @@
 
 extern DevPrivateKeyRec miSyncScreenPrivateKey;
 
+typedef struct _syncFenceStats {
+    uint64_t triggered;         /* fences which became triggered */
+    uint64_t fired;             /* triggers fired by them */
+    uint64_t wakeups;           /* fd fences found triggered by the client */
+} SyncFenceStatsRec, *SyncFenceStatsPtr;
+
 typedef struct _syncScreenPriv {
     /* Wrappable sync-specific screen functions */
     SyncScreenFuncsRec funcs;
+    SyncFenceStatsRec stats;    /* logged when the screen closes */
 } SyncScreenPrivRec, *SyncScreenPrivPtr;
 
 #define SYNC_SCREEN_PRIV(pScreen)                               \
@@ -26,5 +33,7 @@ void miSyncFenceAddTrigger(SyncTrigger * pTrigger);
 void miSyncFenceDeleteTrigger(SyncTrigger * pTrigger);
 int miSyncInitFenceFromFD(DrawablePtr pDraw, SyncFence *pFence, int fd, BOOL initially_triggered);
 int miSyncFDFromFence(DrawablePtr pDraw, SyncFence *pFence);
+void miSyncFenceFireTriggers(SyncFence * pFence);
+Bool miSyncShmIsEventFd(int fd);
 
 #endif /* _XSERVER_MISYNC_PRIV_H */
@@ -22,10 +22,20 @@
 
 #include <dix-config.h>
 
+#include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/mman.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <X11/xshmfence.h>
+#if defined(HAVE_SYS_EVENTFD_H) && defined(HAVE_PREADV2) && defined(RWF_NOWAIT)
+#include <sys/eventfd.h>
+#define SYNC_EVENTFD_FENCES
+#endif
 
 #include "os/osdep.h"
 
@@ -41,11 +51,165 @@ static DevPrivateKeyRec syncShmFencePrivateKey;
 typedef struct _SyncShmFencePrivate {
     struct xshmfence    *fence;
     int                 fd;
+    Bool                eventfd;        /* fd is an eventfd, not a shm fence */
+    Bool                watching;       /* fd is polled for the client's trigger */
 } SyncShmFencePrivateRec, *SyncShmFencePrivatePtr;
 
 #define SYNC_FENCE_PRIV(pFence) \
     (SyncShmFencePrivatePtr) dixLookupPrivate(&pFence->devPrivates, &syncShmFencePrivateKey)
 
+/*
+ * Fences may also be imported from an eventfd: it is triggered while its
+ * count is non-zero, which the client does with a plain write(), without
+ * a SyncTriggerFence round trip.  The server only reads it to reset
+ * the fence, clients must poll() rather than read() to wait for it.  While
+ * triggers wait on such a fence, its fd sits in the main loop's poll set,
+ * so any number of fences the client triggered together are all picked up
+ * by a single wakeup.
+ *
+ * The client shares the file description, so it may clear O_NONBLOCK or
+ * drain the count behind the server's back at any time.  The server thus
+ * never relies on O_NONBLOCK to read: it uses RWF_NOWAIT, and eventfds are
+ * refused where the kernel does not support that.  EFD_SEMAPHORE eventfds
+ * are refused too, a read only takes one off their count and would not
+ * reset the fence.
+ *
+ * Importing eventfds is new in DRI3 1.5, whose FenceFromFD checks the
+ * version the client asked for before they get here.
+ */
+#ifdef SYNC_EVENTFD_FENCES
+
+/* whether the kernel says the eventfd is not a semaphore */
+static Bool
+miSyncShmEventFdIsCounter(int fd)
+{
+    char path[64], line[64];
+    Bool counter = FALSE;
+    FILE *f;
+
+    snprintf(path, sizeof(path), "/proc/self/fdinfo/%d", fd);
+    f = fopen(path, "r");
+    if (!f)
+        return FALSE;
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "eventfd-semaphore:", 18) == 0) {
+            counter = atoi(line + 18) == 0;
+            break;
+        }
+    }
+    fclose(f);
+    return counter;
+}
+
+Bool
+miSyncShmIsEventFd(int fd)
+{
+    char path[64], link[64], probe[4];
+    struct iovec iov = { probe, sizeof(probe) };
+    ssize_t len;
+
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+    len = readlink(path, link, sizeof(link) - 1);
+    if (len < 0)
+        return FALSE;
+    link[len] = '\0';
+    if (strcmp(link, "anon_inode:[eventfd]") != 0 ||
+        !miSyncShmEventFdIsCounter(fd))
+        return FALSE;
+
+    /*
+     * RWF_NOWAIT is checked before the size of the read, so a read too
+     * short for an eventfd fails with EINVAL without touching the count
+     * where it is supported, and with EOPNOTSUPP where it is not.
+     */
+    return preadv2(fd, &iov, 1, -1, RWF_NOWAIT) < 0 && errno == EINVAL;
+}
+
+static Bool
+miSyncShmEventFdTriggered(SyncShmFencePrivatePtr pPriv)
+{
+    struct pollfd pfd = { .fd = pPriv->fd, .events = POLLIN };
+
+    return poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN);
+}
+
+/*
+ * Reset the count without ever blocking: EAGAIN means someone else got
+ * there first and it is reset already.
+ */
+static void
+miSyncShmEventFdReset(SyncShmFencePrivatePtr pPriv)
+{
+    uint64_t count;
+    struct iovec iov = { &count, sizeof(count) };
+
+    while (preadv2(pPriv->fd, &iov, 1, -1, RWF_NOWAIT) < 0 && errno == EINTR)
+        ;
+}
+
+/*
+ * Eventfds do not support RWF_NOWAIT writes, so put O_NONBLOCK back should
+ * the client have cleared it.  A write only blocks when the count is about
+ * to overflow, and only ever happens while it was found zero: EAGAIN means
+ * the client triggered the fence meanwhile.
+ */
+static void
+miSyncShmEventFdTrigger(SyncShmFencePrivatePtr pPriv)
+{
+    uint64_t one = 1;
+    int flags;
+
+    if (miSyncShmEventFdTriggered(pPriv))
+        return;
+    flags = fcntl(pPriv->fd, F_GETFL);
+    if (flags < 0 ||
+        (!(flags & O_NONBLOCK) &&
+         fcntl(pPriv->fd, F_SETFL, flags | O_NONBLOCK) < 0))
+        return;
+    while (write(pPriv->fd, &one, sizeof(one)) < 0 && errno == EINTR)
+        ;
+}
+
+static void
+miSyncShmEventFdNotify(int fd, int ready, void *data)
+{
+    SyncFence *pFence = data;
+    SyncShmFencePrivatePtr pPriv = SYNC_FENCE_PRIV(pFence);
+    SyncScreenPrivPtr pScreenPriv = SYNC_SCREEN_PRIV(pFence->pScreen);
+
+    /* stays readable until reset, stop polling it until then */
+    RemoveNotifyFd(fd);
+    pPriv->watching = FALSE;
+
+    pScreenPriv->stats.wakeups++;
+    miSyncFenceSetTriggered(pFence);
+    miSyncFenceFireTriggers(pFence);
+}
+
+static void
+miSyncShmEventFdWatch(SyncFence *pFence, Bool watch)
+{
+    SyncShmFencePrivatePtr pPriv = SYNC_FENCE_PRIV(pFence);
+
+    if (watch == pPriv->watching)
+        return;
+    if (watch)
+        SetNotifyFd(pPriv->fd, miSyncShmEventFdNotify, X_NOTIFY_READ, pFence);
+    else
+        RemoveNotifyFd(pPriv->fd);
+    pPriv->watching = watch;
+}
+
+#else
+
+Bool
+miSyncShmIsEventFd(int fd)
+{
+    return FALSE;
+}
+
+#endif /* SYNC_EVENTFD_FENCES */
+
 static void
 miSyncShmFenceSetTriggered(SyncFence * pFence)
 {
@@ -53,6 +217,13 @@ miSyncShmFenceSetTriggered(SyncFence * pFence)
 
     if (pPriv->fence)
         xshmfence_trigger(pPriv->fence);
+#ifdef SYNC_EVENTFD_FENCES
+    else if (pPriv->eventfd) {
+        miSyncShmEventFdTrigger(pPriv);
+        /* our caller fires the triggers */
+        miSyncShmEventFdWatch(pFence, FALSE);
+    }
+#endif
     miSyncFenceSetTriggered(pFence);
 }
 
@@ -63,6 +234,13 @@ miSyncShmFenceReset(SyncFence * pFence)
 
     if (pPriv->fence)
         xshmfence_reset(pPriv->fence);
+#ifdef SYNC_EVENTFD_FENCES
+    else if (pPriv->eventfd) {
+        miSyncShmEventFdReset(pPriv);
+        if (pFence->sync.pTriglist)
+            miSyncShmEventFdWatch(pFence, TRUE);
+    }
+#endif
     miSyncFenceReset(pFence);
 }
 
@@ -73,6 +251,10 @@ miSyncShmFenceCheckTriggered(SyncFence * pFence)
 
     if (pPriv->fence)
         return xshmfence_query(pPriv->fence);
+#ifdef SYNC_EVENTFD_FENCES
+    else if (pPriv->eventfd)
+        return miSyncShmEventFdTriggered(pPriv);
+#endif
     else
         return miSyncFenceCheckTriggered(pFence);
 }
@@ -80,12 +262,26 @@ miSyncShmFenceCheckTriggered(SyncFence * pFence)
 static void
 miSyncShmFenceAddTrigger(SyncTrigger * pTrigger)
 {
+#ifdef SYNC_EVENTFD_FENCES
+    SyncFence *pFence = (SyncFence *) pTrigger->pSync;
+    SyncShmFencePrivatePtr pPriv = SYNC_FENCE_PRIV(pFence);
+
+    if (pPriv->eventfd && !miSyncShmEventFdTriggered(pPriv))
+        miSyncShmEventFdWatch(pFence, TRUE);
+#endif
     miSyncFenceAddTrigger(pTrigger);
 }
 
 static void
 miSyncShmFenceDeleteTrigger(SyncTrigger * pTrigger)
 {
+#ifdef SYNC_EVENTFD_FENCES
+    SyncFence *pFence = (SyncFence *) pTrigger->pSync;
+    SyncShmFencePrivatePtr pPriv = SYNC_FENCE_PRIV(pFence);
+
+    if (pPriv->eventfd && !pFence->sync.pTriglist)
+        miSyncShmEventFdWatch(pFence, FALSE);
+#endif
     miSyncFenceDeleteTrigger(pTrigger);
 }
 
@@ -104,6 +300,8 @@ miSyncShmScreenCreateFence(ScreenPtr pScreen, SyncFence * pFence,
     SyncShmFencePrivatePtr      pPriv = SYNC_FENCE_PRIV(pFence);
 
     pPriv->fence = NULL;
+    pPriv->eventfd = FALSE;
+    pPriv->watching = FALSE;
     miSyncScreenCreateFence(pScreen, pFence, initially_triggered);
     pFence->funcs = miSyncShmFenceFuncs;
 }
@@ -118,6 +316,12 @@ miSyncShmScreenDestroyFence(ScreenPtr pScreen, SyncFence * pFence)
         xshmfence_unmap_shm(pPriv->fence);
         close(pPriv->fd);
     }
+#ifdef SYNC_EVENTFD_FENCES
+    else if (pPriv->eventfd) {
+        miSyncShmEventFdWatch(pFence, FALSE);
+        close(pPriv->fd);
+    }
+#endif
     miSyncScreenDestroyFence(pScreen, pFence);
 }
 
@@ -134,8 +338,16 @@ miSyncShmCreateFenceFromFd(ScreenPtr pScreen, SyncFence *pFence, int fd, Bool in
         pPriv->fd = fd;
         return Success;
     }
-    else
-        close(fd);
+#ifdef SYNC_EVENTFD_FENCES
+    if (miSyncShmIsEventFd(fd)) {
+        pPriv->fd = fd;
+        pPriv->eventfd = TRUE;
+        if (initially_triggered)
+            miSyncShmFenceSetTriggered(pFence);
+        return Success;
+    }
+#endif
+    close(fd);
     return BadValue;
 }
 
@@ -144,6 +356,9 @@ miSyncShmGetFenceFd(ScreenPtr pScreen, SyncFence *pFence)
 {
     SyncShmFencePrivatePtr      pPriv = SYNC_FENCE_PRIV(pFence);
 
+    if (pPriv->eventfd)
+        return pPriv->fd;
+
     if (!pPriv->fence) {
         pPriv->fd = xshmfence_alloc_shm();
         if (pPriv->fd < 0)
@@ -48,6 +48,8 @@ void ListenOnOpenFD(int fd, int noxauth);
 int ReadRequestFromClient(struct _Client *client);
 int WriteFdToClient(struct _Client *client, int fd, Bool do_close);
 Bool InsertFakeRequest(struct _Client *client, char *data, int count);
+void *PeekNextRequestFromClient(struct _Client *client, int *len);
+void SkipNextRequestFromClient(struct _Client *client, int len);
 void FlushAllOutput(void);
 void FlushIfCriticalOutputPending(void);
 void ResetOsBuffers(void);
@@ -601,6 +601,52 @@ ResetCurrentRequest(ClientPtr client)
     }
 }
 
+/*****************************************************************
+ * PeekNextRequestFromClient
+ *    Return the request following the current one if it is already
+ *    complete in the input buffer, without dispatching it.  Big requests
+ *    and requests still being read are not returned.  The request is
+ *    in client byte order, its length in bytes is stored in *len.
+ *
+ **********************/
+
+void *
+PeekNextRequestFromClient(ClientPtr client, int *len)
+{
+    OsCommPtr oc = (OsCommPtr) client->osPrivate;
+
+    if (!oc || !oc->input || oc->input->ignoreBytes)
+        return NULL;
+
+    ConnectionInputPtr oci = oc->input;
+    xReq *request = (xReq *) (oci->bufptr + oci->lenLastReq);
+    int gotnow = oci->bufcnt + oci->buffer - (char *) request;
+    int needed;
+
+    if (gotnow < (int) sizeof(xReq))
+        return NULL;
+    needed = get_req_len(request, client) << 2;
+    if (!needed || needed > gotnow)
+        return NULL;
+    *len = needed;
+    return request;
+}
+
+/*****************************************************************
+ * SkipNextRequestFromClient
+ *    Consume the request returned by PeekNextRequestFromClient as part
+ *    of the current one.  The caller accounts for its sequence number.
+ *
+ **********************/
+
+void
+SkipNextRequestFromClient(ClientPtr client, int len)
+{
+    OsCommPtr oc = (OsCommPtr) client->osPrivate;
+
+    oc->input->lenLastReq += len;
+}
+
  /********************
  * FlushAllOutput()
  *    Flush all clients with output.  However, if some client still
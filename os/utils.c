@@ -285,7 +285,7 @@ UseMsg(void)
     ErrorF
         ("-deferglyphs [none|all|16] defer loading of [no|all|16-bit] glyphs\n");
     ErrorF("-f #                   bell base (0-100)\n");
-    ErrorF("-fakescreenfps #       fake screen default fps (1-600)\n");
+    ErrorF("-fakescreenfps #[,#...] fake screen default fps (1-600), per screen\n");
     ErrorF("-fp string             default font path\n");
     ErrorF("-help                  prints message with these options\n");
     ErrorF("+iglx                  Allow creating indirect GLX contexts\n");
@@ -531,9 +531,18 @@ ProcessCommandLine(int argc, char *argv[])
         }
         else if (strcmp(argv[i], "-fakescreenfps") == 0) {
             if (++i < argc) {
-                FakeScreenFps = (uint32_t) atoi(argv[i]);
-                if (FakeScreenFps < 1 || FakeScreenFps > 600)
-                    FatalError("fakescreenfps must be an integer in [1;600] range\n");
+                char *rate = argv[i];
+
+                FakeScreenFpsCount = 0;
+                do {
+                    uint32_t fps = (uint32_t) strtoul(rate, &rate, 10);
+
+                    if (fps < 1 || fps > 600)
+                        FatalError("fakescreenfps must be an integer in [1;600] range\n");
+                    if (FakeScreenFpsCount < MAXSCREENS)
+                        FakeScreenFpsPerScreen[FakeScreenFpsCount++] = fps;
+                } while (*rate++ == ',');
+                FakeScreenFps = FakeScreenFpsPerScreen[0];
             }
             else
                 UseMsg();
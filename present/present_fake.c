@@ -24,13 +24,20 @@
 #include "include/list.h"
 #include "present/present_priv.h"
 
-static struct xorg_list fake_vblank_queue;
+/*
+ * Fake vblank events are kept per screen, sorted by target MSC, and a
+ * single timer per screen fires at the next MSC anything waits for.  One
+ * tick delivers every event due at that MSC, so many clients presenting
+ * at the same rate cost one wakeup per frame instead of one each.
+ */
+
+/* records kept around per screen to queue vblanks without allocating */
+#define PRESENT_FAKE_PREALLOC   16
 
 typedef struct present_fake_vblank {
     struct xorg_list            list;
     uint64_t                    event_id;
-    OsTimerPtr                  timer;
-    ScreenPtr                   screen;
+    uint64_t                    msc;
 } present_fake_vblank_rec, *present_fake_vblank_ptr;
 
 int
@@ -52,30 +59,62 @@ present_fake_notify(ScreenPtr screen, uint64_t event_id)
     present_event_notify(event_id, ust, msc);
 }
 
+/* Milliseconds until the screen reaches msc, at least 1 */
+static CARD32
+present_fake_delay(present_screen_priv_ptr screen_priv, uint64_t msc)
+{
+    uint64_t                    ust = msc * screen_priv->fake_interval;
+    int64_t                     delay = ((int64_t) (ust - GetTimeInMicros())) / 1000;
+
+    return delay > 0 ? delay : 1;
+}
+
 static CARD32
 present_fake_do_timer(OsTimerPtr timer,
                       CARD32 time,
                       void *arg)
 {
-    present_fake_vblank_ptr     fake_vblank = arg;
+    ScreenPtr                   screen = arg;
+    present_screen_priv_ptr     screen_priv = present_screen_priv(screen);
+    present_fake_vblank_ptr     fake_vblank;
+    uint64_t                    ust, msc;
+
+    present_fake_get_ust_msc(screen, &ust, &msc);
+
+    /* events may queue or abort others, the timer is re-armed below */
+    screen_priv->fake_in_timer = TRUE;
+    while (!xorg_list_is_empty(&screen_priv->fake_queue)) {
+        fake_vblank = xorg_list_first_entry(&screen_priv->fake_queue,
+                                            present_fake_vblank_rec, list);
+        if (fake_vblank->msc > msc)
+            break;
+        xorg_list_del(&fake_vblank->list);
+        xorg_list_add(&fake_vblank->list, &screen_priv->fake_free);
+        present_event_notify(fake_vblank->event_id, ust, msc);
+    }
+    screen_priv->fake_in_timer = FALSE;
 
-    present_fake_notify(fake_vblank->screen, fake_vblank->event_id);
-    xorg_list_del(&fake_vblank->list);
-    TimerFree(fake_vblank->timer);
-    free(fake_vblank);
-    return 0;
+    if (xorg_list_is_empty(&screen_priv->fake_queue)) {
+        screen_priv->fake_timer_msc = 0;
+        return 0;
+    }
+    fake_vblank = xorg_list_first_entry(&screen_priv->fake_queue,
+                                        present_fake_vblank_rec, list);
+    screen_priv->fake_timer_msc = fake_vblank->msc;
+    return present_fake_delay(screen_priv, fake_vblank->msc);
 }
 
 void
 present_fake_abort_vblank(ScreenPtr screen, uint64_t event_id, uint64_t msc)
 {
+    present_screen_priv_ptr     screen_priv = present_screen_priv(screen);
     present_fake_vblank_ptr     fake_vblank, tmp;
 
-    xorg_list_for_each_entry_safe(fake_vblank, tmp, &fake_vblank_queue, list) {
+    /* an idle timer finds nothing to do, leave it be */
+    xorg_list_for_each_entry_safe(fake_vblank, tmp, &screen_priv->fake_queue, list) {
         if (fake_vblank->event_id == event_id) {
-            TimerFree(fake_vblank->timer); /* TimerFree will call TimerCancel() */
             xorg_list_del(&fake_vblank->list);
-            free (fake_vblank);
+            xorg_list_add(&fake_vblank->list, &screen_priv->fake_free);
             break;
         }
     }
@@ -90,39 +129,57 @@ present_fake_queue_vblank(ScreenPtr     screen,
     uint64_t                    ust = msc * screen_priv->fake_interval;
     uint64_t                    now = GetTimeInMicros();
     INT32                       delay = ((int64_t) (ust - now)) / 1000;
-    present_fake_vblank_ptr     fake_vblank;
+    present_fake_vblank_ptr     fake_vblank, next;
 
     if (delay <= 0) {
         present_fake_notify(screen, event_id);
         return Success;
     }
 
-    fake_vblank = calloc (1, sizeof (present_fake_vblank_rec));
-    if (!fake_vblank)
-        return BadAlloc;
+    if (!xorg_list_is_empty(&screen_priv->fake_free)) {
+        fake_vblank = xorg_list_first_entry(&screen_priv->fake_free,
+                                            present_fake_vblank_rec, list);
+        xorg_list_del(&fake_vblank->list);
+    } else {
+        fake_vblank = calloc (1, sizeof (present_fake_vblank_rec));
+        if (!fake_vblank)
+            return BadAlloc;
+    }
 
-    fake_vblank->screen = screen;
     fake_vblank->event_id = event_id;
-    fake_vblank->timer = TimerSet(NULL, 0, delay, present_fake_do_timer, fake_vblank);
-    if (!fake_vblank->timer) {
-        free(fake_vblank);
-        return BadAlloc;
-    }
+    fake_vblank->msc = msc;
+
+    /* keep the queue sorted, after any event for the same msc */
+    xorg_list_for_each_entry(next, &screen_priv->fake_queue, list)
+        if (next->msc > msc)
+            break;
+    xorg_list_append(&fake_vblank->list, &next->list);
 
-    xorg_list_add(&fake_vblank->list, &fake_vblank_queue);
+    if (!screen_priv->fake_in_timer &&
+        (!screen_priv->fake_timer_msc || msc < screen_priv->fake_timer_msc)) {
+        screen_priv->fake_timer_msc = msc;
+        TimerSet(screen_priv->fake_timer, 0, delay, present_fake_do_timer, screen);
+    }
 
     return Success;
 }
 
 uint32_t FakeScreenFps = 0;
+uint32_t FakeScreenFpsPerScreen[MAXSCREENS];
+int FakeScreenFpsCount = 0;
 
-void
+Bool
 present_fake_screen_init(ScreenPtr screen)
 {
     uint32_t                fake_fps;
     present_screen_priv_ptr screen_priv = present_screen_priv(screen);
+    present_fake_vblank_ptr fake_vblank;
+    int                     i;
 
-    if (FakeScreenFps)
+    /* -fakescreenfps a,b,c: the last rate also covers further screens */
+    if (FakeScreenFpsCount)
+        fake_fps = FakeScreenFpsPerScreen[min(screen->myNum, FakeScreenFpsCount - 1)];
+    else if (FakeScreenFps)
         fake_fps = FakeScreenFps;
     else {
         /* For screens with hardware vblank support, the fake code
@@ -137,10 +194,41 @@ present_fake_screen_init(ScreenPtr screen)
             fake_fps = 60;
     }
     screen_priv->fake_interval = 1000000 / fake_fps;
+
+    xorg_list_init(&screen_priv->fake_queue);
+    xorg_list_init(&screen_priv->fake_free);
+    screen_priv->fake_timer = TimerSet(NULL, 0, 0, NULL, NULL);
+    if (!screen_priv->fake_timer)
+        return FALSE;
+
+    for (i = 0; i < PRESENT_FAKE_PREALLOC; i++) {
+        fake_vblank = calloc(1, sizeof (present_fake_vblank_rec));
+        if (!fake_vblank)
+            break;
+        xorg_list_add(&fake_vblank->list, &screen_priv->fake_free);
+    }
+    return TRUE;
 }
 
 void
-present_fake_queue_init(void)
+present_fake_screen_fini(ScreenPtr screen)
 {
-    xorg_list_init(&fake_vblank_queue);
+    present_screen_priv_ptr screen_priv = present_screen_priv(screen);
+    present_fake_vblank_ptr fake_vblank, tmp;
+
+    if (!screen_priv->fake_timer)
+        return;
+
+    TimerFree(screen_priv->fake_timer);
+    screen_priv->fake_timer = NULL;
+
+    /* queued events die with the screen, like with any other vblank */
+    xorg_list_for_each_entry_safe(fake_vblank, tmp, &screen_priv->fake_queue, list) {
+        xorg_list_del(&fake_vblank->list);
+        free(fake_vblank);
+    }
+    xorg_list_for_each_entry_safe(fake_vblank, tmp, &screen_priv->fake_free, list) {
+        xorg_list_del(&fake_vblank->list);
+        free(fake_vblank);
+    }
 }
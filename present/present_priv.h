@@ -57,6 +57,9 @@ extern DevPrivateKeyRec present_screen_private_key;
 
 typedef struct present_fence *present_fence_ptr;
 
+typedef struct present_frame_stats present_frame_stats_rec, *present_frame_stats_ptr;
+typedef struct present_crtc_stats present_crtc_stats_rec, *present_crtc_stats_ptr;
+
 typedef struct present_notify present_notify_rec, *present_notify_ptr;
 
 struct present_notify {
@@ -82,6 +85,7 @@ struct present_vblank {
     uint64_t            target_msc;     /* target MSC when present should complete */
     uint64_t            exec_msc;       /* MSC at which present can be executed */
     uint64_t            msc_offset;
+    uint64_t            queue_ust;      /* when PresentPixmap was received */
     present_fence_ptr   idle_fence;
     present_fence_ptr   wait_fence;
     present_notify_ptr  notifies;
@@ -172,6 +176,11 @@ struct present_screen_priv {
     uint64_t                    unflip_event_id;
 
     uint32_t                    fake_interval;
+    struct xorg_list            fake_queue;     /* by target msc */
+    struct xorg_list            fake_free;      /* spare queue records */
+    OsTimerPtr                  fake_timer;
+    uint64_t                    fake_timer_msc; /* 0 while the timer is idle */
+    Bool                        fake_in_timer;
 
     /* Currently active flipped pixmap and fence */
     RRCrtcPtr                   flip_crtc;
@@ -183,6 +192,10 @@ struct present_screen_priv {
 
     present_screen_info_ptr     info;
 
+    /* Frame statistics for each CRTC presented on */
+    present_crtc_stats_ptr      crtc_stats;
+    int                         num_crtc_stats;
+
     /* Mode hooks */
     present_priv_query_capabilities_ptr query_capabilities;
     present_priv_get_crtc_ptr           get_crtc;
@@ -239,6 +252,7 @@ struct present_window_priv {
     uint64_t               msc;         /* Last reported MSC from the current crtc */
     struct xorg_list       vblank;
     struct xorg_list       notifies;
+    present_frame_stats_ptr stats;      /* allocated on the first frame */
 };
 
 #define PresentCrtcNeverSet     ((RRCrtcPtr) 1)
@@ -376,11 +390,23 @@ present_fake_queue_vblank(ScreenPtr screen, uint64_t event_id, uint64_t msc);
 void
 present_fake_abort_vblank(ScreenPtr screen, uint64_t event_id, uint64_t msc);
 
-void
+Bool
 present_fake_screen_init(ScreenPtr screen);
 
 void
-present_fake_queue_init(void);
+present_fake_screen_fini(ScreenPtr screen);
+
+/*
+ * present_stats.c
+ */
+void
+present_stats_record(present_vblank_ptr vblank, CARD8 mode, uint64_t ust, uint64_t crtc_msc);
+
+void
+present_stats_free_screen(present_screen_priv_ptr screen_priv);
+
+Bool
+present_stats_init(void);
 
 /*
  * present_fence.c
@@ -547,5 +573,7 @@ void present_register_complete_notify(present_complete_notify_proc proc);
 Bool present_can_window_flip(WindowPtr window);
 
 extern uint32_t FakeScreenFps;
+extern uint32_t FakeScreenFpsPerScreen[MAXSCREENS];
+extern int FakeScreenFpsCount;
 
 #endif /*  _PRESENT_PRIV_H_ */
@@ -64,6 +64,9 @@ static void present_close_screen(CallbackListPtr *pcbl, ScreenPtr screen, void *
     if (screen_priv->flip_destroy)
         screen_priv->flip_destroy(screen);
 
+    present_fake_screen_fini(screen);
+    present_stats_free_screen(screen_priv);
+
     dixScreenUnhookClose(screen, present_close_screen);
     dixSetPrivate(&screen->devPrivates, &present_screen_private_key, NULL);
     free(screen_priv);
@@ -112,6 +115,7 @@ present_destroy_window(CallbackListPtr *pcbl, ScreenPtr pScreen, WindowPtr windo
 
         screen_priv->clear_window_flip(window);
 
+        free(window_priv->stats);
         free(window_priv);
     }
 }
@@ -226,7 +230,8 @@ present_screen_init(ScreenPtr screen, present_screen_info_ptr info)
         screen_priv->info = info;
         present_scmd_init_mode_hooks(screen_priv);
 
-        present_fake_screen_init(screen);
+        if (!present_fake_screen_init(screen))
+            return FALSE;
     }
 
     return TRUE;
@@ -259,6 +264,9 @@ present_extension_init(void)
     if (!present_event_init())
         goto bail;
 
+    if (!present_stats_init())
+        goto bail;
+
     DIX_FOR_EACH_SCREEN({
         if (!present_screen_init(walkScreen, NULL))
             goto bail;
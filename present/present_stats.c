@@ -0,0 +1,304 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Frame timing statistics for PresentPixmap.
+ *
+ * Each completed PresentPixmap is accounted to its window and to the CRTC
+ * it completed on: running totals, plus the last few frames in a ring so
+ * that a stutter can be looked at frame by frame.  Monitoring clients read
+ * them with the XORG-PresentStats extension, see presentstatsproto.h.
+ */
+#include <dix-config.h>
+
+#include "dix/dix_priv.h"
+#include "dix/request_priv.h"
+#include "present/present_priv.h"
+#include "present/presentstatsproto.h"
+
+#include "randrstr_priv.h"
+
+typedef struct {
+    uint64_t    ust;
+    uint32_t    latency;
+    uint16_t    late;
+    uint8_t     mode;
+    uint8_t     flags;
+} present_frame_sample_rec;
+
+struct present_frame_stats {
+    uint64_t    presents;
+    uint64_t    flips;
+    uint64_t    copies;
+    uint64_t    skips;
+    uint64_t    async_flips;
+    uint64_t    missed;
+    uint64_t    total_latency;
+    uint32_t    max_latency;
+    uint32_t    next;           /* ring slot of the next sample */
+    present_frame_sample_rec samples[PRESENT_STATS_SAMPLES];
+};
+
+/* one per CRTC with stats, so they go when the CRTC does */
+static RESTYPE present_crtc_stats_type;
+
+struct present_crtc_stats {
+    RRCrtc                      crtc;   /* None for presents without one */
+    present_frame_stats_rec     stats;
+};
+
+static void
+present_stats_add(present_frame_stats_ptr stats,
+                  const present_frame_sample_rec *sample)
+{
+    stats->presents++;
+    switch (sample->mode) {
+    case PresentCompleteModeFlip:
+        stats->flips++;
+        break;
+    case PresentCompleteModeSkip:
+        stats->skips++;
+        break;
+    default:
+        stats->copies++;
+        break;
+    }
+    if (sample->flags & PresentFrameSampleAsync)
+        stats->async_flips++;
+    if (sample->flags & PresentFrameSampleMissed)
+        stats->missed++;
+    stats->total_latency += sample->latency;
+    if (sample->latency > stats->max_latency)
+        stats->max_latency = sample->latency;
+
+    stats->samples[stats->next++ % PRESENT_STATS_SAMPLES] = *sample;
+}
+
+static present_frame_stats_ptr
+present_crtc_stats(present_screen_priv_ptr screen_priv, RRCrtc crtc, Bool create)
+{
+    present_crtc_stats_ptr crtc_stats;
+    int i;
+
+    for (i = 0; i < screen_priv->num_crtc_stats; i++)
+        if (screen_priv->crtc_stats[i].crtc == crtc)
+            return &screen_priv->crtc_stats[i].stats;
+
+    if (!create)
+        return NULL;
+
+    crtc_stats = reallocarray(screen_priv->crtc_stats,
+                              screen_priv->num_crtc_stats + 1,
+                              sizeof (present_crtc_stats_rec));
+    if (!crtc_stats)
+        return NULL;
+    screen_priv->crtc_stats = crtc_stats;
+
+    if (crtc != None && !AddResource(crtc, present_crtc_stats_type, screen_priv))
+        return NULL;
+
+    crtc_stats += screen_priv->num_crtc_stats++;
+    memset(crtc_stats, 0, sizeof (*crtc_stats));
+    crtc_stats->crtc = crtc;
+    return &crtc_stats->stats;
+}
+
+static int
+present_crtc_stats_free(void *value, XID crtc)
+{
+    present_screen_priv_ptr screen_priv = value;
+    int i;
+
+    for (i = 0; i < screen_priv->num_crtc_stats; i++) {
+        if (screen_priv->crtc_stats[i].crtc == crtc) {
+            memmove(screen_priv->crtc_stats + i, screen_priv->crtc_stats + i + 1,
+                    (screen_priv->num_crtc_stats - (i + 1)) * sizeof (present_crtc_stats_rec));
+            screen_priv->num_crtc_stats--;
+            break;
+        }
+    }
+    return Success;
+}
+
+/*
+ * Called for every completed PresentPixmap, from present_vblank_notify().
+ */
+void
+present_stats_record(present_vblank_ptr vblank, CARD8 mode, uint64_t ust, uint64_t crtc_msc)
+{
+    ScreenPtr                   screen = vblank->crtc ? vblank->crtc->pScreen : vblank->screen;
+    present_screen_priv_ptr     screen_priv = present_screen_priv(screen);
+    present_frame_stats_ptr     stats;
+    present_frame_sample_rec    sample = {
+        .ust = ust,
+        .latency = min(ust - vblank->queue_ust, (uint64_t) UINT32_MAX),
+        .mode = mode,
+    };
+
+    if (ust < vblank->queue_ust)
+        sample.latency = 0;
+    if (crtc_msc > vblank->target_msc) {
+        sample.late = min(crtc_msc - vblank->target_msc, (uint64_t) UINT16_MAX);
+        sample.flags |= PresentFrameSampleMissed;
+    }
+    if (mode == PresentCompleteModeFlip && !vblank->sync_flip)
+        sample.flags |= PresentFrameSampleAsync;
+
+    if (vblank->window) {
+        present_window_priv_ptr window_priv = present_window_priv(vblank->window);
+
+        if (window_priv && !window_priv->stats)
+            window_priv->stats = calloc(1, sizeof (present_frame_stats_rec));
+        if (window_priv && window_priv->stats)
+            present_stats_add(window_priv->stats, &sample);
+    }
+
+    if (screen_priv) {
+        stats = present_crtc_stats(screen_priv,
+                                   vblank->crtc ? vblank->crtc->id : None, TRUE);
+        if (stats)
+            present_stats_add(stats, &sample);
+    }
+}
+
+void
+present_stats_free_screen(present_screen_priv_ptr screen_priv)
+{
+    int i;
+
+    for (i = 0; i < screen_priv->num_crtc_stats; i++)
+        if (screen_priv->crtc_stats[i].crtc != None)
+            FreeResourceByType(screen_priv->crtc_stats[i].crtc,
+                               present_crtc_stats_type, TRUE);
+    free(screen_priv->crtc_stats);
+    screen_priv->crtc_stats = NULL;
+    screen_priv->num_crtc_stats = 0;
+}
+
+static int
+proc_present_stats_query_version(ClientPtr client)
+{
+    X_REQUEST_HEAD_STRUCT(xPresentStatsQueryVersionReq);
+    X_REQUEST_FIELD_CARD32(majorVersion);
+    X_REQUEST_FIELD_CARD32(minorVersion);
+
+    xPresentStatsQueryVersionReply reply = {
+        .majorVersion = PRESENT_STATS_MAJOR,
+        .minorVersion = PRESENT_STATS_MINOR
+    };
+
+    if (reply.majorVersion > stuff->majorVersion ||
+        reply.minorVersion > stuff->minorVersion) {
+        reply.majorVersion = stuff->majorVersion;
+        reply.minorVersion = stuff->minorVersion;
+    }
+
+    X_REPLY_FIELD_CARD32(majorVersion);
+    X_REPLY_FIELD_CARD32(minorVersion);
+
+    return X_SEND_REPLY_SIMPLE(client, reply);
+}
+
+static int
+proc_present_stats_query_frame_stats(ClientPtr client)
+{
+    X_REQUEST_HEAD_STRUCT(xPresentStatsQueryFrameStatsReq);
+    X_REQUEST_FIELD_CARD32(target);
+
+    static const present_frame_stats_rec empty;
+    const present_frame_stats_rec *stats = NULL;
+    WindowPtr   window;
+    RRCrtcPtr   crtc;
+    uint32_t    n, i;
+    int         r;
+
+    r = dixLookupWindow(&window, stuff->target, client, DixGetAttrAccess);
+    switch (r) {
+    case Success: {
+        present_window_priv_ptr window_priv = present_window_priv(window);
+
+        if (window_priv)
+            stats = window_priv->stats;
+        break;
+    }
+    case BadWindow: {
+        present_screen_priv_ptr screen_priv;
+
+        VERIFY_RR_CRTC(stuff->target, crtc, DixGetAttrAccess);
+        screen_priv = present_screen_priv(crtc->pScreen);
+        if (screen_priv)
+            stats = present_crtc_stats(screen_priv, crtc->id, FALSE);
+        break;
+    }
+    default:
+        return r;
+    }
+
+    if (!stats)
+        stats = &empty;
+
+    x_rpcbuf_t rpcbuf = { .swapped = client->swapped, .err_clear = TRUE };
+
+    /* oldest first */
+    n = min(stats->next, PRESENT_STATS_SAMPLES);
+    for (i = stats->next - n; i != stats->next; i++) {
+        const present_frame_sample_rec *sample = &stats->samples[i % PRESENT_STATS_SAMPLES];
+
+        x_rpcbuf_write_CARD64(&rpcbuf, sample->ust);
+        x_rpcbuf_write_CARD32(&rpcbuf, sample->latency);
+        x_rpcbuf_write_CARD16(&rpcbuf, sample->late);
+        x_rpcbuf_write_CARD8(&rpcbuf, sample->mode);
+        x_rpcbuf_write_CARD8(&rpcbuf, sample->flags);
+    }
+
+    xPresentStatsQueryFrameStatsReply reply = {
+        .nSamples = n,
+        .maxLatency = stats->max_latency,
+        .presents = stats->presents,
+        .flips = stats->flips,
+        .copies = stats->copies,
+        .skips = stats->skips,
+        .asyncFlips = stats->async_flips,
+        .missed = stats->missed,
+        .totalLatency = stats->total_latency,
+    };
+
+    X_REPLY_FIELD_CARD32(nSamples);
+    X_REPLY_FIELD_CARD32(maxLatency);
+    X_REPLY_FIELD_CARD64(presents);
+    X_REPLY_FIELD_CARD64(flips);
+    X_REPLY_FIELD_CARD64(copies);
+    X_REPLY_FIELD_CARD64(skips);
+    X_REPLY_FIELD_CARD64(asyncFlips);
+    X_REPLY_FIELD_CARD64(missed);
+    X_REPLY_FIELD_CARD64(totalLatency);
+
+    return X_SEND_REPLY_WITH_RPCBUF(client, reply, rpcbuf);
+}
+
+/* the macros above swap what they read and write themselves */
+static int
+proc_present_stats_dispatch(ClientPtr client)
+{
+    REQUEST(xReq);
+
+    switch (stuff->data) {
+        case X_PresentStatsQueryVersion:
+            return proc_present_stats_query_version(client);
+        case X_PresentStatsQueryFrameStats:
+            return proc_present_stats_query_frame_stats(client);
+    }
+
+    return BadRequest;
+}
+
+Bool
+present_stats_init(void)
+{
+    present_crtc_stats_type = CreateNewResourceType(present_crtc_stats_free,
+                                                    "PresentCrtcStats");
+    if (!present_crtc_stats_type)
+        return FALSE;
+
+    return AddExtension(PRESENT_STATS_NAME, 0, 0,
+                        proc_present_stats_dispatch, proc_present_stats_dispatch,
+                        NULL, StandardMinorOpcode) != NULL;
+}
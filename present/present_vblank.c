@@ -30,6 +30,9 @@ present_vblank_notify(present_vblank_ptr vblank, CARD8 kind, CARD8 mode, uint64_
 {
     int n;
 
+    if (kind == PresentCompleteKindPixmap)
+        present_stats_record(vblank, mode, ust, crtc_msc);
+
     if (vblank->window)
         present_send_complete_notify(vblank->window, kind, mode, vblank->serial, ust, crtc_msc - vblank->msc_offset);
     for (n = 0; n < vblank->num_notifies; n++) {
@@ -126,6 +129,7 @@ present_vblank_init(present_vblank_ptr vblank,
     vblank->exec_msc = target_msc;
     vblank->crtc = target_crtc;
     vblank->msc_offset = window_priv->msc_offset;
+    vblank->queue_ust = GetTimeInMicros();
     vblank->notifies = notifies;
     vblank->num_notifies = num_notifies;
     vblank->has_suboptimal = (options & PresentOptionSuboptimal);
@@ -0,0 +1,92 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * XORG-PresentStats, an Xorg server specific companion to Present.
+ *
+ * PresentStatsQueryFrameStats reports how PresentPixmap requests for a
+ * window, or for everything shown on a RandR CRTC, have been completing:
+ * running totals since the window was created (or the server started, for
+ * CRTCs) plus the last PRESENT_STATS_SAMPLES frames, oldest first.
+ * Latencies are in microseconds, from the PresentPixmap request to its
+ * completion.
+ *
+ * It is a separate extension rather than an extra Present request, so
+ * that it cannot collide with future presentproto requests; clients look
+ * for it with QueryExtension.
+ */
+#ifndef _XSERVER_PRESENTSTATSPROTO_H
+#define _XSERVER_PRESENTSTATSPROTO_H
+
+#include <X11/Xmd.h>
+
+#define PRESENT_STATS_NAME              "XORG-PresentStats"
+#define PRESENT_STATS_MAJOR             1
+#define PRESENT_STATS_MINOR             0
+
+#define X_PresentStatsQueryVersion      0
+#define X_PresentStatsQueryFrameStats   1
+
+#define PRESENT_STATS_SAMPLES           64
+
+/* xPresentFrameSample.flags */
+#define PresentFrameSampleAsync         (1 << 0)        /* async flip */
+#define PresentFrameSampleMissed        (1 << 1)        /* after target MSC */
+
+typedef struct {
+    CARD8   reqType;
+    CARD8   presentStatsReqType;
+    CARD16  length;
+    CARD32  majorVersion;
+    CARD32  minorVersion;
+} xPresentStatsQueryVersionReq;
+#define sz_xPresentStatsQueryVersionReq 12
+
+typedef struct {
+    BYTE    type;               /* X_Reply */
+    CARD8   pad0;
+    CARD16  sequenceNumber;
+    CARD32  length;
+    CARD32  majorVersion;
+    CARD32  minorVersion;
+    CARD32  pad1;
+    CARD32  pad2;
+    CARD32  pad3;
+    CARD32  pad4;
+} xPresentStatsQueryVersionReply;
+#define sz_xPresentStatsQueryVersionReply 32
+
+typedef struct {
+    CARD8   reqType;
+    CARD8   presentStatsReqType;
+    CARD16  length;
+    CARD32  target;             /* window or RandR CRTC */
+} xPresentStatsQueryFrameStatsReq;
+#define sz_xPresentStatsQueryFrameStatsReq 8
+
+typedef struct {
+    BYTE    type;               /* X_Reply */
+    CARD8   pad0;
+    CARD16  sequenceNumber;
+    CARD32  length;
+    CARD32  nSamples;
+    CARD32  maxLatency;
+    CARD64  presents;           /* completed PresentPixmap requests */
+    CARD64  flips;
+    CARD64  copies;
+    CARD64  skips;
+    CARD64  asyncFlips;
+    CARD64  missed;             /* completed after their target MSC */
+    CARD64  totalLatency;
+} xPresentStatsQueryFrameStatsReply;
+#define sz_xPresentStatsQueryFrameStatsReply 72
+
+/* nSamples of these follow the reply */
+typedef struct {
+    CARD64  ust;                /* completion time */
+    CARD32  latency;
+    CARD16  late;               /* MSCs after the target, saturating */
+    CARD8   mode;               /* PresentCompleteMode */
+    CARD8   flags;
+} xPresentFrameSample;
+#define sz_xPresentFrameSample          16
+
+#endif /* _XSERVER_PRESENTSTATSPROTO_H */
@@ -58,7 +58,6 @@ typedef struct _AnimCurElt {
 typedef struct _AnimCur {
     int nelt;                   /* number of elements in the elts array */
     AnimCurElt *elts;           /* actually allocated right after the structure */
-    OsTimerPtr timer;
 } AnimCurRec, *AnimCurPtr;
 
 typedef struct _AnimScrPriv {
@@ -78,6 +77,13 @@ static CursorBits animCursorBits = {
 
 static DevPrivateKeyRec AnimCurScreenPrivateKeyRec;
 
+/*
+ * One timer drives the animated cursors of all devices on all screens; it
+ * fires when the earliest frame is due and advances every sprite whose
+ * next frame is due by then.
+ */
+static OsTimerPtr animCurTimer;
+
 #define IsAnimCur(c)	    ((c) && ((c)->bits == &animCursorBits))
 #define GetAnimCur(c)	    ((AnimCurPtr) ((((char *)(c) + CURSOR_REC_SIZE))))
 #define GetAnimCurScreen(s) ((AnimCurScreenPtr)dixLookupPrivate(&(s)->devPrivates, &AnimCurScreenPrivateKeyRec))
@@ -91,6 +97,10 @@ static void AnimCurScreenClose(CallbackListPtr *pcbl, ScreenPtr pScreen, void *u
 
     dixScreenUnhookClose(pScreen, AnimCurScreenClose);
 
+    /* recreated as needed, timers don't survive a server reset */
+    TimerFree(animCurTimer);
+    animCurTimer = NULL;
+
     Unwrap(as, pScreen, CursorLimits);
     Unwrap(as, pScreen, DisplayCursor);
     Unwrap(as, pScreen, SetCursorPosition);
@@ -119,21 +129,35 @@ AnimCurCursorLimits(DeviceIntPtr pDev,
     Wrap(as, pScreen, CursorLimits, AnimCurCursorLimits);
 }
 
+static Bool
+AnimCurIsRunning(DeviceIntPtr dev)
+{
+    return dev->spriteInfo && dev->spriteInfo->anim.pending &&
+        dev->spriteInfo->anim.pScreen;
+}
+
 /*
- * The cursor animation timer has expired, go display any relevant cursor changes
- * and compute a new timeout value
+ * Show the frame of dev's animated cursor which is due at now.  Frames
+ * whose time has passed while the server was busy are skipped rather than
+ * shown one after the other.
  */
-
-static CARD32
-AnimCurTimerNotify(OsTimerPtr timer, CARD32 now, void *arg)
+static void
+AnimCurAdvance(DeviceIntPtr dev, CARD32 now)
 {
-    DeviceIntPtr dev = arg;
     ScreenPtr pScreen = dev->spriteInfo->anim.pScreen;
     AnimCurScreenPtr as = GetAnimCurScreen(pScreen);
-
     AnimCurPtr ac = GetAnimCur(dev->spriteInfo->sprite->current);
-    int elt = (dev->spriteInfo->anim.elt + 1) % ac->nelt;
+    int elt = dev->spriteInfo->anim.elt;
+    CARD32 time = dev->spriteInfo->anim.time;
     DisplayCursorProcPtr DisplayCursor = pScreen->DisplayCursor;
+    int i;
+
+    for (i = 0; i < ac->nelt; i++) {
+        elt = (elt + 1) % ac->nelt;
+        time += ac->elts[elt].delay;
+        if (!ac->elts[elt].delay || (INT32) (time - now) > 0)
+            break;
+    }
 
     /*
      * Not a simple Unwrap/Wrap as this isn't called along the DisplayCursor
@@ -146,18 +170,79 @@ AnimCurTimerNotify(OsTimerPtr timer, CARD32 now, void *arg)
 
     dev->spriteInfo->anim.elt = elt;
     dev->spriteInfo->anim.pCursor = ac->elts[elt].pCursor;
+    /* a frame without delay stays up until the cursor changes */
+    dev->spriteInfo->anim.pending = ac->elts[elt].delay != 0;
+    if ((INT32) (time - now) <= 0)
+        time = now + ac->elts[elt].delay;
+    dev->spriteInfo->anim.time = time;
+}
+
+/*
+ * The cursor animation timer has expired, go display any relevant cursor
+ * changes and compute a new timeout value
+ */
 
-    return ac->elts[elt].delay;
+static CARD32
+AnimCurTimerNotify(OsTimerPtr timer, CARD32 now, void *arg)
+{
+    DeviceIntPtr dev;
+    CARD32 next = 0;
+
+    for (dev = inputInfo.devices; dev; dev = dev->next) {
+        CARD32 delay;
+
+        if (!AnimCurIsRunning(dev))
+            continue;
+        if (!dev->spriteInfo->sprite ||
+            !IsAnimCur(dev->spriteInfo->sprite->current)) {
+            dev->spriteInfo->anim.pending = FALSE;
+            continue;
+        }
+        if ((INT32) (dev->spriteInfo->anim.time - now) <= 0)
+            AnimCurAdvance(dev, now);
+        if (!dev->spriteInfo->anim.pending)
+            continue;
+        delay = max((INT32) (dev->spriteInfo->anim.time - now), 1);
+        if (!next || delay < next)
+            next = delay;
+    }
+    return next;
 }
 
+/*
+ * Program the shared timer for the earliest frame due.
+ */
 static void
-AnimCurCancelTimer(DeviceIntPtr pDev)
+AnimCurSchedule(void)
 {
-    CursorPtr cur = pDev->spriteInfo->sprite ?
-                    pDev->spriteInfo->sprite->current : NULL;
+    CARD32 now = GetTimeInMillis();
+    DeviceIntPtr dev;
+    CARD32 next = 0;
+
+    for (dev = inputInfo.devices; dev; dev = dev->next) {
+        CARD32 delay;
+
+        if (!AnimCurIsRunning(dev))
+            continue;
+        delay = max((INT32) (dev->spriteInfo->anim.time - now), 1);
+        if (!next || delay < next)
+            next = delay;
+    }
+
+    if (next)
+        animCurTimer = TimerSet(animCurTimer, 0, next, AnimCurTimerNotify,
+                                NULL);
+    else
+        TimerCancel(animCurTimer);
+}
 
-    if (IsAnimCur(cur))
-        TimerCancel(GetAnimCur(cur)->timer);
+static void
+AnimCurStop(DeviceIntPtr pDev)
+{
+    if (pDev->spriteInfo->anim.pending) {
+        pDev->spriteInfo->anim.pending = FALSE;
+        AnimCurSchedule();
+    }
 }
 
 static Bool
@@ -171,25 +256,32 @@ AnimCurDisplayCursor(DeviceIntPtr pDev, ScreenPtr pScreen, CursorPtr pCursor)
 
     Unwrap(as, pScreen, DisplayCursor);
     if (IsAnimCur(pCursor)) {
-        if (pCursor != pDev->spriteInfo->sprite->current) {
+        /*
+         * Also restart the animation when the cursor comes back after
+         * XFixesHideCursor, which displayed no cursor in between.
+         */
+        if (pCursor != pDev->spriteInfo->sprite->current ||
+            !pDev->spriteInfo->anim.pCursor) {
             AnimCurPtr ac = GetAnimCur(pCursor);
 
-            AnimCurCancelTimer(pDev);
+            pDev->spriteInfo->anim.pending = FALSE;
             ret = (*pScreen->DisplayCursor) (pDev, pScreen,
                                              ac->elts[0].pCursor);
 
             if (ret) {
                 pDev->spriteInfo->anim.elt = 0;
-                pDev->spriteInfo->anim.pCursor = pCursor;
+                pDev->spriteInfo->anim.pCursor = ac->elts[0].pCursor;
                 pDev->spriteInfo->anim.pScreen = pScreen;
-
-                ac->timer = TimerSet(ac->timer, 0, ac->elts[0].delay,
-                                     AnimCurTimerNotify, pDev);
+                pDev->spriteInfo->anim.time =
+                    GetTimeInMillis() + ac->elts[0].delay;
+                pDev->spriteInfo->anim.pending = ac->elts[0].delay != 0;
             }
+            AnimCurSchedule();
         }
     }
     else {
-        AnimCurCancelTimer(pDev);
+        /* no frames are shown while the cursor is hidden */
+        AnimCurStop(pDev);
         pDev->spriteInfo->anim.pCursor = 0;
         pDev->spriteInfo->anim.pScreen = 0;
         ret = (*pScreen->DisplayCursor) (pDev, pScreen, pCursor);
@@ -334,15 +426,12 @@ AnimCursorCreate(CursorPtr *cursors, CARD32 *deltas, int ncursor,
     pCursor->id = cid;
 
     ac = GetAnimCur(pCursor);
-    ac->timer = TimerSet(NULL, 0, 0, AnimCurTimerNotify, NULL);
 
     /* security creation/labeling check */
-    if (ac->timer)
-        rc = XaceHookResourceAccess(client, cid, X11_RESTYPE_CURSOR, pCursor,
-                      X11_RESTYPE_NONE, NULL, DixCreateAccess);
+    rc = XaceHookResourceAccess(client, cid, X11_RESTYPE_CURSOR, pCursor,
+                  X11_RESTYPE_NONE, NULL, DixCreateAccess);
 
     if (rc != Success) {
-        TimerFree(ac->timer);
         dixFiniPrivates(pCursor, PRIVATE_CURSOR);
         free(pCursor);
         return rc;
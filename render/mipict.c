@@ -547,6 +547,28 @@ miTriFan(CARD8 op,
     free(tris);
 }
 
+/*
+ * Composite each rectangle through the screen's Composite hook.  Backends
+ * which can do better for a run install their own CompositeBatch, but
+ * must come back here when something they don't know about has wrapped
+ * Composite above them, or that layer would never see the rectangles.
+ */
+void
+miCompositeBatch(CARD8 op,
+                 PicturePtr pSrc,
+                 PicturePtr pMask,
+                 PicturePtr pDst, int nrect, PictCompositeRectPtr rects)
+{
+    PictureScreenPtr ps = GetPictureScreen(pDst->pDrawable->pScreen);
+
+    for (; nrect--; rects++)
+        (*ps->Composite) (op, pSrc, pMask, pDst,
+                          rects->xSrc, rects->ySrc,
+                          rects->xMask, rects->yMask,
+                          rects->xDst, rects->yDst,
+                          rects->width, rects->height);
+}
+
 Bool
 miPictureInit(ScreenPtr pScreen, PictFormatPtr formats, int nformats)
 {
@@ -582,6 +604,7 @@ miPictureInit(ScreenPtr pScreen, PictFormatPtr formats, int nformats)
 
     ps->TriStrip = miTriStrip;  /* converts call to CompositeTriangles */
     ps->TriFan = miTriFan;
+    ps->CompositeBatch = miCompositeBatch;
 
     return TRUE;
 }
@@ -53,6 +53,7 @@ DevPrivateKeyRec PictureWindowPrivateKeyRec;
 RESTYPE PictureType;
 RESTYPE PictFormatType;
 RESTYPE GlyphSetType;
+CallbackListPtr SourcePictureDestroyCallback;
 int PictureCmapPolicy = PictureCmapPolicyDefault;
 
 PictFormatPtr
@@ -1381,6 +1382,7 @@ FreePicture(void *value, XID pid)
         free(pPicture->filter_params);
 
         if (pPicture->pSourcePict) {
+            CallCallbacks(&SourcePictureDestroyCallback, pPicture);
             if (pPicture->pSourcePict->type != SourcePictTypeSolidFill)
                 free(pPicture->pSourcePict->linear.stops);
 
@@ -1547,6 +1549,43 @@ CompositePicture(CARD8 op,
                       xSrc, ySrc, xMask, yMask, xDst, yDst, width, height);
 }
 
+/**
+ * Composite several rectangles between the same pictures.  The op is
+ * reduced per rectangle, as CompositePicture does, and runs sharing the
+ * reduced op are handed to the screen in one call.
+ */
+void
+CompositePictureBatch(CARD8 op,
+                      PicturePtr pSrc,
+                      PicturePtr pMask,
+                      PicturePtr pDst, int nrect, PictCompositeRectPtr rects)
+{
+    PictureScreenPtr ps = GetPictureScreen(pDst->pDrawable->pScreen);
+    CARD8 runOp = PictOpDst;
+    int i, first = 0;
+
+    ValidatePicture(pSrc);
+    if (pMask)
+        ValidatePicture(pMask);
+    ValidatePicture(pDst);
+
+    for (i = 0; i <= nrect; i++) {
+        CARD8 rectOp = PictOpDst;
+
+        if (i < nrect)
+            rectOp = ReduceCompositeOp(op, pSrc, pMask, pDst,
+                                       rects[i].xSrc, rects[i].ySrc,
+                                       rects[i].width, rects[i].height);
+        if (i > first && (i == nrect || rectOp != runOp)) {
+            if (runOp != PictOpDst)
+                (*ps->CompositeBatch) (runOp, pSrc, pMask, pDst,
+                                       i - first, rects + first);
+            first = i;
+        }
+        runOp = rectOp;
+    }
+}
+
 void
 CompositeRects(CARD8 op,
                PicturePtr pDst,
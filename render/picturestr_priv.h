@@ -11,6 +11,7 @@
 #include "glyphstr.h"
 #include "resource.h"
 #include "privates.h"
+#include "callback.h"
 
 #define PICT_GRADIENT_STOPTABLE_SIZE 1024
 
@@ -18,6 +19,14 @@ extern RESTYPE PictureType;
 extern RESTYPE PictFormatType;
 extern RESTYPE GlyphSetType;
 
+/*
+ * Called with the PicturePtr when the last reference to a source picture
+ * goes away, for renderers keeping something of their own on it.
+ *
+ * NOTE: only exported for libwfb, not supposed to be used by drivers.
+ */
+extern _X_EXPORT CallbackListPtr SourcePictureDestroyCallback;
+
 #define VERIFY_PICTURE(pPicture, pid, client, mode) {\
     int tmprc = dixLookupResourceByType((void *)&(pPicture), pid,\
 	                                PictureType, client, mode);\
@@ -34,10 +34,12 @@
 #include "dix/colormap_priv.h"
 #include "dix/cursor_priv.h"
 #include "dix/dix_priv.h"
+#include "dix/extension_priv.h"
 #include "dix/request_priv.h"
 #include "dix/screenint_priv.h"
 #include "dix/server_priv.h"
 #include "miext/extinit_priv.h"
+#include "os/client_priv.h"
 #include "os/osdep.h"
 #include "Xext/panoramiX.h"
 #include "Xext/panoramiXsrv.h"
@@ -511,8 +513,80 @@ PictOpValid(CARD8 op)
     return FALSE;
 }
 
+/*
+ * Toolkits often send long runs of Composite requests between the same
+ * pictures, one per tile or icon.  Those already sitting in the client's
+ * input buffer right behind the current one are gathered here and go
+ * down to the screen as a single batch.
+ */
+#define RENDER_COMPOSITE_BATCH  256
+
 static int
-SingleRenderComposite(ClientPtr client, xRenderCompositeReq *stuff)
+RenderCollectComposites(ClientPtr client, xRenderCompositeReq *stuff,
+                        PictCompositeRectPtr rects)
+{
+    xRenderCompositeReq copy;
+    int nrect = 0;
+
+    /*
+     * Requests swallowed here are never dispatched on their own, so don't
+     * batch while anyone wants to see each of them.
+     */
+    if (client->requestVector !=
+        (client->swapped ? SwappedProcVector : ProcVector) ||
+        ExtensionDispatchCallback)
+        return 0;
+
+    for (;;) {
+        rects[nrect].xSrc = stuff->xSrc;
+        rects[nrect].ySrc = stuff->ySrc;
+        rects[nrect].xMask = stuff->xMask;
+        rects[nrect].yMask = stuff->yMask;
+        rects[nrect].xDst = stuff->xDst;
+        rects[nrect].yDst = stuff->yDst;
+        rects[nrect].width = stuff->width;
+        rects[nrect].height = stuff->height;
+        if (++nrect == RENDER_COMPOSITE_BATCH)
+            break;
+
+        xRenderCompositeReq *next;
+        int len;
+
+        next = PeekNextRequestFromClient(client, &len);
+        if (!next || len != (int) sizeof(xRenderCompositeReq) ||
+            next->reqType != client->majorOp ||
+            next->renderReqType != X_RenderComposite ||
+            next->op != stuff->op)
+            break;
+
+        copy = *next;
+        if (client->swapped) {
+            swapl(&copy.src);
+            swapl(&copy.mask);
+            swapl(&copy.dst);
+            swaps(&copy.xSrc);
+            swaps(&copy.ySrc);
+            swaps(&copy.xMask);
+            swaps(&copy.yMask);
+            swaps(&copy.xDst);
+            swaps(&copy.yDst);
+            swaps(&copy.width);
+            swaps(&copy.height);
+        }
+        /* same pictures, so it can't fail where this one succeeded */
+        if (copy.src != stuff->src || copy.mask != stuff->mask ||
+            copy.dst != stuff->dst)
+            break;
+
+        SkipNextRequestFromClient(client, len);
+        client->sequence++;
+        stuff = &copy;
+    }
+    return nrect;
+}
+
+static int
+SingleRenderComposite(ClientPtr client, xRenderCompositeReq *stuff, Bool batch)
 {
     PicturePtr pSrc, pMask, pDst;
 
@@ -536,6 +610,15 @@ SingleRenderComposite(ClientPtr client, xRenderCompositeReq *stuff)
                                                                    pDrawable->
                                                                    pScreen))
         return BadMatch;
+    if (batch) {
+        PictCompositeRectRec rects[RENDER_COMPOSITE_BATCH];
+        int nrect = RenderCollectComposites(client, stuff, rects);
+
+        if (nrect > 1) {
+            CompositePictureBatch(stuff->op, pSrc, pMask, pDst, nrect, rects);
+            return Success;
+        }
+    }
     CompositePicture(stuff->op,
                      pSrc,
                      pMask,
@@ -2077,7 +2160,7 @@ PanoramiXRenderComposite(ClientPtr client, xRenderCompositeReq *orig_req)
                 sub_req.yMask = orig.yMask - walkScreen->y;
             }
         }
-        result = SingleRenderComposite(client, &sub_req);
+        result = SingleRenderComposite(client, &sub_req, FALSE);
         if (result != Success)
             break;
     });
@@ -2651,9 +2734,9 @@ ProcRenderComposite(ClientPtr client)
 
 #ifdef XINERAMA
     return (usePanoramiX ? PanoramiXRenderComposite(client, stuff)
-                         : SingleRenderComposite(client, stuff));
+                         : SingleRenderComposite(client, stuff, TRUE));
 #else
-    return SingleRenderComposite(client, stuff);
+    return SingleRenderComposite(client, stuff, TRUE);
 #endif
 }
 
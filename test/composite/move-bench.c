@@ -0,0 +1,170 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Move and restack one redirected toplevel over a stack of other
+ * redirected toplevels, each with a tree of children, and report the
+ * time per ConfigureWindow.  Afterwards, draw into a child of every
+ * toplevel and read it back from the toplevel's pixmap, to check that
+ * the clip lists inside the redirected windows are still right.
+ *
+ *   composite-move-bench [toplevels [children [iterations]]]
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <xcb/xcb.h>
+#include <xcb/composite.h>
+
+#define WIN_SIZE        200
+#define CHILD_SIZE      20
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+sync_server(xcb_connection_t *c)
+{
+    free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL));
+}
+
+static xcb_window_t
+create_window(xcb_connection_t *c, xcb_screen_t *screen, xcb_window_t parent,
+              int x, int y, int size, uint32_t pixel)
+{
+    xcb_window_t w = xcb_generate_id(c);
+    uint32_t values[] = { pixel };
+
+    xcb_create_window(c, XCB_COPY_FROM_PARENT, w, parent, x, y, size, size,
+                      0, XCB_WINDOW_CLASS_INPUT_OUTPUT, screen->root_visual,
+                      XCB_CW_BACK_PIXEL, values);
+    xcb_map_window(c, w);
+    return w;
+}
+
+static void
+configure(xcb_connection_t *c, xcb_window_t w, int iterations,
+          const char *what, uint16_t mask, int step)
+{
+    double start = now();
+    int i;
+
+    for (i = 0; i < iterations; i++) {
+        uint32_t values[2] = { 1 + (i * step) % 600, 1 + (i * step / 2) % 400 };
+
+        if (mask == XCB_CONFIG_WINDOW_STACK_MODE)
+            values[0] = i & 1 ? XCB_STACK_MODE_ABOVE : XCB_STACK_MODE_BELOW;
+        xcb_configure_window(c, w, mask, values);
+    }
+    sync_server(c);
+    printf("%-8s %8.2f us per request\n", what,
+           (now() - start) / iterations * 1e6);
+}
+
+/* Fill the first child of each toplevel and look for it in the pixmap */
+static int
+check_children(xcb_connection_t *c, xcb_screen_t *screen,
+               xcb_window_t *toplevels, xcb_window_t *children, int n,
+               int nchildren)
+{
+    xcb_gcontext_t gc = xcb_generate_id(c);
+    uint32_t pixel = 0x00123456;
+    xcb_rectangle_t rect = { 0, 0, CHILD_SIZE, CHILD_SIZE };
+    int failed = 0;
+    int i;
+
+    xcb_create_gc(c, gc, screen->root, XCB_GC_FOREGROUND, &pixel);
+
+    for (i = 0; i < n; i++) {
+        xcb_pixmap_t pixmap = xcb_generate_id(c);
+        xcb_get_image_reply_t *image;
+        uint32_t *data;
+
+        xcb_poly_fill_rectangle(c, children[i * nchildren], gc, 1, &rect);
+        xcb_composite_name_window_pixmap(c, toplevels[i], pixmap);
+        image = xcb_get_image_reply(c,
+                                    xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                                  pixmap, 1, 1, 1, 1, ~0),
+                                    NULL);
+        assert(image);
+        data = (uint32_t *) xcb_get_image_data(image);
+        if ((data[0] & 0xffffff) != pixel) {
+            printf("toplevel %d: child contents 0x%06x, expected 0x%06x\n",
+                   i, data[0] & 0xffffff, pixel);
+            failed = 1;
+        }
+        free(image);
+        xcb_free_pixmap(c, pixmap);
+    }
+    xcb_free_gc(c, gc);
+    return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+    int n = argc > 1 ? atoi(argv[1]) : 64;
+    int nchildren = argc > 2 ? atoi(argv[2]) : 32;
+    int iterations = argc > 3 ? atoi(argv[3]) : 2000;
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen;
+    xcb_window_t *toplevels, *children, mover;
+    xcb_composite_query_version_reply_t *version;
+    int i, j, ret;
+
+    assert(!xcb_connection_has_error(c));
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+
+    version = xcb_composite_query_version_reply(c,
+        xcb_composite_query_version(c, 0, 4), NULL);
+    if (!version) {
+        printf("no Composite extension\n");
+        return 77;
+    }
+    free(version);
+
+    /* what a compositing manager does */
+    xcb_composite_redirect_subwindows(c, screen->root,
+                                      XCB_COMPOSITE_REDIRECT_MANUAL);
+
+    toplevels = calloc(n, sizeof(*toplevels));
+    children = calloc(n * nchildren, sizeof(*children));
+    for (i = 0; i < n; i++) {
+        toplevels[i] = create_window(c, screen, screen->root,
+                                     (i * 37) % 600, (i * 23) % 400,
+                                     WIN_SIZE, 0x808080);
+        for (j = 0; j < nchildren; j++)
+            children[i * nchildren + j] =
+                create_window(c, screen, toplevels[i],
+                              1 + (j * CHILD_SIZE) % (WIN_SIZE - CHILD_SIZE),
+                              1 + (j * 7) % (WIN_SIZE - CHILD_SIZE),
+                              CHILD_SIZE, 0xc0c0c0);
+    }
+    mover = create_window(c, screen, screen->root, 0, 0, WIN_SIZE, 0x404040);
+    sync_server(c);
+
+    printf("%d toplevels with %d children each, %d iterations\n",
+           n, nchildren, iterations);
+    configure(c, mover, iterations, "move",
+              XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y, 7);
+    configure(c, mover, iterations, "restack",
+              XCB_CONFIG_WINDOW_STACK_MODE, 0);
+    configure(c, mover, iterations, "resize",
+              XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT, 3);
+
+    ret = check_children(c, screen, toplevels, children, n, nchildren);
+
+    free(children);
+    free(toplevels);
+    xcb_disconnect(c);
+    return ret;
+}
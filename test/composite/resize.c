@@ -0,0 +1,147 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Resize two redirected windows back and forth, the way an interactive
+ * resize does, and check what ends up in them: pixmaps of the new size,
+ * the old contents kept where the bit gravity puts them, and newly
+ * exposed parts painted with the background rather than left over from
+ * an earlier size or from the other window.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <xcb/xcb.h>
+#include <xcb/composite.h>
+
+#define NWINDOWS        2
+#define ARRAY_SIZE(x)   (int) (sizeof(x) / sizeof((x)[0]))
+
+static const struct {
+    int width, height;
+} sizes[] = {
+    { 200, 150 }, { 201, 151 }, { 150, 100 }, { 230, 160 }, { 150, 100 },
+    { 300, 40 }, { 40, 300 }, { 64, 64 }, { 500, 400 }, { 200, 150 },
+};
+
+static xcb_window_t
+create_window(xcb_connection_t *c, xcb_screen_t *screen, int x,
+              uint32_t pixel)
+{
+    xcb_window_t w = xcb_generate_id(c);
+    uint32_t values[] = { pixel, XCB_GRAVITY_NORTH_WEST };
+
+    xcb_create_window(c, XCB_COPY_FROM_PARENT, w, screen->root, x, 0,
+                      sizes[0].width, sizes[0].height, 0,
+                      XCB_WINDOW_CLASS_INPUT_OUTPUT, screen->root_visual,
+                      XCB_CW_BACK_PIXEL | XCB_CW_BIT_GRAVITY, values);
+    xcb_map_window(c, w);
+    return w;
+}
+
+static int
+check_window(xcb_connection_t *c, xcb_window_t w, int n, int width,
+             int height, int kept_width, int kept_height, uint32_t kept,
+             uint32_t background)
+{
+    xcb_pixmap_t pixmap = xcb_generate_id(c);
+    xcb_get_geometry_reply_t *geom;
+    xcb_get_image_reply_t *image;
+    uint32_t *data;
+    int x, y;
+    int failed = 0;
+
+    xcb_composite_name_window_pixmap(c, w, pixmap);
+    geom = xcb_get_geometry_reply(c, xcb_get_geometry(c, pixmap), NULL);
+    assert(geom);
+    if (geom->width != width || geom->height != height) {
+        printf("window %d: pixmap is %dx%d, expected %dx%d\n",
+               n, geom->width, geom->height, width, height);
+        failed = 1;
+    }
+    free(geom);
+    xcb_free_pixmap(c, pixmap);
+
+    image = xcb_get_image_reply(c,
+                                xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP, w,
+                                              0, 0, width, height, ~0),
+                                NULL);
+    assert(image);
+    data = (uint32_t *) xcb_get_image_data(image);
+    for (y = 0; y < height && !failed; y++) {
+        for (x = 0; x < width; x++) {
+            uint32_t expect = x < kept_width && y < kept_height ?
+                kept : background;
+            uint32_t got = data[y * width + x] & 0xffffff;
+
+            if (got != expect) {
+                printf("window %d at %dx%d: pixel %d,%d is 0x%06x, "
+                       "expected 0x%06x\n",
+                       n, width, height, x, y, got, expect);
+                failed = 1;
+                break;
+            }
+        }
+    }
+    free(image);
+    return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_composite_query_version_reply_t *version;
+    xcb_screen_t *screen;
+    xcb_window_t windows[NWINDOWS];
+    uint32_t background[NWINDOWS] = { 0x202020, 0x404040 };
+    xcb_gcontext_t gc;
+    int i, n, ret = 0;
+
+    assert(!xcb_connection_has_error(c));
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+
+    version = xcb_composite_query_version_reply(c,
+        xcb_composite_query_version(c, 0, 4), NULL);
+    if (!version) {
+        printf("no Composite extension\n");
+        return 77;
+    }
+    free(version);
+
+    xcb_composite_redirect_subwindows(c, screen->root,
+                                      XCB_COMPOSITE_REDIRECT_MANUAL);
+
+    for (n = 0; n < NWINDOWS; n++)
+        windows[n] = create_window(c, screen, n * 600, background[n]);
+    gc = xcb_generate_id(c);
+    xcb_create_gc(c, gc, screen->root, 0, NULL);
+
+    for (i = 1; i < ARRAY_SIZE(sizes); i++) {
+        for (n = 0; n < NWINDOWS; n++) {
+            /* never one of the backgrounds */
+            uint32_t pixel = 0x010101 * (i * 16 + n * 8 + 4);
+            uint32_t values[] = { sizes[i].width, sizes[i].height };
+            xcb_rectangle_t all = {
+                0, 0, sizes[i - 1].width, sizes[i - 1].height
+            };
+
+            xcb_change_gc(c, gc, XCB_GC_FOREGROUND, &pixel);
+            xcb_poly_fill_rectangle(c, windows[n], gc, 1, &all);
+            xcb_configure_window(c, windows[n],
+                                 XCB_CONFIG_WINDOW_WIDTH |
+                                 XCB_CONFIG_WINDOW_HEIGHT, values);
+
+            ret |= check_window(c, windows[n], n,
+                                sizes[i].width, sizes[i].height,
+                                sizes[i - 1].width, sizes[i - 1].height,
+                                pixel, background[n]);
+        }
+    }
+
+    xcb_free_gc(c, gc);
+    xcb_disconnect(c);
+    return ret;
+}
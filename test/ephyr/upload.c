@@ -0,0 +1,132 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Draw lots of small scattered rectangles in an Xephyr and check that its
+ * window on the host ends up showing exactly the same picture, however
+ * the damage was merged and paced on the way there.
+ *
+ *   ephyr-upload <xephyr display> <host display>
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <xcb/xcb.h>
+
+#define WIDTH   320
+#define HEIGHT  240
+#define RECTS   500
+
+static xcb_get_image_reply_t *
+get_image(xcb_connection_t *c, xcb_drawable_t d)
+{
+    xcb_get_image_reply_t *image;
+
+    image = xcb_get_image_reply(c,
+                                xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP, d,
+                                              0, 0, WIDTH, HEIGHT, ~0),
+                                NULL);
+    assert(image);
+    assert(xcb_get_image_data_length(image) == WIDTH * HEIGHT * 4);
+    return image;
+}
+
+static int
+same_image(xcb_get_image_reply_t *a, xcb_get_image_reply_t *b)
+{
+    uint32_t *da = (uint32_t *) xcb_get_image_data(a);
+    uint32_t *db = (uint32_t *) xcb_get_image_data(b);
+    int i;
+
+    for (i = 0; i < WIDTH * HEIGHT; i++)
+        if ((da[i] & 0xffffff) != (db[i] & 0xffffff))
+            return 0;
+    return 1;
+}
+
+/* the host window of the Xephyr screen is the one of its size */
+static xcb_window_t
+find_host_window(xcb_connection_t *r)
+{
+    xcb_screen_t *screen = xcb_setup_roots_iterator(xcb_get_setup(r)).data;
+    xcb_query_tree_reply_t *tree;
+    xcb_window_t *children, found = XCB_NONE;
+    int i;
+
+    tree = xcb_query_tree_reply(r, xcb_query_tree(r, screen->root), NULL);
+    assert(tree);
+    children = xcb_query_tree_children(tree);
+    for (i = 0; i < xcb_query_tree_children_length(tree); i++) {
+        xcb_get_geometry_reply_t *geom =
+            xcb_get_geometry_reply(r, xcb_get_geometry(r, children[i]), NULL);
+
+        if (geom && geom->width == WIDTH && geom->height == HEIGHT)
+            found = children[i];
+        free(geom);
+    }
+    free(tree);
+    return found;
+}
+
+int
+main(int argc, char **argv)
+{
+    xcb_connection_t *c, *r;
+    xcb_screen_t *screen;
+    xcb_window_t host;
+    xcb_gcontext_t gc;
+    xcb_get_image_reply_t *want, *got = NULL;
+    struct timespec pause = { 0, 20 * 1000 * 1000 };
+    int i, tries;
+
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <xephyr display> <host display>\n",
+                argv[0]);
+        return 1;
+    }
+    c = xcb_connect(argv[1], NULL);
+    r = xcb_connect(argv[2], NULL);
+    assert(!xcb_connection_has_error(c) && !xcb_connection_has_error(r));
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    assert(screen->root_depth == 24);
+    assert(screen->width_in_pixels == WIDTH &&
+           screen->height_in_pixels == HEIGHT);
+    host = find_host_window(r);
+    assert(host != XCB_NONE);
+
+    /* far more boxes than go into one upload, in many colours */
+    gc = xcb_generate_id(c);
+    xcb_create_gc(c, gc, screen->root, 0, NULL);
+    for (i = 0; i < RECTS; i++) {
+        uint32_t pixel = (i * 2654435761U) & 0xffffff;
+        xcb_rectangle_t rect = {
+            (i * 37) % (WIDTH - 3), (i * 23) % (HEIGHT - 3), 1 + i % 3, 3
+        };
+
+        xcb_change_gc(c, gc, XCB_GC_FOREGROUND, &pixel);
+        xcb_poly_fill_rectangle(c, screen->root, gc, 1, &rect);
+    }
+    want = get_image(c, screen->root);
+
+    /* a few frames at the slowest */
+    for (tries = 0; tries < 50; tries++) {
+        free(got);
+        got = get_image(r, host);
+        if (same_image(want, got))
+            break;
+        nanosleep(&pause, NULL);
+    }
+    if (tries == 50)
+        printf("the host window does not show what was drawn\n");
+
+    free(want);
+    free(got);
+    xcb_free_gc(c, gc);
+    xcb_disconnect(c);
+    xcb_disconnect(r);
+    return tries == 50;
+}
@@ -0,0 +1,257 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Replay a page of text through the EXA glyph cache: lines of glyphs drawn
+ * from a large set with a Zipf-like frequency, as in CJK text or a page
+ * mixing several fonts and sizes.  Reports the time per glyph and how
+ * often a glyph had to be uploaded to the cache, then checks that a line
+ * drawn twice in a row only uploads its glyphs the first time.
+ *
+ *   exa-glyphs-bench [glyphs [lines [megabytes]]]
+ */
+#include <dix-config.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "exa_priv.h"
+#include "glyphstr_priv.h"
+
+#define GLYPHS_PER_LINE 80
+
+/*
+ * The glyph cache only needs pictures to put glyphs into and to composite
+ * from; stand in for them and for the rest of EXA, which would drag in the
+ * whole server.
+ */
+DevPrivateKeyRec exaScreenPrivateKeyRec = { .initialized = TRUE };
+ClientPtr serverClient;
+
+static PictFormatRec a8Format = { .depth = 8, .format = PIXMAN_a8 };
+static PictFormatRec argbFormat = { .depth = 32, .format = PIXMAN_a8r8g8b8 };
+static PicturePtr *glyphPictures;
+static int uploads, composites;
+
+PictFormatPtr
+PictureMatchFormat(ScreenPtr pScreen, int depth, CARD32 format)
+{
+    return format == PIXMAN_a8 ? &a8Format : &argbFormat;
+}
+
+PicturePtr
+CreatePicture(Picture pid, DrawablePtr pDrawable, PictFormatPtr pFormat,
+              Mask mask, XID *list, ClientPtr client, int *error)
+{
+    PicturePtr pPicture = calloc(1, sizeof(PictureRec));
+
+    pPicture->pDrawable = pDrawable;
+    pPicture->pFormat = pFormat;
+    pPicture->format = pFormat->format;
+    pPicture->refcnt = 1;
+    return pPicture;
+}
+
+int
+FreePicture(void *value, XID pid)
+{
+    PicturePtr pPicture = value;
+
+    if (--pPicture->refcnt == 0) {
+        free(pPicture->pDrawable);
+        free(pPicture);
+    }
+    return Success;
+}
+
+void
+CompositePicture(CARD8 op, PicturePtr pSrc, PicturePtr pMask, PicturePtr pDst,
+                 INT16 xSrc, INT16 ySrc, INT16 xMask, INT16 yMask,
+                 INT16 xDst, INT16 yDst, CARD16 width, CARD16 height)
+{
+    uploads++;
+}
+
+void
+exaCompositeRects(CARD8 op, PicturePtr pSrc, PicturePtr pMask,
+                  PicturePtr pDst, int nrect, ExaCompositeRectPtr rects)
+{
+    composites++;
+}
+
+PicturePtr
+GetGlyphPicture(GlyphPtr glyph, ScreenPtr pScreen)
+{
+    return glyphPictures[*(CARD32 *) glyph->sha1];
+}
+
+void
+exaPixmapDirty(PixmapPtr pPix, int x1, int y1, int x2, int y2)
+{
+}
+
+Bool
+exaPixmapHasGpuCopy(PixmapPtr p)
+{
+    return FALSE;
+}
+
+void
+exaDoMigration(ExaMigrationPtr pixmaps, int npixmaps, Bool can_accel)
+{
+}
+
+int
+dixDestroyPixmap(void *pPixmap, XID id)
+{
+    return Success;
+}
+
+GCPtr
+GetScratchGC(unsigned depth, ScreenPtr pScreen)
+{
+    return NULL;
+}
+
+void
+FreeScratchGC(GCPtr pGC)
+{
+}
+
+void
+ValidateGC(DrawablePtr pDraw, GCPtr pGC)
+{
+}
+
+void
+LogMessageVerb(MessageType type, int verb, const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static PixmapPtr
+benchCreatePixmap(ScreenPtr pScreen, int width, int height, int depth,
+                  unsigned usage_hint)
+{
+    PixmapPtr pPixmap = calloc(1, sizeof(PixmapRec) + sizeof(ExaPixmapPrivRec));
+
+    pPixmap->drawable.pScreen = pScreen;
+    pPixmap->drawable.width = width;
+    pPixmap->drawable.height = height;
+    pPixmap->drawable.depth = depth;
+    pPixmap->drawable.bitsPerPixel = depth == 8 ? 8 : 32;
+    pPixmap->devPrivates = (PrivatePtr) (pPixmap + 1);
+    return pPixmap;
+}
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int
+main(int argc, char **argv)
+{
+    int nglyphs = argc > 1 ? atoi(argv[1]) : 3000;
+    int lines = argc > 2 ? atoi(argv[2]) : 20000;
+    int megabytes = argc > 3 ? atoi(argv[3]) : 64;
+    ExaDriverRec info = { 0 };
+    ExaScreenPrivRec exaScr = { 0 };
+    ScreenRec screen = { 0 };
+    void *screenPrivate = &exaScr;
+    PixmapPtr pDstPixmap;
+    PicturePtr pSrc, pDst;
+    GlyphPtr *glyphs, line[GLYPHS_PER_LINE];
+    GlyphListRec list = { .xOff = 0, .yOff = 16, .len = GLYPHS_PER_LINE };
+    double *cdf, sum = 0, start, elapsed;
+    int i, j, before;
+
+    info.memorySize = (unsigned long) megabytes << 20;
+    info.offScreenBase = 8 << 20;       /* the visible screen */
+    info.maxY = 8192;
+    exaScr.info = &info;
+    exaScr.pixmapPrivateKeyRec.initialized = TRUE;
+    exaScr.pixmapPrivateKeyRec.size = sizeof(ExaPixmapPrivRec);
+    screen.devPrivates = (PrivatePtr) &screenPrivate;
+    screen.CreatePixmap = benchCreatePixmap;
+
+    pDstPixmap = benchCreatePixmap(&screen, 1920, 1080, 32, 0);
+    pDst = CreatePicture(0, &pDstPixmap->drawable, &argbFormat, 0, NULL,
+                         serverClient, NULL);
+    pSrc = CreatePicture(0, &benchCreatePixmap(&screen, 1, 1, 32, 0)->drawable,
+                         &argbFormat, 0, NULL, serverClient, NULL);
+
+    /* mostly body text, with some larger headings */
+    glyphs = calloc(nglyphs, sizeof(GlyphPtr));
+    glyphPictures = calloc(nglyphs, sizeof(PicturePtr));
+    cdf = calloc(nglyphs, sizeof(double));
+    for (i = 0; i < nglyphs; i++) {
+        int size = i % 5 ? 14 : 24;
+        PixmapPtr pPixmap = benchCreatePixmap(&screen, size, size, 8, 0);
+
+        glyphs[i] = calloc(1, sizeof(GlyphRec));
+        *(CARD32 *) glyphs[i]->sha1 = i;
+        glyphs[i]->sha1[4] = 1;
+        glyphs[i]->info.width = glyphs[i]->info.height = size;
+        glyphs[i]->info.xOff = size;
+        glyphPictures[i] = CreatePicture(0, &pPixmap->drawable, &a8Format, 0,
+                                         NULL, serverClient, NULL);
+
+        sum += 1.0 / (i + 1);
+        cdf[i] = sum;
+    }
+    for (i = 0; i < nglyphs; i++)
+        cdf[i] /= sum;
+
+    exaGlyphsInit(&screen);
+
+    srand(1);
+    start = now();
+    for (i = 0; i < lines; i++) {
+        for (j = 0; j < GLYPHS_PER_LINE; j++) {
+            double r = (double) rand() / RAND_MAX;
+            int lo = 0, hi = nglyphs - 1;
+
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+
+                if (cdf[mid] < r)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            line[j] = glyphs[lo];
+        }
+        exaGlyphs(PictOpOver, pSrc, pDst, NULL, 0, 0, 1, &list, line);
+    }
+    elapsed = now() - start;
+
+    printf("%d glyphs in %d MB, %d lines: %d uploads (%.1f%%), "
+           "%d composites\n", nglyphs, megabytes, lines, uploads,
+           100.0 * uploads / ((double) lines * GLYPHS_PER_LINE), composites);
+    printf("%.3f us per glyph\n",
+           elapsed / ((double) lines * GLYPHS_PER_LINE) * 1e6);
+
+    /* both sizes, in the order of a freshly used line */
+    for (j = 0; j < GLYPHS_PER_LINE; j++)
+        line[j] = glyphs[(nglyphs - 1 - j) % nglyphs];
+    exaGlyphs(PictOpOver, pSrc, pDst, NULL, 0, 0, 1, &list, line);
+    before = uploads;
+    exaGlyphs(PictOpOver, pSrc, pDst, NULL, 0, 0, 1, &list, line);
+    if (uploads != before) {
+        printf("%d glyphs of a line just drawn uploaded again\n",
+               uploads - before);
+        return 1;
+    }
+
+    exaGlyphsFini(&screen);
+    return 0;
+}
@@ -0,0 +1,172 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Stress the classic EXA offscreen allocator with a random mix of pixmap
+ * allocations, frees and uses, the way a desktop churns through pixmaps
+ * once offscreen memory is full, and report the time per operation.
+ * Afterwards, check that the areas still tile offscreen memory and that
+ * every area in use is the one its pixmap holds.
+ *
+ *   exa-offscreen-bench [pixmaps [operations [megabytes]]]
+ */
+#include <dix-config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "exa_priv.h"
+
+/*
+ * The allocator only needs the screen and pixmap privates; stand in for
+ * the rest of EXA, which would drag in the whole server.
+ */
+DevPrivateKeyRec exaScreenPrivateKeyRec = { .initialized = TRUE };
+
+void
+exaPixmapSave(ScreenPtr pScreen, ExaOffscreenArea * area)
+{
+}
+
+void
+exaMarkSync(ScreenPtr pScreen)
+{
+}
+
+int
+dixDestroyPixmap(void *pPixmap, XID id)
+{
+    return Success;
+}
+
+typedef struct {
+    PixmapRec pixmap;
+    ExaPixmapPrivRec priv;
+} BenchPixmapRec;
+
+static int evictions;
+
+static void
+benchSave(ScreenPtr pScreen, ExaOffscreenArea * area)
+{
+    BenchPixmapRec *bench = area->privData;
+
+    bench->priv.area = NULL;
+    evictions++;
+}
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* mostly small pixmaps, glyphs and icons, and now and then a window */
+static int
+random_size(void)
+{
+    int r = rand() % 100;
+
+    if (r < 70)
+        return 256 + rand() % (16 << 10);
+    if (r < 95)
+        return (16 << 10) + rand() % (256 << 10);
+    return (256 << 10) + rand() % (4 << 20);
+}
+
+int
+main(int argc, char **argv)
+{
+    int npixmaps = argc > 1 ? atoi(argv[1]) : 8192;
+    int operations = argc > 2 ? atoi(argv[2]) : 1000000;
+    int megabytes = argc > 3 ? atoi(argv[3]) : 256;
+    ExaDriverRec info = { 0 };
+    ExaScreenPrivRec exaScr = { 0 };
+    ScreenRec screen = { 0 };
+    void *screenPrivate = &exaScr;
+    BenchPixmapRec *pixmaps;
+    ExaOffscreenArea *area, *prev = NULL;
+    int allocs = 0, failed = 0, frees = 0, uses = 0, used = 0;
+    double start, elapsed;
+    int i;
+
+    info.memorySize = (unsigned long) megabytes << 20;
+    info.offScreenBase = 8 << 20;       /* the visible screen */
+    exaScr.info = &info;
+    exaScr.pixmapPrivateKeyRec.initialized = TRUE;
+    exaScr.pixmapPrivateKeyRec.size = sizeof(ExaPixmapPrivRec);
+    screen.devPrivates = (PrivatePtr) &screenPrivate;
+
+    pixmaps = calloc(npixmaps, sizeof(BenchPixmapRec));
+    for (i = 0; i < npixmaps; i++) {
+        pixmaps[i].pixmap.drawable.pScreen = &screen;
+        pixmaps[i].pixmap.devPrivates = (PrivatePtr) &pixmaps[i].priv;
+    }
+
+    if (!exaOffscreenInit(&screen))
+        return 1;
+
+    srand(1);
+    start = now();
+    for (i = 0; i < operations; i++) {
+        BenchPixmapRec *bench = &pixmaps[rand() % npixmaps];
+
+        if (!bench->priv.area) {
+            bench->priv.area = exaOffscreenAlloc(&screen, random_size(), 64,
+                                                 FALSE, benchSave, bench);
+            if (bench->priv.area)
+                allocs++;
+            else
+                failed++;
+        } else if (rand() % 4 == 0) {
+            exaOffscreenFree(&screen, bench->priv.area);
+            bench->priv.area = NULL;
+            frees++;
+        } else {
+            ExaOffscreenMarkUsed(&bench->pixmap);
+            uses++;
+        }
+    }
+    elapsed = now() - start;
+
+    printf("%d pixmaps in %d MB: %d allocs (%d failed), %d frees, %d uses, "
+           "%d evictions\n", npixmaps, megabytes, allocs, failed, frees,
+           uses, evictions);
+    printf("%.3f us per operation\n", elapsed / operations * 1e6);
+
+    /* the areas must still tile offscreen memory */
+    for (area = info.offScreenAreas; area; prev = area, area = area->next) {
+        if ((prev ? prev->base_offset + prev->size : (int) info.offScreenBase) !=
+            area->base_offset ||
+            (prev && prev->state == ExaOffscreenAvail &&
+             area->state == ExaOffscreenAvail)) {
+            printf("offscreen areas corrupted at 0x%x\n", area->base_offset);
+            return 1;
+        }
+        if (area->state != ExaOffscreenAvail) {
+            BenchPixmapRec *bench = area->privData;
+
+            if (bench->priv.area != area) {
+                printf("area at 0x%x is not its pixmap's\n", area->base_offset);
+                return 1;
+            }
+            used++;
+        }
+    }
+    if (!prev || prev->base_offset + prev->size != (int) info.memorySize) {
+        printf("offscreen areas do not cover memory\n");
+        return 1;
+    }
+    for (i = 0; i < npixmaps; i++)
+        used -= pixmaps[i].priv.area != NULL;
+    if (used) {
+        printf("%d areas in use without a pixmap\n", used);
+        return 1;
+    }
+
+    ExaOffscreenFini(&screen);
+    free(pixmaps);
+    return 0;
+}
@@ -0,0 +1,131 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Ask for the same font name patterns several times, with different
+ * limits on the number of names and around a SetFontPath, and check that
+ * the answers are the same as the first time, when the server had to
+ * walk the font path to find them.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xcb.h>
+
+static xcb_list_fonts_reply_t *
+list_fonts(xcb_connection_t *c, const char *pattern, int max)
+{
+    xcb_list_fonts_reply_t *reply;
+
+    reply = xcb_list_fonts_reply(c, xcb_list_fonts(c, max, strlen(pattern),
+                                                   pattern), NULL);
+    assert(reply);
+    return reply;
+}
+
+/* the first n names of both lists are the same */
+static int
+same_names(xcb_list_fonts_reply_t *a, xcb_list_fonts_reply_t *b, int n)
+{
+    xcb_str_iterator_t i = xcb_list_fonts_names_iterator(a);
+    xcb_str_iterator_t j = xcb_list_fonts_names_iterator(b);
+
+    if (a->names_len < n || b->names_len < n)
+        return 0;
+    for (; n > 0; n--, xcb_str_next(&i), xcb_str_next(&j)) {
+        if (xcb_str_name_length(i.data) != xcb_str_name_length(j.data) ||
+            memcmp(xcb_str_name(i.data), xcb_str_name(j.data),
+                   xcb_str_name_length(i.data)))
+            return 0;
+    }
+    return 1;
+}
+
+static int
+check(const char *what, xcb_list_fonts_reply_t *expect,
+      xcb_list_fonts_reply_t *got, int n)
+{
+    if (!same_names(expect, got, n)) {
+        printf("%s: %d names, expected the first %d of %d\n",
+               what, got->names_len, n, expect->names_len);
+        return 1;
+    }
+    return 0;
+}
+
+static void
+reset_font_path(xcb_connection_t *c)
+{
+    xcb_get_font_path_reply_t *path;
+    xcb_generic_error_t *error;
+
+    path = xcb_get_font_path_reply(c, xcb_get_font_path(c), NULL);
+    assert(path);
+    error = xcb_request_check(c,
+        xcb_set_font_path_checked(c, path->path_len,
+                                  xcb_get_font_path_path_iterator(path).data));
+    assert(!error);
+    free(path);
+}
+
+int
+main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_list_fonts_reply_t *all, *fixed, *reply;
+    int ret = 0;
+
+    assert(!xcb_connection_has_error(c));
+
+    all = list_fonts(c, "*", 1000);
+    assert(all->names_len > 0);
+    reply = list_fonts(c, "*", 1000);
+    ret |= check("again", all, reply, all->names_len);
+    ret |= reply->names_len != all->names_len;
+    free(reply);
+
+    /* a long list answers a request for fewer names */
+    reply = list_fonts(c, "*", 1);
+    ret |= check("fewer", all, reply, 1);
+    ret |= reply->names_len != 1;
+    free(reply);
+
+    /* a short list does not answer a request for more names */
+    fixed = list_fonts(c, "*fixed*", 1);
+    assert(fixed->names_len == 1);
+    reply = list_fonts(c, "*fixed*", 1000);
+    ret |= check("more", fixed, reply, 1);
+    free(fixed);
+    fixed = reply;
+    reply = list_fonts(c, "*fixed*", 1000);
+    ret |= check("more, again", fixed, reply, fixed->names_len);
+    ret |= reply->names_len != fixed->names_len;
+    free(reply);
+
+    /* font names match without regard to case */
+    reply = list_fonts(c, "*FIXED*", 1000);
+    ret |= check("upper case", fixed, reply, fixed->names_len);
+    free(reply);
+
+    reply = list_fonts(c, "no-such-font-*", 1000);
+    ret |= reply->names_len != 0;
+    free(reply);
+    reply = list_fonts(c, "no-such-font-*", 1000);
+    ret |= reply->names_len != 0;
+    free(reply);
+
+    /* setting the font path starts over */
+    reset_font_path(c);
+    reply = list_fonts(c, "*", 1000);
+    ret |= check("new font path", all, reply, all->names_len);
+    ret |= reply->names_len != all->names_len;
+    free(reply);
+
+    free(all);
+    free(fixed);
+    xcb_disconnect(c);
+    return ret;
+}
@@ -0,0 +1,165 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Ask for the metrics and the glyphs of the same font several times: the
+ * first time the server has to get them from the font backend, later on
+ * it may answer from what it kept of the first time, and after the font
+ * was closed and opened again it has to start over.  All of these have
+ * to give the same answers.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xcb.h>
+
+#define FONT            "fixed"
+#define WIDTH           1600
+#define HEIGHT          40
+
+static xcb_font_t
+open_font(xcb_connection_t *c)
+{
+    xcb_font_t font = xcb_generate_id(c);
+    xcb_generic_error_t *error;
+
+    error = xcb_request_check(c, xcb_open_font_checked(c, font, strlen(FONT),
+                                                       FONT));
+    assert(!error);
+    return font;
+}
+
+static xcb_query_font_reply_t *
+query_font(xcb_connection_t *c, xcb_font_t font)
+{
+    xcb_query_font_reply_t *reply;
+
+    reply = xcb_query_font_reply(c, xcb_query_font(c, font), NULL);
+    assert(reply);
+    return reply;
+}
+
+/* everything but the sequence number */
+static int
+compare_replies(const char *what, xcb_query_font_reply_t *a,
+                xcb_query_font_reply_t *b)
+{
+    size_t size = 32 + a->length * 4;
+
+    if (a->length != b->length ||
+        memcmp((char *) a + 8, (char *) b + 8, size - 8)) {
+        printf("%s: QueryFont replies differ\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Every 8-bit character and some 16-bit ones, in rows the font has and
+ * rows it does not, drawn with ImageText into a fresh pixmap.
+ */
+static xcb_get_image_reply_t *
+draw_text(xcb_connection_t *c, xcb_screen_t *screen, xcb_font_t font)
+{
+    xcb_pixmap_t pixmap = xcb_generate_id(c);
+    xcb_gcontext_t gc = xcb_generate_id(c);
+    uint32_t values[] = { screen->white_pixel, screen->black_pixel, font };
+    xcb_char2b_t wide[64];
+    char line[64];
+    xcb_get_image_reply_t *image;
+    int i, row;
+
+    xcb_create_pixmap(c, screen->root_depth, pixmap, screen->root,
+                      WIDTH, HEIGHT);
+    xcb_create_gc(c, gc, pixmap,
+                  XCB_GC_FOREGROUND | XCB_GC_BACKGROUND | XCB_GC_FONT,
+                  values);
+
+    for (row = 0; row < 4; row++) {
+        for (i = 0; i < 64; i++)
+            line[i] = row * 64 + i;
+        xcb_image_text_8(c, 64, pixmap, gc, 0, 10 * row + 9, line);
+    }
+    for (i = 0; i < 64; i++) {
+        wide[i].byte1 = i % 3 == 0 ? 0 : i % 3 == 1 ? 0x01 : 0x30;
+        wide[i].byte2 = 0x20 + i;
+    }
+    xcb_image_text_16(c, 64, pixmap, gc, 800, 9, wide);
+
+    image = xcb_get_image_reply(c,
+                                xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                              pixmap, 0, 0, WIDTH, HEIGHT,
+                                              ~0),
+                                NULL);
+    assert(image);
+    xcb_free_gc(c, gc);
+    xcb_free_pixmap(c, pixmap);
+    return image;
+}
+
+static int
+compare_images(const char *what, xcb_get_image_reply_t *a,
+               xcb_get_image_reply_t *b)
+{
+    if (xcb_get_image_data_length(a) != xcb_get_image_data_length(b) ||
+        memcmp(xcb_get_image_data(a), xcb_get_image_data(b),
+               xcb_get_image_data_length(a))) {
+        printf("%s: text differs\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen;
+    xcb_query_font_reply_t *first, *reply;
+    xcb_get_image_reply_t *text, *image;
+    xcb_font_t font, other;
+    int ret = 0;
+
+    assert(!xcb_connection_has_error(c));
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+
+    font = open_font(c);
+    first = query_font(c, font);
+    text = draw_text(c, screen, font);
+
+    reply = query_font(c, font);
+    ret |= compare_replies("again", first, reply);
+    free(reply);
+    image = draw_text(c, screen, font);
+    ret |= compare_images("again", text, image);
+    free(image);
+
+    /* a second id for the same font shares whatever the server keeps */
+    other = open_font(c);
+    reply = query_font(c, other);
+    ret |= compare_replies("second id", first, reply);
+    free(reply);
+    xcb_close_font(c, other);
+
+    /* with both ids closed the font is gone, and starts over when reopened */
+    xcb_close_font(c, font);
+    font = open_font(c);
+    image = draw_text(c, screen, font);
+    ret |= compare_images("reopened", text, image);
+    free(image);
+    reply = query_font(c, font);
+    ret |= compare_replies("reopened", first, reply);
+    free(reply);
+    reply = query_font(c, font);
+    ret |= compare_replies("reopened, again", first, reply);
+    free(reply);
+    xcb_close_font(c, font);
+
+    free(first);
+    free(text);
+    xcb_disconnect(c);
+    return ret;
+}
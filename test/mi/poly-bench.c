@@ -0,0 +1,269 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Fill lots of small polygons the way mapping and plotting programs do,
+ * in the spirit of x11perf -poly10 and -complex10, and report the time per
+ * polygon.  Afterwards, check that polygons which are filled without an
+ * edge table come out the same as through one.
+ *
+ *   mi-poly-bench [iterations]
+ *
+ * With 0 iterations, only the check runs.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <xcb/xcb.h>
+
+#define WIN_SIZE        600
+#define CHECK_SIZE      256
+#define MAX_POINTS      64
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+sync_server(xcb_connection_t *c)
+{
+    free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL));
+}
+
+static xcb_gcontext_t
+create_gc(xcb_connection_t *c, xcb_drawable_t drawable, uint32_t function,
+          uint32_t fill_rule)
+{
+    xcb_gcontext_t gc = xcb_generate_id(c);
+    uint32_t values[] = { function, 0xffffffff, fill_rule };
+
+    xcb_create_gc(c, gc, drawable,
+                  XCB_GC_FUNCTION | XCB_GC_FOREGROUND | XCB_GC_FILL_RULE,
+                  values);
+    return gc;
+}
+
+/* a hexagon, convex */
+static int
+make_hexagon(xcb_point_t *points, int x, int y, int size)
+{
+    static const int hx[] = { 2, 6, 8, 6, 2, 0 };
+    static const int hy[] = { 0, 0, 4, 8, 8, 4 };
+    int i;
+
+    for (i = 0; i < 6; i++) {
+        points[i].x = x + hx[i] * size / 8;
+        points[i].y = y + hy[i] * size / 8;
+    }
+    return 6;
+}
+
+/* a block of a street map: a rectangle with a notch, going down only once */
+static int
+make_block(xcb_point_t *points, int x, int y, int size)
+{
+    static const int bx[] = { 0, 8, 8, 5, 5, 8, 8, 0 };
+    static const int by[] = { 0, 0, 3, 3, 5, 5, 8, 8 };
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        points[i].x = x + bx[i] * size / 8;
+        points[i].y = y + by[i] * size / 8;
+    }
+    return 8;
+}
+
+/* a coastline: the top goes up and down along the way */
+static int
+make_coast(xcb_point_t *points, int x, int y, int size)
+{
+    int n = 0;
+    int i;
+
+    for (i = 0; i <= 16; i++) {
+        points[n].x = x + i * size / 16;
+        points[n++].y = y + (i & 1 ? size / 4 : 0) + (i * 7) % 5;
+    }
+    points[n].x = x + size;
+    points[n++].y = y + size;
+    points[n].x = x;
+    points[n++].y = y + size;
+    return n;
+}
+
+/* a star, crossing itself */
+static int
+make_star(xcb_point_t *points, int x, int y, int size)
+{
+    static const int sx[] = { 4, 6, 0, 8, 2 };
+    static const int sy[] = { 0, 8, 3, 3, 8 };
+    int i;
+
+    for (i = 0; i < 5; i++) {
+        points[i].x = x + sx[i] * size / 8;
+        points[i].y = y + sy[i] * size / 8;
+    }
+    return 5;
+}
+
+typedef int (*make_poly_proc)(xcb_point_t *points, int x, int y, int size);
+
+static void
+polys(xcb_connection_t *c, xcb_drawable_t d, int iterations,
+      const char *what, make_poly_proc make_poly, uint8_t shape, int size)
+{
+    xcb_gcontext_t gc = create_gc(c, d, XCB_GX_COPY, XCB_FILL_RULE_EVEN_ODD);
+    xcb_point_t points[MAX_POINTS];
+    double start = now();
+    int i, n;
+
+    for (i = 0; i < iterations; i++) {
+        n = make_poly(points, (i * 37) % (WIN_SIZE - size),
+                      (i * 23) % (WIN_SIZE - size), size);
+        xcb_fill_poly(c, d, gc, shape, XCB_COORD_MODE_ORIGIN, n, points);
+    }
+    sync_server(c);
+    printf("%-16s %8.3f us per polygon\n", what,
+           (now() - start) / iterations * 1e6);
+    xcb_free_gc(c, gc);
+}
+
+static xcb_pixmap_t
+create_pixmap(xcb_connection_t *c, xcb_screen_t *screen)
+{
+    xcb_pixmap_t pixmap = xcb_generate_id(c);
+    xcb_gcontext_t gc = create_gc(c, screen->root, XCB_GX_CLEAR, 0);
+    xcb_rectangle_t rect = { 0, 0, CHECK_SIZE, CHECK_SIZE };
+
+    xcb_create_pixmap(c, screen->root_depth, pixmap, screen->root,
+                      CHECK_SIZE, CHECK_SIZE);
+    xcb_poly_fill_rectangle(c, pixmap, gc, 1, &rect);
+    xcb_free_gc(c, gc);
+    return pixmap;
+}
+
+static int
+compare(xcb_connection_t *c, const char *what, xcb_pixmap_t a, xcb_pixmap_t b)
+{
+    xcb_get_image_reply_t *ia, *ib;
+    int failed;
+
+    ia = xcb_get_image_reply(c, xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                              a, 0, 0, CHECK_SIZE, CHECK_SIZE,
+                                              ~0), NULL);
+    ib = xcb_get_image_reply(c, xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                              b, 0, 0, CHECK_SIZE, CHECK_SIZE,
+                                              ~0), NULL);
+    assert(ia && ib);
+    failed = xcb_get_image_data_length(ia) != xcb_get_image_data_length(ib) ||
+        memcmp(xcb_get_image_data(ia), xcb_get_image_data(ib),
+               xcb_get_image_data_length(ia));
+    if (failed)
+        printf("%s: images differ\n", what);
+    free(ia);
+    free(ib);
+    return failed;
+}
+
+/*
+ * A polygon which goes down and up only once may be filled without an edge
+ * table.  Compare it to the same polygon with a triangle hanging off its
+ * top vertex outside of the pixmap, joined by horizontal edges that fill
+ * nothing, which has to go through the edge table.
+ */
+static int
+check_poly(xcb_connection_t *c, xcb_screen_t *screen, const char *what,
+           make_poly_proc make_poly, uint32_t fill_rule)
+{
+    xcb_pixmap_t fast = create_pixmap(c, screen);
+    xcb_pixmap_t slow = create_pixmap(c, screen);
+    xcb_gcontext_t fast_gc = create_gc(c, fast, XCB_GX_XOR, fill_rule);
+    xcb_gcontext_t slow_gc = create_gc(c, slow, XCB_GX_XOR, fill_rule);
+    xcb_point_t points[MAX_POINTS];
+    int failed = 0;
+    int i, n, top;
+
+    for (i = 0; i < 40; i++) {
+        int x = (i * 37) % (CHECK_SIZE - 40);
+        int y = (i * 23) % (CHECK_SIZE - 40);
+
+        n = make_poly(points, x, y, 20 + i % 20);
+        xcb_fill_poly(c, fast, fast_gc, XCB_POLY_SHAPE_COMPLEX,
+                      XCB_COORD_MODE_ORIGIN, n, points);
+
+        for (top = 0; top < n && points[top].y != y; top++)
+            ;
+        assert(top < n);
+        memmove(&points[top + 5], &points[top + 1],
+                (n - top - 1) * sizeof(xcb_point_t));
+        points[top + 1] = (xcb_point_t) { CHECK_SIZE + 10, y };
+        points[top + 2] = (xcb_point_t) { CHECK_SIZE + 20, y + 10 };
+        points[top + 3] = (xcb_point_t) { CHECK_SIZE + 30, y };
+        points[top + 4] = points[top];
+        xcb_fill_poly(c, slow, slow_gc, XCB_POLY_SHAPE_COMPLEX,
+                      XCB_COORD_MODE_ORIGIN, n + 4, points);
+    }
+    failed = compare(c, what, fast, slow);
+
+    xcb_free_gc(c, fast_gc);
+    xcb_free_gc(c, slow_gc);
+    xcb_free_pixmap(c, fast);
+    xcb_free_pixmap(c, slow);
+    return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 20000;
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen;
+    xcb_pixmap_t pixmap;
+    int ret;
+
+    assert(!xcb_connection_has_error(c));
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+
+    pixmap = xcb_generate_id(c);
+    xcb_create_pixmap(c, screen->root_depth, pixmap, screen->root,
+                      WIN_SIZE, WIN_SIZE);
+    sync_server(c);
+
+    if (iterations > 0) {
+        printf("%d iterations\n", iterations);
+        polys(c, pixmap, iterations, "poly10 convex", make_hexagon,
+              XCB_POLY_SHAPE_CONVEX, 10);
+        polys(c, pixmap, iterations, "poly10", make_hexagon,
+              XCB_POLY_SHAPE_COMPLEX, 10);
+        polys(c, pixmap, iterations, "poly100", make_hexagon,
+              XCB_POLY_SHAPE_COMPLEX, 100);
+        polys(c, pixmap, iterations, "block100", make_block,
+              XCB_POLY_SHAPE_NONCONVEX, 100);
+        polys(c, pixmap, iterations, "coast100", make_coast,
+              XCB_POLY_SHAPE_COMPLEX, 100);
+        polys(c, pixmap, iterations, "complex10", make_star,
+              XCB_POLY_SHAPE_COMPLEX, 10);
+        polys(c, pixmap, iterations, "complex100", make_star,
+              XCB_POLY_SHAPE_COMPLEX, 100);
+    }
+
+    ret = check_poly(c, screen, "hexagon", make_hexagon,
+                     XCB_FILL_RULE_EVEN_ODD);
+    ret |= check_poly(c, screen, "block", make_block,
+                      XCB_FILL_RULE_EVEN_ODD);
+    ret |= check_poly(c, screen, "block winding", make_block,
+                      XCB_FILL_RULE_WINDING);
+
+    xcb_free_pixmap(c, pixmap);
+    xcb_disconnect(c);
+    return ret;
+}
@@ -0,0 +1,262 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Move the software cursor of Xvfb around a patterned root window, in
+ * small steps which overlap the old position and in jumps which do not,
+ * and draw under it, and check the framebuffer Xvfb writes to -fbdir
+ * after each step: the cursor where the pointer is, and the pattern,
+ * not a leftover of the cursor, everywhere else.
+ *
+ *   mi-sw-cursor <fbdir>
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <xcb/xcb.h>
+#include <X11/XWDFile.h>
+
+#define CURSOR_SIZE     16
+#define CURSOR_PIXEL    0xff0000
+#define PATTERN_A       0x336699
+#define PATTERN_B       0x996633
+#define FILL_PIXEL      0x00ff00
+
+static const uint8_t *fb;
+static int fb_width, fb_height, fb_stride;
+static int cursor_x, cursor_y;
+static xcb_rectangle_t filled;
+
+static void
+map_framebuffer(const char *dir)
+{
+    const XWDFileHeader *header;
+    char path[4096];
+    struct stat st;
+    void *map;
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/Xvfb_screen0", dir);
+    fd = open(path, O_RDONLY);
+    assert(fd >= 0);
+    assert(fstat(fd, &st) == 0);
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    assert(map != MAP_FAILED);
+    close(fd);
+
+    /* the header is most significant byte first */
+    header = map;
+    assert(ntohl(header->bits_per_pixel) == 32);
+    fb_width = ntohl(header->pixmap_width);
+    fb_height = ntohl(header->pixmap_height);
+    fb_stride = ntohl(header->bytes_per_line);
+    fb = (const uint8_t *) map + ntohl(header->header_size) +
+        ntohl(header->ncolors) * sizeof(XWDColor);
+}
+
+static uint32_t
+pattern(int x, int y)
+{
+    return (x / 3 + y / 5) & 1 ? PATTERN_B : PATTERN_A;
+}
+
+static uint32_t
+expected(int x, int y)
+{
+    if (x >= cursor_x && x < cursor_x + CURSOR_SIZE &&
+        y >= cursor_y && y < cursor_y + CURSOR_SIZE)
+        return CURSOR_PIXEL;
+    if (x >= filled.x && x < filled.x + filled.width &&
+        y >= filled.y && y < filled.y + filled.height)
+        return FILL_PIXEL;
+    return pattern(x, y);
+}
+
+/* the first pixel which is off, or -1 */
+static int
+check_framebuffer(void)
+{
+    int x, y;
+
+    for (y = 0; y < fb_height; y++) {
+        const uint32_t *line = (const uint32_t *) (fb + y * fb_stride);
+
+        for (x = 0; x < fb_width; x++)
+            if ((line[x] & 0xffffff) != expected(x, y))
+                return y * fb_width + x;
+    }
+    return -1;
+}
+
+/* the cursor is updated when the server goes idle */
+static int
+wait_for_framebuffer(xcb_connection_t *c, const char *what)
+{
+    int tries, bad = -1;
+
+    free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL));
+    for (tries = 0; tries < 200; tries++) {
+        bad = check_framebuffer();
+        if (bad < 0)
+            return 0;
+        usleep(10000);
+    }
+    printf("%s: pixel %d,%d is 0x%06x, expected 0x%06x\n", what,
+           bad % fb_width, bad / fb_width,
+           *(const uint32_t *) (fb + (bad / fb_width) * fb_stride +
+                                (bad % fb_width) * 4) & 0xffffff,
+           expected(bad % fb_width, bad / fb_width));
+    return 1;
+}
+
+static void
+warp(xcb_connection_t *c, xcb_window_t root, int x, int y)
+{
+    xcb_warp_pointer(c, XCB_NONE, root, 0, 0, 0, 0, x, y);
+    cursor_x = x;
+    cursor_y = y;
+}
+
+static void
+paint_pattern(xcb_connection_t *c, xcb_screen_t *screen)
+{
+    xcb_gcontext_t gc = xcb_generate_id(c);
+    uint32_t values[] = { XCB_GX_COPY, PATTERN_A };
+    xcb_rectangle_t rect = { 0, 0, fb_width, fb_height };
+    int i;
+
+    xcb_create_gc(c, gc, screen->root,
+                  XCB_GC_FUNCTION | XCB_GC_FOREGROUND, values);
+    xcb_poly_fill_rectangle(c, screen->root, gc, 1, &rect);
+
+    /* stripes across, xor stripes down */
+    values[0] = XCB_GX_XOR;
+    values[1] = PATTERN_A ^ PATTERN_B;
+    xcb_change_gc(c, gc, XCB_GC_FUNCTION | XCB_GC_FOREGROUND, values);
+    for (i = 3; i < fb_width; i += 6) {
+        rect = (xcb_rectangle_t) { i, 0, 3, fb_height };
+        xcb_poly_fill_rectangle(c, screen->root, gc, 1, &rect);
+    }
+    for (i = 5; i < fb_height; i += 10) {
+        rect = (xcb_rectangle_t) { 0, i, fb_width, 5 };
+        xcb_poly_fill_rectangle(c, screen->root, gc, 1, &rect);
+    }
+    xcb_free_gc(c, gc);
+}
+
+static void
+define_cursor(xcb_connection_t *c, xcb_screen_t *screen)
+{
+    xcb_pixmap_t bits = xcb_generate_id(c);
+    xcb_gcontext_t gc = xcb_generate_id(c);
+    xcb_cursor_t cursor = xcb_generate_id(c);
+    uint32_t one = 1;
+    xcb_rectangle_t rect = { 0, 0, CURSOR_SIZE, CURSOR_SIZE };
+
+    xcb_create_pixmap(c, 1, bits, screen->root, CURSOR_SIZE, CURSOR_SIZE);
+    xcb_create_gc(c, gc, bits, XCB_GC_FOREGROUND, &one);
+    xcb_poly_fill_rectangle(c, bits, gc, 1, &rect);
+    xcb_create_cursor(c, cursor, bits, bits, 0xffff, 0, 0, 0, 0, 0, 0, 0);
+    xcb_change_window_attributes(c, screen->root, XCB_CW_CURSOR, &cursor);
+    xcb_free_cursor(c, cursor);
+    xcb_free_gc(c, gc);
+    xcb_free_pixmap(c, bits);
+}
+
+/* drawing under the cursor shows on screen, but not the cursor in GetImage */
+static int
+fill_under_cursor(xcb_connection_t *c, xcb_screen_t *screen)
+{
+    xcb_gcontext_t gc = xcb_generate_id(c);
+    uint32_t pixel = FILL_PIXEL;
+    xcb_get_image_reply_t *image;
+    uint32_t *data;
+    int i, failed = 0;
+
+    filled = (xcb_rectangle_t) { cursor_x - 4, cursor_y - 4,
+                                 CURSOR_SIZE + 8, CURSOR_SIZE + 8 };
+    xcb_create_gc(c, gc, screen->root, XCB_GC_FOREGROUND, &pixel);
+    xcb_poly_fill_rectangle(c, screen->root, gc, 1, &filled);
+    xcb_free_gc(c, gc);
+
+    image = xcb_get_image_reply(c,
+                                xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                              screen->root,
+                                              filled.x, filled.y,
+                                              filled.width, filled.height,
+                                              ~0),
+                                NULL);
+    assert(image);
+    data = (uint32_t *) xcb_get_image_data(image);
+    for (i = 0; i < filled.width * filled.height; i++) {
+        if ((data[i] & 0xffffff) != FILL_PIXEL) {
+            printf("fill: GetImage pixel %d is 0x%06x\n", i,
+                   data[i] & 0xffffff);
+            failed = 1;
+            break;
+        }
+    }
+    free(image);
+    return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen;
+    int ret = 0;
+    int i;
+
+    assert(argc == 2);
+    assert(!xcb_connection_has_error(c));
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    assert(screen->root_depth == 24);
+
+    map_framebuffer(argv[1]);
+    assert(fb_width == screen->width_in_pixels);
+    assert(fb_height == screen->height_in_pixels);
+
+    define_cursor(c, screen);
+    warp(c, screen->root, 100, 100);
+    paint_pattern(c, screen);
+    ret |= wait_for_framebuffer(c, "first");
+
+    /* overlapping steps, in each direction */
+    warp(c, screen->root, 104, 103);
+    ret |= wait_for_framebuffer(c, "down right");
+    warp(c, screen->root, 99, 101);
+    ret |= wait_for_framebuffer(c, "left");
+    warp(c, screen->root, 101, 90);
+    ret |= wait_for_framebuffer(c, "up");
+
+    /* a jump */
+    warp(c, screen->root, 300, 200);
+    ret |= wait_for_framebuffer(c, "jump");
+
+    /* lots of motion in one go, ending up close to where it started */
+    for (i = 0; i < 50; i++)
+        warp(c, screen->root, 300 + i % 7, 200 + i % 5);
+    ret |= wait_for_framebuffer(c, "many steps");
+
+    ret |= fill_under_cursor(c, screen);
+    ret |= wait_for_framebuffer(c, "fill");
+    warp(c, screen->root, cursor_x + 5, cursor_y + 5);
+    ret |= wait_for_framebuffer(c, "step off the fill");
+
+    /* right up to the edge of the screen, where the save area is cut */
+    warp(c, screen->root, fb_width - 10, fb_height - 10);
+    ret |= wait_for_framebuffer(c, "edge jump");
+    warp(c, screen->root, fb_width - 6, fb_height - 12);
+    ret |= wait_for_framebuffer(c, "edge step");
+
+    xcb_disconnect(c);
+    return ret;
+}
@@ -0,0 +1,301 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Draw wide lines and arcs the way plotting and CAD programs do, in the
+ * spirit of x11perf -wline10, -wcirc10 and -wellipse100, and report the
+ * time per object.  Afterwards, check that a self-crossing wide line in
+ * GXxor touches every pixel once, that a PolyArc of overlapping circles
+ * draws the same as one request per circle, and that wide arcs of a size
+ * the server has drawn before come out as they did the first time.
+ *
+ *   mi-wide-bench [iterations]
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <xcb/xcb.h>
+
+#define WIN_SIZE        600
+#define CHECK_SIZE      256
+#define PER_REQUEST     100
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+sync_server(xcb_connection_t *c)
+{
+    free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL));
+}
+
+static xcb_gcontext_t
+create_gc(xcb_connection_t *c, xcb_drawable_t drawable, uint32_t function,
+          uint32_t line_width)
+{
+    xcb_gcontext_t gc = xcb_generate_id(c);
+    uint32_t values[] = { function, 0xffffffff, line_width,
+                          XCB_CAP_STYLE_ROUND, XCB_JOIN_STYLE_ROUND };
+
+    xcb_create_gc(c, gc, drawable,
+                  XCB_GC_FUNCTION | XCB_GC_FOREGROUND | XCB_GC_LINE_WIDTH |
+                  XCB_GC_CAP_STYLE | XCB_GC_JOIN_STYLE, values);
+    return gc;
+}
+
+/* a plot: a zigzag of PER_REQUEST + 1 points */
+static void
+make_line(xcb_point_t *points, int i, int size)
+{
+    int j;
+
+    for (j = 0; j <= PER_REQUEST; j++) {
+        points[j].x = (j * 5 + i) % (size - 20) + 10;
+        points[j].y = (j & 1 ? size / 4 : 3 * size / 4) + (i * 3) % 20;
+    }
+}
+
+static void
+make_arcs(xcb_arc_t *arcs, int i, int size, int diameter, int angle)
+{
+    int j;
+
+    for (j = 0; j < PER_REQUEST; j++) {
+        arcs[j].x = (j * 37 + i * 7) % (size - diameter);
+        arcs[j].y = (j * 23 + i * 13) % (size - diameter);
+        arcs[j].width = diameter;
+        arcs[j].height = diameter / (1 + (angle < 360 * 64));
+        arcs[j].angle1 = 0;
+        arcs[j].angle2 = angle;
+    }
+}
+
+static void
+lines(xcb_connection_t *c, xcb_drawable_t d, int iterations,
+      const char *what, uint32_t function, uint32_t width)
+{
+    xcb_gcontext_t gc = create_gc(c, d, function, width);
+    xcb_point_t points[PER_REQUEST + 1];
+    double start = now();
+    int i;
+
+    for (i = 0; i < iterations; i++) {
+        make_line(points, i, WIN_SIZE);
+        xcb_poly_line(c, XCB_COORD_MODE_ORIGIN, d, gc, PER_REQUEST + 1,
+                      points);
+    }
+    sync_server(c);
+    printf("%-16s %8.3f us per line\n", what,
+           (now() - start) / ((double) iterations * PER_REQUEST) * 1e6);
+    xcb_free_gc(c, gc);
+}
+
+static void
+arcs(xcb_connection_t *c, xcb_drawable_t d, int iterations,
+     const char *what, uint32_t function, uint32_t width, int diameter,
+     int angle)
+{
+    xcb_gcontext_t gc = create_gc(c, d, function, width);
+    xcb_arc_t arc[PER_REQUEST];
+    double start = now();
+    int i;
+
+    for (i = 0; i < iterations; i++) {
+        make_arcs(arc, i, WIN_SIZE, diameter, angle);
+        xcb_poly_arc(c, d, gc, PER_REQUEST, arc);
+    }
+    sync_server(c);
+    printf("%-16s %8.3f us per arc\n", what,
+           (now() - start) / ((double) iterations * PER_REQUEST) * 1e6);
+    xcb_free_gc(c, gc);
+}
+
+static xcb_pixmap_t
+create_pixmap(xcb_connection_t *c, xcb_screen_t *screen)
+{
+    xcb_pixmap_t pixmap = xcb_generate_id(c);
+    xcb_gcontext_t gc = create_gc(c, screen->root, XCB_GX_CLEAR, 0);
+    xcb_rectangle_t rect = { 0, 0, CHECK_SIZE, CHECK_SIZE };
+
+    xcb_create_pixmap(c, screen->root_depth, pixmap, screen->root,
+                      CHECK_SIZE, CHECK_SIZE);
+    xcb_poly_fill_rectangle(c, pixmap, gc, 1, &rect);
+    xcb_free_gc(c, gc);
+    return pixmap;
+}
+
+static int
+compare(xcb_connection_t *c, const char *what, xcb_pixmap_t a, xcb_pixmap_t b)
+{
+    xcb_get_image_reply_t *ia, *ib;
+    int failed;
+
+    ia = xcb_get_image_reply(c, xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                              a, 0, 0, CHECK_SIZE, CHECK_SIZE,
+                                              ~0), NULL);
+    ib = xcb_get_image_reply(c, xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                              b, 0, 0, CHECK_SIZE, CHECK_SIZE,
+                                              ~0), NULL);
+    assert(ia && ib);
+    failed = xcb_get_image_data_length(ia) != xcb_get_image_data_length(ib) ||
+        memcmp(xcb_get_image_data(ia), xcb_get_image_data(ib),
+               xcb_get_image_data_length(ia));
+    if (failed)
+        printf("%s: images differ\n", what);
+    free(ia);
+    free(ib);
+    return failed;
+}
+
+/* A wide line never touches a pixel twice, even where it crosses itself */
+static int
+check_line(xcb_connection_t *c, xcb_screen_t *screen)
+{
+    xcb_pixmap_t copy = create_pixmap(c, screen);
+    xcb_pixmap_t xor = create_pixmap(c, screen);
+    xcb_gcontext_t copy_gc = create_gc(c, copy, XCB_GX_COPY, 9);
+    xcb_gcontext_t xor_gc = create_gc(c, xor, XCB_GX_XOR, 9);
+    xcb_point_t points[PER_REQUEST + 1];
+    int failed;
+
+    make_line(points, 1, CHECK_SIZE);
+    xcb_poly_line(c, XCB_COORD_MODE_ORIGIN, copy, copy_gc, PER_REQUEST + 1,
+                  points);
+    xcb_poly_line(c, XCB_COORD_MODE_ORIGIN, xor, xor_gc, PER_REQUEST + 1,
+                  points);
+    failed = compare(c, "line", copy, xor);
+
+    xcb_free_gc(c, copy_gc);
+    xcb_free_gc(c, xor_gc);
+    xcb_free_pixmap(c, copy);
+    xcb_free_pixmap(c, xor);
+    return failed;
+}
+
+/* Arcs of one PolyArc may overlap each other like separate requests do */
+static int
+check_arcs(xcb_connection_t *c, xcb_screen_t *screen)
+{
+    xcb_pixmap_t one = create_pixmap(c, screen);
+    xcb_pixmap_t each = create_pixmap(c, screen);
+    xcb_gcontext_t one_gc = create_gc(c, one, XCB_GX_XOR, 5);
+    xcb_gcontext_t each_gc = create_gc(c, each, XCB_GX_XOR, 5);
+    xcb_arc_t arc[PER_REQUEST];
+    int failed;
+    int i;
+
+    make_arcs(arc, 1, CHECK_SIZE, 40, 360 * 64);
+    xcb_poly_arc(c, one, one_gc, PER_REQUEST, arc);
+    for (i = 0; i < PER_REQUEST; i++)
+        xcb_poly_arc(c, each, each_gc, 1, &arc[i]);
+    failed = compare(c, "arcs", one, each);
+
+    xcb_free_gc(c, one_gc);
+    xcb_free_gc(c, each_gc);
+    xcb_free_pixmap(c, one);
+    xcb_free_pixmap(c, each);
+    return failed;
+}
+
+/*
+ * Wide arcs of count sizes, starting at the first, from a few start angles
+ * or full circle, into a fresh pixmap.  The sizes do not repeat within
+ * a few thousand, and the benchmarks use none of them.
+ */
+static xcb_pixmap_t
+draw_sized_arcs(xcb_connection_t *c, xcb_screen_t *screen, int first,
+                int count, int full)
+{
+    xcb_pixmap_t pixmap = create_pixmap(c, screen);
+    xcb_gcontext_t gc = create_gc(c, pixmap, XCB_GX_COPY, 7);
+    int i;
+
+    for (i = first; i < first + count; i++) {
+        xcb_arc_t arc = {
+            (i * 37) % (CHECK_SIZE - 140), (i * 23) % (CHECK_SIZE - 80),
+            13 + i % 40 * 3, 11 + i * 7 % 61,
+            full ? 0 : i * 17 * 64, full ? 360 * 64 : 200 * 64
+        };
+
+        xcb_poly_arc(c, pixmap, gc, 1, &arc);
+    }
+    xcb_free_gc(c, gc);
+    return pixmap;
+}
+
+/*
+ * Wide arc outlines are kept by size.  The first arcs of each size are
+ * worked out from scratch, later ones come from what was kept, with other
+ * angles, or worked out again after other sizes took their place.
+ */
+static int
+check_arc_cache(xcb_connection_t *c, xcb_screen_t *screen)
+{
+    xcb_pixmap_t partial = draw_sized_arcs(c, screen, 0, 40, 0);
+    xcb_pixmap_t full = draw_sized_arcs(c, screen, 40, 40, 1);
+    xcb_pixmap_t again;
+    int failed;
+
+    again = draw_sized_arcs(c, screen, 0, 40, 0);
+    failed = compare(c, "cached partial arcs", partial, again);
+    xcb_free_pixmap(c, again);
+
+    again = draw_sized_arcs(c, screen, 40, 40, 1);
+    failed |= compare(c, "cached full arcs", full, again);
+    xcb_free_pixmap(c, again);
+
+    /* push them out with plenty of other sizes */
+    xcb_free_pixmap(c, draw_sized_arcs(c, screen, 80, 600, 1));
+    again = draw_sized_arcs(c, screen, 0, 40, 0);
+    failed |= compare(c, "evicted partial arcs", partial, again);
+    xcb_free_pixmap(c, again);
+
+    xcb_free_pixmap(c, partial);
+    xcb_free_pixmap(c, full);
+    return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 200;
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen;
+    xcb_pixmap_t pixmap;
+    int ret;
+
+    assert(!xcb_connection_has_error(c));
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+
+    pixmap = xcb_generate_id(c);
+    xcb_create_pixmap(c, screen->root_depth, pixmap, screen->root,
+                      WIN_SIZE, WIN_SIZE);
+    sync_server(c);
+
+    printf("%d iterations of %d objects\n", iterations, PER_REQUEST);
+    lines(c, pixmap, iterations, "wline10", XCB_GX_COPY, 10);
+    lines(c, pixmap, iterations, "wline10 xor", XCB_GX_XOR, 10);
+    arcs(c, pixmap, iterations, "wcirc10", XCB_GX_COPY, 3, 10, 360 * 64);
+    arcs(c, pixmap, iterations, "wcirc100", XCB_GX_COPY, 3, 100, 360 * 64);
+    arcs(c, pixmap, iterations, "wellipse100 arc", XCB_GX_COPY, 5, 100,
+         270 * 64);
+    arcs(c, pixmap, iterations, "wellipse100 xor", XCB_GX_XOR, 3, 100, 180 * 64);
+
+    ret = check_line(c, screen);
+    ret |= check_arcs(c, screen);
+    ret |= check_arc_cache(c, screen);
+
+    xcb_free_pixmap(c, pixmap);
+    xcb_disconnect(c);
+    return ret;
+}
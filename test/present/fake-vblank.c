@@ -0,0 +1,120 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Wait for a handful of MSCs, out of order, on every screen of a server
+ * without a real display, and check that each one completes no earlier
+ * than asked, in MSC order, at the rate -fakescreenfps gave that screen.
+ *
+ *   present-fake-vblank <fps of screen 0> [<fps of screen 1> ...]
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <xcb/xcb.h>
+#include <xcb/present.h>
+
+static const int targets[] = { 6, 2, 9, 2, 4 };
+
+#define NTARGETS        (int) (sizeof(targets) / sizeof(targets[0]))
+
+static xcb_present_complete_notify_event_t *
+wait_complete(xcb_connection_t *c, xcb_special_event_t *special)
+{
+    xcb_generic_event_t *ev = xcb_wait_for_special_event(c, special);
+
+    assert(ev);
+    assert(((xcb_ge_generic_event_t *) ev)->event_type ==
+           XCB_PRESENT_EVENT_COMPLETE_NOTIFY);
+    return (xcb_present_complete_notify_event_t *) ev;
+}
+
+static int
+check_screen(xcb_connection_t *c, xcb_screen_t *screen, int n, int fps)
+{
+    xcb_window_t w = xcb_generate_id(c);
+    uint32_t eid = xcb_generate_id(c);
+    xcb_special_event_t *special;
+    xcb_present_complete_notify_event_t *ev;
+    uint64_t ust0, msc0, last_msc, interval;
+    int i, failed = 0;
+
+    xcb_create_window(c, XCB_COPY_FROM_PARENT, w, screen->root,
+                      0, 0, 16, 16, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                      screen->root_visual, 0, NULL);
+    xcb_map_window(c, w);
+    special = xcb_register_for_special_xge(c, &xcb_present_id, eid, NULL);
+    xcb_present_select_input(c, eid, w,
+                             XCB_PRESENT_EVENT_MASK_COMPLETE_NOTIFY);
+
+    /* a target in the past completes right away, with the current MSC */
+    xcb_present_notify_msc(c, w, 0, 0, 0, 0);
+    xcb_flush(c);
+    ev = wait_complete(c, special);
+    ust0 = ev->ust;
+    msc0 = ev->msc;
+    free(ev);
+
+    for (i = 0; i < NTARGETS; i++)
+        xcb_present_notify_msc(c, w, i + 1, msc0 + targets[i], 0, 0);
+    xcb_flush(c);
+
+    last_msc = msc0;
+    for (i = 0; i < NTARGETS; i++) {
+        int target;
+
+        ev = wait_complete(c, special);
+        assert(ev->kind == XCB_PRESENT_COMPLETE_KIND_NOTIFY_MSC);
+        assert(ev->serial >= 1 && ev->serial <= NTARGETS);
+        target = targets[ev->serial - 1];
+        if (ev->msc < msc0 + target || ev->msc < last_msc) {
+            printf("screen %d: MSC %d came at %d, after %d\n", n, target,
+                   (int) (ev->msc - msc0), (int) (last_msc - msc0));
+            failed = 1;
+        }
+        last_msc = ev->msc;
+        if (i == NTARGETS - 1 && last_msc > msc0) {
+            interval = (ev->ust - ust0) / (last_msc - msc0);
+            if (interval < 800000 / fps || interval > 1200000 / fps) {
+                printf("screen %d: %d us per frame at %d fps\n", n,
+                       (int) interval, fps);
+                failed = 1;
+            }
+        }
+        free(ev);
+    }
+
+    xcb_unregister_for_special_event(c, special);
+    xcb_destroy_window(c, w);
+    return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_iterator_t it;
+    int n, ret = 0;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <fps> [<fps> ...]\n", argv[0]);
+        return 1;
+    }
+    assert(!xcb_connection_has_error(c));
+    if (!xcb_get_extension_data(c, &xcb_present_id)->present) {
+        printf("no Present extension\n");
+        return 77;
+    }
+
+    it = xcb_setup_roots_iterator(xcb_get_setup(c));
+    for (n = 0; it.rem; n++, xcb_screen_next(&it)) {
+        int fps = atoi(argv[n + 1 < argc ? n + 1 : argc - 1]);
+
+        ret |= check_screen(c, it.data, n, fps);
+    }
+
+    xcb_disconnect(c);
+    return ret;
+}
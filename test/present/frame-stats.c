@@ -0,0 +1,145 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Present a few pixmaps to a window and check that the XORG-PresentStats
+ * extension accounts for them, and forgets them with the window.
+ *
+ *   present-frame-stats
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <xcb/xcb.h>
+#include <xcb/xcbext.h>
+#include <xcb/present.h>
+
+#include "present/presentstatsproto.h"
+
+#define FRAMES  5
+
+static xcb_extension_t present_stats_id = { PRESENT_STATS_NAME, 0 };
+
+static void *
+send_request(xcb_connection_t *c, int opcode, void *req, size_t len)
+{
+    const xcb_protocol_request_t xcb_req = {
+        .count = 2,
+        .ext = &present_stats_id,
+        .opcode = opcode,
+        .isvoid = 0,
+    };
+    struct iovec parts[4];
+    unsigned int seq;
+
+    parts[2].iov_base = req;
+    parts[2].iov_len = len;
+    parts[3].iov_base = NULL;
+    parts[3].iov_len = -parts[2].iov_len & 3;
+    seq = xcb_send_request(c, XCB_REQUEST_CHECKED, parts + 2, &xcb_req);
+
+    return xcb_wait_for_reply(c, seq, NULL);
+}
+
+static xPresentStatsQueryFrameStatsReply *
+query_frame_stats(xcb_connection_t *c, uint32_t target)
+{
+    xPresentStatsQueryFrameStatsReq req = { .target = target };
+
+    return send_request(c, X_PresentStatsQueryFrameStats, &req, sizeof(req));
+}
+
+int
+main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen;
+    xcb_window_t w;
+    xcb_pixmap_t pixmap;
+    xPresentStatsQueryVersionReq version_req = {
+        .majorVersion = PRESENT_STATS_MAJOR,
+        .minorVersion = PRESENT_STATS_MINOR,
+    };
+    xPresentStatsQueryVersionReply *version;
+    xPresentStatsQueryFrameStatsReply *stats;
+    xPresentFrameSample *samples;
+    int i, tries;
+
+    assert(!xcb_connection_has_error(c));
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+
+    if (!xcb_get_extension_data(c, &xcb_present_id)->present ||
+        !xcb_get_extension_data(c, &present_stats_id)->present) {
+        printf("no Present or XORG-PresentStats extension\n");
+        return 77;
+    }
+
+    version = send_request(c, X_PresentStatsQueryVersion, &version_req,
+                           sizeof(version_req));
+    assert(version);
+    assert(version->majorVersion == PRESENT_STATS_MAJOR &&
+           version->minorVersion == PRESENT_STATS_MINOR);
+    free(version);
+
+    w = xcb_generate_id(c);
+    xcb_create_window(c, XCB_COPY_FROM_PARENT, w, screen->root,
+                      0, 0, 64, 64, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                      screen->root_visual, 0, NULL);
+    xcb_map_window(c, w);
+    pixmap = xcb_generate_id(c);
+    xcb_create_pixmap(c, screen->root_depth, pixmap, w, 64, 64);
+
+    /* a window which never presented has nothing to report */
+    stats = query_frame_stats(c, w);
+    assert(stats);
+    assert(stats->presents == 0 && stats->nSamples == 0);
+    free(stats);
+
+    for (i = 0; i < FRAMES; i++)
+        xcb_present_pixmap(c, w, pixmap, i, XCB_NONE, XCB_NONE, 0, 0,
+                           XCB_NONE, XCB_NONE, XCB_NONE,
+                           XCB_PRESENT_OPTION_COPY, 0, 0, 0, 0, NULL);
+
+    /* completions come with the (fake) vblanks */
+    for (tries = 0; tries < 200; tries++) {
+        stats = query_frame_stats(c, w);
+        assert(stats);
+        if (stats->presents == FRAMES)
+            break;
+        free(stats);
+        stats = NULL;
+        usleep(10000);
+    }
+    assert(stats);
+    assert(stats->nSamples == FRAMES);
+    assert(stats->length == (sizeof(*stats) - 32) / 4 +
+           FRAMES * sizeof(xPresentFrameSample) / 4);
+    assert(stats->copies + stats->skips == FRAMES);
+    assert(stats->flips == 0 && stats->asyncFlips == 0);
+    assert(stats->maxLatency <= stats->totalLatency);
+
+    samples = (xPresentFrameSample *) (stats + 1);
+    for (i = 0; i < FRAMES; i++) {
+        assert(samples[i].mode == XCB_PRESENT_COMPLETE_MODE_COPY ||
+               samples[i].mode == XCB_PRESENT_COMPLETE_MODE_SKIP);
+        assert(samples[i].latency <= stats->maxLatency);
+    }
+    free(stats);
+
+    /* an unknown target is an error, not an empty reply */
+    stats = query_frame_stats(c, xcb_generate_id(c));
+    assert(!stats);
+
+    /* and so is a window which went away, along with its stats */
+    xcb_destroy_window(c, w);
+    stats = query_frame_stats(c, w);
+    assert(!stats);
+
+    xcb_disconnect(c);
+    return 0;
+}
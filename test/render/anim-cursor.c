@@ -0,0 +1,200 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Show animated cursors on Xvfb and watch its software cursor in the
+ * framebuffer Xvfb writes to -fbdir: the frames have to keep taking turns
+ * at about the pace the cursor asks for, also after the pointer moved,
+ * and an animation ending in a frame with no delay has to stop there.
+ *
+ *   render-anim-cursor <fbdir>
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <xcb/xcb.h>
+#include <xcb/render.h>
+#include <X11/XWDFile.h>
+
+#define CURSOR_SIZE     16
+#define RED             0xff0000
+#define BLUE            0x0000ff
+#define DELAY           40      /* ms per frame */
+
+static const uint8_t *fb;
+static int fb_stride;
+
+static void
+map_framebuffer(const char *dir)
+{
+    const XWDFileHeader *header;
+    char path[4096];
+    struct stat st;
+    void *map;
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/Xvfb_screen0", dir);
+    fd = open(path, O_RDONLY);
+    assert(fd >= 0);
+    assert(fstat(fd, &st) == 0);
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    assert(map != MAP_FAILED);
+    close(fd);
+
+    /* the header is most significant byte first */
+    header = map;
+    assert(ntohl(header->bits_per_pixel) == 32);
+    fb_stride = ntohl(header->bytes_per_line);
+    fb = (const uint8_t *) map + ntohl(header->header_size) +
+        ntohl(header->ncolors) * sizeof(XWDColor);
+}
+
+static uint32_t
+read_fb(int x, int y)
+{
+    return *(const uint32_t *) (fb + y * fb_stride + x * 4) & 0xffffff;
+}
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static xcb_cursor_t
+solid_cursor(xcb_connection_t *c, xcb_screen_t *screen, uint32_t rgb)
+{
+    xcb_pixmap_t bits = xcb_generate_id(c);
+    xcb_gcontext_t gc = xcb_generate_id(c);
+    xcb_cursor_t cursor = xcb_generate_id(c);
+    uint32_t one = 1;
+    xcb_rectangle_t rect = { 0, 0, CURSOR_SIZE, CURSOR_SIZE };
+
+    xcb_create_pixmap(c, 1, bits, screen->root, CURSOR_SIZE, CURSOR_SIZE);
+    xcb_create_gc(c, gc, bits, XCB_GC_FOREGROUND, &one);
+    xcb_poly_fill_rectangle(c, bits, gc, 1, &rect);
+    xcb_create_cursor(c, cursor, bits, bits,
+                      (rgb >> 16) * 0x101, (rgb >> 8 & 0xff) * 0x101,
+                      (rgb & 0xff) * 0x101, 0, 0, 0, 0, 0);
+    xcb_free_gc(c, gc);
+    xcb_free_pixmap(c, bits);
+    return cursor;
+}
+
+static void
+show_anim_cursor(xcb_connection_t *c, xcb_screen_t *screen,
+                 xcb_cursor_t red, xcb_cursor_t blue, int last_delay)
+{
+    xcb_cursor_t cursor = xcb_generate_id(c);
+    xcb_render_animcursorelt_t frames[] = {
+        { red, DELAY }, { blue, last_delay }
+    };
+
+    xcb_render_create_anim_cursor(c, cursor, 2, frames);
+    xcb_change_window_attributes(c, screen->root, XCB_CW_CURSOR, &cursor);
+    xcb_free_cursor(c, cursor);
+}
+
+/*
+ * Sample the middle of the cursor for a while and count how often it
+ * changed; anything but the two frames fails straight away.
+ */
+static int
+count_frames(xcb_connection_t *c, int x, int y, double seconds,
+             int *changes, uint32_t *last)
+{
+    double end;
+    uint32_t pixel, previous = 0;
+
+    free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL));
+    usleep(2 * DELAY * 1000);
+    *changes = 0;
+    for (end = now() + seconds; now() < end; usleep(2000)) {
+        pixel = read_fb(x + CURSOR_SIZE / 2, y + CURSOR_SIZE / 2);
+        if (pixel != RED && pixel != BLUE) {
+            printf("pixel under the cursor is 0x%06x\n", pixel);
+            return 1;
+        }
+        if (previous && pixel != previous)
+            (*changes)++;
+        previous = pixel;
+    }
+    *last = previous;
+    return 0;
+}
+
+static int
+check_animating(xcb_connection_t *c, const char *what, int x, int y)
+{
+    int changes;
+    uint32_t last;
+
+    if (count_frames(c, x, y, 1.0, &changes, &last))
+        return 1;
+    /* 25 at full pace; a loaded machine may drop some, but not most */
+    if (changes < 8) {
+        printf("%s: the cursor changed %d times in a second\n", what,
+               changes);
+        return 1;
+    }
+    return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_render_query_version_reply_t *version;
+    xcb_screen_t *screen;
+    xcb_cursor_t red, blue;
+    uint32_t last;
+    int changes, ret = 0;
+
+    assert(argc == 2);
+    assert(!xcb_connection_has_error(c));
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    assert(screen->root_depth == 24);
+
+    version = xcb_render_query_version_reply(c,
+        xcb_render_query_version(c, 0, 11), NULL);
+    if (!version) {
+        printf("no Render extension\n");
+        return 77;
+    }
+    free(version);
+
+    map_framebuffer(argv[1]);
+    red = solid_cursor(c, screen, RED);
+    blue = solid_cursor(c, screen, BLUE);
+
+    xcb_warp_pointer(c, XCB_NONE, screen->root, 0, 0, 0, 0, 50, 50);
+    show_anim_cursor(c, screen, red, blue, DELAY);
+    ret |= check_animating(c, "first", 50, 50);
+
+    xcb_warp_pointer(c, XCB_NONE, screen->root, 0, 0, 0, 0, 200, 120);
+    ret |= check_animating(c, "moved", 200, 120);
+
+    /* a frame with no delay is the last one */
+    show_anim_cursor(c, screen, red, blue, 0);
+    ret |= count_frames(c, 200, 120, 0.3, &changes, &last);
+    if (changes || last != BLUE) {
+        printf("stopped: %d changes, ending at 0x%06x\n", changes, last);
+        ret = 1;
+    }
+
+    xcb_free_cursor(c, red);
+    xcb_free_cursor(c, blue);
+    xcb_disconnect(c);
+    return ret;
+}
@@ -0,0 +1,364 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Issue lots of small Render Composite requests between the same few
+ * pictures, the way toolkits draw icons, glyph runs and widget borders,
+ * and report the time per request.  Afterwards, check that a run of
+ * composites lands where it should, draws the same as single composites
+ * and keeps sequence numbers straight, then change the repeat mode of the
+ * source and the clip of a destination and check that the server noticed.
+ *
+ *   render-composite-bench [iterations]
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <xcb/xcb.h>
+#include <xcb/render.h>
+
+#define SRC_SIZE        16
+#define DST_SIZE        512
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+sync_server(xcb_connection_t *c)
+{
+    free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL));
+}
+
+static xcb_render_pictformat_t
+find_format(xcb_render_query_pict_formats_reply_t *formats, int depth,
+            int red_mask)
+{
+    xcb_render_pictforminfo_iterator_t i;
+
+    for (i = xcb_render_query_pict_formats_formats_iterator(formats);
+         i.rem; xcb_render_pictforminfo_next(&i)) {
+        if (i.data->type == XCB_RENDER_PICT_TYPE_DIRECT &&
+            i.data->depth == depth &&
+            i.data->direct.alpha_mask == 0xff &&
+            i.data->direct.red_mask == red_mask &&
+            (!red_mask || i.data->direct.red_shift == 16))
+            return i.data->id;
+    }
+    return XCB_NONE;
+}
+
+static xcb_render_picture_t
+create_picture(xcb_connection_t *c, xcb_screen_t *screen,
+               xcb_render_pictformat_t format, int depth, int size,
+               xcb_render_color_t color)
+{
+    xcb_pixmap_t pixmap = xcb_generate_id(c);
+    xcb_render_picture_t picture = xcb_generate_id(c);
+    xcb_rectangle_t rect = { 0, 0, size, size };
+
+    xcb_create_pixmap(c, depth, pixmap, screen->root, size, size);
+    xcb_render_create_picture(c, picture, pixmap, format, 0, NULL);
+    xcb_render_fill_rectangles(c, XCB_RENDER_PICT_OP_SRC, picture, color,
+                               1, &rect);
+    xcb_free_pixmap(c, pixmap);
+    return picture;
+}
+
+static void
+composite(xcb_connection_t *c, int iterations, const char *what,
+          xcb_render_picture_t src, xcb_render_picture_t mask,
+          xcb_render_picture_t dst)
+{
+    double start = now();
+    int i;
+
+    for (i = 0; i < iterations; i++)
+        xcb_render_composite(c, XCB_RENDER_PICT_OP_OVER, src, mask, dst,
+                             0, 0, 0, 0,
+                             (i * 7) % (DST_SIZE - SRC_SIZE),
+                             (i * 13) % (DST_SIZE - SRC_SIZE),
+                             SRC_SIZE, SRC_SIZE);
+    sync_server(c);
+    printf("%-10s %8.3f us per request\n", what,
+           (now() - start) / iterations * 1e6);
+}
+
+static uint32_t
+read_pixel(xcb_connection_t *c, xcb_drawable_t drawable, int x, int y)
+{
+    xcb_get_image_reply_t *image;
+    uint32_t pixel;
+
+    image = xcb_get_image_reply(c,
+                                xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                              drawable, x, y, 1, 1, ~0),
+                                NULL);
+    assert(image);
+    pixel = *(uint32_t *) xcb_get_image_data(image);
+    free(image);
+    return pixel;
+}
+
+/*
+ * The server may handle a run of identical-looking composites in one go:
+ * every rectangle of the run has to be drawn, and an error right after it
+ * has to carry the sequence number of its own request.
+ */
+static int
+check_run(xcb_connection_t *c, xcb_screen_t *screen,
+          xcb_render_pictformat_t argb, xcb_render_picture_t src)
+{
+    xcb_pixmap_t pixmap = xcb_generate_id(c);
+    xcb_render_picture_t dst = xcb_generate_id(c);
+    xcb_render_color_t clear = { 0, 0, 0, 0 };
+    xcb_rectangle_t rect = { 0, 0, DST_SIZE, 1 };
+    xcb_get_image_reply_t *image;
+    xcb_void_cookie_t cookie;
+    xcb_generic_error_t *error;
+    uint32_t *data;
+    int failed = 0;
+    int i;
+
+    xcb_create_pixmap(c, 32, pixmap, screen->root, DST_SIZE, 1);
+    xcb_render_create_picture(c, dst, pixmap, argb, 0, NULL);
+    xcb_render_fill_rectangles(c, XCB_RENDER_PICT_OP_SRC, dst, clear, 1, &rect);
+
+    for (i = 0; i < DST_SIZE; i += 2)
+        xcb_render_composite(c, XCB_RENDER_PICT_OP_SRC, src, XCB_NONE, dst,
+                             0, 0, 0, 0, i, 0, 1, 1);
+    cookie = xcb_render_free_picture_checked(c, xcb_generate_id(c));
+    error = xcb_request_check(c, cookie);
+    if (!error || error->sequence != (cookie.sequence & 0xffff)) {
+        printf("run: error for sequence %d, expected %d\n",
+               error ? error->sequence : -1, cookie.sequence & 0xffff);
+        failed = 1;
+    }
+    free(error);
+
+    image = xcb_get_image_reply(c,
+                                xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                              pixmap, 0, 0, DST_SIZE, 1, ~0),
+                                NULL);
+    assert(image);
+    data = (uint32_t *) xcb_get_image_data(image);
+    for (i = 0; i < DST_SIZE; i++) {
+        if (!data[i] != (i & 1)) {
+            printf("run: pixel %d is 0x%08x\n", i, data[i]);
+            failed = 1;
+            break;
+        }
+    }
+    free(image);
+
+    xcb_render_free_picture(c, dst);
+    xcb_free_pixmap(c, pixmap);
+    return failed;
+}
+
+/*
+ * Overlapping composites from a patterned source through a mask come out
+ * the same whether the server gets them as one run or, with a NoOperation
+ * after each, one at a time.
+ */
+static int
+check_batch(xcb_connection_t *c, xcb_screen_t *screen,
+            xcb_render_pictformat_t argb, xcb_render_picture_t mask)
+{
+    xcb_pixmap_t pixmaps[2], src_pixmap = xcb_generate_id(c);
+    xcb_render_picture_t dst[2], src = xcb_generate_id(c);
+    xcb_render_color_t gray = { 0x4000, 0x4000, 0x4000, 0xffff };
+    xcb_rectangle_t rect = { 0, 0, 4 * SRC_SIZE, 4 * SRC_SIZE };
+    xcb_get_image_reply_t *image[2];
+    xcb_gcontext_t gc = xcb_generate_id(c);
+    uint32_t pattern[SRC_SIZE * SRC_SIZE];
+    int failed;
+    int i, n;
+
+    for (i = 0; i < SRC_SIZE * SRC_SIZE; i++)
+        pattern[i] = 0x80000000 | (i * 0x010307);
+    xcb_create_pixmap(c, 32, src_pixmap, screen->root, SRC_SIZE, SRC_SIZE);
+    xcb_create_gc(c, gc, src_pixmap, 0, NULL);
+    xcb_put_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP, src_pixmap, gc,
+                  SRC_SIZE, SRC_SIZE, 0, 0, 0, 32, sizeof(pattern),
+                  (uint8_t *) pattern);
+    xcb_free_gc(c, gc);
+    xcb_render_create_picture(c, src, src_pixmap, argb, 0, NULL);
+    xcb_free_pixmap(c, src_pixmap);
+
+    for (n = 0; n < 2; n++) {
+        pixmaps[n] = xcb_generate_id(c);
+        dst[n] = xcb_generate_id(c);
+        xcb_create_pixmap(c, 32, pixmaps[n], screen->root,
+                          4 * SRC_SIZE, 4 * SRC_SIZE);
+        xcb_render_create_picture(c, dst[n], pixmaps[n], argb, 0, NULL);
+        xcb_render_fill_rectangles(c, XCB_RENDER_PICT_OP_SRC, dst[n], gray,
+                                   1, &rect);
+        sync_server(c);
+
+        for (i = 0; i < 64; i++) {
+            xcb_render_composite(c, XCB_RENDER_PICT_OP_OVER, src, mask,
+                                 dst[n], i % 8, (i * 3) % 8, i % 4, 0,
+                                 (i * 5) % (3 * SRC_SIZE),
+                                 (i * 7) % (3 * SRC_SIZE),
+                                 SRC_SIZE / 2, SRC_SIZE / 2);
+            if (n)
+                xcb_no_operation(c);
+        }
+    }
+
+    for (n = 0; n < 2; n++) {
+        image[n] = xcb_get_image_reply(c,
+            xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP, pixmaps[n], 0, 0,
+                          4 * SRC_SIZE, 4 * SRC_SIZE, ~0), NULL);
+        assert(image[n]);
+    }
+    failed = memcmp(xcb_get_image_data(image[0]), xcb_get_image_data(image[1]),
+                    xcb_get_image_data_length(image[0])) != 0;
+    if (failed)
+        printf("batch: a run and single composites differ\n");
+
+    for (n = 0; n < 2; n++) {
+        free(image[n]);
+        xcb_render_free_picture(c, dst[n]);
+        xcb_free_pixmap(c, pixmaps[n]);
+    }
+    xcb_render_free_picture(c, src);
+    return failed;
+}
+
+/* Compositing past the edge of the source only fills with repeat on */
+static int
+check_repeat(xcb_connection_t *c, xcb_screen_t *screen,
+             xcb_render_pictformat_t argb, xcb_render_picture_t src)
+{
+    xcb_pixmap_t pixmap = xcb_generate_id(c);
+    xcb_render_picture_t dst = xcb_generate_id(c);
+    xcb_render_color_t clear = { 0, 0, 0, 0 };
+    xcb_rectangle_t rect = { 0, 0, 4 * SRC_SIZE, 4 * SRC_SIZE };
+    uint32_t repeat = XCB_RENDER_REPEAT_NORMAL;
+    uint32_t before, after;
+
+    xcb_create_pixmap(c, 32, pixmap, screen->root, 4 * SRC_SIZE, 4 * SRC_SIZE);
+    xcb_render_create_picture(c, dst, pixmap, argb, 0, NULL);
+    xcb_render_fill_rectangles(c, XCB_RENDER_PICT_OP_SRC, dst, clear, 1, &rect);
+
+    xcb_render_composite(c, XCB_RENDER_PICT_OP_SRC, src, XCB_NONE, dst,
+                         0, 0, 0, 0, 0, 0, 4 * SRC_SIZE, 4 * SRC_SIZE);
+    before = read_pixel(c, pixmap, 3 * SRC_SIZE, 3 * SRC_SIZE);
+
+    xcb_render_change_picture(c, src, XCB_RENDER_CP_REPEAT, &repeat);
+    xcb_render_composite(c, XCB_RENDER_PICT_OP_SRC, src, XCB_NONE, dst,
+                         0, 0, 0, 0, 0, 0, 4 * SRC_SIZE, 4 * SRC_SIZE);
+    after = read_pixel(c, pixmap, 3 * SRC_SIZE, 3 * SRC_SIZE);
+
+    xcb_render_free_picture(c, dst);
+    xcb_free_pixmap(c, pixmap);
+
+    if (before != 0 || after == 0) {
+        printf("repeat: pixel outside the source 0x%08x before and "
+               "0x%08x after turning repeat on\n", before, after);
+        return 1;
+    }
+    return 0;
+}
+
+/* A clip set on a picture already drawn to applies to the next draw */
+static int
+check_clip(xcb_connection_t *c, xcb_screen_t *screen,
+           xcb_render_pictformat_t argb, xcb_render_picture_t src)
+{
+    xcb_pixmap_t pixmap = xcb_generate_id(c);
+    xcb_render_picture_t dst = xcb_generate_id(c);
+    xcb_render_color_t clear = { 0, 0, 0, 0 };
+    xcb_rectangle_t rect = { 0, 0, 2 * SRC_SIZE, SRC_SIZE };
+    xcb_rectangle_t left = { 0, 0, SRC_SIZE, SRC_SIZE };
+    uint32_t inside, outside;
+
+    xcb_create_pixmap(c, 32, pixmap, screen->root, 2 * SRC_SIZE, SRC_SIZE);
+    xcb_render_create_picture(c, dst, pixmap, argb, 0, NULL);
+    xcb_render_composite(c, XCB_RENDER_PICT_OP_SRC, src, XCB_NONE, dst,
+                         0, 0, 0, 0, 0, 0, SRC_SIZE, SRC_SIZE);
+    xcb_render_composite(c, XCB_RENDER_PICT_OP_SRC, src, XCB_NONE, dst,
+                         0, 0, 0, 0, SRC_SIZE, 0, SRC_SIZE, SRC_SIZE);
+
+    xcb_render_set_picture_clip_rectangles(c, dst, 0, 0, 1, &left);
+    xcb_render_fill_rectangles(c, XCB_RENDER_PICT_OP_SRC, dst, clear, 1, &rect);
+    inside = read_pixel(c, pixmap, SRC_SIZE / 2, SRC_SIZE / 2);
+    outside = read_pixel(c, pixmap, SRC_SIZE + SRC_SIZE / 2, SRC_SIZE / 2);
+
+    xcb_render_free_picture(c, dst);
+    xcb_free_pixmap(c, pixmap);
+
+    if (inside != 0 || outside == 0) {
+        printf("clip: pixel 0x%08x inside and 0x%08x outside the clip\n",
+               inside, outside);
+        return 1;
+    }
+    return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 200000;
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen;
+    xcb_render_query_version_reply_t *version;
+    xcb_render_query_pict_formats_reply_t *formats;
+    xcb_render_pictformat_t argb, a8;
+    xcb_render_picture_t src, mask, dst;
+    xcb_render_color_t red = { 0xc000, 0, 0, 0xc000 };
+    xcb_render_color_t half = { 0, 0, 0, 0x8000 };
+    xcb_render_color_t white = { 0xffff, 0xffff, 0xffff, 0xffff };
+    int ret;
+
+    assert(!xcb_connection_has_error(c));
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+
+    version = xcb_render_query_version_reply(c,
+        xcb_render_query_version(c, 0, 11), NULL);
+    if (!version) {
+        printf("no Render extension\n");
+        return 77;
+    }
+    free(version);
+
+    formats = xcb_render_query_pict_formats_reply(c,
+        xcb_render_query_pict_formats(c), NULL);
+    assert(formats);
+    argb = find_format(formats, 32, 0xff);
+    a8 = find_format(formats, 8, 0);
+    free(formats);
+    assert(argb != XCB_NONE && a8 != XCB_NONE);
+
+    src = create_picture(c, screen, argb, 32, SRC_SIZE, red);
+    mask = create_picture(c, screen, a8, 8, SRC_SIZE, half);
+    dst = create_picture(c, screen, argb, 32, DST_SIZE, white);
+    sync_server(c);
+
+    printf("%d iterations of %dx%d composites\n", iterations,
+           SRC_SIZE, SRC_SIZE);
+    composite(c, iterations, "over", src, XCB_NONE, dst);
+    composite(c, iterations, "over mask", src, mask, dst);
+
+    ret = check_run(c, screen, argb, src);
+    ret |= check_batch(c, screen, argb, mask);
+    ret |= check_repeat(c, screen, argb, src);
+    ret |= check_clip(c, screen, argb, src);
+
+    xcb_render_free_picture(c, src);
+    xcb_render_free_picture(c, mask);
+    xcb_render_free_picture(c, dst);
+    xcb_disconnect(c);
+    return ret;
+}
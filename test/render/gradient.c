@@ -0,0 +1,157 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Draw a linear gradient picture several times over, changing its
+ * transform in between and replacing it by a picture with other stops,
+ * and check that every draw shows what the picture is at that moment
+ * rather than what it was the first time it was drawn.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <xcb/xcb.h>
+#include <xcb/render.h>
+
+#define WIDTH           256
+
+static xcb_render_pictformat_t
+find_argb_format(xcb_connection_t *c)
+{
+    xcb_render_query_pict_formats_reply_t *formats;
+    xcb_render_pictforminfo_iterator_t i;
+    xcb_render_pictformat_t format = XCB_NONE;
+
+    formats = xcb_render_query_pict_formats_reply(c,
+        xcb_render_query_pict_formats(c), NULL);
+    assert(formats);
+    for (i = xcb_render_query_pict_formats_formats_iterator(formats);
+         i.rem; xcb_render_pictforminfo_next(&i)) {
+        if (i.data->type == XCB_RENDER_PICT_TYPE_DIRECT &&
+            i.data->depth == 32 &&
+            i.data->direct.alpha_mask == 0xff &&
+            i.data->direct.red_mask == 0xff &&
+            i.data->direct.red_shift == 16)
+            format = i.data->id;
+    }
+    free(formats);
+    return format;
+}
+
+/* from black at x = 0 to white at x = WIDTH, or the other way round */
+static xcb_render_picture_t
+create_gradient(xcb_connection_t *c, int reversed)
+{
+    xcb_render_picture_t gradient = xcb_generate_id(c);
+    xcb_render_pointfix_t p1 = { 0, 0 };
+    xcb_render_pointfix_t p2 = { WIDTH << 16, 0 };
+    xcb_render_fixed_t stops[] = { 0, 1 << 16 };
+    xcb_render_color_t colors[] = {
+        { 0, 0, 0, 0xffff }, { 0xffff, 0xffff, 0xffff, 0xffff }
+    };
+
+    if (reversed) {
+        xcb_render_color_t black = colors[0];
+
+        colors[0] = colors[1];
+        colors[1] = black;
+    }
+    xcb_render_create_linear_gradient(c, gradient, p1, p2, 2, stops, colors);
+    return gradient;
+}
+
+static void
+set_scale(xcb_connection_t *c, xcb_render_picture_t picture, int scale)
+{
+    xcb_render_transform_t transform = {
+        scale << 16, 0, 0,
+        0, 1 << 16, 0,
+        0, 0, 1 << 16
+    };
+
+    xcb_render_set_picture_transform(c, picture, transform);
+}
+
+/* the red channel at x, after drawing the gradient over the whole row */
+static int
+draw(xcb_connection_t *c, xcb_render_picture_t gradient,
+     xcb_render_picture_t dst, xcb_pixmap_t pixmap, int x)
+{
+    xcb_get_image_reply_t *image;
+    int red;
+
+    xcb_render_composite(c, XCB_RENDER_PICT_OP_SRC, gradient, XCB_NONE, dst,
+                         0, 0, 0, 0, 0, 0, WIDTH, 1);
+    image = xcb_get_image_reply(c,
+                                xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                              pixmap, x, 0, 1, 1, ~0),
+                                NULL);
+    assert(image);
+    red = (*(uint32_t *) xcb_get_image_data(image) >> 16) & 0xff;
+    free(image);
+    return red;
+}
+
+static int
+check(const char *what, int red, int expect)
+{
+    if (abs(red - expect) > 2) {
+        printf("%s: red is %d, expected %d\n", what, red, expect);
+        return 1;
+    }
+    return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_render_query_version_reply_t *version;
+    xcb_screen_t *screen;
+    xcb_render_pictformat_t argb;
+    xcb_render_picture_t gradient, dst;
+    xcb_pixmap_t pixmap;
+    int ret = 0;
+
+    assert(!xcb_connection_has_error(c));
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+
+    version = xcb_render_query_version_reply(c,
+        xcb_render_query_version(c, 0, 11), NULL);
+    if (!version) {
+        printf("no Render extension\n");
+        return 77;
+    }
+    free(version);
+
+    argb = find_argb_format(c);
+    assert(argb != XCB_NONE);
+    pixmap = xcb_generate_id(c);
+    dst = xcb_generate_id(c);
+    xcb_create_pixmap(c, 32, pixmap, screen->root, WIDTH, 1);
+    xcb_render_create_picture(c, dst, pixmap, argb, 0, NULL);
+
+    gradient = create_gradient(c, 0);
+    ret |= check("first draw", draw(c, gradient, dst, pixmap, 64), 64);
+    ret |= check("second draw", draw(c, gradient, dst, pixmap, 64), 64);
+
+    set_scale(c, gradient, 2);
+    ret |= check("scaled", draw(c, gradient, dst, pixmap, 64), 128);
+
+    /* an identity transform is stored as no transform at all */
+    set_scale(c, gradient, 1);
+    ret |= check("unscaled", draw(c, gradient, dst, pixmap, 64), 64);
+
+    /* the new picture may well end up where the old one was */
+    xcb_render_free_picture(c, gradient);
+    gradient = create_gradient(c, 1);
+    ret |= check("replaced", draw(c, gradient, dst, pixmap, 64), 191);
+
+    xcb_render_free_picture(c, gradient);
+    xcb_render_free_picture(c, dst);
+    xcb_free_pixmap(c, pixmap);
+    xcb_disconnect(c);
+    return ret;
+}
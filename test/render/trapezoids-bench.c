@@ -0,0 +1,269 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Draw anti-aliased discs made of trapezoids, the way clients without
+ * client-side rasterization draw SVG icons and rounded widgets, and
+ * report how many Trapezoids requests (one mask each) the server does
+ * per second.  Afterwards, check that drawing through a mask format gives
+ * the same pixels as adding the trapezoids into an alpha picture and
+ * compositing through that, for Over and for Src and In, which change
+ * the destination outside of the trapezoids as well.
+ *
+ *   render-trapezoids-bench [iterations [discs]]
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <xcb/xcb.h>
+#include <xcb/render.h>
+
+#define DST_WIDTH       1024
+#define DST_HEIGHT      768
+#define SLICES          16
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+sync_server(xcb_connection_t *c)
+{
+    free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL));
+}
+
+static xcb_render_fixed_t
+fixed(double v)
+{
+    return (xcb_render_fixed_t) (v * 65536);
+}
+
+static xcb_render_pictformat_t
+find_format(xcb_render_query_pict_formats_reply_t *formats, int depth,
+            int red_mask)
+{
+    xcb_render_pictforminfo_iterator_t i;
+
+    for (i = xcb_render_query_pict_formats_formats_iterator(formats);
+         i.rem; xcb_render_pictforminfo_next(&i)) {
+        if (i.data->type == XCB_RENDER_PICT_TYPE_DIRECT &&
+            i.data->depth == depth &&
+            i.data->direct.alpha_mask == 0xff &&
+            i.data->direct.red_mask == red_mask &&
+            (!red_mask || i.data->direct.red_shift == 16))
+            return i.data->id;
+    }
+    return XCB_NONE;
+}
+
+static xcb_render_picture_t
+create_picture(xcb_connection_t *c, xcb_screen_t *screen,
+               xcb_render_pictformat_t format, int depth,
+               int width, int height, xcb_pixmap_t *pixmap_ret)
+{
+    xcb_pixmap_t pixmap = xcb_generate_id(c);
+    xcb_render_picture_t picture = xcb_generate_id(c);
+    xcb_render_color_t clear = { 0, 0, 0, 0 };
+    xcb_rectangle_t rect = { 0, 0, width, height };
+
+    xcb_create_pixmap(c, depth, pixmap, screen->root, width, height);
+    xcb_render_create_picture(c, picture, pixmap, format, 0, NULL);
+    xcb_render_fill_rectangles(c, XCB_RENDER_PICT_OP_SRC, picture, clear,
+                               1, &rect);
+    if (pixmap_ret)
+        *pixmap_ret = pixmap;
+    else
+        xcb_free_pixmap(c, pixmap);
+    return picture;
+}
+
+/* A disc as a stack of trapezoids */
+static void
+disc(xcb_render_trapezoid_t *traps, double cx, double cy, double r)
+{
+    int i;
+
+    for (i = 0; i < SLICES; i++) {
+        double y1 = cy - r + 2 * r * i / SLICES;
+        double y2 = cy - r + 2 * r * (i + 1) / SLICES;
+        double w1 = sqrt(fmax(0, r * r - (y1 - cy) * (y1 - cy)));
+        double w2 = sqrt(fmax(0, r * r - (y2 - cy) * (y2 - cy)));
+
+        traps[i].top = fixed(y1);
+        traps[i].bottom = fixed(y2);
+        traps[i].left.p1.x = fixed(cx - w1);
+        traps[i].left.p1.y = fixed(y1);
+        traps[i].left.p2.x = fixed(cx - w2);
+        traps[i].left.p2.y = fixed(y2);
+        traps[i].right.p1.x = fixed(cx + w1);
+        traps[i].right.p1.y = fixed(y1);
+        traps[i].right.p2.x = fixed(cx + w2);
+        traps[i].right.p2.y = fixed(y2);
+    }
+}
+
+/* Discs of the given radius scattered over the destination */
+static xcb_render_trapezoid_t *
+scatter(int ndiscs, double r, int seed)
+{
+    xcb_render_trapezoid_t *traps = calloc(ndiscs * SLICES, sizeof(*traps));
+    int i;
+
+    srand(seed);
+    for (i = 0; i < ndiscs; i++)
+        disc(traps + i * SLICES,
+             r + (double) rand() / RAND_MAX * (DST_WIDTH - 2 * r),
+             r + (double) rand() / RAND_MAX * (DST_HEIGHT - 2 * r), r);
+    return traps;
+}
+
+static void
+trapezoids(xcb_connection_t *c, int iterations, const char *what,
+           xcb_render_picture_t src, xcb_render_picture_t dst,
+           xcb_render_pictformat_t mask_format,
+           int ntraps, xcb_render_trapezoid_t *traps)
+{
+    double start = now(), elapsed;
+    int i;
+
+    for (i = 0; i < iterations; i++)
+        xcb_render_trapezoids(c, XCB_RENDER_PICT_OP_OVER, src, dst,
+                              mask_format, 0, 0, ntraps, traps);
+    sync_server(c);
+    elapsed = now() - start;
+    printf("%-16s %8.0f masks per second\n", what, iterations / elapsed);
+}
+
+static int
+check_mask(xcb_connection_t *c, xcb_screen_t *screen,
+           xcb_render_pictformat_t argb, xcb_render_pictformat_t a8,
+           const char *what, uint8_t op, xcb_render_picture_t src,
+           int ntraps, xcb_render_trapezoid_t *traps)
+{
+    xcb_pixmap_t direct_pixmap, indirect_pixmap;
+    xcb_render_picture_t direct, indirect, mask, white;
+    xcb_render_color_t opaque = { 0xffff, 0xffff, 0xffff, 0xffff };
+    xcb_render_color_t gray = { 0x4000, 0x4000, 0x4000, 0xffff };
+    xcb_rectangle_t rect = { 0, 0, DST_WIDTH, DST_HEIGHT };
+    xcb_get_image_reply_t *direct_image, *indirect_image;
+    int failed;
+
+    direct = create_picture(c, screen, argb, 32, DST_WIDTH, DST_HEIGHT,
+                            &direct_pixmap);
+    indirect = create_picture(c, screen, argb, 32, DST_WIDTH, DST_HEIGHT,
+                              &indirect_pixmap);
+    mask = create_picture(c, screen, a8, 8, DST_WIDTH, DST_HEIGHT, NULL);
+    white = xcb_generate_id(c);
+    xcb_render_create_solid_fill(c, white, opaque);
+    xcb_render_fill_rectangles(c, XCB_RENDER_PICT_OP_SRC, direct, gray,
+                               1, &rect);
+    xcb_render_fill_rectangles(c, XCB_RENDER_PICT_OP_SRC, indirect, gray,
+                               1, &rect);
+
+    xcb_render_trapezoids(c, op, src, direct, a8, 0, 0, ntraps, traps);
+
+    xcb_render_trapezoids(c, XCB_RENDER_PICT_OP_ADD, white, mask, a8,
+                          0, 0, ntraps, traps);
+    xcb_render_composite(c, op, src, mask, indirect,
+                         0, 0, 0, 0, 0, 0, DST_WIDTH, DST_HEIGHT);
+
+    direct_image = xcb_get_image_reply(c,
+        xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP, direct_pixmap,
+                      0, 0, DST_WIDTH, DST_HEIGHT, ~0), NULL);
+    indirect_image = xcb_get_image_reply(c,
+        xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP, indirect_pixmap,
+                      0, 0, DST_WIDTH, DST_HEIGHT, ~0), NULL);
+    assert(direct_image && indirect_image);
+
+    failed = memcmp(xcb_get_image_data(direct_image),
+                    xcb_get_image_data(indirect_image),
+                    xcb_get_image_data_length(direct_image)) != 0;
+    if (failed)
+        printf("%s: trapezoids through a mask format differ from the "
+               "same trapezoids added into a mask\n", what);
+
+    free(direct_image);
+    free(indirect_image);
+    xcb_render_free_picture(c, direct);
+    xcb_render_free_picture(c, indirect);
+    xcb_render_free_picture(c, mask);
+    xcb_render_free_picture(c, white);
+    xcb_free_pixmap(c, direct_pixmap);
+    xcb_free_pixmap(c, indirect_pixmap);
+    return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+    int ndiscs = argc > 2 ? atoi(argv[2]) : 50;
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen;
+    xcb_render_query_version_reply_t *version;
+    xcb_render_query_pict_formats_reply_t *formats;
+    xcb_render_pictformat_t argb, a8;
+    xcb_render_picture_t src, dst;
+    xcb_render_color_t red = { 0xc000, 0, 0, 0xc000 };
+    xcb_render_trapezoid_t *icons, *one;
+    int ret;
+
+    assert(!xcb_connection_has_error(c));
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+
+    version = xcb_render_query_version_reply(c,
+        xcb_render_query_version(c, 0, 11), NULL);
+    if (!version) {
+        printf("no Render extension\n");
+        return 77;
+    }
+    free(version);
+
+    formats = xcb_render_query_pict_formats_reply(c,
+        xcb_render_query_pict_formats(c), NULL);
+    assert(formats);
+    argb = find_format(formats, 32, 0xff);
+    a8 = find_format(formats, 8, 0);
+    free(formats);
+    assert(argb != XCB_NONE && a8 != XCB_NONE);
+
+    src = xcb_generate_id(c);
+    xcb_render_create_solid_fill(c, src, red);
+    dst = create_picture(c, screen, argb, 32, DST_WIDTH, DST_HEIGHT, NULL);
+
+    icons = scatter(ndiscs, 12, 1);
+    one = scatter(1, DST_HEIGHT / 2 - 1, 2);
+    sync_server(c);
+
+    printf("%d iterations, %d discs of %d trapezoids\n", iterations, ndiscs,
+           SLICES);
+    trapezoids(c, iterations, "scattered", src, dst, a8,
+               ndiscs * SLICES, icons);
+    trapezoids(c, iterations, "scattered, none", src, dst, XCB_NONE,
+               ndiscs * SLICES, icons);
+    trapezoids(c, iterations, "large", src, dst, a8, SLICES, one);
+
+    ret = check_mask(c, screen, argb, a8, "over", XCB_RENDER_PICT_OP_OVER,
+                     src, ndiscs * SLICES, icons);
+    ret |= check_mask(c, screen, argb, a8, "src", XCB_RENDER_PICT_OP_SRC,
+                      src, ndiscs * SLICES, icons);
+    ret |= check_mask(c, screen, argb, a8, "in", XCB_RENDER_PICT_OP_IN,
+                      src, ndiscs * SLICES, icons);
+
+    free(icons);
+    free(one);
+    xcb_render_free_picture(c, src);
+    xcb_render_free_picture(c, dst);
+    xcb_disconnect(c);
+    return ret;
+}
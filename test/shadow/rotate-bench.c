@@ -0,0 +1,244 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Drive shadowUpdateRotatePacked() over synthetic damage and report the
+ * throughput of every blit kernel set the CPU supports, checking that
+ * all of them put every damaged pixel where the rotation says and leave
+ * the rest of the screen alone.  With 0 iterations, only check.
+ *
+ *   shadow-rotate-bench [width height [iterations]]
+ */
+#include <dix-config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "scrnintstr.h"
+#include "shadow.h"
+#include "shadow_priv.h"
+#include "fb.h"
+
+/*
+ * The update procs only need the damage region and the pixmap bits, so
+ * stand in for the pieces of the server they would otherwise drag in.
+ */
+RegionPtr
+DamageRegion(DamagePtr pDamage)
+{
+    return &pDamage->damage;
+}
+
+DevPrivateKey
+fbGetScreenPrivateKey(void)
+{
+    abort();
+}
+
+static CARD8 *screenBits;
+static CARD32 screenPitch;
+
+static void *
+benchWindow(ScreenPtr pScreen, CARD32 row, CARD32 offset, int mode,
+            CARD32 *size, void *closure)
+{
+    *size = screenPitch - offset;
+    return screenBits + row * screenPitch + offset;
+}
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static CARD32
+get_pixel(const CARD8 *line, int x, int bpp)
+{
+    return bpp == 16 ? ((const CARD16 *) line)[x] : ((const CARD32 *) line)[x];
+}
+
+/*
+ * Compare the screen to the shadow rotated pixel by pixel: the screen
+ * pixel at (x, y) comes from the shadow pixel at (sx, sy), or is still
+ * zero if that shadow pixel was not damaged.
+ */
+static int
+check_screen(const CARD8 *shadow, int stride, int bpp, int width, int height,
+             int randr, RegionPtr damage)
+{
+    Bool rotated = randr & (SHADOW_ROTATE_90 | SHADOW_ROTATE_270);
+    int scrWidth = rotated ? height : width;
+    int scrHeight = rotated ? width : height;
+    int x, y, sx, sy;
+
+    for (y = 0; y < scrHeight; y++) {
+        for (x = 0; x < scrWidth; x++) {
+            CARD32 expect, got;
+
+            switch (randr) {
+            case SHADOW_ROTATE_90:
+                sx = width - 1 - y;
+                sy = x;
+                break;
+            case SHADOW_ROTATE_180:
+                sx = width - 1 - x;
+                sy = height - 1 - y;
+                break;
+            case SHADOW_ROTATE_270:
+                sx = y;
+                sy = height - 1 - x;
+                break;
+            default:
+                sx = x;
+                sy = y;
+                break;
+            }
+            expect = pixman_region_contains_point(damage, sx, sy, NULL) ?
+                get_pixel(shadow + sy * stride, sx, bpp) : 0;
+            got = get_pixel(screenBits + y * screenPitch, x, bpp);
+            if (got != expect) {
+                printf("screen pixel %d,%d is %08x, expected %08x\n",
+                       x, y, (unsigned) got, (unsigned) expect);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+ * A few hundred small boxes, roughly what a busy desktop damages.  The
+ * regions are built with pixman directly, the Region wrappers want the
+ * dix globals.
+ */
+static void
+synthetic_damage(RegionPtr region, int width, int height)
+{
+    int i;
+
+    pixman_region_init(region);
+    srand(1);
+    for (i = 0; i < 256; i++) {
+        int x = rand() % width;
+        int y = rand() % height;
+        int w = 1 + rand() % 200;
+        int h = 1 + rand() % 50;
+
+        pixman_region_union_rect(region, region, x, y,
+                                 min(width - x, w), min(height - y, h));
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    static const char *kernels[] = { "c", "sse2", "avx2", "neon" };
+    static const struct {
+        const char *name;
+        int randr;
+    } rotations[] = {
+        { "0", SHADOW_ROTATE_0 },
+        { "90", SHADOW_ROTATE_90 },
+        { "180", SHADOW_ROTATE_180 },
+        { "270", SHADOW_ROTATE_270 },
+    };
+    int width = argc > 2 ? atoi(argv[1]) : 3840;
+    int height = argc > 2 ? atoi(argv[2]) : 2160;
+    int iterations = argc > 3 ? atoi(argv[3]) : 20;
+    int bpp, i;
+    size_t r, k;
+    int ret = 0;
+
+    for (bpp = 16; bpp <= 32; bpp += 16) {
+        int stride = ((width * bpp + FB_MASK) >> FB_SHIFT) * sizeof(FbBits);
+        CARD8 *shadow = malloc((size_t) stride * height);
+
+        for (i = 0; i < stride * height; i++)
+            shadow[i] = rand();
+
+        for (r = 0; r < ARRAY_SIZE(rotations); r++) {
+            Bool rotated = rotations[r].randr &
+                (SHADOW_ROTATE_90 | SHADOW_ROTATE_270);
+            int scrWidth = rotated ? height : width;
+            int scrHeight = rotated ? width : height;
+            ScreenRec screen = { 0 };
+            PixmapRec pixmap = { 0 };
+            DamageRec damage = { 0 };
+            shadowBufRec buf = { 0 };
+
+            screenPitch = scrWidth * bpp / 8;
+            screenBits = calloc(screenPitch, scrHeight);
+
+            screen.width = width;
+            screen.height = height;
+            pixmap.drawable.type = DRAWABLE_PIXMAP;
+            pixmap.drawable.width = width;
+            pixmap.drawable.height = height;
+            pixmap.drawable.bitsPerPixel = bpp;
+            pixmap.devKind = stride;
+            pixmap.devPrivate.ptr = shadow;
+            buf.pDamage = &damage;
+            buf.pPixmap = &pixmap;
+            buf.window = benchWindow;
+            buf.randr = rotations[r].randr;
+
+            for (k = 0; k < ARRAY_SIZE(kernels); k++) {
+                BoxRec all = { 0, 0, width, height };
+                double start, full, partial;
+
+                if (!shadowBlitSelect(kernels[k]))
+                    continue;
+
+                /* scattered boxes onto a blank screen */
+                memset(screenBits, 0, (size_t) screenPitch * scrHeight);
+                synthetic_damage(&damage.damage, width, height);
+                shadowUpdateRotatePacked(&screen, &buf);
+                if (check_screen(shadow, stride, bpp, width, height,
+                                 rotations[r].randr, &damage.damage)) {
+                    printf("%d bpp rotate %s: %s kernels misplace boxes\n",
+                           bpp, rotations[r].name, kernels[k]);
+                    ret = 1;
+                }
+                pixman_region_fini(&damage.damage);
+
+                /* whole screen */
+                pixman_region_init_rects(&damage.damage, &all, 1);
+                shadowUpdateRotatePacked(&screen, &buf);
+                if (check_screen(shadow, stride, bpp, width, height,
+                                 rotations[r].randr, &damage.damage)) {
+                    printf("%d bpp rotate %s: %s kernels misplace pixels\n",
+                           bpp, rotations[r].name, kernels[k]);
+                    ret = 1;
+                }
+                if (!iterations) {
+                    pixman_region_fini(&damage.damage);
+                    continue;
+                }
+                start = now();
+                for (i = 0; i < iterations; i++)
+                    shadowUpdateRotatePacked(&screen, &buf);
+                full = (now() - start) / iterations;
+                pixman_region_fini(&damage.damage);
+
+                /* scattered small boxes */
+                synthetic_damage(&damage.damage, width, height);
+                start = now();
+                for (i = 0; i < iterations; i++)
+                    shadowUpdateRotatePacked(&screen, &buf);
+                partial = (now() - start) / iterations;
+                pixman_region_fini(&damage.damage);
+
+                printf("%2d bpp rotate %-3s %-4s: full %7.3f ms (%6.0f Mpix/s)  boxes %7.3f ms\n",
+                       bpp, rotations[r].name, kernels[k], full * 1e3,
+                       (double) width * height / full / 1e6, partial * 1e3);
+            }
+            free(screenBits);
+        }
+        free(shadow);
+    }
+    return ret;
+}
@@ -0,0 +1,204 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Check that the shadow flush thread runs the update proc on a copy of
+ * the shadow pixmap, defers damage while it is busy, and still records
+ * updates it has to run synchronously.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <dix-config.h>
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "scrnintstr.h"
+#include "pixmapstr.h"
+#include "shadow.h"
+#include "shadow_priv.h"
+#include "fb.h"
+
+#define WIDTH   64
+#define HEIGHT  32
+
+/*
+ * The flush thread only needs the damage region, the pixmaps and a
+ * notify fd, so stand in for the pieces of the server it would
+ * otherwise drag in.
+ */
+DevPrivateKeyRec shadowScrPrivateKeyRec;
+RegDataRec RegionEmptyData;
+BoxRec RegionEmptyBox;
+
+RegionPtr
+DamageRegion(DamagePtr pDamage)
+{
+    return &pDamage->damage;
+}
+
+void
+DamageEmpty(DamagePtr pDamage)
+{
+    pixman_region_fini(&pDamage->damage);
+    pixman_region_init(&pDamage->damage);
+}
+
+DevPrivateKey
+fbGetScreenPrivateKey(void)
+{
+    abort();
+}
+
+RegionPtr
+RegionFromRects(int nrects, xRectangle *prect, int ctype)
+{
+    abort();
+}
+
+void
+RegionDestroy(RegionPtr pRegion)
+{
+    abort();
+}
+
+Bool
+SetNotifyFd(int fd, NotifyFdProcPtr notify_fd, int mask, void *data)
+{
+    return TRUE;
+}
+
+CARD64
+GetTimeInMicros(void)
+{
+    return 0;
+}
+
+static Bool failAlloc;
+
+static PixmapPtr
+testCreatePixmap(ScreenPtr pScreen, int width, int height, int depth,
+                 unsigned usage_hint)
+{
+    PixmapPtr pPixmap;
+
+    if (failAlloc)
+        return NULL;
+    pPixmap = calloc(1, sizeof(PixmapRec) + width * height * sizeof(CARD32));
+    assert(pPixmap);
+    pPixmap->drawable.type = DRAWABLE_PIXMAP;
+    pPixmap->drawable.width = width;
+    pPixmap->drawable.height = height;
+    pPixmap->drawable.depth = depth;
+    pPixmap->drawable.bitsPerPixel = 32;
+    pPixmap->devKind = width * sizeof(CARD32);
+    pPixmap->devPrivate.ptr = pPixmap + 1;
+    return pPixmap;
+}
+
+int
+dixDestroyPixmap(void *pPixmap, XID unused)
+{
+    free(pPixmap);
+    return 0;
+}
+
+/* the update proc notes what it saw and waits for the gate to open */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static Bool gateOpen;
+static PixmapPtr seenPixmap;
+static CARD32 seenPixel;
+static int updates;
+
+static void
+testUpdate(ScreenPtr pScreen, shadowBufPtr pBuf)
+{
+    pthread_mutex_lock(&lock);
+    seenPixmap = pBuf->pPixmap;
+    seenPixel = *(CARD32 *) pBuf->pPixmap->devPrivate.ptr;
+    updates++;
+    while (!gateOpen)
+        pthread_cond_wait(&cond, &lock);
+    pthread_mutex_unlock(&lock);
+}
+
+static void
+setGate(Bool open)
+{
+    pthread_mutex_lock(&lock);
+    gateOpen = open;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&lock);
+}
+
+int
+main(int argc, char **argv)
+{
+    ScreenRec screen = { 0 };
+    DamageRec damage = { 0 };
+    shadowBufRec buf = { 0 };
+    void *privates = &buf;
+    PixmapPtr pShadow;
+    CARD32 *bits;
+    shadowFlushStatsRec stats;
+
+    shadowScrPrivateKeyRec.initialized = TRUE;
+    screen.devPrivates = (PrivatePtr) &privates;
+    screen.CreatePixmap = testCreatePixmap;
+    pShadow = testCreatePixmap(&screen, WIDTH, HEIGHT, 24, 0);
+    bits = pShadow->devPrivate.ptr;
+    buf.pDamage = &damage;
+    buf.pPixmap = pShadow;
+    buf.update = testUpdate;
+    pixman_region_init(&damage.damage);
+
+    assert(shadowSetAsync(&screen, TRUE));
+
+    /* drawing during a flush does not show up in the frame being flushed */
+    bits[0] = 1;
+    pixman_region_init_rect(&damage.damage, 0, 0, WIDTH, HEIGHT);
+    shadowThreadQueue(&screen, &buf);
+    assert(!RegionNotEmpty(&damage.damage));
+    bits[0] = 2;
+    pixman_region_init_rect(&damage.damage, 0, 0, 1, 1);
+
+    /* while the thread is busy, damage stays where it is */
+    shadowThreadQueue(&screen, &buf);
+    assert(RegionNotEmpty(&damage.damage));
+
+    setGate(TRUE);
+    shadowFlushWait(&screen);
+    assert(updates == 1);
+    assert(seenPixmap != pShadow);
+    assert(seenPixel == 1);
+    shadowGetFlushStats(&screen, &stats);
+    assert(stats.frames == 1);
+    assert(stats.skipped == 1);
+
+    /* the deferred damage goes out with the next flush */
+    shadowThreadQueue(&screen, &buf);
+    shadowFlushWait(&screen);
+    assert(updates == 2);
+    assert(seenPixel == 2);
+
+    /* without memory for the copy the update runs right here, and counts */
+    failAlloc = TRUE;
+    pShadow->drawable.width = WIDTH / 2;
+    bits[0] = 3;
+    pixman_region_init_rect(&damage.damage, 0, 0, 1, 1);
+    shadowThreadQueue(&screen, &buf);
+    assert(updates == 3);
+    assert(seenPixmap == pShadow);
+    assert(seenPixel == 3);
+    shadowGetFlushStats(&screen, &stats);
+    assert(stats.frames == 3);
+
+    assert(shadowSetAsync(&screen, FALSE));
+    pixman_region_fini(&damage.damage);
+    free(pShadow);
+    return 0;
+}
@@ -0,0 +1,175 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Check that the shadow tile tracker drops damaged tiles whose contents
+ * did not change, and keeps those that did.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <dix-config.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "scrnintstr.h"
+#include "shadow.h"
+#include "shadow_priv.h"
+#include "fb.h"
+
+#define WIDTH   128
+#define HEIGHT  80              /* the last row of tiles is cut short */
+#define TILE    32
+
+/*
+ * The tile tracker only needs the damage region and the pixmap bits, so
+ * stand in for the pieces of the server it would otherwise drag in.
+ */
+DevPrivateKeyRec shadowScrPrivateKeyRec;
+
+RegionPtr
+DamageRegion(DamagePtr pDamage)
+{
+    return &pDamage->damage;
+}
+
+DevPrivateKey
+fbGetScreenPrivateKey(void)
+{
+    abort();
+}
+
+void
+shadowFlushWait(ScreenPtr pScreen)
+{
+}
+
+RegionPtr
+RegionFromRects(int nrects, xRectangle *prect, int ctype)
+{
+    RegionPtr pRegion = malloc(sizeof(RegionRec));
+    int i;
+
+    assert(pRegion);
+    pixman_region_init(pRegion);
+    for (i = 0; i < nrects; i++)
+        pixman_region_union_rect(pRegion, pRegion, prect[i].x, prect[i].y,
+                                 prect[i].width, prect[i].height);
+    return pRegion;
+}
+
+void
+RegionDestroy(RegionPtr pRegion)
+{
+    pixman_region_fini(pRegion);
+    free(pRegion);
+}
+
+static void
+damage_all(DamagePtr pDamage)
+{
+    pixman_region_fini(&pDamage->damage);
+    pixman_region_init_rect(&pDamage->damage, 0, 0, WIDTH, HEIGHT);
+}
+
+static int
+count_tiles(shadowBufPtr pBuf, BoxPtr pLast)
+{
+    int tile = 0, n = 0;
+
+    while (shadowTilesNext(pBuf, &tile, pLast))
+        n++;
+    return n;
+}
+
+int
+main(int argc, char **argv)
+{
+    ScreenRec screen = { 0 };
+    PixmapRec pixmap = { 0 };
+    DamageRec damage = { 0 };
+    shadowBufRec buf = { 0 };
+    void *privates = &buf;
+    int stride = WIDTH * sizeof(CARD32);
+    CARD32 *bits = malloc(stride * HEIGHT);
+    RegionPtr pRegion = &damage.damage;
+    shadowTileStatsRec stats;
+    BoxRec box;
+    int i;
+
+    assert(bits);
+    for (i = 0; i < WIDTH * HEIGHT; i++)
+        bits[i] = i * 2654435761U;
+
+    shadowScrPrivateKeyRec.initialized = TRUE;
+    screen.devPrivates = (PrivatePtr) &privates;
+    pixmap.drawable.type = DRAWABLE_PIXMAP;
+    pixmap.drawable.width = WIDTH;
+    pixmap.drawable.height = HEIGHT;
+    pixmap.drawable.depth = 24;
+    pixmap.drawable.bitsPerPixel = 32;
+    pixmap.devKind = stride;
+    pixmap.devPrivate.ptr = bits;
+    buf.pDamage = &damage;
+    buf.pPixmap = &pixmap;
+    pixman_region_init(pRegion);
+
+    assert(shadowTilesEnable(&screen, TILE));
+
+    /* everything is new at the first update */
+    damage_all(&damage);
+    assert(shadowTilesFilter(&screen, &buf));
+    assert(count_tiles(&buf, &box) == (WIDTH / TILE) * 3);
+    assert(RegionNumRects(pRegion) == 1);
+    assert(RegionExtents(pRegion)->x2 == WIDTH &&
+           RegionExtents(pRegion)->y2 == HEIGHT);
+    shadowTilesClear(&buf);
+
+    /* drawing the same pixels again leaves nothing to update */
+    damage_all(&damage);
+    assert(!shadowTilesFilter(&screen, &buf));
+    assert(count_tiles(&buf, &box) == 0);
+    shadowTilesClear(&buf);
+
+    /* one pixel in the short last row of tiles */
+    bits[(HEIGHT - 1) * WIDTH + 2 * TILE + 5] ^= 1;
+    damage_all(&damage);
+    assert(shadowTilesFilter(&screen, &buf));
+    assert(count_tiles(&buf, &box) == 1);
+    assert(box.x1 == 2 * TILE && box.x2 == 3 * TILE);
+    assert(box.y1 == 2 * TILE && box.y2 == HEIGHT);
+    assert(RegionNumRects(pRegion) == 1);
+    assert(RegionExtents(pRegion)->x1 == box.x1 &&
+           RegionExtents(pRegion)->y1 == box.y1 &&
+           RegionExtents(pRegion)->x2 == box.x2 &&
+           RegionExtents(pRegion)->y2 == box.y2);
+    shadowTilesClear(&buf);
+
+    /* damage outside the changed tile does not bring it back */
+    bits[5] ^= 1;
+    pixman_region_fini(pRegion);
+    pixman_region_init_rect(pRegion, TILE, 0, TILE, TILE);
+    assert(!shadowTilesFilter(&screen, &buf));
+    shadowTilesClear(&buf);
+
+    /* the change shows up once its own tile is damaged */
+    pixman_region_fini(pRegion);
+    pixman_region_init_rect(pRegion, 0, 0, 1, 1);
+    assert(shadowTilesFilter(&screen, &buf));
+    assert(count_tiles(&buf, &box) == 1);
+    assert(box.x1 == 0 && box.y1 == 0 && box.x2 == TILE && box.y2 == TILE);
+    shadowTilesClear(&buf);
+
+    shadowTilesGetStats(&screen, &stats);
+    assert(stats.tilesDamaged == 3 * (WIDTH / TILE) * 3 + 2);
+    assert(stats.tilesChanged == (WIDTH / TILE) * 3 + 2);
+    assert(stats.bytesChanged ==
+           (uint64_t) stride * HEIGHT + (HEIGHT - 2 * TILE + TILE) * TILE * 4);
+
+    shadowTilesDisable(&screen);
+    pixman_region_fini(pRegion);
+    free(bits);
+    return 0;
+}
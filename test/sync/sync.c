@@ -25,6 +25,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <unistd.h>
+#include <xcb/xcbext.h>
 #include <xcb/sync.h>
 
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
@@ -285,6 +287,113 @@ test_change_alarm_delta(xcb_connection_t *c)
     }
 }
 
+/* Sets up many transition alarms on one counter and checks that moving
+ * the counter notifies exactly the alarms whose values it crossed.
+ */
+static void
+test_alarms_crossed(xcb_connection_t *c)
+{
+    enum { N = 64, UP = 40, DOWN = 10 };
+    const xcb_query_extension_reply_t *ext = xcb_get_extension_data(c, &xcb_sync_id);
+    xcb_sync_counter_t counter = xcb_generate_id(c);
+    xcb_sync_alarm_t alarms[2 * N];
+    int notified[2 * N] = { 0 };
+    xcb_generic_event_t *ev;
+
+    xcb_sync_create_counter(c, counter, sync_value(0));
+
+    /* positive transitions at 1..N, then negative transitions at 1..N */
+    for (int i = 0; i < 2 * N; i++) {
+        int64_t value = i % N + 1;
+        uint32_t test_type = (i < N ? XCB_SYNC_TESTTYPE_POSITIVE_TRANSITION :
+                              XCB_SYNC_TESTTYPE_NEGATIVE_TRANSITION);
+        uint32_t values[] = {
+            counter, XCB_SYNC_VALUETYPE_ABSOLUTE, value >> 32, value,
+            test_type, 0, 0, 1,
+        };
+
+        alarms[i] = xcb_generate_id(c);
+        xcb_sync_create_alarm(c, alarms[i],
+                              XCB_SYNC_CA_COUNTER | XCB_SYNC_CA_VALUE_TYPE |
+                              XCB_SYNC_CA_VALUE | XCB_SYNC_CA_TEST_TYPE |
+                              XCB_SYNC_CA_DELTA | XCB_SYNC_CA_EVENTS, values);
+    }
+
+    xcb_sync_set_counter(c, counter, sync_value(UP));
+    xcb_sync_set_counter(c, counter, sync_value(DOWN));
+    free(xcb_sync_query_counter_reply(c, xcb_sync_query_counter(c, counter), NULL));
+
+    while ((ev = xcb_poll_for_queued_event(c))) {
+        xcb_sync_alarm_notify_event_t *ane = (xcb_sync_alarm_notify_event_t *) ev;
+
+        if ((ev->response_type & 0x7f) == ext->first_event + XCB_SYNC_ALARM_NOTIFY) {
+            for (int i = 0; i < 2 * N; i++)
+                if (alarms[i] == ane->alarm)
+                    notified[i]++;
+        }
+        free(ev);
+    }
+
+    for (int i = 0; i < 2 * N; i++) {
+        int64_t value = i % N + 1;
+        int expected = (i < N ? value <= UP : value >= DOWN && value < UP);
+
+        if (notified[i] != expected) {
+            fprintf(stderr, "%s transition alarm at %lld notified %d times, "
+                    "expected %d\n", i < N ? "Positive" : "Negative",
+                    (long long)value, notified[i], expected);
+            exit(1);
+        }
+        xcb_sync_destroy_alarm(c, alarms[i]);
+    }
+    xcb_sync_destroy_counter(c, counter);
+}
+
+/* Has a second client await several fences at once, and one of them
+ * twice, and checks that it only goes on once all of them were triggered.
+ */
+static void
+test_fence_await(xcb_connection_t *c)
+{
+    enum { N = 4 };
+    xcb_connection_t *waiter = xcb_connect(NULL, NULL);
+    xcb_window_t root = xcb_setup_roots_iterator(xcb_get_setup(c)).data->root;
+    xcb_sync_fence_t fences[N];
+    xcb_get_input_focus_cookie_t cookie;
+    void *reply;
+    xcb_generic_error_t *error;
+
+    for (int i = 0; i < N; i++) {
+        fences[i] = xcb_generate_id(c);
+        xcb_sync_create_fence(c, root, fences[i], 0);
+    }
+    free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL));
+
+    xcb_sync_await_fence(waiter, N, fences);
+    xcb_sync_await_fence(waiter, 1, fences);
+    cookie = xcb_get_input_focus(waiter);
+    xcb_flush(waiter);
+
+    for (int i = N - 1; i > 0; i--)
+        xcb_sync_trigger_fence(c, fences[i]);
+    free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL));
+    usleep(50000);
+
+    if (xcb_poll_for_reply(waiter, cookie.sequence, &reply, &error)) {
+        fprintf(stderr, "Await returned before all fences were triggered\n");
+        exit(1);
+    }
+
+    /* blocks forever if the waiter was left behind */
+    xcb_sync_trigger_fence(c, fences[0]);
+    xcb_flush(c);
+    free(xcb_get_input_focus_reply(waiter, cookie, NULL));
+
+    for (int i = 0; i < N; i++)
+        xcb_sync_destroy_fence(c, fences[i]);
+    xcb_disconnect(waiter);
+}
+
 int main(int argc, char **argv)
 {
     int screen;
@@ -302,6 +411,8 @@ int main(int argc, char **argv)
     test_change_counter_overflow(c);
     test_change_alarm_value(c);
     test_change_alarm_delta(c);
+    test_alarms_crossed(c);
+    test_fence_await(c);
 
     xcb_disconnect(c);
     exit(0);
@@ -0,0 +1,101 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Check that Xvfb -damagering publishes what a client draws.
+ *
+ *   vfb-damage-ring <fbdir>
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <xcb/xcb.h>
+
+#include "hw/vfb/vfbdamage.h"
+
+#define WIN_X   10
+#define WIN_Y   20
+#define WIN_W   30
+#define WIN_H   40
+
+int
+main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen;
+    xcb_window_t w;
+    uint32_t values[] = { 0 };
+    char path[4096];
+    struct stat st;
+    vfbDamageRingPtr ring;
+    uint32_t frame, tail, end, i;
+    int x1 = 65535, y1 = 65535, x2 = 0, y2 = 0;
+    int fd, tries;
+
+    assert(argc == 2);
+    assert(!xcb_connection_has_error(c));
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+
+    snprintf(path, sizeof(path), "%s/Xvfb_screen0.damage", argv[1]);
+    fd = open(path, O_RDONLY);
+    assert(fd >= 0);
+    assert(fstat(fd, &st) == 0);
+    ring = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    assert(ring != MAP_FAILED);
+    assert(__atomic_load_n(&ring->magic, __ATOMIC_ACQUIRE) == VFB_DAMAGE_MAGIC);
+    assert(ring->version == VFB_DAMAGE_VERSION);
+    assert(ring->width == screen->width_in_pixels);
+    assert(ring->height == screen->height_in_pixels);
+
+    frame = __atomic_load_n(&ring->frame, __ATOMIC_ACQUIRE);
+    tail = __atomic_load_n(&ring->committed, __ATOMIC_ACQUIRE);
+
+    values[0] = screen->white_pixel;
+    w = xcb_generate_id(c);
+    xcb_create_window(c, XCB_COPY_FROM_PARENT, w, screen->root,
+                      WIN_X, WIN_Y, WIN_W, WIN_H, 0,
+                      XCB_WINDOW_CLASS_INPUT_OUTPUT, screen->root_visual,
+                      XCB_CW_BACK_PIXEL, values);
+    xcb_map_window(c, w);
+    free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL));
+
+    /* the ring is updated when the server goes idle */
+    for (tries = 0; tries < 500; tries++) {
+        if (__atomic_load_n(&ring->frame, __ATOMIC_ACQUIRE) != frame)
+            break;
+        usleep(10000);
+    }
+    assert(__atomic_load_n(&ring->frame, __ATOMIC_ACQUIRE) != frame);
+
+    end = __atomic_load_n(&ring->committed, __ATOMIC_ACQUIRE);
+    assert(end != tail);
+    for (i = tail; i != end; i++) {
+        vfbDamageRect *r = &ring->rects[i & (ring->nrects - 1)];
+
+        if (r->x < x1) x1 = r->x;
+        if (r->y < y1) y1 = r->y;
+        if (r->x + r->width > x2) x2 = r->x + r->width;
+        if (r->y + r->height > y2) y2 = r->y + r->height;
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    assert(__atomic_load_n(&ring->claimed, __ATOMIC_RELAXED) - tail <=
+           ring->nrects);
+
+    if (x1 > WIN_X || y1 > WIN_Y ||
+        x2 < WIN_X + WIN_W || y2 < WIN_Y + WIN_H) {
+        printf("damage %d,%d %dx%d does not cover the window\n",
+               x1, y1, x2 - x1, y2 - y1);
+        return 1;
+    }
+
+    munmap(ring, st.st_size);
+    close(fd);
+    xcb_disconnect(c);
+    return 0;
+}
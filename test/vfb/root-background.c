@@ -0,0 +1,50 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Check that the root window of a fresh Xvfb is black, whatever the
+ * -blackpixel and -background options say.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <xcb/xcb.h>
+
+#define SIZE    16
+
+int
+main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen;
+    xcb_get_image_reply_t *image;
+    uint32_t *data;
+    int i, ret = 0;
+
+    assert(!xcb_connection_has_error(c));
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    assert(screen->root_depth == 24);
+
+    image = xcb_get_image_reply(c,
+                                xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                              screen->root, 0, 0, SIZE, SIZE,
+                                              ~0),
+                                NULL);
+    assert(image);
+    data = (uint32_t *) xcb_get_image_data(image);
+    for (i = 0; i < SIZE * SIZE; i++) {
+        if ((data[i] & 0xffffff) != screen->black_pixel) {
+            printf("pixel %d,%d is 0x%06x, black is 0x%06x\n",
+                   i % SIZE, i / SIZE, data[i] & 0xffffff,
+                   screen->black_pixel);
+            ret = 1;
+            break;
+        }
+    }
+
+    free(image);
+    xcb_disconnect(c);
+    return ret;
+}
@@ -0,0 +1,178 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Start an X server over and over, and report how long it takes until it
+ * accepts connections and how much memory it uses once it does.
+ *
+ * With -xkbcache among the server arguments, the cache directory is created
+ * private to the user, as the server wants it, and the benchmark fails if
+ * the first run did not leave a compiled keymap there for the others.
+ *
+ *   vfb-startup-bench iterations server [server args...]
+ */
+#include <dirent.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* VmRSS of the process in kB, or -1 without /proc */
+static long
+rss(pid_t pid)
+{
+    char path[64], line[256];
+    long kb = -1;
+    FILE *f;
+
+    snprintf(path, sizeof(path), "/proc/%d/status", (int) pid);
+    f = fopen(path, "r");
+    if (!f)
+        return -1;
+    while (fgets(line, sizeof(line), f))
+        if (sscanf(line, "VmRSS: %ld kB", &kb) == 1)
+            break;
+    fclose(f);
+    return kb;
+}
+
+static int
+start_server(char **server, double *elapsed, long *kb)
+{
+    char buf[16], fdarg[16];
+    int fds[2], status;
+    double start;
+    ssize_t n;
+    pid_t pid;
+
+    if (pipe(fds) < 0)
+        return -1;
+    snprintf(fdarg, sizeof(fdarg), "%d", fds[1]);
+
+    start = now();
+    pid = fork();
+    if (pid < 0)
+        return -1;
+    if (pid == 0) {
+        int argc = 0;
+        char **argv;
+
+        while (server[argc])
+            argc++;
+        argv = calloc(argc + 3, sizeof(*argv));
+        memcpy(argv, server, argc * sizeof(*argv));
+        argv[argc] = "-displayfd";
+        argv[argc + 1] = fdarg;
+        close(fds[0]);
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    close(fds[1]);
+
+    /* the display number shows up once the server is ready */
+    do
+        n = read(fds[0], buf, sizeof(buf));
+    while (n < 0 && errno == EINTR);
+    *elapsed = now() - start;
+    *kb = rss(pid);
+    close(fds[0]);
+
+    kill(pid, SIGTERM);
+    waitpid(pid, &status, 0);
+    return n > 0 ? 0 : -1;
+}
+
+static const char *
+xkb_cache_dir(char **server)
+{
+    for (; *server; server++)
+        if (!strcmp(*server, "-xkbcache") && server[1])
+            return server[1];
+    return NULL;
+}
+
+/* the server ignores a cache others can write to, whatever the umask */
+static int
+xkb_cache_create(const char *dir)
+{
+    if (mkdir(dir, 0700) < 0 && errno != EEXIST)
+        return -1;
+    return chmod(dir, 0700);
+}
+
+static int
+xkb_cache_used(const char *dir)
+{
+    DIR *d = opendir(dir);
+    struct dirent *entry;
+    int found = 0;
+
+    if (!d)
+        return 0;
+    while (!found && (entry = readdir(d)))
+        found = !strncmp(entry->d_name, "cache-", 6) &&
+            strstr(entry->d_name, ".xkm");
+    closedir(d);
+    return found;
+}
+
+int
+main(int argc, char **argv)
+{
+    const char *cache;
+    double total = 0, best = 1e9, elapsed;
+    long kb, kbtotal = 0;
+    int iterations, i;
+
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s iterations server [args...]\n", argv[0]);
+        return 1;
+    }
+    iterations = atoi(argv[1]);
+
+    cache = xkb_cache_dir(argv + 2);
+    if (cache && xkb_cache_create(cache) < 0) {
+        fprintf(stderr, "cannot create %s: %s\n", cache, strerror(errno));
+        return 1;
+    }
+
+    /* the first run fills caches, don't count it */
+    if (start_server(argv + 2, &elapsed, &kb) < 0) {
+        fprintf(stderr, "%s failed to start\n", argv[2]);
+        return 1;
+    }
+    if (cache && !xkb_cache_used(cache)) {
+        fprintf(stderr, "no keymap was cached in %s\n", cache);
+        return 1;
+    }
+
+    for (i = 0; i < iterations; i++) {
+        if (start_server(argv + 2, &elapsed, &kb) < 0) {
+            fprintf(stderr, "%s failed to start\n", argv[2]);
+            return 1;
+        }
+        total += elapsed;
+        if (elapsed < best)
+            best = elapsed;
+        kbtotal += kb;
+    }
+
+    printf("startup: mean %.1f ms, best %.1f ms\n",
+           total / iterations * 1e3, best * 1e3);
+    if (kb >= 0)
+        printf("rss when ready: mean %ld kB\n", kbtotal / iterations);
+    return 0;
+}
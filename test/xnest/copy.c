@@ -0,0 +1,211 @@
+/* SPDX-License-Identifier: MIT OR X11
+ *
+ * Check what Xnest hands back without asking the upstream server each
+ * time: copies which cannot expose anything only get a NoExpose, copies
+ * which can still get the right GraphicsExpose events, repeated
+ * QueryBestSize requests get the same answer, and large images read back
+ * the way they were drawn.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <xcb/xcb.h>
+
+#define SIZE    100             /* the source pixmap */
+#define WIN     200
+#define STRIP   10              /* how far a copy reaches outside of it */
+
+static const uint32_t colors[] = { 0xff0000, 0x00ff00, 0x0000ff, 0xffff00 };
+
+static uint32_t
+pattern(int x, int y)
+{
+    return colors[(x >= SIZE / 2) + 2 * (y >= SIZE / 2)];
+}
+
+static void
+sync_server(xcb_connection_t *c)
+{
+    free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL));
+}
+
+static xcb_pixmap_t
+create_source(xcb_connection_t *c, xcb_screen_t *screen)
+{
+    xcb_pixmap_t pixmap = xcb_generate_id(c);
+    xcb_gcontext_t gc = xcb_generate_id(c);
+    int i;
+
+    xcb_create_pixmap(c, screen->root_depth, pixmap, screen->root,
+                      SIZE, SIZE);
+    xcb_create_gc(c, gc, pixmap, 0, NULL);
+    for (i = 0; i < 4; i++) {
+        xcb_rectangle_t rect = {
+            i % 2 * SIZE / 2, i / 2 * SIZE / 2, SIZE / 2, SIZE / 2
+        };
+
+        xcb_change_gc(c, gc, XCB_GC_FOREGROUND, &colors[i]);
+        xcb_poly_fill_rectangle(c, pixmap, gc, 1, &rect);
+    }
+    xcb_free_gc(c, gc);
+    return pixmap;
+}
+
+/* the events a copy produced, up to and including the last one */
+static int
+copy_events(xcb_connection_t *c, int *no_exposes, int *area, int dstx,
+            int dsty)
+{
+    xcb_generic_event_t *ev;
+    int failed = 0;
+
+    *no_exposes = 0;
+    *area = 0;
+    sync_server(c);
+    while ((ev = xcb_poll_for_event(c))) {
+        switch (ev->response_type & 0x7f) {
+        case XCB_NO_EXPOSURE:
+            (*no_exposes)++;
+            break;
+        case XCB_GRAPHICS_EXPOSURE: {
+            xcb_graphics_exposure_event_t *gev = (void *) ev;
+
+            /* only the part which came from outside the pixmap */
+            if (gev->x < dstx || gev->x + gev->width > dstx + STRIP ||
+                gev->y < dsty || gev->y + gev->height > dsty + SIZE) {
+                printf("GraphicsExpose %d,%d %dx%d outside of the strip\n",
+                       gev->x, gev->y, gev->width, gev->height);
+                failed = 1;
+            }
+            *area += gev->width * gev->height;
+            break;
+        }
+        case 0:
+            printf("error %d\n", ((xcb_generic_error_t *) ev)->error_code);
+            failed = 1;
+            break;
+        }
+        free(ev);
+    }
+    return failed;
+}
+
+static int
+check_image(xcb_connection_t *c, xcb_drawable_t d, int x, int y,
+            int width, int height, int offset)
+{
+    xcb_get_image_reply_t *image;
+    uint32_t *data;
+    int i, j, failed = 0;
+
+    image = xcb_get_image_reply(c,
+                                xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP, d,
+                                              x, y, width, height, ~0),
+                                NULL);
+    assert(image);
+    assert(xcb_get_image_data_length(image) == width * height * 4);
+    data = (uint32_t *) xcb_get_image_data(image);
+    for (j = 0; j < height && !failed; j++) {
+        for (i = 0; i < width; i++) {
+            uint32_t got = data[j * width + i] & 0xffffff;
+            uint32_t expect = pattern(i + offset, j + offset);
+
+            if (got != expect) {
+                printf("pixel %d,%d is 0x%06x, expected 0x%06x\n",
+                       x + i, y + j, got, expect);
+                failed = 1;
+                break;
+            }
+        }
+    }
+    free(image);
+    return failed;
+}
+
+int
+main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen;
+    xcb_pixmap_t source;
+    xcb_window_t w;
+    xcb_gcontext_t gc;
+    xcb_query_best_size_reply_t *best[2];
+    uint32_t values[] = { 0 };
+    int no_exposes, area, i, ret = 0;
+
+    assert(!xcb_connection_has_error(c));
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    assert(screen->root_depth == 24);
+
+    source = create_source(c, screen);
+    w = xcb_generate_id(c);
+    xcb_create_window(c, XCB_COPY_FROM_PARENT, w, screen->root, 0, 0,
+                      WIN, WIN, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                      screen->root_visual, XCB_CW_BACK_PIXEL, values);
+    xcb_map_window(c, w);
+    gc = xcb_generate_id(c);
+    xcb_create_gc(c, gc, w, 0, NULL);   /* graphics exposures on */
+    sync_server(c);
+
+    /* large enough to be read through shared memory where there is some */
+    ret |= check_image(c, source, 0, 0, SIZE, SIZE, 0);
+
+    /* all of it comes from inside the pixmap, nothing to expose */
+    xcb_copy_area(c, source, w, gc, 0, 0, 0, 0, SIZE, SIZE);
+    ret |= copy_events(c, &no_exposes, &area, 0, 0);
+    if (no_exposes != 1 || area) {
+        printf("copy inside: %d NoExpose, %d pixels exposed\n",
+               no_exposes, area);
+        ret = 1;
+    }
+    ret |= check_image(c, w, 0, 0, SIZE, SIZE, 0);
+
+    /* the first columns come from outside of the pixmap */
+    xcb_copy_area(c, source, w, gc, -STRIP, 0, SIZE, 0, SIZE, SIZE);
+    ret |= copy_events(c, &no_exposes, &area, SIZE, 0);
+    if (no_exposes || area != STRIP * SIZE) {
+        printf("copy outside: %d NoExpose, %d pixels exposed\n",
+               no_exposes, area);
+        ret = 1;
+    }
+    ret |= check_image(c, w, SIZE + STRIP, 0, SIZE - STRIP, SIZE, 0);
+
+    /* without graphics exposures there are no events at all */
+    values[0] = 0;
+    xcb_change_gc(c, gc, XCB_GC_GRAPHICS_EXPOSURES, values);
+    xcb_copy_area(c, source, w, gc, -STRIP, 0, 0, SIZE, SIZE, SIZE);
+    xcb_copy_area(c, source, w, gc, 0, 0, 0, SIZE, SIZE, SIZE);
+    ret |= copy_events(c, &no_exposes, &area, 0, SIZE);
+    if (no_exposes || area) {
+        printf("copy without exposures: %d NoExpose, %d pixels exposed\n",
+               no_exposes, area);
+        ret = 1;
+    }
+
+    /* the answer does not change from one request to the next */
+    for (i = 0; i < 2; i++) {
+        best[i] = xcb_query_best_size_reply(c,
+            xcb_query_best_size(c, XCB_QUERY_SHAPE_OF_LARGEST_CURSOR, w,
+                                17, 13),
+            NULL);
+        assert(best[i]);
+    }
+    if (best[0]->width != best[1]->width ||
+        best[0]->height != best[1]->height) {
+        printf("QueryBestSize: %dx%d, then %dx%d\n", best[0]->width,
+               best[0]->height, best[1]->width, best[1]->height);
+        ret = 1;
+    }
+    free(best[0]);
+    free(best[1]);
+
+    xcb_free_gc(c, gc);
+    xcb_free_pixmap(c, source);
+    xcb_disconnect(c);
+    return ret;
+}
@@ -37,10 +37,12 @@ THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include <X11/keysym.h>
 #include <X11/extensions/XI.h>
 #include <X11/extensions/XKM.h>
+#include <sys/stat.h>
 
 #include "dix/dix_priv.h"
 #include "os/log_priv.h"
 #include "os/osdep.h"
+#include "os/xsha1.h"
 #include "xkb/xkbfile_priv.h"
 #include "xkb/xkbfmisc_priv.h"
 #include "xkb/xkbrules_priv.h"
@@ -61,9 +63,68 @@ THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #define PATHSEPARATOR "/"
 #endif
 
+/* compiled keymaps in the -xkbcache directory are named cache-<sha1>.xkm */
+#define XKM_CACHE_PREFIX "cache-"
+
 static unsigned
 LoadXKM(unsigned want, unsigned need, const char *keymap, XkbDescPtr *xkbRtrn);
 
+#ifndef WIN32
+/*
+ * Anything loaded from the cache is trusted as much as xkbcomp's output,
+ * so only use a directory nobody else can write to.
+ */
+static Bool
+XkbCacheUsable(void)
+{
+    static int usable = -1;
+    struct stat st;
+
+    if (usable >= 0)
+        return usable;
+
+    usable = XkbCacheDirectory && XkbCacheDirectory[0] == '/' &&
+        stat(XkbCacheDirectory, &st) == 0 && S_ISDIR(st.st_mode) &&
+        st.st_uid == geteuid() && !(st.st_mode & (S_IWGRP | S_IWOTH)) &&
+        access(XkbCacheDirectory, W_OK | X_OK) == 0;
+    if (XkbCacheDirectory && !usable)
+        LogMessage(X_WARNING, "XKB: Not caching keymaps in %s, it must be "
+                   "an absolute path to a directory only the server's user "
+                   "can write to\n", XkbCacheDirectory);
+    return usable;
+}
+
+/*
+ * Name the keymap after everything that goes into compiling it, so that
+ * servers started with the same configuration find each other's output.
+ */
+static Bool
+XkbCacheName(const char *text, size_t len, char *name, size_t size)
+{
+    const char *dirs[] = { XkbBaseDirectory, XkbBinDirectory };
+    unsigned char sha1[20];
+    void *ctx;
+    size_t n;
+
+    if (len > INT_MAX || !(ctx = x_sha1_init()))
+        return FALSE;
+    for (size_t i = 0; i < ARRAY_SIZE(dirs); i++) {
+        const char *dir = dirs[i] ? dirs[i] : "";
+
+        x_sha1_update(ctx, (void *) dir, strlen(dir) + 1);
+    }
+    x_sha1_update(ctx, (void *) text, len);
+    if (!x_sha1_final(ctx, sha1))
+        return FALSE;
+
+    snprintf(name, size, XKM_CACHE_PREFIX);
+    n = strlen(name);
+    for (size_t j = 0; j < sizeof(sha1) && n + 2 < size; j++, n += 2)
+        snprintf(name + n, size - n, "%02x", sha1[j]);
+    return TRUE;
+}
+#endif
+
 static void
 OutputDirectory(char *outdir, size_t size)
 {
@@ -73,7 +134,9 @@ OutputDirectory(char *outdir, size_t size)
 
 #ifndef WIN32
     /* Can we write an xkm and then open it too? */
-    if (access(XKM_OUTPUT_DIR, W_OK | X_OK) == 0) {
+    if (XkbCacheUsable()) {
+        directory = XkbCacheDirectory;
+    } else if (access(XKM_OUTPUT_DIR, W_OK | X_OK) == 0) {
         directory = XKM_OUTPUT_DIR;
     } else {
         const char *xdg_runtime_dir = getenv("XDG_RUNTIME_DIR");
@@ -128,12 +191,43 @@ RunXkbComp(xkbcomp_buffer_callback callback, void *userdata)
     const char *xkmfile = tmpname;
 #else
     const char *xkmfile = "-";
+    char cached[PATH_MAX] = { 0 };
+    char *text = NULL;
+    size_t textlen = 0;
 #endif
 
     snprintf(keymap, sizeof(keymap), "server-%s", display);
 
     OutputDirectory(xkm_output_dir, sizeof(xkm_output_dir));
 
+#ifndef WIN32
+    if (XkbCacheUsable()) {
+        FILE *mem = open_memstream(&text, &textlen);
+
+        if (mem) {
+            (*callback)(mem, userdata);
+            if (fclose(mem) != 0 ||
+                !XkbCacheName(text, textlen, cached, sizeof(cached))) {
+                free(text);
+                text = NULL;
+            }
+        }
+
+        if (text) {
+            char path[PATH_MAX];
+
+            if ((size_t) snprintf(path, sizeof(path), "%s%s.xkm",
+                                  xkm_output_dir, cached) < sizeof(path) &&
+                access(path, R_OK) == 0) {
+                LogMessageVerb(X_INFO, 4, "XKB: Using cached keymap %s\n",
+                               path);
+                free(text);
+                return strdup(cached);
+            }
+        }
+    }
+#endif
+
 #ifdef WIN32
     strcpy(tmpname, Win32TempDir());
     strcat(tmpname, "\\xkb_XXXXXX");
@@ -172,6 +266,9 @@ RunXkbComp(xkbcomp_buffer_callback callback, void *userdata)
     if (!buf) {
         LogMessage(X_ERROR,
                    "XKB: Could not invoke xkbcomp: not enough memory\n");
+#ifndef WIN32
+        free(text);
+#endif
         return NULL;
     }
 
@@ -183,6 +280,11 @@ RunXkbComp(xkbcomp_buffer_callback callback, void *userdata)
 
     if (out != NULL) {
         /* Now write to xkbcomp */
+#ifndef WIN32
+        if (text)
+            fwrite(text, textlen, 1, out);
+        else
+#endif
         (*callback)(out, userdata);
 
 #ifndef WIN32
@@ -196,6 +298,19 @@ RunXkbComp(xkbcomp_buffer_callback callback, void *userdata)
             free(buf);
 #ifdef WIN32
             unlink(tmpname);
+#else
+            if (text) {
+                char from[PATH_MAX], to[PATH_MAX];
+
+                free(text);
+                /* atomically, other servers may be looking for it */
+                if ((size_t) snprintf(from, sizeof(from), "%s%s.xkm",
+                                      xkm_output_dir, keymap) < sizeof(from) &&
+                    (size_t) snprintf(to, sizeof(to), "%s%s.xkm",
+                                      xkm_output_dir, cached) < sizeof(to) &&
+                    rename(from, to) == 0)
+                    return strdup(cached);
+            }
 #endif
             return strdup(keymap);
         }
@@ -215,6 +330,9 @@ RunXkbComp(xkbcomp_buffer_callback callback, void *userdata)
         LogMessage(X_ERROR, "Could not open file %s\n", tmpname);
 #endif
     }
+#ifndef WIN32
+    free(text);
+#endif
     free(buf);
     return NULL;
 }
@@ -370,7 +488,9 @@ LoadXKM(unsigned want, unsigned need, const char *keymap, XkbDescPtr *xkbRtrn)
                (*xkbRtrn)->defined);
     }
     fclose(file);
-    (void) unlink(fileName);
+    /* cached keymaps are there for the next server */
+    if (strncmp(keymap, XKM_CACHE_PREFIX, strlen(XKM_CACHE_PREFIX)) != 0)
+        (void) unlink(fileName);
     return (need | want) & (~missing);
 }
 
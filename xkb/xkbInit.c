@@ -83,6 +83,7 @@ THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 const char *XkbBaseDirectory = XKB_BASE_DIRECTORY;
 const char *XkbBinDirectory = XKB_BIN_DIRECTORY;
+const char *XkbCacheDirectory = NULL;
 static int XkbWantAccessX = 0;
 
 static char *XkbRulesDflt = NULL;
@@ -763,6 +764,19 @@ XkbProcessArguments(int argc, char *argv[], int i)
             return -1;
         }
     }
+    else if (strcmp(argv[i], "-xkbcache") == 0) {
+        if (++i >= argc)
+            return -1;
+#if !defined(WIN32) && !defined(__CYGWIN__)
+        if (getuid() != geteuid()) {
+            LogMessage(X_WARNING,
+                       "-xkbcache is not available for setuid X servers\n");
+            return -1;
+        }
+#endif
+        XkbCacheDirectory = argv[i];
+        return 2;
+    }
     else if ((strncmp(argv[i], "-accessx", 8) == 0) ||
              (strncmp(argv[i], "+accessx", 8) == 0)) {
         int j = 1;
@@ -827,4 +841,5 @@ XkbUseMsg(void)
     ErrorF("                       enable/disable accessx key sequences\n");
     ErrorF("-ardelay               set XKB autorepeat delay\n");
     ErrorF("-arinterval            set XKB autorepeat interval\n");
+    ErrorF("-xkbcache dir          share compiled keymaps through dir\n");
 }
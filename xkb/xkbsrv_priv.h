@@ -189,6 +189,7 @@ extern int XkbEventBase;
 extern int XkbKeyboardErrorCode;
 extern const char *XkbBaseDirectory;
 extern const char *XkbBinDirectory;
+extern const char *XkbCacheDirectory;
 extern CARD32 xkbDebugFlags;
 
 /* AccessX functions */